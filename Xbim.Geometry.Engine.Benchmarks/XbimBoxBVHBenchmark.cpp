@@ -0,0 +1,194 @@
+// Benchmark for BOPCol_BoxBVH against the unbalanced tree of boxes BOPDS_Iterator finds overlapping sub-shapes with
+// The OCC sources build with the Visual C++ compiler, with the TKernel and TKMath packages the trees use, e.g. from this folder
+//   set OCC=..\Xbim.Geometry.Engine\OCC
+//   cl /O2 /EHsc /DWNT /DHAVE_NO_DLL /I%OCC%\inc /I%OCC%\drv\Standard /I%OCC%\drv\MMgt /I%OCC%\drv\OSD /I%OCC%\drv\Quantity
+//      /I%OCC%\drv\TCollection /I%OCC%\drv\gp /I%OCC%\drv\Bnd XbimBoxBVHBenchmark.cpp %OCC%\src\Standard\*.cxx %OCC%\src\MMgt\*.cxx
+//      %OCC%\src\OSD\*.cxx %OCC%\src\Quantity\*.cxx %OCC%\src\TCollection\*.cxx %OCC%\src\NCollection\*.cxx %OCC%\src\gp\*.cxx
+//      %OCC%\src\Bnd\Bnd_Box.cxx %OCC%\src\BOPCol\BOPCol_BoxBndTree.cxx %OCC%\src\BOPCol\BOPCol_BoxBVH.cxx
+// Usage: XbimBoxBVHBenchmark [elements] [repeats]
+// Makes the boxes of the sub-shapes of 2000 elements by default, as BOPDS_DS has them for a boolean of a storey, the solid, faces,
+// edges and vertices of walls that are long and thin, some of them diagonal, of slabs and of the openings cut from them. Finds each
+// pair of overlapping boxes with the unbalanced tree, filled and then queried with every box as BOPDS_Iterator does, serially and
+// with the queries run concurrently, and with the hierarchy, built and searched for its pairs serially and concurrently. Reports
+// the time of each, the pairs found by each must be the same
+#include <BOPCol_BoxBndTree.hxx>
+#include <BOPCol_BoxBVH.hxx>
+#include <NCollection_UBTreeFiller.hxx>
+#include <OSD_Parallel.hxx>
+#include <Bnd_Box.hxx>
+#include <gp_Pnt.hxx>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+typedef std::vector<std::pair<int, int> > Pairs;
+
+static double Random(double from, double to)
+{
+	return from + (to - from) * (rand() / (double)RAND_MAX);
+}
+
+//adds the boxes of the solid, the faces, edges and vertices of the element spanning from p to q, of the width and height
+static void AddElement(std::vector<Bnd_Box>& boxes, const double p[3], const double q[3], double width, double height)
+{
+	double d[2] = { q[0] - p[0], q[1] - p[1] };
+	double length = sqrt(d[0] * d[0] + d[1] * d[1]);
+	double n[2] = { -d[1] / length * width / 2, d[0] / length * width / 2 };
+	double corners[8][3];
+	for (int i = 0; i < 8; i++)
+	{
+		const double* end = (i & 1) ? q : p;
+		double side = (i & 2) ? 1 : -1;
+		corners[i][0] = end[0] + side * n[0];
+		corners[i][1] = end[1] + side * n[1];
+		corners[i][2] = end[2] + ((i & 4) ? height : 0);
+	}
+	const int faces[6][4] = { { 0, 1, 3, 2 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 3, 7, 5 } };
+	const int edges[12][2] = { { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 }, { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 }, { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 } };
+	Bnd_Box solid;
+	for (int i = 0; i < 8; i++) solid.Add(gp_Pnt(corners[i][0], corners[i][1], corners[i][2]));
+	boxes.push_back(solid);
+	for (int f = 0; f < 6; f++)
+	{
+		Bnd_Box face;
+		for (int k = 0; k < 4; k++) face.Add(gp_Pnt(corners[faces[f][k]][0], corners[faces[f][k]][1], corners[faces[f][k]][2]));
+		boxes.push_back(face);
+	}
+	for (int e = 0; e < 12; e++)
+	{
+		Bnd_Box edge;
+		for (int k = 0; k < 2; k++) edge.Add(gp_Pnt(corners[edges[e][k]][0], corners[edges[e][k]][1], corners[edges[e][k]][2]));
+		boxes.push_back(edge);
+	}
+	for (int v = 0; v < 8; v++)
+	{
+		Bnd_Box vertex;
+		vertex.Add(gp_Pnt(corners[v][0], corners[v][1], corners[v][2]));
+		boxes.push_back(vertex);
+	}
+}
+
+static void MakeStorey(std::vector<Bnd_Box>& boxes, int elements)
+{
+	double size = sqrt((double)elements) * 4;
+	for (int e = 0; e < elements; e++)
+	{
+		double p[3] = { Random(0, size), Random(0, size), 0 };
+		double q[3] = { p[0], p[1], 0 };
+		int kind = e % 10;
+		if (kind < 5) //a wall along an axis
+		{
+			q[(e / 10) % 2] += Random(3, 20);
+			AddElement(boxes, p, q, 0.2, 3);
+		}
+		else if (kind < 7) //a diagonal wall, whose box is large and mostly empty
+		{
+			double angle = Random(0.2, 1.4);
+			double length = Random(3, 20);
+			q[0] += length * cos(angle);
+			q[1] += length * sin(angle);
+			AddElement(boxes, p, q, 0.2, 3);
+		}
+		else if (kind < 8) //a slab
+		{
+			q[0] += Random(5, 15);
+			AddElement(boxes, p, q, Random(5, 15), 0.25);
+		}
+		else //an opening
+		{
+			p[2] = q[2] = Random(0, 1);
+			q[e % 2] += Random(0.8, 2);
+			AddElement(boxes, p, q, 0.4, 2.1);
+		}
+	}
+	for (size_t i = 0; i < boxes.size(); i++) boxes[i].SetGap(1e-7);
+}
+
+struct SelectBox
+{
+	BOPCol_BoxBndTree* Tree;
+	const std::vector<Bnd_Box>* Boxes;
+	std::vector<Pairs>* Found;
+	void operator()(const Standard_Integer i) const
+	{
+		BOPCol_BoxBndTreeSelector selector;
+		selector.SetBox((*Boxes)[i]);
+		Tree->Select(selector);
+		for (BOPCol_ListIteratorOfListOfInteger it(selector.Indices()); it.More(); it.Next())
+			if (it.Value() > i) (*Found)[i].push_back(std::make_pair(i, it.Value()));
+	}
+};
+
+static Pairs UBTree(const std::vector<Bnd_Box>& boxes, bool parallel)
+{
+	BOPCol_BoxBndTree tree;
+	NCollection_UBTreeFiller<Standard_Integer, Bnd_Box> filler(tree);
+	for (size_t i = 0; i < boxes.size(); i++) filler.Add((Standard_Integer)i, boxes[i]);
+	filler.Fill();
+	std::vector<Pairs> found(boxes.size());
+	SelectBox select = { &tree, &boxes, &found };
+	OSD_Parallel::For(0, (Standard_Integer)boxes.size(), select, !parallel);
+	Pairs pairs;
+	for (size_t i = 0; i < found.size(); i++) pairs.insert(pairs.end(), found[i].begin(), found[i].end());
+	return pairs;
+}
+
+static Pairs Hierarchy(const std::vector<Bnd_Box>& boxes, bool parallel)
+{
+	BOPCol_BoxBVH bvh;
+	for (size_t i = 0; i < boxes.size(); i++) bvh.Add((Standard_Integer)i, boxes[i]);
+	bvh.Build(parallel);
+	Pairs pairs;
+	bvh.SelectPairs(parallel, pairs);
+	return pairs;
+}
+
+//best time in ms of the search, pairs is set to the sorted pairs found
+static double Time(Pairs(*search)(const std::vector<Bnd_Box>&, bool), const std::vector<Bnd_Box>& boxes, bool parallel, int repeats, Pairs& pairs)
+{
+	double best = 1e300;
+	for (int r = 0; r < repeats; r++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		pairs = search(boxes, parallel);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (ms < best) best = ms;
+	}
+	std::sort(pairs.begin(), pairs.end());
+	return best;
+}
+
+int main(int argc, char* argv[])
+{
+	int elements = argc > 1 ? atoi(argv[1]) : 2000;
+	int repeats = argc > 2 ? atoi(argv[2]) : 3;
+	srand(1);
+	std::vector<Bnd_Box> boxes;
+	MakeStorey(boxes, elements);
+	printf("%d logical processors, %d elements, %zu boxes, best of %d\n", OSD_Parallel::NbLogicalProcessors(), elements, boxes.size(), repeats);
+	Pairs results[4];
+	double ms[4];
+	ms[0] = Time(UBTree, boxes, false, repeats, results[0]);
+	ms[1] = Time(UBTree, boxes, true, repeats, results[1]);
+	ms[2] = Time(Hierarchy, boxes, false, repeats, results[2]);
+	ms[3] = Time(Hierarchy, boxes, true, repeats, results[3]);
+	const char* names[] = { "unbalanced tree, serial        ", "unbalanced tree, parallel query", "hierarchy, serial              ",
+		"hierarchy, parallel            " };
+	bool match = true;
+	for (int i = 0; i < 4; i++)
+	{
+		printf("  %s %10.2f ms %10zu pairs, x%.2f of the serial unbalanced tree\n", names[i], ms[i], results[i].size(), ms[0] / ms[i]);
+		match = match && results[i] == results[0];
+	}
+	if (!match)
+	{
+		printf("ERROR: the pairs differ\n");
+		return 1;
+	}
+	printf("pairs match\n");
+	return 0;
+}
@@ -0,0 +1,101 @@
+// Micro-benchmark for Xbim::Geometry::XbimBoxClusterer
+// Builds on any platform with a C++11 compiler, e.g. from this folder
+//   g++ -O2 -std=c++11 -I../Xbim.Geometry.Engine XbimBoxClustererBenchmark.cpp ../Xbim.Geometry.Engine/XbimBoxClusterer.cpp -o XbimBoxClustererBenchmark
+// Usage: XbimBoxClustererBenchmark [grid size] [touching percentage]
+// Lays out a grid of grid size * grid size boxes, 100 * 100 = 10k by default, a percentage of them are stretched to touch their
+// neighbour so that chains of boxes form clusters. The boxes are clustered by testing every box against every other and
+// collecting the connected ones recursively, as XbimCompound::Merge did, and with XbimBoxClusterer, the groupings must match
+
+#include "XbimBoxClusterer.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using Xbim::Geometry::XbimBoxClusterer;
+
+struct Box
+{
+	double min[3], max[3];
+	bool Intersects(const Box& o) const
+	{
+		for (int axis = 0; axis < 3; axis++)
+			if (o.min[axis] > max[axis] || o.max[axis] < min[axis]) return false;
+		return true;
+	}
+};
+
+static void Connect(size_t box, const std::vector<std::vector<size_t>>& overlaps, std::vector<size_t>& clusters, size_t cluster)
+{
+	std::vector<size_t> stack(1, box);
+	clusters[box] = cluster;
+	while (!stack.empty())
+	{
+		size_t current = stack.back();
+		stack.pop_back();
+		for (size_t i = 0; i < overlaps[current].size(); i++)
+		{
+			size_t other = overlaps[current][i];
+			if (clusters[other] != (size_t)-1) continue;
+			clusters[other] = cluster;
+			stack.push_back(other);
+		}
+	}
+}
+
+//the old approach, every box against every other, then the connected boxes of each unvisited box
+static size_t ClusterAllPairs(const std::vector<Box>& boxes, std::vector<size_t>& clusters)
+{
+	std::vector<std::vector<size_t>> overlaps(boxes.size());
+	for (size_t i = 0; i < boxes.size(); i++)
+		for (size_t j = 0; j < boxes.size(); j++)
+			if (i != j && boxes[i].Intersects(boxes[j])) overlaps[i].push_back(j);
+	clusters.assign(boxes.size(), (size_t)-1);
+	size_t clusterCount = 0;
+	for (size_t i = 0; i < boxes.size(); i++)
+		if (clusters[i] == (size_t)-1) Connect(i, overlaps, clusters, clusterCount++);
+	return clusterCount;
+}
+
+static size_t ClusterSweep(const std::vector<Box>& boxes, std::vector<size_t>& clusters)
+{
+	XbimBoxClusterer clusterer;
+	for (size_t i = 0; i < boxes.size(); i++)
+		clusterer.Add(boxes[i].min[0], boxes[i].min[1], boxes[i].min[2], boxes[i].max[0], boxes[i].max[1], boxes[i].max[2]);
+	return clusterer.Cluster(clusters);
+}
+
+int main(int argc, char* argv[])
+{
+	int gridSize = argc > 1 ? atoi(argv[1]) : 100;
+	int touching = argc > 2 ? atoi(argv[2]) : 30;
+	std::srand(1);
+	std::vector<Box> boxes;
+	boxes.reserve((size_t)gridSize * gridSize);
+	for (int i = 0; i < gridSize; i++)
+	{
+		for (int j = 0; j < gridSize; j++)
+		{
+			Box box;
+			box.min[0] = i * 2.0; box.min[1] = j * 2.0; box.min[2] = 0;
+			box.max[0] = box.min[0] + 1; box.max[1] = box.min[1] + 1; box.max[2] = 3;
+			if (std::rand() % 100 < touching) box.max[std::rand() % 2] += 1; //reaches the next box along x or y
+			boxes.push_back(box);
+		}
+	}
+
+	std::vector<size_t> allPairs, sweep;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	size_t allPairsCount = ClusterAllPairs(boxes, allPairs);
+	double allPairsMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	start = std::chrono::high_resolution_clock::now();
+	size_t sweepCount = ClusterSweep(boxes, sweep);
+	double sweepMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	bool same = allPairsCount == sweepCount && allPairs == sweep;
+	std::printf("%zu boxes, %zu clusters\n", boxes.size(), sweepCount);
+	std::printf("all pairs: %10.2f ms\n", allPairsMs);
+	std::printf("sweep:     %10.2f ms (%.1fx)\n", sweepMs, allPairsMs / sweepMs);
+	std::printf("groupings %s\n", same ? "match" : "DIFFER");
+	return same ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+// Micro-benchmark for carve::mesh::Arena
+// The Carve sources build with the Visual C++ compiler, e.g. from this folder
+//   cl /O2 /EHsc /I..\Xbim.Geometry.Engine\CarveCsg\include XbimCarveArenaBenchmark.cpp ..\Xbim.Geometry.Engine\CarveCsg\lib\*.cpp
+// Usage: XbimCarveArenaBenchmark [resolution] [repeats]
+// Subtracts one tessellated sphere from another that overlaps it, 2 * resolution * (resolution - 1) triangles each, 100 by default,
+// about 20k faces, with the edges, faces and meshes on the heap and then taken from an arena, counting the calls to the
+// global operator new and the time taken. The results must match
+
+#include <carve/csg.hpp>
+#include <carve/arena.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+typedef carve::mesh::MeshSet<3> meshset_t;
+
+static size_t heapAllocations = 0;
+
+void* operator new(size_t size)
+{
+	heapAllocations++;
+	void* p = malloc(size == 0 ? 1 : size);
+	if (p == 0) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p)
+{
+	free(p);
+}
+
+static meshset_t* Sphere(double cx, double cy, double cz, double r, int n)
+{
+	const double pi = 3.14159265358979323846;
+	int rings = n, segments = 2 * n;
+	std::vector<carve::geom3d::Vector> points;
+	std::vector<int> indices;
+	size_t faces = 0;
+	points.push_back(carve::geom::VECTOR(cx, cy, cz + r));
+	for (int i = 1; i < rings; i++)
+		for (int j = 0; j < segments; j++)
+		{
+			double theta = pi * i / rings, phi = 2 * pi * j / segments + 0.1234; //turned so the spheres do not share seams
+			points.push_back(carve::geom::VECTOR(cx + r * sin(theta) * cos(phi), cy + r * sin(theta) * sin(phi), cz + r * cos(theta)));
+		}
+	points.push_back(carve::geom::VECTOR(cx, cy, cz - r));
+	int south = (int)points.size() - 1;
+	for (int i = 0; i < rings; i++)
+		for (int j = 0; j < segments; j++)
+		{
+			int a = 1 + (i - 1) * segments + j, b = 1 + (i - 1) * segments + (j + 1) % segments;
+			int c = a + segments, d = b + segments;
+			if (i == 0) { int t[] = { 3, 0, c, d }; indices.insert(indices.end(), t, t + 4); faces++; }
+			else if (i == rings - 1) { int t[] = { 3, south, b, a }; indices.insert(indices.end(), t, t + 4); faces++; }
+			else
+			{
+				int t[] = { 3, a, c, d, 3, a, d, b };
+				indices.insert(indices.end(), t, t + 8);
+				faces += 2;
+			}
+		}
+	return new meshset_t(points, faces, indices);
+}
+
+static std::string Describe(const meshset_t* mesh)
+{
+	std::ostringstream text;
+	text.precision(17);
+	for (size_t i = 0; i < mesh->vertex_storage.size(); i++)
+		text << mesh->vertex_storage[i].v.x << ' ' << mesh->vertex_storage[i].v.y << ' ' << mesh->vertex_storage[i].v.z << '\n';
+	for (meshset_t::const_face_iter f = mesh->faceBegin(); f != mesh->faceEnd(); ++f)
+	{
+		const meshset_t::edge_t* e = (*f)->edge;
+		do
+		{
+			text << (e->vert - &mesh->vertex_storage[0]) << ' ';
+			e = e->next;
+		} while (e != (*f)->edge);
+		text << '\n';
+	}
+	return text.str();
+}
+
+static double Subtract(int resolution, bool pooled, size_t& allocations, std::string& result)
+{
+	meshset_t* a = Sphere(0, 0, 0, 1, resolution);
+	meshset_t* b = Sphere(0.5, 0.3, 0.2, 0.8, resolution);
+	size_t before = heapAllocations;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	carve::mesh::Arena::Scope* arena = pooled ? new carve::mesh::Arena::Scope() : 0;
+	meshset_t* difference = carve::csg::CSG(1e-6).compute(a, b, carve::csg::CSG::A_MINUS_B, NULL, carve::csg::CSG::CLASSIFY_NORMAL);
+	delete arena;
+	std::chrono::steady_clock::duration computed = std::chrono::steady_clock::now() - start;
+	size_t computeAllocations = heapAllocations - before;
+	result = Describe(difference);
+	start = std::chrono::steady_clock::now();
+	delete difference; //the arena is released here
+	std::chrono::steady_clock::duration released = std::chrono::steady_clock::now() - start;
+	allocations = computeAllocations;
+	delete a;
+	delete b;
+	return std::chrono::duration<double, std::milli>(computed + released).count();
+}
+
+int main(int argc, char* argv[])
+{
+	int resolution = argc > 1 ? atoi(argv[1]) : 100;
+	int repeats = argc > 2 ? atoi(argv[2]) : 5;
+	printf("A_MINUS_B of two spheres of %d faces each, best of %d\n", 2 * resolution * (resolution - 1), repeats);
+	double best[2] = { 1e300, 1e300 };
+	size_t allocations[2] = { 0, 0 };
+	std::string results[2];
+	for (int r = 0; r < repeats; r++)
+		for (int pooled = 0; pooled < 2; pooled++)
+		{
+			double ms = Subtract(resolution, pooled != 0, allocations[pooled], results[pooled]);
+			if (ms < best[pooled]) best[pooled] = ms;
+		}
+	printf("  heap  %10.1f ms %12zu operator new calls\n", best[0], allocations[0]);
+	printf("  arena %10.1f ms %12zu operator new calls\n", best[1], allocations[1]);
+	printf("  speedup x%.2f, %.1f%% fewer allocations\n", best[0] / best[1], 100.0 * (1.0 - (double)allocations[1] / allocations[0]));
+	if (results[0] != results[1])
+	{
+		printf("ERROR: the results differ\n");
+		return 1;
+	}
+	printf("results match\n");
+	return 0;
+}
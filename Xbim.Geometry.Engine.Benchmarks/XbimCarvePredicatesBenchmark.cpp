@@ -0,0 +1,138 @@
+// Benchmark for the exact predicates of carve::csg::CSG
+// The Carve sources build with the Visual C++ compiler, e.g. from this folder
+//   cl /O2 /EHsc /I..\Xbim.Geometry.Engine\CarveCsg\include XbimCarvePredicatesBenchmark.cpp ..\Xbim.Geometry.Engine\CarveCsg\lib\*.cpp
+// Usage: XbimCarvePredicatesBenchmark [resolution] [repeats]
+// Times the subtraction of one tessellated sphere from another that overlaps it, 2 * resolution * (resolution - 1) triangles
+// each, 100 by default, with floating point and with exact predicates, the overhead of the exact predicates should stay
+// under about 15%. Then runs a set of near degenerate cases, boxes cut by copies of themselves turned and moved by tiny
+// amounts, and counts those that fail, by throwing or by returning no result or one that is not closed, with each
+
+
+#include <carve/csg.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+typedef carve::mesh::MeshSet<3> meshset_t;
+
+static meshset_t* Sphere(double cx, double cy, double cz, double r, int n)
+{
+	const double pi = 3.14159265358979323846;
+	int rings = n, segments = 2 * n;
+	std::vector<carve::geom3d::Vector> points;
+	std::vector<int> indices;
+	size_t faces = 0;
+	points.push_back(carve::geom::VECTOR(cx, cy, cz + r));
+	for (int i = 1; i < rings; i++)
+		for (int j = 0; j < segments; j++)
+		{
+			double theta = pi * i / rings, phi = 2 * pi * j / segments + 0.1234; //turned so the spheres do not share seams
+			points.push_back(carve::geom::VECTOR(cx + r * sin(theta) * cos(phi), cy + r * sin(theta) * sin(phi), cz + r * cos(theta)));
+		}
+	points.push_back(carve::geom::VECTOR(cx, cy, cz - r));
+	int south = (int)points.size() - 1;
+	for (int i = 0; i < rings; i++)
+		for (int j = 0; j < segments; j++)
+		{
+			int a = 1 + (i - 1) * segments + j, b = 1 + (i - 1) * segments + (j + 1) % segments;
+			int c = a + segments, d = b + segments;
+			if (i == 0) { int t[] = { 3, 0, c, d }; indices.insert(indices.end(), t, t + 4); faces++; }
+			else if (i == rings - 1) { int t[] = { 3, south, b, a }; indices.insert(indices.end(), t, t + 4); faces++; }
+			else
+			{
+				int t[] = { 3, a, c, d, 3, a, d, b };
+				indices.insert(indices.end(), t, t + 8);
+				faces += 2;
+			}
+		}
+	return new meshset_t(points, faces, indices);
+}
+
+//a box of the given size, turned by angle about the z axis and then the x axis, and moved by offset
+static meshset_t* Box(double sx, double sy, double sz, double angle, double offset)
+{
+	std::vector<carve::geom3d::Vector> points;
+	double c = cos(angle), s = sin(angle);
+	for (int i = 0; i < 8; i++)
+	{
+		double x = (i & 1) ? sx : 0, y = (i & 2) ? sy : 0, z = (i & 4) ? sz : 0;
+		double x1 = c * x - s * y, y1 = s * x + c * y;
+		double y2 = c * y1 - s * z, z2 = s * y1 + c * z;
+		points.push_back(carve::geom::VECTOR(x1 + offset, y2 + offset, z2 + offset));
+	}
+	int indices[] = { 4, 0, 2, 3, 1, 4, 4, 5, 7, 6, 4, 0, 1, 5, 4, 4, 2, 6, 7, 3, 4, 0, 4, 6, 2, 4, 1, 3, 7, 5 };
+	return new meshset_t(points, 6, std::vector<int>(indices, indices + 30));
+}
+
+static double Subtract(int resolution, bool exact)
+{
+	meshset_t* a = Sphere(0, 0, 0, 1, resolution);
+	meshset_t* b = Sphere(0.5, 0.3, 0.2, 0.8, resolution);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	carve::csg::CSG csg(1e-6);
+	csg.exact_predicates = exact;
+	meshset_t* difference = csg.compute(a, b, carve::csg::CSG::A_MINUS_B, NULL, carve::csg::CSG::CLASSIFY_NORMAL);
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	delete difference;
+	delete a;
+	delete b;
+	return ms;
+}
+
+static bool Fails(meshset_t* a, meshset_t* b, carve::csg::CSG::OP op, bool exact)
+{
+	bool failed;
+	try
+	{
+		carve::csg::CSG csg(1e-9);
+		csg.exact_predicates = exact;
+		meshset_t* result = csg.compute(a, b, op, NULL, carve::csg::CSG::CLASSIFY_NORMAL);
+		failed = result == NULL || !result->isClosed();
+		delete result;
+	}
+	catch (...)
+	{
+		failed = true;
+	}
+	return failed;
+}
+
+int main(int argc, char* argv[])
+{
+	int resolution = argc > 1 ? atoi(argv[1]) : 100;
+	int repeats = argc > 2 ? atoi(argv[2]) : 5;
+	printf("A_MINUS_B of two spheres of %d faces each, best of %d\n", 2 * resolution * (resolution - 1), repeats);
+	double best[2] = { 1e300, 1e300 };
+	for (int r = 0; r < repeats; r++)
+		for (int exact = 0; exact < 2; exact++)
+		{
+			double ms = Subtract(resolution, exact != 0);
+			if (ms < best[exact]) best[exact] = ms;
+		}
+	printf("  floating point %10.1f ms\n", best[0]);
+	printf("  exact          %10.1f ms\n", best[1]);
+	printf("  overhead %.1f%%\n", 100.0 * (best[1] / best[0] - 1.0));
+
+	const double angles[] = { 0, 1e-15, 1e-13, 1e-11, 1e-9, 1e-7 };
+	const double offsets[] = { 0, 1e-15, 1e-13, 1e-11, 1e-9, 1e-7 };
+	const carve::csg::CSG::OP ops[] = { carve::csg::CSG::A_MINUS_B, carve::csg::CSG::UNION, carve::csg::CSG::INTERSECTION };
+	int cases = 0, failures[2] = { 0, 0 };
+	for (size_t i = 0; i < sizeof(angles) / sizeof(angles[0]); i++)
+		for (size_t j = 0; j < sizeof(offsets) / sizeof(offsets[0]); j++)
+			for (size_t k = 0; k < sizeof(ops) / sizeof(ops[0]); k++)
+			{
+				meshset_t* a = Box(1, 2, 3, 0.3, 0);
+				meshset_t* b = Box(1, 2, 3, 0.3 + angles[i], offsets[j]);
+				for (int exact = 0; exact < 2; exact++)
+					if (Fails(a, b, ops[k], exact != 0)) failures[exact]++;
+				cases++;
+				delete a;
+				delete b;
+			}
+	printf("%d near degenerate cases\n", cases);
+	printf("  floating point %4d failed\n", failures[0]);
+	printf("  exact          %4d failed\n", failures[1]);
+	return 0;
+}
@@ -0,0 +1,217 @@
+// Benchmark for carve::mesh::MeshSimplifier::mergeCoplanarFaces, as used by XbimFacetedSolid::MergeCoPlanarFaces
+// The Carve sources build with the Visual C++ compiler, e.g. from this folder
+//   cl /O2 /EHsc /I..\Xbim.Geometry.Engine\CarveCsg\include XbimCoplanarMergeBenchmark.cpp ..\Xbim.Geometry.Engine\CarveCsg\lib\*.cpp
+// Usage: XbimCoplanarMergeBenchmark [openings] [resolution] [repeats]
+// Makes two post boolean meshes, a wall with 1000 openings cut from it and a sphere of 2 * resolution * (resolution - 1) triangles,
+// 200 by default, with another cut from it, and triangulates their faces as XbimFacetedSolid::WriteTriangulation does. Then merges
+// the coplanar triangles back together within 0.4 of a degree, the angle ReadTriangulation uses, one edge at a time in the order
+// of a hash set of the edges, as Carve did, and with the batched normal test, whose time includes the clean up of the meshes that
+// follows it. Reports the face reduction and the time of each, the face counts must match
+
+#include <carve/csg.hpp>
+#include <carve/mesh_simplify.hpp>
+#include <carve/triangulator.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_set>
+#include <vector>
+
+typedef carve::mesh::MeshSet<3> meshset_t;
+typedef meshset_t::mesh_t mesh_t;
+typedef meshset_t::edge_t edge_t;
+
+static meshset_t* Sphere(double cx, double cy, double cz, double r, int n)
+{
+	const double pi = 3.14159265358979323846;
+	int rings = n, segments = 2 * n;
+	std::vector<carve::geom3d::Vector> points;
+	std::vector<int> indices;
+	size_t faces = 0;
+	points.push_back(carve::geom::VECTOR(cx, cy, cz + r));
+	for (int i = 1; i < rings; i++)
+		for (int j = 0; j < segments; j++)
+		{
+			double theta = pi * i / rings, phi = 2 * pi * j / segments + 0.1234; //turned so the spheres do not share seams
+			points.push_back(carve::geom::VECTOR(cx + r * sin(theta) * cos(phi), cy + r * sin(theta) * sin(phi), cz + r * cos(theta)));
+		}
+	points.push_back(carve::geom::VECTOR(cx, cy, cz - r));
+	int south = (int)points.size() - 1;
+	for (int i = 0; i < rings; i++)
+		for (int j = 0; j < segments; j++)
+		{
+			int a = 1 + (i - 1) * segments + j, b = 1 + (i - 1) * segments + (j + 1) % segments;
+			int c = a + segments, d = b + segments;
+			if (i == 0) { int t[] = { 3, 0, c, d }; indices.insert(indices.end(), t, t + 4); faces++; }
+			else if (i == rings - 1) { int t[] = { 3, south, b, a }; indices.insert(indices.end(), t, t + 4); faces++; }
+			else
+			{
+				int t[] = { 3, a, c, d, 3, a, d, b };
+				indices.insert(indices.end(), t, t + 8);
+				faces += 2;
+			}
+		}
+	return new meshset_t(points, faces, indices);
+}
+
+static void AddBox(std::vector<carve::geom3d::Vector>& points, std::vector<int>& indices, size_t& faces, double x0, double y0, double z0, double x1, double y1, double z1)
+{
+	int base = (int)points.size();
+	for (int i = 0; i < 8; i++)
+		points.push_back(carve::geom::VECTOR((i & 1) ? x1 : x0, (i & 2) ? y1 : y0, (i & 4) ? z1 : z0));
+	int quads[] = { 0, 2, 3, 1, 4, 5, 7, 6, 0, 1, 5, 4, 2, 6, 7, 3, 0, 4, 6, 2, 1, 3, 7, 5 };
+	for (int f = 0; f < 6; f++)
+	{
+		indices.push_back(4);
+		for (int k = 0; k < 4; k++) indices.push_back(base + quads[f * 4 + k]);
+		faces++;
+	}
+}
+
+static meshset_t* Subtract(meshset_t* a, meshset_t* b)
+{
+	meshset_t* result = carve::csg::CSG(1e-6).compute(a, b, carve::csg::CSG::A_MINUS_B, NULL, carve::csg::CSG::CLASSIFY_NORMAL);
+	delete a;
+	delete b;
+	return result;
+}
+
+static meshset_t* Wall(int openings)
+{
+	std::vector<carve::geom3d::Vector> points;
+	std::vector<int> indices;
+	size_t faces = 0;
+	AddBox(points, indices, faces, 0, 0, 0, openings, 0.3, 3);
+	meshset_t* wall = new meshset_t(points, faces, indices);
+	points.clear();
+	indices.clear();
+	faces = 0;
+	for (int i = 0; i < openings; i++)
+		AddBox(points, indices, faces, i + 0.2, -0.1, 1, i + 0.8, 0.4, 2.2);
+	return Subtract(wall, new meshset_t(points, faces, indices));
+}
+
+//a mesh of the triangles of the faces of mesh
+static meshset_t* Triangulate(const meshset_t* mesh)
+{
+	std::vector<carve::geom3d::Vector> points;
+	std::vector<int> indices;
+	size_t faces = 0;
+	for (size_t i = 0; i < mesh->vertex_storage.size(); i++) points.push_back(mesh->vertex_storage[i].v);
+	for (meshset_t::const_face_iter f = mesh->faceBegin(); f != mesh->faceEnd(); ++f)
+	{
+		std::vector<meshset_t::vertex_t*> verts;
+		(*f)->getVertices(verts);
+		std::vector<carve::triangulate::tri_idx> triangles;
+		if (verts.size() > 3)
+		{
+			std::vector<carve::geom::vector<2> > projected;
+			(*f)->getProjectedVertices(projected);
+			carve::triangulate::triangulate(projected, triangles, 1e-5);
+		}
+		else
+			triangles.push_back(carve::triangulate::tri_idx(0, 1, 2));
+		for (size_t t = 0; t < triangles.size(); t++)
+		{
+			indices.push_back(3);
+			indices.push_back((int)(verts[triangles[t].a] - &mesh->vertex_storage[0]));
+			indices.push_back((int)(verts[triangles[t].b] - &mesh->vertex_storage[0]));
+			indices.push_back((int)(verts[triangles[t].c] - &mesh->vertex_storage[0]));
+			faces++;
+		}
+	}
+	return new meshset_t(points, faces, indices);
+}
+
+//the merge as Carve did it, one edge at a time taken from a hash set of the coplanar edges
+static void MergeOneAtATime(mesh_t* mesh, double angle)
+{
+	std::unordered_set<edge_t*> coplanar;
+	double minDot = cos(angle);
+	for (size_t i = 0; i < mesh->closed_edges.size(); i++)
+	{
+		edge_t* e = mesh->closed_edges[i];
+		if (carve::geom::dot(e->face->plane.N, e->rev->face->plane.N) >= minDot) coplanar.insert(e);
+	}
+	while (!coplanar.empty())
+	{
+		edge_t* edge = *coplanar.begin();
+		if (edge->face == edge->rev->face)
+		{
+			coplanar.erase(edge);
+			continue;
+		}
+		edge_t* removed = edge->mergeFaces();
+		if (removed == NULL)
+		{
+			coplanar.erase(edge);
+			continue;
+		}
+		edge_t* e = removed;
+		do
+		{
+			edge_t* n = e->next;
+			coplanar.erase(std::min(e, e->rev));
+			delete e->rev;
+			delete e;
+			e = n;
+		} while (e != removed);
+	}
+}
+
+static size_t FaceCount(const meshset_t* mesh)
+{
+	size_t faces = 0;
+	for (meshset_t::const_face_iter f = mesh->faceBegin(); f != mesh->faceEnd(); ++f)
+		if ((*f)->nEdges() > 0) faces++;
+	return faces;
+}
+
+static bool Run(const char* name, const meshset_t* result, int repeats)
+{
+	const double angle = 0.4 * 3.14159265358979323846 / 180.0;
+	double best[2] = { 1e300, 1e300 };
+	size_t before = 0, after[2] = { 0, 0 };
+	for (int r = 0; r < repeats; r++)
+		for (int batched = 0; batched < 2; batched++)
+		{
+			meshset_t* mesh = Triangulate(result);
+			before = FaceCount(mesh);
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			if (batched)
+				carve::mesh::MeshSimplifier().mergeCoplanarFaces(mesh, angle);
+			else
+				for (size_t i = 0; i < mesh->meshes.size(); i++)
+					MergeOneAtATime(mesh->meshes[i], angle);
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (ms < best[batched]) best[batched] = ms;
+			after[batched] = FaceCount(mesh);
+			delete mesh;
+		}
+	printf("%s, %zu triangles, best of %d\n", name, before, repeats);
+	printf("  one at a time %10.1f ms %8zu faces, x%.2f fewer\n", best[0], after[0], (double)before / after[0]);
+	printf("  batched       %10.1f ms %8zu faces, x%.2f fewer\n", best[1], after[1], (double)before / after[1]);
+	printf("  speedup x%.2f\n", best[0] / best[1]);
+	return after[0] == after[1];
+}
+
+int main(int argc, char* argv[])
+{
+	int openings = argc > 1 ? atoi(argv[1]) : 1000;
+	int resolution = argc > 2 ? atoi(argv[2]) : 200;
+	int repeats = argc > 3 ? atoi(argv[3]) : 3;
+	meshset_t* wall = Wall(openings);
+	meshset_t* spheres = Subtract(Sphere(0, 0, 0, 1, resolution), Sphere(0.5, 0.3, 0.2, 0.8, resolution));
+	bool match = Run("Wall with openings", wall, repeats);
+	match = Run("Sphere minus sphere", spheres, repeats) && match;
+	delete wall;
+	delete spheres;
+	if (!match)
+	{
+		printf("ERROR: the face counts differ\n");
+		return 1;
+	}
+	printf("face counts match\n");
+	return 0;
+}
@@ -0,0 +1,168 @@
+// Benchmark for carve::mesh::MeshSimplifier::decimate, as used by XbimFacetedSolid::LevelsOfDetail
+// The Carve sources build with the Visual C++ compiler, e.g. from this folder
+//   cl /O2 /EHsc /I..\Xbim.Geometry.Engine\CarveCsg\include XbimDecimationBenchmark.cpp ..\Xbim.Geometry.Engine\CarveCsg\lib\*.cpp
+// Usage: XbimDecimationBenchmark [resolution] [repeats]
+// Decimates a sphere of radius 1 and 2 * resolution * (resolution - 1) triangles, 200 by default, and the triangles of that
+// sphere with another cut from it, to three levels of detail with bounds of 0.001, 0.005 and 0.02. Reports the time, the faces
+// and vertices of each level, and for the sphere the furthest any vertex is from the surface, which must be within the bound.
+// Fails if a level is not closed or has a face that is not a triangle
+
+#include <carve/csg.hpp>
+#include <carve/mesh_simplify.hpp>
+#include <carve/triangulator.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+typedef carve::mesh::MeshSet<3> meshset_t;
+
+static meshset_t* Sphere(double cx, double cy, double cz, double r, int n)
+{
+	const double pi = 3.14159265358979323846;
+	int rings = n, segments = 2 * n;
+	std::vector<carve::geom3d::Vector> points;
+	std::vector<int> indices;
+	size_t faces = 0;
+	points.push_back(carve::geom::VECTOR(cx, cy, cz + r));
+	for (int i = 1; i < rings; i++)
+		for (int j = 0; j < segments; j++)
+		{
+			double theta = pi * i / rings, phi = 2 * pi * j / segments + 0.1234; //turned so the spheres do not share seams
+			points.push_back(carve::geom::VECTOR(cx + r * sin(theta) * cos(phi), cy + r * sin(theta) * sin(phi), cz + r * cos(theta)));
+		}
+	points.push_back(carve::geom::VECTOR(cx, cy, cz - r));
+	int south = (int)points.size() - 1;
+	for (int i = 0; i < rings; i++)
+		for (int j = 0; j < segments; j++)
+		{
+			int a = 1 + (i - 1) * segments + j, b = 1 + (i - 1) * segments + (j + 1) % segments;
+			int c = a + segments, d = b + segments;
+			if (i == 0) { int t[] = { 3, 0, c, d }; indices.insert(indices.end(), t, t + 4); faces++; }
+			else if (i == rings - 1) { int t[] = { 3, south, b, a }; indices.insert(indices.end(), t, t + 4); faces++; }
+			else
+			{
+				int t[] = { 3, a, c, d, 3, a, d, b };
+				indices.insert(indices.end(), t, t + 8);
+				faces += 2;
+			}
+		}
+	return new meshset_t(points, faces, indices);
+}
+
+//a mesh of the triangles of the faces of mesh, as XbimFacetedSolid::LevelsOfDetail makes
+static meshset_t* Triangulate(const meshset_t* mesh)
+{
+	std::vector<carve::geom3d::Vector> points;
+	std::vector<int> indices;
+	size_t faces = 0;
+	for (size_t i = 0; i < mesh->vertex_storage.size(); i++) points.push_back(mesh->vertex_storage[i].v);
+	for (meshset_t::const_face_iter f = mesh->faceBegin(); f != mesh->faceEnd(); ++f)
+	{
+		std::vector<meshset_t::vertex_t*> verts;
+		(*f)->getVertices(verts);
+		std::vector<carve::triangulate::tri_idx> triangles;
+		if (verts.size() > 3)
+		{
+			std::vector<carve::geom::vector<2> > projected;
+			(*f)->getProjectedVertices(projected);
+			carve::triangulate::triangulate(projected, triangles, 1e-5);
+		}
+		else
+			triangles.push_back(carve::triangulate::tri_idx(0, 1, 2));
+		for (size_t t = 0; t < triangles.size(); t++)
+		{
+			indices.push_back(3);
+			indices.push_back((int)(verts[triangles[t].a] - &mesh->vertex_storage[0]));
+			indices.push_back((int)(verts[triangles[t].b] - &mesh->vertex_storage[0]));
+			indices.push_back((int)(verts[triangles[t].c] - &mesh->vertex_storage[0]));
+			faces++;
+		}
+	}
+	return new meshset_t(points, faces, indices);
+}
+
+static size_t FaceCount(const meshset_t* mesh)
+{
+	size_t faces = 0;
+	for (meshset_t::const_face_iter f = mesh->faceBegin(); f != mesh->faceEnd(); ++f) faces++;
+	return faces;
+}
+
+static bool AllTriangles(const meshset_t* mesh)
+{
+	for (meshset_t::const_face_iter f = mesh->faceBegin(); f != mesh->faceEnd(); ++f)
+		if ((*f)->nEdges() != 3) return false;
+	return true;
+}
+
+//decimates copies of mesh, centre is that of the sphere to measure the distance from, or NULL
+static bool Run(const char* name, const meshset_t* mesh, const double* centre, int repeats)
+{
+	std::vector<double> bounds;
+	bounds.push_back(0.001);
+	bounds.push_back(0.005);
+	bounds.push_back(0.02);
+	double best = 1e300;
+	std::vector<meshset_t*> lods;
+	for (int r = 0; r < repeats; r++)
+	{
+		for (size_t i = 0; i < lods.size(); i++) delete lods[i];
+		lods.clear();
+		meshset_t* copy = mesh->clone();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		carve::mesh::MeshSimplifier().decimate(copy, bounds, lods);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (ms < best) best = ms;
+		delete copy;
+	}
+	bool ok = true;
+	printf("%s, %zu triangles %zu vertices, best of %d %10.1f ms\n", name, FaceCount(mesh), mesh->vertex_storage.size(), repeats, best);
+	for (size_t i = 0; i < lods.size(); i++)
+	{
+		const meshset_t* lod = lods[i];
+		bool valid = lod->isClosed() && AllTriangles(lod);
+		printf("  bound %6.3f %8zu faces %8zu vertices, x%.1f fewer", bounds[i], FaceCount(lod), lod->vertex_storage.size(),
+			(double)FaceCount(mesh) / FaceCount(lod));
+		if (centre != NULL)
+		{
+			double furthest = 0;
+			for (size_t v = 0; v < lod->vertex_storage.size(); v++)
+			{
+				carve::geom3d::Vector p = lod->vertex_storage[v].v - carve::geom::VECTOR(centre[0], centre[1], centre[2]);
+				furthest = std::max(furthest, fabs(p.length() - 1.0));
+			}
+			printf(", furthest %.5f from the surface", furthest);
+			valid = valid && furthest <= bounds[i];
+		}
+		printf(valid ? "\n" : " INVALID\n");
+		ok = ok && valid;
+		delete lods[i];
+	}
+	return ok;
+}
+
+int main(int argc, char* argv[])
+{
+	int resolution = argc > 1 ? atoi(argv[1]) : 200;
+	int repeats = argc > 2 ? atoi(argv[2]) : 3;
+	const double origin[] = { 0, 0, 0 };
+	meshset_t* sphere = Sphere(0, 0, 0, 1, resolution);
+	meshset_t* other = Sphere(0.5, 0.3, 0.2, 0.8, resolution);
+	meshset_t* difference = carve::csg::CSG(1e-6).compute(sphere, other, carve::csg::CSG::A_MINUS_B, NULL, carve::csg::CSG::CLASSIFY_NORMAL);
+	meshset_t* triangles = Triangulate(difference);
+	bool ok = Run("Sphere", sphere, origin, repeats);
+	ok = Run("Sphere minus sphere", triangles, NULL, repeats) && ok;
+	delete triangles;
+	delete difference;
+	delete other;
+	delete sphere;
+	if (!ok)
+	{
+		printf("ERROR: a level of detail is invalid\n");
+		return 1;
+	}
+	printf("all levels valid\n");
+	return 0;
+}
@@ -0,0 +1,355 @@
+// Benchmark for the thread pool behind OSD_Parallel::For and OSD_Parallel::ForEach when OCC is built without TBB
+// The OCC sources build with the Visual C++ compiler, with the TKernel packages the loops use, e.g. from this folder
+//   set OCC=..\Xbim.Geometry.Engine\OCC
+//   cl /O2 /EHsc /DWNT /DHAVE_NO_DLL /I%OCC%\inc /I%OCC%\drv\Standard /I%OCC%\drv\MMgt /I%OCC%\drv\OSD /I%OCC%\drv\Quantity
+//      /I%OCC%\drv\TCollection XbimOsdParallelBenchmark.cpp %OCC%\src\Standard\*.cxx %OCC%\src\MMgt\*.cxx %OCC%\src\OSD\*.cxx
+//      %OCC%\src\Quantity\*.cxx %OCC%\src\TCollection\*.cxx %OCC%\src\NCollection\*.cxx
+// Usage: XbimOsdParallelBenchmark [loops] [repeats]
+// Runs loops shaped like those of BOPAlgo, which hands each stage to OSD_Parallel::For through BOPCol_Parallel, and of BRepMesh,
+// which uses OSD_Parallel::ForEach: 2000 loops by default of 10 to 200 items of uneven cost, one loop of 20000 such items, a ForEach
+// over a list of 5000 of them, and a loop of 64 items each running an inner loop of 100. Each is run with the fallback OSD_Parallel
+// had, new threads for every loop sharing out the items one at a time, by an atomic increment for For and a mutex for ForEach, and
+// with the pool. Reports the best time of each and the speedup, the results of every item must match those of a serial run
+// Then checks that an exception thrown by an item of a loop on the pool is raised again on the thread that started the loop
+
+#include <OSD_Parallel.hxx>
+#include <OSD_Thread.hxx>
+#include <Standard_Atomic.hxx>
+#include <Standard_Mutex.hxx>
+#include <NCollection_Array1.hxx>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//the fallback as it was, a range shared by new threads, the integer one advanced atomically and the others under a mutex
+template <typename Value>
+class OldRange
+{
+public:
+	OldRange(const Value& begin, const Value& end) : _end(end), _it(begin) {}
+	const Value& End() const { return _end; }
+	Value It() const
+	{
+		Standard_Mutex::Sentry sentry(_mutex);
+		return _it != _end ? _it++ : _end;
+	}
+private:
+	const Value& _end;
+	mutable Value _it;
+	mutable Standard_Mutex _mutex;
+};
+
+template<> inline Standard_Integer OldRange<Standard_Integer>::It() const
+{
+	return Standard_Atomic_Increment(reinterpret_cast<volatile int*>(&_it)) - 1;
+}
+
+template <typename Functor, typename Value>
+struct OldTask
+{
+	const Functor& Performer;
+	const OldRange<Value>& Range;
+	static Standard_Address RunWithIterator(Standard_Address task)
+	{
+		const OldTask& t = *static_cast<OldTask*>(task);
+		for (Value i = t.Range.It(); i != t.Range.End(); i = t.Range.It()) t.Performer(*i);
+		return NULL;
+	}
+	static Standard_Address RunWithIndex(Standard_Address task)
+	{
+		const OldTask& t = *static_cast<OldTask*>(task);
+		for (Value i = t.Range.It(); i < t.Range.End(); i = t.Range.It()) t.Performer(i);
+		return NULL;
+	}
+};
+
+template <typename Functor>
+static void OldFor(Standard_Integer begin, Standard_Integer end, const Functor& functor)
+{
+	OldRange<Standard_Integer> range(begin, end);
+	OldTask<Functor, Standard_Integer> task = { functor, range };
+	const Standard_Integer nbThreads = OSD_Parallel::NbLogicalProcessors();
+	NCollection_Array1<OSD_Thread> threads(0, nbThreads - 1);
+	for (Standard_Integer i = 0; i < nbThreads; ++i)
+	{
+		threads(i).SetFunction(&OldTask<Functor, Standard_Integer>::RunWithIndex);
+		threads(i).Run(&task);
+	}
+	for (Standard_Integer i = 0; i < nbThreads; ++i) threads(i).Wait();
+}
+
+template <typename InputIterator, typename Functor>
+static void OldForEach(InputIterator begin, InputIterator end, const Functor& functor)
+{
+	OldRange<InputIterator> range(begin, end);
+	OldTask<Functor, InputIterator> task = { functor, range };
+	const Standard_Integer nbThreads = OSD_Parallel::NbLogicalProcessors();
+	NCollection_Array1<OSD_Thread> threads(0, nbThreads - 1);
+	for (Standard_Integer i = 0; i < nbThreads; ++i)
+	{
+		threads(i).SetFunction(&OldTask<Functor, InputIterator>::RunWithIterator);
+		threads(i).Run(&task);
+	}
+	for (Standard_Integer i = 0; i < nbThreads; ++i) threads(i).Wait();
+}
+
+//an item of work, cost iterations of a little floating point, about a tenth of a microsecond each
+struct Item
+{
+	int Cost;
+	double Result;
+};
+
+static double Work(int cost, int seed)
+{
+	double x = 1.0 + seed * 1e-6;
+	for (int i = 0; i < cost; i++) x = sqrt(x * 1.0001 + 0.5);
+	return x;
+}
+
+//the costs are skewed, most items are cheap and a few are 50 times dearer, as the solvers of a BOPAlgo stage are
+static void MakeItems(std::vector<Item>& items, size_t count, unsigned int& seed)
+{
+	items.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		seed = seed * 1103515245u + 12345u;
+		items[i].Cost = (seed >> 16) % 16 == 0 ? 2000 : 40 + (int)((seed >> 8) % 40);
+		items[i].Result = 0;
+	}
+}
+
+struct ItemFunctor
+{
+	std::vector<Item>* Items;
+	void operator()(const Standard_Integer i) const { (*Items)[i].Result = Work((*Items)[i].Cost, i); }
+};
+
+struct ListFunctor
+{
+	void operator()(Item& item) const { item.Result = Work(item.Cost, (int)item.Cost); }
+};
+
+//each item runs a loop of its own over a row of the items, as the solvers that start loops of their own do
+struct NestedFunctor
+{
+	std::vector<Item>* Items;
+	int Row;
+	bool Old;
+	void operator()(const Standard_Integer i) const
+	{
+		ItemFunctor inner = { Items };
+		struct Offset
+		{
+			const ItemFunctor* Inner;
+			int Base;
+			void operator()(const Standard_Integer j) const { (*Inner)(Base + j); }
+		} offset = { &inner, i * Row };
+		if (Old) OldFor(0, Row, offset);
+		else OSD_Parallel::For(0, Row, offset);
+	}
+};
+
+static bool Same(const std::vector<Item>& a, const std::vector<Item>& b)
+{
+	if (a.size() != b.size()) return false;
+	for (size_t i = 0; i < a.size(); i++)
+		if (a[i].Result != b[i].Result) return false;
+	return true;
+}
+
+static bool Same(const std::list<Item>& a, const std::vector<Item>& b)
+{
+	std::vector<Item> copy(a.begin(), a.end());
+	return Same(copy, b);
+}
+
+static double Elapsed(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool Report(const char* name, const double* best, int repeats, bool match)
+{
+	printf("%s, best of %d\n", name, repeats);
+	printf("  new threads per loop %10.2f ms\n", best[0]);
+	printf("  thread pool          %10.2f ms\n", best[1]);
+	printf("  speedup x%.2f%s\n", best[0] / best[1], match ? "" : " RESULTS DIFFER");
+	return match;
+}
+
+//many small loops of a few to a couple of hundred items, one after another
+static bool ManyLoops(int loops, int repeats)
+{
+	unsigned int seed = 1;
+	std::vector<std::vector<Item> > stages(loops), expected(loops);
+	for (int l = 0; l < loops; l++)
+	{
+		seed = seed * 1103515245u + 12345u;
+		MakeItems(stages[l], 10 + (seed >> 16) % 191, seed);
+		expected[l] = stages[l];
+		for (size_t i = 0; i < expected[l].size(); i++) expected[l][i].Result = Work(expected[l][i].Cost, (int)i);
+	}
+	double best[2] = { 1e300, 1e300 };
+	bool match = true;
+	for (int r = 0; r < repeats; r++)
+		for (int pool = 0; pool < 2; pool++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (int l = 0; l < loops; l++)
+			{
+				ItemFunctor functor = { &stages[l] };
+				if (pool) OSD_Parallel::For(0, (Standard_Integer)stages[l].size(), functor);
+				else OldFor(0, (Standard_Integer)stages[l].size(), functor);
+			}
+			double ms = Elapsed(start);
+			if (ms < best[pool]) best[pool] = ms;
+			for (int l = 0; l < loops; l++)
+			{
+				match = match && Same(stages[l], expected[l]);
+				for (size_t i = 0; i < stages[l].size(); i++) stages[l][i].Result = 0;
+			}
+		}
+	char name[64];
+	sprintf(name, "%d For loops of 10 to 200 items", loops);
+	return Report(name, best, repeats, match);
+}
+
+//one loop of many items
+static bool OneLoop(int count, int repeats)
+{
+	unsigned int seed = 2;
+	std::vector<Item> items, expected;
+	MakeItems(items, count, seed);
+	expected = items;
+	for (size_t i = 0; i < expected.size(); i++) expected[i].Result = Work(expected[i].Cost, (int)i);
+	double best[2] = { 1e300, 1e300 };
+	bool match = true;
+	for (int r = 0; r < repeats; r++)
+		for (int pool = 0; pool < 2; pool++)
+		{
+			ItemFunctor functor = { &items };
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			if (pool) OSD_Parallel::For(0, count, functor);
+			else OldFor(0, count, functor);
+			double ms = Elapsed(start);
+			if (ms < best[pool]) best[pool] = ms;
+			match = match && Same(items, expected);
+			for (size_t i = 0; i < items.size(); i++) items[i].Result = 0;
+		}
+	char name[64];
+	sprintf(name, "For loop of %d items", count);
+	return Report(name, best, repeats, match);
+}
+
+//a ForEach over a list, as BRepMesh meshes the faces of a shape
+static bool ListLoop(int count, int repeats)
+{
+	unsigned int seed = 3;
+	std::vector<Item> items;
+	MakeItems(items, count, seed);
+	std::list<Item> list(items.begin(), items.end());
+	for (size_t i = 0; i < items.size(); i++) items[i].Result = Work(items[i].Cost, items[i].Cost);
+	double best[2] = { 1e300, 1e300 };
+	bool match = true;
+	for (int r = 0; r < repeats; r++)
+		for (int pool = 0; pool < 2; pool++)
+		{
+			ListFunctor functor;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			if (pool) OSD_Parallel::ForEach(list.begin(), list.end(), functor);
+			else OldForEach(list.begin(), list.end(), functor);
+			double ms = Elapsed(start);
+			if (ms < best[pool]) best[pool] = ms;
+			match = match && Same(list, items);
+			for (std::list<Item>::iterator it = list.begin(); it != list.end(); ++it) it->Result = 0;
+		}
+	char name[64];
+	sprintf(name, "ForEach over a list of %d items", count);
+	return Report(name, best, repeats, match);
+}
+
+//a loop whose items start loops of their own
+static bool NestedLoops(int outer, int inner, int repeats)
+{
+	unsigned int seed = 4;
+	std::vector<Item> items, expected;
+	MakeItems(items, outer * inner, seed);
+	expected = items;
+	for (int i = 0; i < outer; i++)
+		for (int j = 0; j < inner; j++) expected[i * inner + j].Result = Work(expected[i * inner + j].Cost, i * inner + j);
+	double best[2] = { 1e300, 1e300 };
+	bool match = true;
+	for (int r = 0; r < repeats; r++)
+		for (int pool = 0; pool < 2; pool++)
+		{
+			NestedFunctor functor = { &items, inner, pool == 0 };
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			if (pool) OSD_Parallel::For(0, outer, functor);
+			else OldFor(0, outer, functor);
+			double ms = Elapsed(start);
+			if (ms < best[pool]) best[pool] = ms;
+			match = match && Same(items, expected);
+			for (size_t i = 0; i < items.size(); i++) items[i].Result = 0;
+		}
+	char name[64];
+	sprintf(name, "For loop of %d items of %d item For loops", outer, inner);
+	return Report(name, best, repeats, match);
+}
+
+struct ThrowingFunctor
+{
+	void operator()(const Standard_Integer i) const
+	{
+		Work(100, i);
+		if (i == 777) throw std::runtime_error("item 777");
+	}
+};
+
+static bool Rethrows()
+{
+	bool caught = false;
+	try
+	{
+		OSD_Parallel::For(0, 1000, ThrowingFunctor());
+	}
+	catch (const std::runtime_error& e)
+	{
+		caught = std::string(e.what()) == "item 777";
+	}
+	//the pool must still run loops after one has failed
+	std::vector<Item> items, expected;
+	unsigned int seed = 5;
+	MakeItems(items, 1000, seed);
+	expected = items;
+	for (size_t i = 0; i < expected.size(); i++) expected[i].Result = Work(expected[i].Cost, (int)i);
+	ItemFunctor functor = { &items };
+	OSD_Parallel::For(0, 1000, functor);
+	printf("exception %s on the calling thread, the loop after it %s\n", caught ? "raised" : "NOT RAISED",
+		Same(items, expected) ? "ran" : "FAILED");
+	return caught && Same(items, expected);
+}
+
+int main(int argc, char* argv[])
+{
+	int loops = argc > 1 ? atoi(argv[1]) : 2000;
+	int repeats = argc > 2 ? atoi(argv[2]) : 3;
+	printf("%d logical processors\n", OSD_Parallel::NbLogicalProcessors());
+	bool ok = ManyLoops(loops, repeats);
+	ok = OneLoop(20000, repeats) && ok;
+	ok = ListLoop(5000, repeats) && ok;
+	ok = NestedLoops(64, 100, repeats) && ok;
+	ok = Rethrows() && ok;
+	if (!ok)
+	{
+		printf("ERROR: the results differ\n");
+		return 1;
+	}
+	printf("results match\n");
+	return 0;
+}
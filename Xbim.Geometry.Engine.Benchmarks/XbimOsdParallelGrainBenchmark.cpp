@@ -0,0 +1,117 @@
+// Benchmark for the grain size of OSD_Parallel::For when OCC is built without TBB
+// The OCC sources build with the Visual C++ compiler, with the TKernel packages the loops use, e.g. from this folder
+//   set OCC=..\Xbim.Geometry.Engine\OCC
+//   cl /O2 /EHsc /DWNT /DHAVE_NO_DLL /I%OCC%\inc /I%OCC%\drv\Standard /I%OCC%\drv\MMgt /I%OCC%\drv\OSD /I%OCC%\drv\Quantity
+//      /I%OCC%\drv\TCollection XbimOsdParallelGrainBenchmark.cpp %OCC%\src\Standard\*.cxx %OCC%\src\MMgt\*.cxx %OCC%\src\OSD\*.cxx
+//      %OCC%\src\Quantity\*.cxx %OCC%\src\TCollection\*.cxx %OCC%\src\NCollection\*.cxx
+// Usage: XbimOsdParallelGrainBenchmark [items] [repeats]
+// Runs a loop of 1000000 trivial items by default serially and with grain sizes of 1, one item at a time as the fallback OSD_Parallel
+// had, 64, 4096, the default of a few chunks a thread and AdaptiveGrainSize. Then runs loops of 2000 items, as many as the vertices
+// of the faces BRepMesh checks in its loops, of costs from one to 4096 steps of a tenth of a microsecond or so, and reports for a grain
+// size of 1 and for the adaptive grain the least cost at which the loop is faster than a serial one. The results must match serial runs
+
+#include <OSD_Parallel.hxx>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+struct Trivial
+{
+	std::vector<double>* Values;
+	void operator()(const Standard_Integer i) const { (*Values)[i] = (*Values)[i] * 0.5 + i; }
+};
+
+struct Costly
+{
+	std::vector<double>* Values;
+	int Cost;
+	void operator()(const Standard_Integer i) const
+	{
+		double x = (*Values)[i];
+		for (int k = 0; k < Cost; k++) x = sqrt(x * 1.0001 + 0.5);
+		(*Values)[i] = x;
+	}
+};
+
+static void Reset(std::vector<double>& values)
+{
+	for (size_t i = 0; i < values.size(); i++) values[i] = 1.0 + i * 1e-6;
+}
+
+//best time of the loop in ms, a grain size below -1 runs it serially
+template <typename Functor>
+static double Time(const Functor& functor, std::vector<double>& values, Standard_Integer grain, int repeats,
+	const std::vector<double>& expected, bool& match)
+{
+	double best = 1e300;
+	for (int r = 0; r < repeats; r++)
+	{
+		Reset(values);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (grain < OSD_Parallel::AdaptiveGrainSize)
+			for (Standard_Integer i = 0; i < (Standard_Integer)values.size(); i++) functor(i);
+		else
+			OSD_Parallel::For(0, (Standard_Integer)values.size(), grain, functor);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (ms < best) best = ms;
+		if (!expected.empty()) match = match && values == expected;
+	}
+	return best;
+}
+
+int main(int argc, char* argv[])
+{
+	int count = argc > 1 ? atoi(argv[1]) : 1000000;
+	int repeats = argc > 2 ? atoi(argv[2]) : 5;
+	const Standard_Integer serial = -2;
+	bool match = true;
+	printf("%d logical processors\n", OSD_Parallel::NbLogicalProcessors());
+
+	std::vector<double> values(count), expected;
+	Trivial trivial = { &values };
+	double serialMs = Time(trivial, values, serial, repeats, expected, match);
+	expected = values;
+	printf("%d trivial items, best of %d\n", count, repeats);
+	printf("  serial          %10.2f ms\n", serialMs);
+	const Standard_Integer grains[] = { 1, 64, 4096, 0, OSD_Parallel::AdaptiveGrainSize };
+	const char* names[] = { "grain 1        ", "grain 64       ", "grain 4096     ", "default grain  ", "adaptive grain " };
+	for (int g = 0; g < 5; g++)
+	{
+		double ms = Time(trivial, values, grains[g], repeats, expected, match);
+		printf("  %s %10.2f ms, x%.2f of serial\n", names[g], ms, serialMs / ms);
+	}
+
+	const int items = 2000;
+	int crossover[2] = { 0, 0 };
+	std::vector<double> costly(items);
+	printf("%d items of a cost of\n", items);
+	for (int cost = 1; cost <= 4096; cost *= 4)
+	{
+		Costly functor = { &costly, cost };
+		std::vector<double> none;
+		double serialItems = Time(functor, costly, serial, repeats, none, match);
+		std::vector<double> costlyExpected = costly;
+		double one = Time(functor, costly, 1, repeats, costlyExpected, match);
+		double adaptive = Time(functor, costly, OSD_Parallel::AdaptiveGrainSize, repeats, costlyExpected, match);
+		printf("  %5d steps, serial %8.3f ms, grain 1 %8.3f ms x%.2f, adaptive %8.3f ms x%.2f\n", cost, serialItems, one,
+			serialItems / one, adaptive, serialItems / adaptive);
+		if (crossover[0] == 0 && one < serialItems) crossover[0] = cost;
+		if (crossover[1] == 0 && adaptive < serialItems) crossover[1] = cost;
+	}
+	for (int g = 0; g < 2; g++)
+	{
+		if (crossover[g] == 0)
+			printf("  %s never faster than serial\n", g == 0 ? "grain 1" : "adaptive grain");
+		else
+			printf("  %s faster than serial from %d steps an item\n", g == 0 ? "grain 1" : "adaptive grain", crossover[g]);
+	}
+	if (!match)
+	{
+		printf("ERROR: the results differ from the serial run\n");
+		return 1;
+	}
+	printf("results match\n");
+	return 0;
+}
@@ -0,0 +1,136 @@
+// Micro-benchmark for Xbim::Geometry::XbimVertexWelder
+// Builds on any platform with a C++11 compiler, e.g. from this folder
+//   g++ -O2 -std=c++11 -I../Xbim.Geometry.Engine XbimVertexWelderBenchmark.cpp ../Xbim.Geometry.Engine/XbimVertexWelder.cpp -o XbimVertexWelderBenchmark
+// Usage: XbimVertexWelderBenchmark [grid size] [tolerance]
+// Simulates the nodes of a face by face triangulation, every grid node is emitted once for each face that uses it
+// with noise below tolerance, and welds them with XbimVertexWelder and with a node based hash map keyed on the
+// snapped grid cell that allocates per node, as the managed Dictionary<XbimPoint3DWithTolerance^,int> did
+
+#include "XbimVertexWelder.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+static size_t allocations = 0;
+
+void* operator new(size_t size)
+{
+	allocations++;
+	void* p = std::malloc(size ? size : 1);
+	if (p == nullptr) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+struct GridKey
+{
+	double x, y, z;
+	bool operator==(const GridKey& o) const { return x == o.x && y == o.y && z == o.z; }
+};
+
+struct GridKeyHash
+{
+	size_t operator()(const GridKey& k) const
+	{
+		std::hash<double> h;
+		size_t hash = 2166136261u;
+		hash = hash * 16777619 ^ h(k.x);
+		hash = hash * 16777619 ^ h(k.y);
+		hash = hash * 16777619 ^ h(k.z);
+		return hash;
+	}
+};
+
+struct Node
+{
+	double x, y, z;
+};
+
+//the old approach, snap to a 10 * tolerance grid with fmod and allocate a point object per lookup
+static size_t WeldWithMap(const std::vector<double>& nodes, double tolerance, std::vector<size_t>& lookup)
+{
+	double gridDim = tolerance * 10.;
+	std::unordered_map<GridKey, size_t, GridKeyHash> pointMap;
+	std::vector<Node*> points;
+	for (size_t i = 0; i < nodes.size(); i += 3)
+	{
+		Node* pt = new Node{ nodes[i], nodes[i + 1], nodes[i + 2] };
+		GridKey key = { pt->x - std::fmod(pt->x, gridDim), pt->y - std::fmod(pt->y, gridDim), pt->z - std::fmod(pt->z, gridDim) };
+		auto found = pointMap.find(key);
+		if (found == pointMap.end())
+		{
+			size_t index = points.size();
+			pointMap.emplace(key, index);
+			points.push_back(pt);
+			lookup.push_back(index);
+		}
+		else
+		{
+			lookup.push_back(found->second);
+			delete pt;
+		}
+	}
+	size_t count = points.size();
+	for (size_t i = 0; i < points.size(); i++) delete points[i];
+	return count;
+}
+
+static size_t WeldWithWelder(const std::vector<double>& nodes, double tolerance, std::vector<size_t>& lookup)
+{
+	Xbim::Geometry::XbimVertexWelder welder(tolerance, nodes.size() / 12);
+	for (size_t i = 0; i < nodes.size(); i += 3)
+		lookup.push_back(welder.Weld(nodes[i], nodes[i + 1], nodes[i + 2]));
+	return welder.Count();
+}
+
+int main(int argc, char* argv[])
+{
+	int gridSize = argc > 1 ? std::atoi(argv[1]) : 500;
+	double tolerance = argc > 2 ? std::atof(argv[2]) : 1e-5;
+	double spacing = 0.25;
+	//each quad of the grid is a face, its four corners are written per face as a triangulation would
+	std::vector<double> nodes;
+	nodes.reserve((size_t)gridSize * gridSize * 12);
+	std::srand(42);
+	for (int i = 0; i < gridSize; i++)
+		for (int j = 0; j < gridSize; j++)
+		{
+			int corners[4][2] = { { i, j }, { i + 1, j }, { i + 1, j + 1 }, { i, j + 1 } };
+			for (int c = 0; c < 4; c++)
+			{
+				double noise = ((double)std::rand() / RAND_MAX - 0.5) * tolerance * 0.5;
+				nodes.push_back(corners[c][0] * spacing + noise);
+				nodes.push_back(corners[c][1] * spacing - noise);
+				nodes.push_back(std::sin(corners[c][0] * 0.1) * std::cos(corners[c][1] * 0.1));
+			}
+		}
+	size_t nodeCount = nodes.size() / 3;
+	size_t expected = (size_t)(gridSize + 1) * (gridSize + 1);
+	std::printf("%zu nodes, %zu distinct vertices, tolerance %g\n", nodeCount, expected, tolerance);
+
+	typedef size_t(*WeldFunc)(const std::vector<double>&, double, std::vector<size_t>&);
+	const char* names[2] = { "Hash map (snapped key)", "XbimVertexWelder" };
+	WeldFunc funcs[2] = { WeldWithMap, WeldWithWelder };
+	for (int f = 0; f < 2; f++)
+	{
+		std::vector<size_t> lookup;
+		lookup.reserve(nodeCount);
+		size_t allocsBefore = allocations;
+		auto start = std::chrono::high_resolution_clock::now();
+		size_t welded = funcs[f](nodes, tolerance, lookup);
+		auto end = std::chrono::high_resolution_clock::now();
+		size_t allocs = allocations - allocsBefore;
+		double seconds = std::chrono::duration<double>(end - start).count();
+		std::printf("%-24s %10zu vertices %8.2f Mnodes/s %8.3f allocations/vertex\n",
+			names[f], welded, nodeCount / seconds / 1e6, (double)allocs / welded);
+	}
+	return 0;
+}
@@ -1,5 +1,7 @@
 ﻿using System;
+using System.Collections.Generic;
 using System.IO;
+using System.Reflection;
 using System.Runtime.Remoting;
 
 using Xbim.Common.Geometry;
@@ -14,10 +16,41 @@ using XbimGeometry.Interfaces;
 
 namespace Xbim.Geometry.Engine.Interop
 {  
+    /// <summary>
+    /// Where the parts of a face of a solid lie with respect to another solid, a face that crosses the surface of the other
+    /// solid is both Inside and Outside. The values are those of the engine's XbimFaceContainment
+    /// </summary>
+    [Flags]
+    public enum XbimFaceContainment
+    {
+        Unknown = 0,
+        OnOpposite = 0x01,
+        Outside = 0x02,
+        Inside = 0x04,
+        OnSame = 0x08
+    }
+
     public class XbimGeometryEngine : IXbimGeometryCreator
     {
+        private delegate bool ClassifyFunc(IXbimSolid solid, IXbimSolid other, double tolerance, double deflection, ref int[] faces, ref List<List<XbimPoint3D>> intersections);
+        private delegate void BooleanContextStatisticsFunc(ref int reused, ref int created, ref int invalidated);
+
 
         private readonly IXbimGeometryCreator _engine;
+        //the batch entry point is not part of IXbimGeometryCreator, it is bound from the engine when it is loaded
+        private readonly Func<IfcGeometricRepresentationItem[], double, double, double, XbimGeometryType, IXbimShapeGeometryData[]> _createShapeGeometryBatch;
+        private readonly Func<IfcGeometricRepresentationItem, double, double, double, XbimGeometryType, IXbimShapeGeometryData> _createItemShapeGeometry;
+        private readonly Func<string, bool> _openMeshCache;
+        private readonly Action _closeMeshCache;
+        private readonly Func<TextReader, bool, IXbimGeometryObject> _readTriangulationText;
+        private readonly Func<byte[], bool, IXbimGeometryObject> _readTriangulationData;
+        private readonly Func<string, bool, IXbimGeometryObject> _readTriangulationFile;
+        private readonly Action<BinaryWriter, IXbimGeometryObject, double, double> _writeFacets;
+        private readonly Func<IXbimSolid, IList<XbimPoint3D>, double, double, bool[]> _containsPoints;
+        private readonly Func<IXbimSolid, double, double, IXbimSolid> _createFacetedSolid;
+        private readonly ClassifyFunc _classify;
+        private readonly FieldInfo _cacheBooleanContexts;
+        private readonly BooleanContextStatisticsFunc _booleanContextStatistics;
 
         static XbimGeometryEngine()
         {
@@ -37,6 +70,43 @@ namespace Xbim.Geometry.Engine.Interop
 
             ObjectHandle oh = Activator.CreateInstance(assemblyName, "Xbim.Geometry.XbimGeometryCreator");
             _engine = oh.Unwrap() as IXbimGeometryCreator;   
+            var batch = _engine.GetType().GetMethod("CreateShapeGeometry", new[] { typeof(IfcGeometricRepresentationItem[]), typeof(double), typeof(double), typeof(double), typeof(XbimGeometryType) });
+            _createShapeGeometryBatch = (Func<IfcGeometricRepresentationItem[], double, double, double, XbimGeometryType, IXbimShapeGeometryData[]>)
+                Delegate.CreateDelegate(typeof(Func<IfcGeometricRepresentationItem[], double, double, double, XbimGeometryType, IXbimShapeGeometryData[]>), _engine, batch);
+            var item = _engine.GetType().GetMethod("CreateShapeGeometry", new[] { typeof(IfcGeometricRepresentationItem), typeof(double), typeof(double), typeof(double), typeof(XbimGeometryType) });
+            _createItemShapeGeometry = (Func<IfcGeometricRepresentationItem, double, double, double, XbimGeometryType, IXbimShapeGeometryData>)
+                Delegate.CreateDelegate(typeof(Func<IfcGeometricRepresentationItem, double, double, double, XbimGeometryType, IXbimShapeGeometryData>), _engine, item);
+            _openMeshCache = (Func<string, bool>)Delegate.CreateDelegate(typeof(Func<string, bool>), _engine.GetType().GetMethod("OpenMeshCache"));
+            _closeMeshCache = (Action)Delegate.CreateDelegate(typeof(Action), _engine.GetType().GetMethod("CloseMeshCache"));
+            //the triangulation readers and writers are only in engines built with Carve
+            _readTriangulationText = Bind<Func<TextReader, bool, IXbimGeometryObject>>(_engine,
+                _engine.GetType().GetMethod("ReadTriangulation", new[] { typeof(TextReader), typeof(bool) }));
+            _readTriangulationData = Bind<Func<byte[], bool, IXbimGeometryObject>>(_engine,
+                _engine.GetType().GetMethod("ReadTriangulation", new[] { typeof(byte[]), typeof(bool) }));
+            _readTriangulationFile = Bind<Func<string, bool, IXbimGeometryObject>>(_engine, _engine.GetType().GetMethod("ReadTriangulationFile"));
+            _writeFacets = Bind<Action<BinaryWriter, IXbimGeometryObject, double, double>>(_engine, _engine.GetType().GetMethod("WriteFacets"));
+            _containsPoints = (Func<IXbimSolid, IList<XbimPoint3D>, double, double, bool[]>)Delegate.CreateDelegate(typeof(Func<IXbimSolid, IList<XbimPoint3D>, double, double, bool[]>), _engine,
+                _engine.GetType().GetMethod("ContainsPoints"));
+            //as is faceting and classification
+            _createFacetedSolid = Bind<Func<IXbimSolid, double, double, IXbimSolid>>(_engine,
+                _engine.GetType().GetMethod("CreateFacetedSolid", new[] { typeof(IXbimSolid), typeof(double), typeof(double) }));
+            _classify = Bind<ClassifyFunc>(_engine, _engine.GetType().GetMethod("Classify"));
+            _cacheBooleanContexts = _engine.GetType().GetField("CacheBooleanContexts");
+            _booleanContextStatistics = (BooleanContextStatisticsFunc)Delegate.CreateDelegate(typeof(BooleanContextStatisticsFunc),
+                _engine.GetType().GetMethod("GetBooleanContextStatistics"));
+        }
+
+        //binds a method that only some builds of the engine have, null if this one does not
+        private static T Bind<T>(object target, MethodInfo method) where T : class
+        {
+            if (method == null) return null;
+            return Delegate.CreateDelegate(typeof(T), target, method) as T;
+        }
+
+        private static void Supported(Delegate method, string name)
+        {
+            if (method == null)
+                throw new NotSupportedException(name + " is not supported by this build of the geometry engine");
         }
         public IXbimGeometryObject Create(IfcGeometricRepresentationItem ifcRepresentation)
         {
@@ -59,6 +129,98 @@ namespace Xbim.Geometry.Engine.Interop
             return _engine.CreateShapeGeometry(geometryObject, precision, deflection, angle, storageType);
         }
 
+        /// <summary>
+        /// Creates and triangulates all of the items in one call, the engine schedules them on its native thread pool
+        /// </summary>
+        /// <returns>The shape geometry of items[i] at [i], null if the item has no geometry</returns>
+        public IXbimShapeGeometryData[] CreateShapeGeometry(IfcGeometricRepresentationItem[] items, double precision, double deflection,
+            double angle, XbimGeometryType storageType)
+        {
+            return _createShapeGeometryBatch(items, precision, deflection, angle, storageType);
+        }
+
+        /// <summary>
+        /// Creates and triangulates the item, if the mesh cache is open an identical item meshed by an earlier run is read from it instead
+        /// </summary>
+        /// <returns>The shape geometry of the item, null if it has no geometry</returns>
+        public IXbimShapeGeometryData CreateShapeGeometry(IfcGeometricRepresentationItem item, double precision, double deflection,
+            double angle, XbimGeometryType storageType)
+        {
+            return _createItemShapeGeometry(item, precision, deflection, angle, storageType);
+        }
+
+        /// <summary>
+        /// Opens the file that persists the meshes of items between runs, it is created if it does not exist.
+        /// The cache is shared by every engine in the process, a file can be open in one process at a time
+        /// </summary>
+        /// <returns>false if the file could not be opened, the reason is logged</returns>
+        public bool OpenMeshCache(string path)
+        {
+            return _openMeshCache(path);
+        }
+
+        public void CloseMeshCache()
+        {
+            _closeMeshCache();
+        }
+
+        /// <summary>
+        /// Tests many points against one solid, e.g. to find the space each element is in. The faces of the solid are put in a
+        /// tree of triangles once and the points are classified concurrently
+        /// </summary>
+        /// <returns>For each point whether it is inside the solid or on its boundary within tolerance</returns>
+        public bool[] ContainsPoints(IXbimSolid solid, IList<XbimPoint3D> points, double tolerance, double deflection)
+        {
+            return _containsPoints(solid, points, tolerance, deflection);
+        }
+
+        /// <summary>
+        /// Facets the solid at the deflection, the faces of the result are those reported by Classify
+        /// </summary>
+        public IXbimSolid CreateFacetedSolid(IXbimSolid solid, double precision, double deflection)
+        {
+            Supported(_createFacetedSolid, "CreateFacetedSolid");
+            return _createFacetedSolid(solid, precision, deflection);
+        }
+
+        /// <summary>
+        /// Classifies the faces of solid against other without building a boolean result. Solids that are not faceted are faceted
+        /// at the deflection first, facet them with CreateFacetedSolid to match the faces to their containment
+        /// </summary>
+        /// <param name="faces">The containment of each face of solid, in the order of its faces</param>
+        /// <param name="intersections">The curves along which the surfaces meet, in an order that depends only on their points</param>
+        /// <returns>false if the faces could not be classified, the reason is logged</returns>
+        public bool Classify(IXbimSolid solid, IXbimSolid other, double tolerance, double deflection, out XbimFaceContainment[] faces, out List<List<XbimPoint3D>> intersections)
+        {
+            Supported(_classify, "Classify");
+            int[] bits = null;
+            intersections = null;
+            var classified = _classify(solid, other, tolerance, deflection, ref bits, ref intersections);
+            faces = bits == null ? null : Array.ConvertAll(bits, b => (XbimFaceContainment)b);
+            return classified;
+        }
+
+        /// <summary>
+        /// When true the intersection context of each solid cut by an OCC boolean is kept for a later cut of the same solid at the
+        /// same location. A cut that raises the tolerances of the solid drops its context, so only repeated cuts whose tools do not
+        /// meet the faces of the solid reuse one. The setting is shared by every engine in the process
+        /// </summary>
+        public bool CacheBooleanContexts
+        {
+            get { return (bool)_cacheBooleanContexts.GetValue(null); }
+            set { _cacheBooleanContexts.SetValue(null, value); }
+        }
+
+        /// <summary>
+        /// Totals for the process of the contexts the cuts have reused and made new, and of those dropped as the tolerances of their
+        /// solids had changed
+        /// </summary>
+        public void GetBooleanContextStatistics(out int reused, out int created, out int invalidated)
+        {
+            reused = created = invalidated = 0;
+            _booleanContextStatistics(ref reused, ref created, ref invalidated);
+        }
+
         public IXbimShapeGeometryData CreateShapeGeometry(IXbimGeometryObject geometryObject, double precision, double deflection, double angle)
         {
             return _engine.CreateShapeGeometry(geometryObject,  precision,  deflection,  angle, XbimGeometryType.Polyhedron);
@@ -320,6 +482,44 @@ namespace Xbim.Geometry.Engine.Interop
         {
             WriteTriangulation(bw, shape, tolerance, deflection: deflection, angle: 0.5);
         }
+
+        /// <summary>
+        /// Writes the binary twin of the text triangulation, every vertex and normal at full precision, solids that are not faceted
+        /// are faceted at the deflection first
+        /// </summary>
+        public void WriteFacets(BinaryWriter bw, IXbimGeometryObject shape, double tolerance, double deflection)
+        {
+            Supported(_writeFacets, "WriteFacets");
+            _writeFacets(bw, shape, tolerance, deflection);
+        }
+
+        /// <summary>
+        /// Reads a text triangulation written by WriteTriangulation, if unTriangulate is true coplanar faces are merged
+        /// </summary>
+        /// <returns>A faceted solid, empty if the triangulation could not be read, the reason is logged</returns>
+        public IXbimGeometryObject ReadTriangulation(TextReader tr, bool unTriangulate)
+        {
+            Supported(_readTriangulationText, "ReadTriangulation");
+            return _readTriangulationText(tr, unTriangulate);
+        }
+
+        /// <summary>
+        /// Reads a text triangulation or the binary one written by WriteFacets, the format is told from the data
+        /// </summary>
+        public IXbimGeometryObject ReadTriangulation(byte[] data, bool unTriangulate)
+        {
+            Supported(_readTriangulationData, "ReadTriangulation");
+            return _readTriangulationData(data, unTriangulate);
+        }
+
+        /// <summary>
+        /// Reads a text or binary triangulation from a file, which is memory mapped rather than loaded
+        /// </summary>
+        public IXbimGeometryObject ReadTriangulationFile(string path, bool unTriangulate)
+        {
+            Supported(_readTriangulationFile, "ReadTriangulationFile");
+            return _readTriangulationFile(path, unTriangulate);
+        }
         public ILogger Logger
         {
             get { return _engine.Logger; }
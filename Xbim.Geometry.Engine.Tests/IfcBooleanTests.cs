@@ -543,6 +543,51 @@ namespace GeometryTests
             }
         }
 
+        [TestMethod]
+        public void BooleanCutAllFacetedToolsMatchesSequentialCutsTest()
+        {
+            using (var m = XbimModel.CreateTemporaryModel())
+            {
+                using (var txn = m.BeginTransaction())
+                {
+                    var precision = m.ModelFactors.PrecisionBoolean;
+                    var body = _xbimGeometryCreator.CreateFacetedSolid(_xbimGeometryCreator.CreateSolid(IfcModelBuilder.MakeBlock(m, 10, 15, 20)),
+                        m.ModelFactors.Precision, m.ModelFactors.DeflectionTolerance);
+                    //three holes through the body, each overlapping the next
+                    var holes = new[] { new[] { 2.0, 2, 4, 4 }, new[] { 4.0, 4, 4, 4 }, new[] { 3.0, 5, 2, 6 } };
+                    var tools = _xbimGeometryCreator.CreateSolidSet();
+                    foreach (var hole in holes)
+                    {
+                        var block = IfcModelBuilder.MakeBlock(m, hole[2], hole[3], 30);
+                        block.Position.Location.SetXYZ(hole[0], hole[1], -5);
+                        tools.Add(_xbimGeometryCreator.CreateFacetedSolid(_xbimGeometryCreator.CreateSolid(block),
+                            m.ModelFactors.Precision, m.ModelFactors.DeflectionTolerance));
+                    }
+                    var bodySet = _xbimGeometryCreator.CreateSolidSet();
+                    bodySet.Add(body);
+                    var cutAll = bodySet.Cut(tools, precision);
+
+                    IXbimSolidSet sequential = bodySet;
+                    foreach (var tool in tools)
+                    {
+                        var next = _xbimGeometryCreator.CreateSolidSet();
+                        foreach (var solid in sequential)
+                            foreach (var cut in solid.Cut(tool, precision))
+                                next.Add(cut);
+                        sequential = next;
+                    }
+
+                    Assert.IsTrue(cutAll.Count == sequential.Count, "Cutting all tools at once should give as many solids as cutting them in turn");
+                    var cutAllVolume = cutAll.Sum(s => s.Volume);
+                    var sequentialVolume = sequential.Sum(s => s.Volume);
+                    //holes of 4x4, 4x4 and 2x6 sharing 2x2, 1x2 and 1x3 pairwise and 1x1 together, through a 20 high body
+                    var expected = 10 * 15 * 20 - (16 + 16 + 12 - 4 - 2 - 3 + 1) * 20;
+                    Assert.IsTrue(Math.Abs(cutAllVolume - sequentialVolume) <= expected * 1e-6, "Cutting all tools at once should remove the same volume as cutting them in turn");
+                    Assert.IsTrue(Math.Abs(cutAllVolume - expected) <= expected * 1e-6, "Volume is incorrect");
+                }
+            }
+        }
+
         [TestMethod]
         public void BooleanCutFacetedSolidWithFacetedSolidNonPlanarTest()
         {
@@ -1166,6 +1211,57 @@ namespace GeometryTests
                  }
              }
          } 
+
+        [TestMethod]
+        public void BooleanContextReusedByRepeatedCutTest()
+        {
+            using (var m = XbimModel.CreateTemporaryModel())
+            {
+                using (var txn = m.BeginTransaction())
+                {
+                    var precision = m.ModelFactors.PrecisionBoolean;
+                    var body = _xbimGeometryCreator.CreateSolid(IfcModelBuilder.MakeBlock(m, 10, 15, 20));
+                    //two voids inside the body, cutting them meets none of its faces
+                    var void1 = IfcModelBuilder.MakeSphere(m, 1);
+                    void1.Position.Location.SetXYZ(3, 4, 5);
+                    var void2 = IfcModelBuilder.MakeSphere(m, 1);
+                    void2.Position.Location.SetXYZ(6, 10, 14);
+                    //a hole through the body, its cut raises the tolerances of the faces it crosses
+                    var hole = IfcModelBuilder.MakeRightCircularCylinder(m, 1, 30);
+                    hole.Position.Location.SetXYZ(5, 7, -5);
+                    var tools = new IfcCsgPrimitive3D[] { void1, void2, hole, void1 }.Select(t => _xbimGeometryCreator.CreateSolid(t)).ToArray();
+                    var expected = tools.Select(t => body.Cut(t, precision).Sum(s => s.Volume)).ToArray();
+
+                    var cutsBody = _xbimGeometryCreator.CreateSolid(IfcModelBuilder.MakeBlock(m, 10, 15, 20));
+                    int reused, created, invalidated;
+                    _xbimGeometryCreator.GetBooleanContextStatistics(out reused, out created, out invalidated);
+                    _xbimGeometryCreator.CacheBooleanContexts = true;
+                    try
+                    {
+                        var counts = new int[tools.Length, 3];
+                        for (int i = 0; i < tools.Length; i++)
+                        {
+                            var volume = cutsBody.Cut(tools[i], precision).Sum(s => s.Volume);
+                            Assert.IsTrue(Math.Abs(volume - expected[i]) <= expected[i] * 1e-6, "A kept context should not change the result of a cut");
+                            int r, c, inv;
+                            _xbimGeometryCreator.GetBooleanContextStatistics(out r, out c, out inv);
+                            counts[i, 0] = r - reused;
+                            counts[i, 1] = c - created;
+                            counts[i, 2] = inv - invalidated;
+                            reused = r; created = c; invalidated = inv;
+                        }
+                        Assert.IsTrue(counts[0, 1] == 1, "The first cut should make a context");
+                        Assert.IsTrue(counts[1, 0] == 1, "The second void should reuse the context of the first");
+                        Assert.IsTrue(counts[2, 0] == 1 && counts[2, 2] == 1, "The hole should reuse the context and then drop it");
+                        Assert.IsTrue(counts[3, 1] == 1, "The cut after the hole should make a new context");
+                    }
+                    finally
+                    {
+                        _xbimGeometryCreator.CacheBooleanContexts = false;
+                    }
+                }
+            }
+        }
         #endregion
     }
 }
@@ -1,6 +1,10 @@
 ﻿using System;
+using System.Collections.Generic;
 using System.Diagnostics;
+using System.IO;
+using System.Linq;
 using Microsoft.VisualStudio.TestTools.UnitTesting;
+using Xbim.Common.Geometry;
 using Xbim.Geometry.Engine.Interop;
 using Xbim.Ifc2x3.GeometricModelResource;
 using Xbim.Ifc2x3.GeometryResource;
@@ -127,6 +131,121 @@ namespace GeometryTests
             }
         }
 
+        [TestMethod]
+        public void ContainsPointsTest()
+        {
+            using (var m = XbimModel.CreateTemporaryModel())
+            {
+                using (var txn = m.BeginTransaction())
+                {
+                    var block = _xbimGeometryCreator.CreateSolid(IfcModelBuilder.MakeBlock(m, 10, 15, 20));
+                    var sphere = _xbimGeometryCreator.CreateSolid(IfcModelBuilder.MakeSphere(m, 10));
+                    var precision = m.ModelFactors.Precision;
+                    var deflection = m.ModelFactors.DeflectionTolerance;
+                    foreach (var solid in new[] { block, sphere })
+                    {
+                        var bb = solid.BoundingBox;
+                        var centre = new XbimPoint3D(bb.X + bb.SizeX / 2, bb.Y + bb.SizeY / 2, bb.Z + bb.SizeZ / 2);
+                        var points = new[]
+                        {
+                            centre,
+                            new XbimPoint3D(bb.X - 1, centre.Y, centre.Z), //outside a face
+                            new XbimPoint3D(bb.X + bb.SizeX * 0.01, bb.Y + bb.SizeY * 0.01, bb.Z + bb.SizeZ * 0.01), //inside the block, outside the sphere
+                            new XbimPoint3D(centre.X - (solid == sphere ? 10 : bb.SizeX / 2), centre.Y, centre.Z) //on the boundary
+                        };
+                        var contained = _xbimGeometryCreator.ContainsPoints(solid, points, precision, deflection);
+                        Assert.IsTrue(contained.Length == points.Length, "A result is required for each point");
+                        Assert.IsTrue(contained[0], "The centre should be contained");
+                        Assert.IsFalse(contained[1], "A point outside the box should not be contained");
+                        Assert.IsTrue(contained[2] == (solid == block), "A point near the corner of the box is only in the block");
+                        Assert.IsTrue(contained[3], "A point on the boundary should be contained");
+                    }
+                }
+            }
+        }
+
+        [TestMethod]
+        public void ClassifyFacesTest()
+        {
+            using (var m = XbimModel.CreateTemporaryModel())
+            {
+                using (var txn = m.BeginTransaction())
+                {
+                    var precision = m.ModelFactors.Precision;
+                    var deflection = m.ModelFactors.DeflectionTolerance;
+                    var block = _xbimGeometryCreator.CreateFacetedSolid(_xbimGeometryCreator.CreateSolid(IfcModelBuilder.MakeBlock(m, 10, 15, 20)), precision, deflection);
+                    var sphere = _xbimGeometryCreator.CreateSolid(IfcModelBuilder.MakeSphere(m, 10));
+                    XbimFaceContainment[] faces;
+                    List<List<XbimPoint3D>> intersections;
+                    //the sphere is centred on a corner of the block, the faces at the corner cross its surface
+                    Assert.IsTrue(_xbimGeometryCreator.Classify(block, sphere, precision, deflection, out faces, out intersections), "Classification failed");
+                    Assert.IsTrue(faces.Length == block.Faces.Count(), "A containment is required for each face");
+                    Assert.IsTrue(faces.Any(f => f.HasFlag(XbimFaceContainment.Inside)), "Some faces should be inside the sphere");
+                    Assert.IsTrue(faces.Any(f => f.HasFlag(XbimFaceContainment.Outside)), "Some faces should be outside the sphere");
+                    Assert.IsTrue(intersections.Count > 0, "The surfaces should intersect");
+                    //the curves are ordered by their points, not by where carve happened to allocate them
+                    XbimFaceContainment[] facesAgain;
+                    List<List<XbimPoint3D>> intersectionsAgain;
+                    Assert.IsTrue(_xbimGeometryCreator.Classify(block, sphere, precision, deflection, out facesAgain, out intersectionsAgain), "Classification failed");
+                    Assert.IsTrue(faces.SequenceEqual(facesAgain), "Faces should be classified the same way each time");
+                    Assert.IsTrue(intersections.Count == intersectionsAgain.Count, "The same curves should be found each time");
+                    for (int i = 0; i < intersections.Count; i++)
+                        Assert.IsTrue(intersections[i].SequenceEqual(intersectionsAgain[i]), "The curves should be reported in the same order each time");
+                    //a sphere well clear of the block
+                    var clear = (IXbimSolid)sphere.Transform(XbimMatrix3D.CreateTranslation(new XbimVector3D(100, 0, 0)));
+                    Assert.IsTrue(_xbimGeometryCreator.Classify(block, clear, precision, deflection, out faces, out intersections), "Classification failed");
+                    Assert.IsTrue(faces.All(f => f == XbimFaceContainment.Outside), "All faces should be outside a disjoint solid");
+                    Assert.IsTrue(intersections.Count == 0, "Disjoint solids should not intersect");
+                }
+            }
+        }
+
+        [TestMethod]
+        public void ReadWriteTriangulationOfSphereTest()
+        {
+            using (var m = XbimModel.CreateTemporaryModel())
+            {
+                using (var txn = m.BeginTransaction())
+                {
+                    var sphere = IfcModelBuilder.MakeSphere(m, 10);
+                    var solid = _xbimGeometryCreator.CreateSolid(sphere);
+                    //a curved face is written with the normal of every corner of its triangles
+                    var tw = new StringWriter();
+                    _xbimGeometryCreator.WriteTriangulation(tw, solid, m.ModelFactors.Precision, m.ModelFactors.DeflectionTolerance, 0.5);
+                    var triangulated = _xbimGeometryCreator.ReadTriangulation(new StringReader(tw.ToString()), false) as IXbimSolid;
+                    Assert.IsNotNull(triangulated, "Invalid solid returned");
+                    Assert.IsTrue(triangulated.IsValid, "The triangulation of the sphere could not be read");
+                    Assert.IsTrue(Math.Abs(solid.Volume - triangulated.Volume) < solid.Volume * 0.05, "Volume differs too much");
+                }
+            }
+        }
+
+        [TestMethod]
+        public void ReadWriteFacetsOfCylinderTest()
+        {
+            using (var m = XbimModel.CreateTemporaryModel())
+            {
+                using (var txn = m.BeginTransaction())
+                {
+                    var cylinder = IfcModelBuilder.MakeRightCircularCylinder(m, 10, 20);
+                    var solid = _xbimGeometryCreator.CreateSolid(cylinder);
+                    var data = new MemoryStream();
+                    using (var bw = new BinaryWriter(data))
+                        _xbimGeometryCreator.WriteFacets(bw, solid, m.ModelFactors.Precision, m.ModelFactors.DeflectionTolerance);
+                    var facets = _xbimGeometryCreator.ReadTriangulation(data.ToArray(), false) as IXbimSolid;
+                    Assert.IsNotNull(facets, "Invalid solid returned");
+                    Assert.IsTrue(facets.IsValid, "The facets of the cylinder could not be read");
+                    Assert.IsTrue(Math.Abs(solid.Volume - facets.Volume) < solid.Volume * 0.05, "Volume differs too much");
+                    //the binary and text forms of the same facets read back to the same solid
+                    var tw = new StringWriter();
+                    _xbimGeometryCreator.WriteTriangulation(tw, facets, m.ModelFactors.Precision, m.ModelFactors.DeflectionTolerance, 0.5);
+                    var text = _xbimGeometryCreator.ReadTriangulation(new StringReader(tw.ToString()), false) as IXbimSolid;
+                    Assert.IsNotNull(text, "Invalid solid returned");
+                    Assert.IsTrue(Math.Abs(facets.Volume - text.Volume) < 0.001, "Volume of the text and binary triangulations differs");
+                }
+            }
+        }
+
        
 
         public static void GeneralTest(IXbimSolid solid, bool ignoreVolume = false, bool isHalfSpace= false, int entityLabel = 0)
@@ -1,4 +1,5 @@
 ﻿using System;
+using System.IO;
 using System.Linq;
 using Microsoft.VisualStudio.TestTools.UnitTesting;
 using Xbim.Geometry.Engine.Interop;
@@ -78,6 +79,63 @@ namespace GeometryTests
         }
         
        
+        [TestMethod]
+        public void BatchShapeGeometryTest()
+        {
+            var xbimGeometryCreator = new XbimGeometryEngine();
+            using (var m = new XbimModel())
+            {
+                m.CreateFrom("SolidTestFiles\\1- IfcExtrudedAreaSolid-IfcProfileDef-Parameterised.ifc", null, null, true, true);
+                var items = m.Instances.OfType<IfcExtrudedAreaSolid>().Cast<IfcGeometricRepresentationItem>().ToArray();
+                Assert.IsTrue(items.Length > 1, "Extruded Solids not found");
+                var batch = xbimGeometryCreator.CreateShapeGeometry(items, m.ModelFactors.Precision, m.ModelFactors.DeflectionTolerance, m.ModelFactors.DeflectionAngle, XbimGeometryType.PolyhedronBinary);
+                Assert.IsTrue(batch.Length == items.Length);
+                for (int i = 0; i < items.Length; i++) //each result should be that of creating the item on its own
+                {
+                    var solid = xbimGeometryCreator.Create(items[i]);
+                    var shapeGeom = xbimGeometryCreator.CreateShapeGeometry(solid, m.ModelFactors.Precision, m.ModelFactors.DeflectionTolerance, m.ModelFactors.DeflectionAngle, XbimGeometryType.PolyhedronBinary);
+                    Assert.IsNotNull(batch[i], "No shape geometry for #{0}", items[i].EntityLabel);
+                    Assert.IsTrue(shapeGeom.ShapeData.SequenceEqual(batch[i].ShapeData), "Shape geometry differs for #{0}", items[i].EntityLabel);
+                }
+            }
+        }
+
+        [TestMethod]
+        public void MeshCacheTest()
+        {
+            var xbimGeometryCreator = new XbimGeometryEngine();
+            var cacheFile = Path.GetTempFileName();
+            try
+            {
+                using (var m = new XbimModel())
+                {
+                    m.CreateFrom("SolidTestFiles\\1- IfcExtrudedAreaSolid-IfcProfileDef-Parameterised.ifc", null, null, true, true);
+                    var items = m.Instances.OfType<IfcExtrudedAreaSolid>().ToArray();
+                    Assert.IsTrue(items.Length > 1, "Extruded Solids not found");
+                    var mf = m.ModelFactors;
+                    var created = items.Select(i => xbimGeometryCreator.CreateShapeGeometry(i, mf.Precision, mf.DeflectionTolerance, mf.DeflectionAngle, XbimGeometryType.PolyhedronBinary)).ToArray();
+                    //the first run writes the meshes, a second run, after the cache is reopened, must read back the same data
+                    for (int run = 0; run < 2; run++)
+                    {
+                        Assert.IsTrue(xbimGeometryCreator.OpenMeshCache(cacheFile), "Mesh cache could not be opened");
+                        for (int i = 0; i < items.Length; i++)
+                        {
+                            var shapeGeom = xbimGeometryCreator.CreateShapeGeometry(items[i], mf.Precision, mf.DeflectionTolerance, mf.DeflectionAngle, XbimGeometryType.PolyhedronBinary);
+                            Assert.IsNotNull(shapeGeom, "No shape geometry for #{0}", items[i].EntityLabel);
+                            Assert.IsTrue(created[i].ShapeData.SequenceEqual(shapeGeom.ShapeData), "Shape geometry differs for #{0}", items[i].EntityLabel);
+                        }
+                        xbimGeometryCreator.CloseMeshCache();
+                    }
+                    Assert.IsTrue(new FileInfo(cacheFile).Length > 0, "Nothing was written to the mesh cache");
+                }
+            }
+            finally
+            {
+                xbimGeometryCreator.CloseMeshCache();
+                File.Delete(cacheFile);
+            }
+        }
+
         [TestMethod]
         public void TestDerivedProfileDefWithTShapedParent()
         {
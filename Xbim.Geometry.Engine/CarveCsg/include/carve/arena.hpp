@@ -0,0 +1,63 @@
+#pragma once
+
+#include <carve/carve.hpp>
+
+#include <cstddef>
+
+namespace carve {
+  namespace mesh {
+
+    /**
+     * \class Arena
+     * \brief Pooled storage for the edges, faces and meshes of a mesh
+     * operation.
+     *
+     * While an Arena::Scope is alive, the edges, faces and meshes
+     * created by its thread are carved out of large blocks instead of
+     * being allocated one at a time, and the storage of those deleted
+     * by the same thread is reused. The blocks are released together
+     * when the scope has ended and the last object taken from them has
+     * been deleted, by whichever thread deletes it, so objects may
+     * outlive the scope, for example in the result of a CSG operation.
+     *
+     * Objects created with no scope alive use the heap, as before.
+     * This header does not include the platform or thread headers.
+     */
+    class Arena {
+      struct Impl;
+      Impl *impl;
+
+      Arena();
+      ~Arena();
+      Arena(const Arena &);
+      Arena &operator=(const Arena &);
+
+      void release();
+
+    public:
+      class Scope {
+        Arena *arena;
+        Arena *previous;
+
+        Scope(const Scope &);
+        Scope &operator=(const Scope &);
+
+      public:
+        Scope();
+        ~Scope();
+
+        /// The number of objects taken from the arena of this scope,
+        /// and of those, the number that reused the storage of a
+        /// deleted object.
+        size_t allocations() const;
+        size_t reused() const;
+        /// The number of blocks allocated from the heap.
+        size_t blocks() const;
+      };
+
+      static void *allocate(size_t size);
+      static void deallocate(void *p, size_t size);
+    };
+
+  }
+}
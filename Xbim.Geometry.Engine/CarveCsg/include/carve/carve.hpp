@@ -167,6 +167,34 @@ namespace carve {
 
 
 
+  /**
+   * \class ExactPredicates
+   * \brief Selects the orientation tests used by the calling thread.
+   *
+   * While a scope that enables them is alive, geom2d::orient2d() and
+   * geom3d::orient3d() go through Shewchuk's adaptive predicates on
+   * its thread. These evaluate the determinant in floating point and
+   * only fall back to exact arithmetic when its sign is within the
+   * rounding error bound, so they cost little more than the plain
+   * determinant for all but near degenerate input. Scopes nest, and
+   * builds defining CARVE_USE_EXACT_PREDICATES always use them.
+   */
+  class ExactPredicates {
+    bool previous;
+
+    ExactPredicates(const ExactPredicates &);
+    ExactPredicates &operator=(const ExactPredicates &);
+
+  public:
+    ExactPredicates(bool enable);
+    ~ExactPredicates();
+
+    /// true if the calling thread uses the exact predicates.
+    static bool enabled();
+  };
+
+
+
   template<typename T>
   struct identity_t {
     typedef T argument_type;
@@ -57,6 +57,7 @@ namespace carve {
     namespace detail {
       struct Data;
       class LoopEdges;
+      class FaceBounds;
     }
 
     /** 
@@ -134,6 +135,14 @@ namespace carve {
         ~Hooks();
       };
 
+      /// Runs body(context, i) for each i in [0, count), on several
+      /// threads where it can, and returns when all have run. When set,
+      /// the intersection candidates and the intersections between the
+      /// candidate faces are found in parallel, with the same result as
+      /// the serial search. Not set by default.
+      typedef void (*parallel_for_t)(size_t count, void (*body)(void *context, size_t index), void *context);
+      static parallel_for_t parallel_for;
+
         /** 
          * \class Collector
          * \brief Base class for objects responsible for selecting result from which form the result polyhedron.
@@ -156,6 +165,10 @@ namespace carve {
     private:
       typedef carve::geom::RTreeNode<3, carve::mesh::Face<3> *> face_rtree_t;
       typedef std::unordered_map<carve::mesh::Face<3> *, std::vector<carve::mesh::Face<3> *> > face_pairs_t;
+      typedef std::vector<std::pair<carve::mesh::Face<3> *, carve::mesh::Face<3> *> > face_pair_list_t;
+
+      struct CandidateTask;
+      struct IntersectionPhase;
 
       /// The computed intersection data.
       Intersections intersections;
@@ -201,10 +214,36 @@ namespace carve {
 
      void generateIntersectionCandidates(meshset_t *a,
                                           const face_rtree_t *a_node,
+                                          const detail::FaceBounds &a_bounds,
                                           meshset_t *b,
                                           const face_rtree_t *b_node,
-                                          face_pairs_t &face_pairs,
+                                          const detail::FaceBounds &b_bounds,
+                                          face_pair_list_t &face_pairs,
 										  double EPSILON,bool descend_a = true);
+
+      /** 
+       * \brief Split the search for intersection candidates into
+       * subtree pairs that are searched in parallel, the pairs found
+       * are recorded in the order of the serial search.
+       */
+      void generateIntersectionCandidatesInParallel(meshset_t *a,
+                                                    const face_rtree_t *a_node,
+                                                    const detail::FaceBounds &a_bounds,
+                                                    meshset_t *b,
+                                                    const face_rtree_t *b_node,
+                                                    const detail::FaceBounds &b_bounds,
+                                                    face_pair_list_t &face_pairs,
+                                                    double EPSILON);
+      static void generateCandidateTask(void *context, size_t index);
+
+      /** 
+       * \brief Run one of the generate*Intersections() steps over all
+       * the face pairs. The pairs that intersect are found in parallel
+       * and then recorded serially, in order, so the intersections and
+       * the vertices created are the same as those of the serial step.
+       */
+      void generateIntersectionsInParallel(IntersectionPhase &phase);
+      static void findPhaseIntersections(void *context, size_t index);
       /** 
        * \brief Compute all points of intersection between poly \a a and poly \a b
        * 
@@ -445,8 +484,33 @@ namespace carve {
         CLASSIFY_EDGE           /**< Edge classifier. */
       };
 
+      /**
+       * \brief Where the faces of two polyhedra lie with respect to each
+       * other, and where their surfaces meet, as found by classify().
+       */
+      struct ClassifyResult {
+        /// For each face of a, and of b, in the order of faceBegin(), the
+        /// FaceClassBit of each part it was cut into, or-ed together. A
+        /// face that crosses the surface of the other polyhedron has
+        /// both FACE_IN_BIT and FACE_OUT_BIT, one that could not be
+        /// classified has none.
+        std::vector<unsigned> a_faces;
+        std::vector<unsigned> b_faces;
+        /// The curves along which the surfaces meet. A closed curve ends
+        /// with its first point. The curves, and the direction and first
+        /// point of each, are ordered by their coordinates.
+        std::vector<std::vector<carve::geom3d::Vector> > polylines;
+      };
+
       CSG::Hooks hooks;         /**< The manager for calculation hooks. */
 
+      /**
+       * When true, the orientation tests made while computing and
+       * slicing, on every thread, use Shewchuk's adaptive predicates,
+       * see carve::ExactPredicates. False by default.
+       */
+      bool exact_predicates;
+
       
 	  CSG(double prec = 1e-5); /* Constructs a CSG tree with the specified precision*/
 		
@@ -459,6 +523,8 @@ namespace carve {
        * @param b Polyhedron b
        * @param collector The collector (determines the CSG operation performed)
        * @param shared_edges A pointer to a set that will be populated with shared edges (if not NULL).
+       *        If the collector makes no result, the edges are those found, their vertices belong
+       *        to \a a, \a b or to this CSG until its next operation.
        * @param classify_type The type of classifier to use.
        * 
        * @return 
@@ -488,6 +554,48 @@ namespace carve {
         V2Set *shared_edges = NULL,
         CLASSIFY_TYPE classify_type = CLASSIFY_NORMAL);
 
+      /** 
+       * \brief Subtract a number of closed polyhedra from \a a, without
+       * first merging them into one.
+       *
+       * Tools whose bounding box is clear of that of \a a are skipped.
+       * The others are copied, each as a mesh of its own, into as few
+       * meshsets as possible in which no two bounding boxes overlap, and
+       * each of those is subtracted from \a a in a single pass, so that
+       * intersections and classification stay local to each tool. The
+       * openings of a wall rarely overlap, and are cut in one pass.
+       * 
+       * @param a Polyhedron a
+       * @param tools The polyhedra to subtract, which are not modified.
+       * @param classify_type The type of classifier to use.
+       * 
+       * @return A new meshset, a copy of \a a if no tool is near it.
+       */
+      meshset_t *subtract(
+        meshset_t *a,
+        const std::vector<meshset_t *> &tools,
+        CLASSIFY_TYPE classify_type = CLASSIFY_NORMAL);
+
+      /** 
+       * \brief Classify the faces of \a a and \a b with respect to each
+       * other, without building a result.
+       *
+       * The faces are intersected and classified as by compute(), but
+       * the parts they are cut into are only recorded against the face
+       * they came from, so no faces or meshes are created. Neither
+       * polyhedron is modified.
+       * 
+       * @param a Polyhedron a
+       * @param b Polyhedron b
+       * @param[out] result The classification of each face, and the intersection curves.
+       * @param classify_type The type of classifier to use.
+       */
+      void classify(
+        meshset_t *a,
+        meshset_t *b,
+        ClassifyResult &result,
+        CLASSIFY_TYPE classify_type = CLASSIFY_NORMAL);
+
       void slice(
         meshset_t *a,
         meshset_t *b,
@@ -32,9 +32,7 @@
 #  include <iostream>
 #endif
 
-#if defined CARVE_USE_EXACT_PREDICATES
-#  include <carve/shewchuk_predicates.hpp>
-#endif
+#include <carve/shewchuk_predicates.hpp>
 
 namespace carve {
   namespace geom2d {
@@ -57,7 +55,7 @@ namespace carve {
     /** 
      * \brief Return the orientation of c with respect to the ray defined by a->b.
      *
-     * (Can be implemented exactly)
+     * (Exact while carve::ExactPredicates are enabled)
      * 
      * @param[in] a 
      * @param[in] b 
@@ -67,19 +65,18 @@ namespace carve {
      *         zero, if c is colinear with a->b.
      *         negative, if c to the right of a->b.
      */
-#if defined CARVE_USE_EXACT_PREDICATES
     inline double orient2d(const P2 &a, const P2 &b, const P2 &c) {
+#if !defined CARVE_USE_EXACT_PREDICATES
+      if (!carve::ExactPredicates::enabled()) {
+        double acx = a.x - c.x;
+        double bcx = b.x - c.x;
+        double acy = a.y - c.y;
+        double bcy = b.y - c.y;
+        return acx * bcy - acy * bcx;
+      }
+#endif
       return shewchuk::orient2d(a.v, b.v, c.v);
     }
-#else
-    inline double orient2d(const P2 &a, const P2 &b, const P2 &c) {
-      double acx = a.x - c.x;
-      double bcx = b.x - c.x;
-      double acy = a.y - c.y;
-      double bcy = b.y - c.y;
-      return acx * bcy - acy * bcx;
-    }
-#endif
 
     /** 
      * \brief Determine whether p is internal to the anticlockwise
@@ -31,9 +31,7 @@
 #  include <iostream>
 #endif
 
-#if defined CARVE_USE_EXACT_PREDICATES
-#  include <carve/shewchuk_predicates.hpp>
-#endif
+#include <carve/shewchuk_predicates.hpp>
 
 namespace carve {
   namespace geom3d {
@@ -126,21 +124,18 @@ namespace carve {
     // return: +ve = d is below a,b,c
     //         -ve = d is above a,b,c
     //           0 = d is on a,b,c
-#if defined CARVE_USE_EXACT_PREDICATES
+    // exact while carve::ExactPredicates are enabled.
     inline double orient3d(const Vector &a,
                            const Vector &b,
                            const Vector &c,
                            const Vector &d) {
+#if !defined CARVE_USE_EXACT_PREDICATES
+      if (!carve::ExactPredicates::enabled()) {
+        return dotcross((a - d), (b - d), (c - d));
+      }
+#endif
       return shewchuk::orient3d(a.v, b.v, c.v, d.v);
     }
-#else
-    inline double orient3d(const Vector &a,
-                           const Vector &b,
-                           const Vector &c,
-                           const Vector &d) {
-      return dotcross((a - d), (b - d), (c - d));
-    }
-#endif
 
     // Volume of a tetrahedron described by 4 points. Will be
     // positive if the anticlockwise normal of a,b,c is oriented out
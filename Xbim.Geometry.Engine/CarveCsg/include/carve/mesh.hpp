@@ -18,6 +18,7 @@
 #pragma once
 #pragma warning (disable:4267) //disable for 64 bit compiles
 #include <carve/carve.hpp>
+#include <carve/arena.hpp>
 
 #include <carve/geom.hpp>
 #include <carve/geom3d.hpp>
@@ -140,6 +141,9 @@ namespace carve {
       face_t *face;
       Edge *prev, *next, *rev;
 
+      static void *operator new(size_t size) { return Arena::allocate(size); }
+      static void operator delete(void *p, size_t size) { Arena::deallocate(p, size); }
+
     private:
       static void _link(Edge *a, Edge *b) {
         a->next = b; b->prev = a;
@@ -291,6 +295,9 @@ namespace carve {
       project_t project;
       unproject_t unproject;
 
+      static void *operator new(size_t size) { return Arena::allocate(size); }
+      static void operator delete(void *p, size_t size) { Arena::deallocate(p, size); }
+
     private:
       Face &operator=(const Face &other);
 
@@ -639,6 +646,9 @@ namespace carve {
 
       meshset_t *meshset;
 
+      static void *operator new(size_t size) { return Arena::allocate(size); }
+      static void operator delete(void *p, size_t size) { Arena::deallocate(p, size); }
+
     protected:
       Mesh(std::vector<face_t *> &_faces,
            std::vector<edge_t *> &_open_edges,
@@ -728,10 +738,14 @@ namespace carve {
       typedef Face<ndim> face_t;
       typedef Mesh<ndim> mesh_t;
       typedef carve::geom::aabb<ndim> aabb_t;
+      typedef carve::geom::RTreeNode<ndim, face_t *> face_rtree_t;
 
       std::vector<vertex_t> vertex_storage;
       std::vector<mesh_t *> meshes;
 
+    private:
+      face_rtree_t *face_rtree;
+
     public:
       template<typename face_type>
       struct FaceIter : public std::iterator<std::random_access_iterator_tag, face_type> {
@@ -799,6 +813,7 @@ namespace carve {
 
       template<typename func_t>
       void transform(func_t func) {
+        invalidateFaceRTree();
         for (size_t i = 0; i < vertex_storage.size(); ++i) {
           vertex_storage[i].v = func(vertex_storage[i].v);
         }
@@ -850,6 +865,28 @@ namespace carve {
       void canonicalize();
 
       void separateMeshes();
+
+      // The spatial index of the faces left by the CSG operation that
+      // produced this mesh set, or NULL. CSG operations on this mesh set
+      // use it rather than building a new one. It is only valid while
+      // the faces and their vertices are unchanged, so anything that
+      // adds, removes or replaces a face, or moves a vertex, must call
+      // invalidateFaceRTree().
+      const face_rtree_t *faceRTree() const {
+        return face_rtree;
+      }
+
+      // Takes ownership of rtree, which must index exactly the faces of
+      // this mesh set.
+      void setFaceRTree(face_rtree_t *rtree) {
+        if (rtree == face_rtree) return;
+        delete face_rtree;
+        face_rtree = rtree;
+      }
+
+      void invalidateFaceRTree() {
+        setFaceRTree(NULL);
+      }
     };
 
 
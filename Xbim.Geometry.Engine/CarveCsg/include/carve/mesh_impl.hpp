@@ -124,9 +124,13 @@ namespace carve {
         e->face = fwdface;
         fwdface->n_edges++;
       }
+#if defined(CARVE_DEBUG)
+      // walks the whole of the merged face, which would make merging a
+      // run of faces in to one quadratic.
       for (Edge *e = link2_n; e != link1_n; e = e->next) {
         CARVE_ASSERT(e->face == fwdface);
       }
+#endif
 
       fwdface->n_edges -= n_removed;
 
@@ -813,7 +817,7 @@ namespace carve {
     MeshSet<ndim>::MeshSet(const std::vector<typename MeshSet<ndim>::vertex_t::vector_t> &points,
                            size_t n_faces,
                            const std::vector<int> &face_indices,
-                           const MeshOptions &opts, double EPSILON2, bool flipBadFaces ) {
+                           const MeshOptions &opts, double EPSILON2, bool flipBadFaces ) : face_rtree(NULL) {
       vertex_storage.reserve(points.size());
       std::vector<face_t *> faces;
       faces.reserve(n_faces);
@@ -843,14 +847,14 @@ namespace carve {
 
 
     template<unsigned ndim>
-    MeshSet<ndim>::MeshSet(std::vector<face_t *> &faces, const MeshOptions &opts) {
+    MeshSet<ndim>::MeshSet(std::vector<face_t *> &faces, const MeshOptions &opts) : face_rtree(NULL) {
       _init_from_faces(faces.begin(), faces.end(), opts);
     }
 
 
 
     template<unsigned ndim>
-    MeshSet<ndim>::MeshSet(std::list<face_t *> &faces, const MeshOptions &opts) {
+    MeshSet<ndim>::MeshSet(std::list<face_t *> &faces, const MeshOptions &opts) : face_rtree(NULL) {
       _init_from_faces(faces.begin(), faces.end(), opts);
     }
 
@@ -858,7 +862,7 @@ namespace carve {
 
     template<unsigned ndim>
     MeshSet<ndim>::MeshSet(std::vector<vertex_t> &_vertex_storage,
-                           std::vector<mesh_t *> &_meshes) {
+                           std::vector<mesh_t *> &_meshes) : face_rtree(NULL) {
       vertex_storage.swap(_vertex_storage);
       meshes.swap(_meshes);
 
@@ -870,7 +874,7 @@ namespace carve {
 
 
     template<unsigned ndim>
-    MeshSet<ndim>::MeshSet(std::vector<typename MeshSet<ndim>::mesh_t *> &_meshes) {
+    MeshSet<ndim>::MeshSet(std::vector<typename MeshSet<ndim>::mesh_t *> &_meshes) : face_rtree(NULL) {
       meshes.swap(_meshes);
       std::unordered_map<vertex_t *, size_t> vert_idx;
 
@@ -925,6 +929,7 @@ namespace carve {
 
     template<unsigned ndim>
     MeshSet<ndim>::~MeshSet() {
+      delete face_rtree;
       for (size_t i = 0; i < meshes.size(); ++i) {
         delete meshes[i];
       }
@@ -522,6 +522,7 @@ namespace carve {
 
       size_t flipEdges(meshset_t *mesh,
                        const FlippableBase &flipper, double EPSILON) {
+        mesh->invalidateFaceRTree();
         face_rtree_t *tree = face_rtree_t::construct_STR(mesh->faceBegin(), mesh->faceEnd(), 4, 4);
 
         size_t n_mods = 0;
@@ -676,6 +677,7 @@ namespace carve {
       // collapse edges edges based upon the predicate implemented by EdgeMerger.
       size_t collapseEdges(meshset_t *mesh,
                            const EdgeMerger &merger, double EPSILON) {
+        mesh->invalidateFaceRTree();
         face_rtree_t *tree = face_rtree_t::construct_STR(mesh->faceBegin(), mesh->faceEnd(), 4, 4);
 
         size_t n_mods = 0;
@@ -865,45 +867,67 @@ namespace carve {
 
 
 
+      // merges the faces connected by edges across which the normals
+      // differ by less than min_normal_angle, returns the number of
+      // faces removed. the normals either side of every closed edge are
+      // gathered in to arrays of their components and compared in one
+      // pass, then the faces are merged an edge at a time, always
+      // folding the face with fewer edges in to the other, as
+      // mergeFaces() moves the edges of the face it removes.
       size_t mergeCoplanarFaces(mesh_t *mesh, double min_normal_angle) {
-        std::unordered_set<edge_t *> coplanar_face_edges;
+        if (mesh->meshset) mesh->meshset->invalidateFaceRTree();
         double min_dp = cos(min_normal_angle);
-        size_t n_merge = 0;
-
-        for (size_t i = 0; i < mesh->closed_edges.size(); ++i) {
-          edge_t *e = mesh->closed_edges[i];
-          face_t *f1 = e->face;
-          face_t *f2 = e->rev->face;
+        const size_t n_pairs = mesh->closed_edges.size();
 
-          if (carve::geom::dot(f1->plane.N, f2->plane.N) < min_dp) {
-            continue;
-          }
+        std::vector<double> ax(n_pairs), ay(n_pairs), az(n_pairs);
+        std::vector<double> bx(n_pairs), by(n_pairs), bz(n_pairs);
+        for (size_t i = 0; i < n_pairs; ++i) {
+          const edge_t *e = mesh->closed_edges[i];
+          const vector_t &a = e->face->plane.N;
+          const vector_t &b = e->rev->face->plane.N;
+          ax[i] = a.x; ay[i] = a.y; az[i] = a.z;
+          bx[i] = b.x; by[i] = b.y; bz[i] = b.z;
+        }
+        std::vector<double> dp(n_pairs);
+        for (size_t i = 0; i < n_pairs; ++i) {
+          dp[i] = ax[i] * bx[i] + ay[i] * by[i] + az[i] * bz[i];
+        }
 
-          coplanar_face_edges.insert(std::min(e, e->rev));
+        std::vector<edge_t *> coplanar_edges;
+        for (size_t i = 0; i < n_pairs; ++i) {
+          if (dp[i] >= min_dp) coplanar_edges.push_back(mesh->closed_edges[i]);
         }
+        const size_t n_coplanar = coplanar_edges.size();
 
-        while (coplanar_face_edges.size()) {
-          edge_t *edge = *coplanar_face_edges.begin();
-          if (edge->face == edge->rev->face) {
-            coplanar_face_edges.erase(edge);
+        // the loops that merging removes are deleted at the end, their
+        // edges have no face, so later edges of the list that were in
+        // them are skipped.
+        std::vector<edge_t *> removed_loops;
+        size_t n_merge = 0;
+        for (size_t i = 0; i < n_coplanar; ++i) {
+          edge_t *edge = coplanar_edges[i];
+          if (edge->face == NULL || edge->face == edge->rev->face) {
             continue;
           }
-
+          if (edge->face->n_edges < edge->rev->face->n_edges) {
+            edge = edge->rev;
+          }
           edge_t *removed = edge->mergeFaces();
-          if (removed == NULL) {
-            coplanar_face_edges.erase(edge);
+          if (removed != NULL) {
+            removed_loops.push_back(removed);
             ++n_merge;
-          } else {
-            edge_t *e = removed;
-            do {
-              edge_t *n = e->next;
-              coplanar_face_edges.erase(std::min(e, e->rev));
-              delete e->rev;
-              delete e;
-              e = n;
-            } while (e != removed);
           }
         }
+
+        for (size_t i = 0; i < removed_loops.size(); ++i) {
+          edge_t *e = removed_loops[i];
+          do {
+            edge_t *n = e->next;
+            delete e->rev;
+            delete e;
+            e = n;
+          } while (e != removed_loops[i]);
+        }
         return n_merge;
       }
 
@@ -1063,6 +1087,7 @@ namespace carve {
 
 
       size_t cleanFaceEdges(mesh_t *mesh) {
+        if (mesh->meshset) mesh->meshset->invalidateFaceRTree();
         size_t n_removed = 0;
         for (size_t i = 0; i < mesh->faces.size(); ++i) {
           face_t *face = mesh->faces[i];
@@ -1094,6 +1119,7 @@ namespace carve {
 
 
       void removeRemnantFaces(mesh_t *mesh) {
+        if (mesh->meshset) mesh->meshset->invalidateFaceRTree();
         size_t n = 0;
         for (size_t i = 0; i < mesh->faces.size(); ++i) {
           if (mesh->faces[i]->nEdges() == 0) {
@@ -1164,6 +1190,245 @@ namespace carve {
 
 
 
+      // The quadric error of Garland and Heckbert, the sum of the
+      // squared distances of a point from a set of planes, held as
+      // the upper triangle of the symmetric 4x4 matrix.
+      struct Quadric {
+        double q[10];
+
+        Quadric() {
+          std::fill(q, q + 10, 0.0);
+        }
+
+        void addPlane(const vector_t &N, double d) {
+          q[0] += N.x * N.x; q[1] += N.x * N.y; q[2] += N.x * N.z; q[3] += N.x * d;
+          q[4] += N.y * N.y; q[5] += N.y * N.z; q[6] += N.y * d;
+          q[7] += N.z * N.z; q[8] += N.z * d;
+          q[9] += d * d;
+        }
+
+        Quadric &operator+=(const Quadric &other) {
+          for (size_t i = 0; i < 10; ++i) q[i] += other.q[i];
+          return *this;
+        }
+
+        double error(const vector_t &v) const {
+          return v.x * (v.x * q[0] + 2.0 * (v.y * q[1] + v.z * q[2] + q[3])) +
+                 v.y * (v.y * q[4] + 2.0 * (v.z * q[5] + q[6])) +
+                 v.z * (v.z * q[7] + 2.0 * q[8]) +
+                 q[9];
+        }
+
+        // The point of least error, false if the planes are too
+        // close to parallel to fix one.
+        bool minimum(vector_t &v) const {
+          double c00 = q[4] * q[7] - q[5] * q[5];
+          double c01 = q[2] * q[5] - q[1] * q[7];
+          double c02 = q[1] * q[5] - q[2] * q[4];
+          double c11 = q[0] * q[7] - q[2] * q[2];
+          double c12 = q[1] * q[2] - q[0] * q[5];
+          double c22 = q[0] * q[4] - q[1] * q[1];
+          double det = q[0] * c00 + q[1] * c01 + q[2] * c02;
+          double trace = q[0] + q[4] + q[7];
+          if (!(fabs(det) > 1e-9 * trace * trace * trace)) return false;
+          v.x = -(c00 * q[3] + c01 * q[6] + c02 * q[8]) / det;
+          v.y = -(c01 * q[3] + c11 * q[6] + c12 * q[8]) / det;
+          v.z = -(c02 * q[3] + c12 * q[6] + c22 * q[8]) / det;
+          return true;
+        }
+      };
+
+
+
+      // An edge that may be collapsed, valid while the stamps of its
+      // vertices are unchanged. Ordered so that the std heap functions
+      // give the cheapest first.
+      struct CollapseCandidate {
+        double cost;
+        size_t v1, v2;
+        size_t stamp1, stamp2;
+        vector_t target;
+
+        bool operator<(const CollapseCandidate &other) const {
+          return cost > other.cost;
+        }
+      };
+
+
+
+      struct Decimation {
+        vertex_t *base;
+        std::vector<Quadric> quadric;
+        // an edge leaving each vertex, kept valid as edges are removed
+        std::vector<edge_t *> out_edge;
+        // vertices on open edges, on faces that are not triangles, or
+        // joining more than one fan of faces are never moved
+        std::vector<unsigned char> movable;
+        std::vector<size_t> stamp;
+        std::vector<size_t> mark;
+        size_t mark_value;
+        std::vector<CollapseCandidate> heap;
+
+        Decimation(meshset_t *meshset) :
+            base(&meshset->vertex_storage[0]),
+            quadric(meshset->vertex_storage.size()),
+            out_edge(meshset->vertex_storage.size(), (edge_t *)NULL),
+            movable(meshset->vertex_storage.size(), 1),
+            stamp(meshset->vertex_storage.size(), 0),
+            mark(meshset->vertex_storage.size(), 0),
+            mark_value(0),
+            heap() {
+        }
+
+        size_t index(const vertex_t *v) const { return (size_t)(v - base); }
+
+        // the next edge leaving the same vertex as e, turning about it
+        static edge_t *turn(edge_t *e) { return e->rev->next; }
+      };
+
+
+
+      // Prices the collapse of v1 and v2 in to one vertex at the point
+      // of least error of their summed quadrics, if that is near the
+      // edge, otherwise at whichever of the ends and the midpoint has
+      // least error, and queues it.
+      void pushCollapse(Decimation &d, size_t v1, size_t v2) {
+        Quadric q = d.quadric[v1];
+        q += d.quadric[v2];
+        const vector_t &p1 = d.base[v1].v;
+        const vector_t &p2 = d.base[v2].v;
+        vector_t mid = (p1 + p2) / 2.0;
+
+        CollapseCandidate c;
+        c.v1 = v1;
+        c.v2 = v2;
+        c.stamp1 = d.stamp[v1];
+        c.stamp2 = d.stamp[v2];
+        c.target = mid;
+        c.cost = q.error(mid);
+
+        vector_t best;
+        if (q.minimum(best) && carve::geom::distance2(best, mid) <= carve::geom::distance2(p1, p2)) {
+          double cost = q.error(best);
+          if (cost < c.cost) { c.cost = cost; c.target = best; }
+        }
+        double cost1 = q.error(p1), cost2 = q.error(p2);
+        if (cost1 < c.cost) { c.cost = cost1; c.target = p1; }
+        if (cost2 < c.cost) { c.cost = cost2; c.target = p2; }
+        if (c.cost < 0.0) c.cost = 0.0;
+
+        d.heap.push_back(c);
+        std::push_heap(d.heap.begin(), d.heap.end());
+      }
+
+
+
+      // True if moving the vertex that edges leave from to target turns
+      // the normal of any of its faces, other than f1 and f2, by more
+      // than 60 degrees.
+      bool collapseFolds(edge_t *start, const face_t *f1, const face_t *f2, const vector_t &target) {
+        edge_t *o = start;
+        do {
+          if (o->face != f1 && o->face != f2) {
+            const vector_t &p0 = o->vert->v;
+            const vector_t &p1 = o->next->vert->v;
+            const vector_t &p2 = o->prev->vert->v;
+            vector_t before = carve::geom::cross(p1 - p0, p2 - p0);
+            vector_t after = carve::geom::cross(p1 - target, p2 - target);
+            double dp = carve::geom::dot(before, after);
+            if (dp <= 0.0 || dp * dp <= 0.25 * before.length2() * after.length2()) return true;
+          }
+          o = Decimation::turn(o);
+        } while (o != start);
+        return false;
+      }
+
+
+
+      // Collapses the edge from v1 to v2, v1 is removed and v2 moved to
+      // the target. Refused where it would make the mesh non manifold
+      // or fold a face over.
+      bool collapseEdge(Decimation &d, const CollapseCandidate &c) {
+        vertex_t *vert1 = d.base + c.v1, *vert2 = d.base + c.v2;
+        edge_t *e = d.out_edge[c.v1];
+        edge_t *start = e;
+        while (e->next->vert != vert2) {
+          e = Decimation::turn(e);
+          if (e == start) return false;
+        }
+        edge_t *r = e->rev;
+        face_t *f = e->face, *g = r->face;
+        if (f == g || e->prev->vert == r->prev->vert) return false;
+
+        // the link condition, the ends may only share the two
+        // neighbours that are opposite the edge
+        size_t degree1 = 0, degree2 = 0, shared = 0;
+        ++d.mark_value;
+        edge_t *o = e;
+        do {
+          d.mark[d.index(o->next->vert)] = d.mark_value;
+          ++degree1;
+          o = Decimation::turn(o);
+        } while (o != e);
+        o = r;
+        do {
+          if (d.mark[d.index(o->next->vert)] == d.mark_value) ++shared;
+          ++degree2;
+          o = Decimation::turn(o);
+        } while (o != r);
+        if (shared != 2 || (degree1 == 3 && degree2 == 3)) return false;
+
+        if (collapseFolds(e, f, g, c.target) || collapseFolds(r, f, g, c.target)) return false;
+
+        // every edge leaving v1 now leaves v2
+        o = e;
+        do {
+          o->vert = vert2;
+          o = Decimation::turn(o);
+        } while (o != e);
+
+        // close up the gaps left by f and g
+        edge_t *a1 = e->next->rev, *a2 = e->prev->rev;
+        edge_t *b1 = r->next->rev, *b2 = r->prev->rev;
+        a1->rev = a2; a2->rev = a1;
+        b1->rev = b2; b2->rev = b1;
+        d.out_edge[c.v2] = a2;
+        d.out_edge[d.index(a1->vert)] = a1;
+        d.out_edge[d.index(b1->vert)] = b1;
+        d.out_edge[c.v1] = NULL;
+        f->clearEdges();
+        g->clearEdges();
+
+        vert2->v = c.target;
+        d.quadric[c.v2] += d.quadric[c.v1];
+        d.movable[c.v1] = 0;
+        ++d.stamp[c.v1];
+        ++d.stamp[c.v2];
+
+        o = a2;
+        do {
+          size_t w = d.index(o->next->vert);
+          if (d.movable[w]) pushCollapse(d, c.v2, w);
+          o = Decimation::turn(o);
+        } while (o != a2);
+        return true;
+      }
+
+
+
+      void tidyDecimatedMeshes(meshset_t *meshset) {
+        removeRemnantFaces(meshset);
+        for (size_t m = 0; m < meshset->meshes.size(); ++m) {
+          mesh_t *mesh = meshset->meshes[m];
+          for (size_t f = 0; f < mesh->faces.size(); ++f) {
+            mesh->faces[f]->recalc();
+          }
+          mesh->cacheEdges();
+        }
+      }
+
+
+
     public:
       // Merge adjacent coplanar faces (where coplanar is determined
       // by dot-product >= cos(min_normal_angle)).
@@ -1178,6 +1443,110 @@ namespace carve {
         return n_removed;
       }
 
+
+
+      // Decimates a mesh of triangles by collapsing edges in order of
+      // their quadric error, the sum of the squared distances of the
+      // merged vertex from the planes of the original faces about it.
+      // For each bound in max_errors, which should ascend, collapses
+      // every edge whose error is within the square of the bound and
+      // appends a copy of the mesh to lods, so each is coarser than
+      // the last and no vertex is further than its bound from any of
+      // the planes it stands for. Stops early if the number of faces
+      // falls to min_faces. Vertices on open edges or faces that are
+      // not triangles are left where they are. Returns the number of
+      // edges collapsed, meshset is left at the last bound.
+      size_t decimate(meshset_t *meshset,
+                      const std::vector<double> &max_errors,
+                      std::vector<meshset_t *> &lods,
+                      size_t min_faces = 0) {
+        if (!meshset->vertex_storage.size()) return 0;
+        meshset->invalidateFaceRTree();
+        Decimation d(meshset);
+        std::vector<size_t> degree(meshset->vertex_storage.size(), 0);
+        size_t n_faces = 0, n_collapsed = 0;
+
+        for (size_t m = 0; m < meshset->meshes.size(); ++m) {
+          mesh_t *mesh = meshset->meshes[m];
+          for (size_t f = 0; f < mesh->faces.size(); ++f) {
+            face_t *face = mesh->faces[f];
+            bool triangle = face->nEdges() == 3;
+            edge_t *e = face->edge;
+            do {
+              size_t v = d.index(e->vert);
+              d.out_edge[v] = e;
+              ++degree[v];
+              if (!triangle || !e->rev) {
+                d.movable[v] = 0;
+                d.movable[d.index(e->next->vert)] = 0;
+              }
+              e = e->next;
+            } while (e != face->edge);
+            ++n_faces;
+            if (!triangle) continue;
+            const vector_t &p0 = e->vert->v;
+            vector_t N = carve::geom::cross(e->next->vert->v - p0, e->prev->vert->v - p0);
+            double length = N.length();
+            if (length == 0.0) continue;
+            N /= length;
+            double dist = -carve::geom::dot(N, p0);
+            do {
+              d.quadric[d.index(e->vert)].addPlane(N, dist);
+              e = e->next;
+            } while (e != face->edge);
+          }
+        }
+
+        // a vertex whose faces form more than one fan cannot be walked
+        // around, leave it be
+        for (size_t v = 0; v < d.out_edge.size(); ++v) {
+          if (!d.out_edge[v]) { d.movable[v] = 0; continue; }
+          if (!d.movable[v]) continue;
+          size_t n = 0;
+          edge_t *o = d.out_edge[v];
+          do {
+            ++n;
+            o = Decimation::turn(o);
+          } while (o != d.out_edge[v] && n <= degree[v]);
+          if (n != degree[v]) d.movable[v] = 0;
+        }
+
+        for (size_t m = 0; m < meshset->meshes.size(); ++m) {
+          mesh_t *mesh = meshset->meshes[m];
+          for (size_t f = 0; f < mesh->faces.size(); ++f) {
+            edge_t *e = mesh->faces[f]->edge;
+            do {
+              size_t v1 = d.index(e->vert), v2 = d.index(e->next->vert);
+              if (e->rev && e < e->rev && d.movable[v1] && d.movable[v2]) pushCollapse(d, v1, v2);
+              e = e->next;
+            } while (e != mesh->faces[f]->edge);
+          }
+        }
+
+        for (size_t i = 0; i < max_errors.size(); ++i) {
+          double limit = max_errors[i] * max_errors[i];
+          while (d.heap.size() && n_faces > min_faces) {
+            CollapseCandidate c = d.heap.front();
+            bool current = c.stamp1 == d.stamp[c.v1] && c.stamp2 == d.stamp[c.v2];
+            if (current && c.cost > limit) break;
+            std::pop_heap(d.heap.begin(), d.heap.end());
+            d.heap.pop_back();
+            if (current && collapseEdge(d, c)) {
+              n_faces -= 2;
+              ++n_collapsed;
+            }
+          }
+          tidyDecimatedMeshes(meshset);
+          meshset_t *lod = meshset->clone();
+          lod->collectVertices();
+          lods.push_back(lod);
+        }
+
+        tidyDecimatedMeshes(meshset);
+        meshset->collectVertices();
+        return n_collapsed;
+      }
+
       size_t improveMesh_conservative(meshset_t *meshset, double EPSILON) {
         initEdgeInfo(meshset);
         size_t modifications = flipEdges(meshset, FlippableConservative(),EPSILON);
@@ -1220,6 +1589,7 @@ namespace carve {
                 int log2_grid,
                 int angle_xy_quantization = 0,
                 int angle_z_quantization = 0) {
+        meshset->invalidateFaceRTree();
         double grid = 0.0;
         if (log2_grid >= std::numeric_limits<double>::min_exponent) grid = pow(2.0, (double)log2_grid);
 
@@ -1397,6 +1767,7 @@ namespace carve {
       
       
       size_t removeFins(mesh_t *mesh) {
+        if (mesh->meshset) mesh->meshset->invalidateFaceRTree();
         size_t n_removed = 0;
         for (size_t i = 0; i < mesh->faces.size(); ++i) {
           n_removed += removeFin(mesh->faces[i]);
@@ -1418,6 +1789,7 @@ namespace carve {
 
 
       size_t removeLowVolumeManifolds(meshset_t *meshset, double min_abs_volume) {
+        meshset->invalidateFaceRTree();
         size_t n_removed;
         for (size_t i = 0; i < meshset->meshes.size(); ++i) {
           if (fabs(meshset->meshes[i]->volume()) < min_abs_volume) {
@@ -1517,6 +1889,7 @@ namespace carve {
       };
 
       void selfIntersectionAwareQuantize(meshset_t *meshset, int base, int n_dp, double EPSILON) {
+        meshset->invalidateFaceRTree();
         typedef std::unordered_map<vertex_t *, quantization_info_t> vfsmap_t;
 
         vfsmap_t vertex_qinfo;
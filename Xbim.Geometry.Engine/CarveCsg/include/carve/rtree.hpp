@@ -165,11 +165,151 @@ namespace carve {
         }
       }
 
+      RTreeNode() : bbox(), child(NULL), sibling(NULL), data() {
+      }
+
       template<typename iter_t>
       RTreeNode(iter_t begin, iter_t end) : bbox(), child(NULL), sibling(NULL), data() {
         _fill(begin, end, typename std::iterator_traits<iter_t>::value_type());
       }
 
+      // copy the subtree rooted at this node. the siblings of this node
+      // are not copied.
+      node_t *copy() const {
+        node_t *result = new node_t();
+        result->bbox = bbox;
+        result->data = data;
+        node_t **tail = &result->child;
+        for (const node_t *node = child; node; node = node->sibling) {
+          *tail = node->copy();
+          tail = &(*tail)->sibling;
+        }
+        return result;
+      }
+
+      // replace each item with successor(item), or drop it if that
+      // returns data_t(). each replacement must lie within the bounding
+      // box of the item it replaces. the bounding boxes of nodes that
+      // lost items are refitted and nodes left empty are deleted.
+      // returns false if this node is left empty.
+      template<typename successor_t>
+      bool replace(successor_t &successor) {
+        if (child) {
+          node_t **link = &child;
+          while (*link) {
+            node_t *node = *link;
+            if (node->replace(successor)) {
+              link = &node->sibling;
+            } else {
+              *link = node->sibling;
+              node->sibling = NULL;
+              delete node;
+            }
+          }
+          if (!child) return false;
+          bbox = child->bbox;
+          for (node_t *node = child->sibling; node; node = node->sibling) {
+            bbox.unionAABB(node->bbox);
+          }
+          return true;
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < data.size(); ++i) {
+          data_t next = successor(data[i]);
+          if (next != data_t()) data[kept++] = next;
+        }
+        if (kept == 0) {
+          data.clear();
+          return false;
+        }
+        if (kept != data.size()) {
+          data.resize(kept);
+          bbox.fit(data.begin(), data.end());
+        }
+        return true;
+      }
+
+      // insert an item into the tree rooted at this node, which must not
+      // be empty. at each level the item goes to the child whose bounding
+      // box grows least in half perimeter. leaves holding more than
+      // twice leaf_size items, and internal nodes holding more than twice
+      // internal_size children, are split as construct_STR() would split
+      // them, and the root gains a level when it overflows, so all
+      // leaves stay at the same depth.
+      void insert(const data_t &item, size_t leaf_size, size_t internal_size) {
+        std::vector<node_t *> split;
+        _insert(item, aabb_calc_t()(item), leaf_size, internal_size, split);
+        if (split.empty()) return;
+
+        node_t *first = new node_t();
+        first->bbox = bbox;
+        first->child = child;
+        first->data.swap(data);
+        split.insert(split.begin(), first);
+        child = NULL;
+        _fill(split.begin(), split.end(), (node_t *)NULL);
+      }
+
+      // insert an item below this node. nodes split off this one are
+      // appended to split, for the parent to take.
+      void _insert(const data_t &item,
+                   const aabb_t &item_bbox,
+                   size_t leaf_size,
+                   size_t internal_size,
+                   std::vector<node_t *> &split) {
+        bbox.unionAABB(item_bbox);
+
+        std::vector<node_t *> parts;
+        if (!child) {
+          data.push_back(item);
+          if (data.size() <= 2 * leaf_size) return;
+          std::vector<data_aabb_t> items(data.begin(), data.end());
+          makeNodes(items.begin(), items.end(), 0, 0, leaf_size, parts);
+          data.swap(parts[0]->data);
+        } else {
+          node_t *best = NULL;
+          double best_growth = 0.0, best_size = 0.0;
+          for (node_t *node = child; node; node = node->sibling) {
+            aabb_t grown = node->bbox;
+            grown.unionAABB(item_bbox);
+            double size = halfPerimeter(node->bbox);
+            double growth = halfPerimeter(grown) - size;
+            if (!best || growth < best_growth || (growth == best_growth && size < best_size)) {
+              best = node;
+              best_growth = growth;
+              best_size = size;
+            }
+          }
+
+          std::vector<node_t *> children;
+          best->_insert(item, item_bbox, leaf_size, internal_size, children);
+          if (children.empty()) return;
+          for (node_t *node = child; node; node = node->sibling) {
+            children.push_back(node);
+          }
+          for (size_t i = 0; i < children.size(); ++i) {
+            children[i]->sibling = NULL;
+          }
+          if (children.size() <= 2 * internal_size) {
+            _fill(children.begin(), children.end(), (node_t *)NULL);
+            return;
+          }
+          makeNodes(children.begin(), children.end(), 0, 0, internal_size, parts);
+          child = parts[0]->child;
+          parts[0]->child = NULL;
+        }
+        bbox = parts[0]->bbox;
+        delete parts[0];
+        split.insert(split.end(), parts.begin() + 1, parts.end());
+      }
+
+      static double halfPerimeter(const aabb_t &box) {
+        double sum = 0.0;
+        for (unsigned i = 0; i < ndim; ++i) sum += box.extent.v[i];
+        return 2.0 * sum;
+      }
+
       ~RTreeNode() {
         if (child) {
           RTreeNode *next = child;
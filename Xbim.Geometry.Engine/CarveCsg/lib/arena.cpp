@@ -0,0 +1,176 @@
+#if defined(HAVE_CONFIG_H)
+#  include <carve_config.h>
+#endif
+
+#include <carve/arena.hpp>
+
+#include <atomic>
+#include <new>
+#include <vector>
+
+#if defined(_MSC_VER)
+#  define CARVE_THREAD_LOCAL __declspec(thread)
+#else
+#  define CARVE_THREAD_LOCAL __thread
+#endif
+
+namespace {
+  // the arena of the innermost scope alive on this thread.
+  CARVE_THREAD_LOCAL carve::mesh::Arena *current = NULL;
+
+  // each object is preceded by the arena it was taken from, or NULL if
+  // it is on the heap. the double keeps the object aligned as the heap
+  // would.
+  union Header {
+    carve::mesh::Arena *arena;
+    double align;
+  };
+
+  struct FreeItem {
+    FreeItem *next;
+  };
+
+  const size_t BLOCK_SIZE = 64 * 1024;
+
+  size_t storageSize(size_t size) {
+    return (size + 2 * sizeof(Header) - 1) / sizeof(Header) * sizeof(Header);
+  }
+}
+
+
+
+struct carve::mesh::Arena::Impl {
+  // one for the scope and one for each object taken from the arena
+  // and not yet deleted.
+  std::atomic<size_t> references;
+
+  // only used by the thread of the scope, while the scope is alive.
+  std::vector<char *> blocks;
+  char *next;
+  char *end;
+  // the storage of deleted objects, by size. there are only a few
+  // sizes, one for each type of object.
+  std::vector<std::pair<size_t, FreeItem *> > free_lists;
+  size_t allocations;
+  size_t reused;
+
+  Impl() : references(1), next(NULL), end(NULL), allocations(0), reused(0) {
+  }
+
+  ~Impl() {
+    for (size_t i = 0; i < blocks.size(); ++i) {
+      delete[] blocks[i];
+    }
+  }
+
+  FreeItem *&freeList(size_t size) {
+    for (size_t i = 0; i < free_lists.size(); ++i) {
+      if (free_lists[i].first == size) return free_lists[i].second;
+    }
+    free_lists.push_back(std::make_pair(size, (FreeItem *)NULL));
+    return free_lists.back().second;
+  }
+
+  char *newBlock(size_t size) {
+    blocks.reserve(blocks.size() + 1);
+    char *block = new char[size];
+    blocks.push_back(block);
+    return block;
+  }
+
+  char *take(size_t size) {
+    FreeItem *&free_list = freeList(size);
+    ++allocations;
+    if (free_list) {
+      FreeItem *item = free_list;
+      free_list = item->next;
+      ++reused;
+      return (char *)item;
+    }
+    if (size > BLOCK_SIZE / 16) {
+      return newBlock(size);
+    }
+    if ((size_t)(end - next) < size) {
+      next = newBlock(BLOCK_SIZE);
+      end = next + BLOCK_SIZE;
+    }
+    char *p = next;
+    next += size;
+    return p;
+  }
+
+  void give(char *p, size_t size) {
+    FreeItem *&free_list = freeList(size);
+    FreeItem *item = (FreeItem *)p;
+    item->next = free_list;
+    free_list = item;
+  }
+};
+
+
+
+carve::mesh::Arena::Arena() : impl(new Impl()) {
+}
+
+carve::mesh::Arena::~Arena() {
+  delete impl;
+}
+
+void carve::mesh::Arena::release() {
+  if (--impl->references == 0) delete this;
+}
+
+
+
+carve::mesh::Arena::Scope::Scope() : arena(new Arena()), previous(current) {
+  current = arena;
+}
+
+carve::mesh::Arena::Scope::~Scope() {
+  current = previous;
+  arena->release();
+}
+
+size_t carve::mesh::Arena::Scope::allocations() const {
+  return arena->impl->allocations;
+}
+
+size_t carve::mesh::Arena::Scope::reused() const {
+  return arena->impl->reused;
+}
+
+size_t carve::mesh::Arena::Scope::blocks() const {
+  return arena->impl->blocks.size();
+}
+
+
+
+void *carve::mesh::Arena::allocate(size_t size) {
+  size_t storage = storageSize(size);
+  Arena *arena = current;
+  Header *header;
+  if (arena) {
+    header = (Header *)arena->impl->take(storage);
+    ++arena->impl->references;
+  } else {
+    header = (Header *)::operator new(storage);
+  }
+  header->arena = arena;
+  return header + 1;
+}
+
+void carve::mesh::Arena::deallocate(void *p, size_t size) {
+  if (!p) return;
+  Header *header = (Header *)p - 1;
+  Arena *arena = header->arena;
+  if (!arena) {
+    ::operator delete(header);
+    return;
+  }
+  // the storage is only reused by the thread of the scope, while the
+  // scope is alive. otherwise it waits for the arena to be released.
+  if (arena == current) {
+    arena->impl->give((char *)header, storageSize(size));
+  }
+  arena->release();
+}
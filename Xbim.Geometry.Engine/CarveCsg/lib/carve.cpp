@@ -29,3 +29,28 @@ namespace carve {
   double EPSILON2 = DEF_EPSILON * DEF_EPSILON;*/
  
 }
+
+
+
+#if defined(_MSC_VER)
+#  define CARVE_THREAD_LOCAL __declspec(thread)
+#else
+#  define CARVE_THREAD_LOCAL __thread
+#endif
+
+namespace {
+  // set by the innermost ExactPredicates scope alive on this thread.
+  CARVE_THREAD_LOCAL bool exact_predicates = false;
+}
+
+carve::ExactPredicates::ExactPredicates(bool enable) : previous(exact_predicates) {
+  exact_predicates = enable;
+}
+
+carve::ExactPredicates::~ExactPredicates() {
+  exact_predicates = previous;
+}
+
+bool carve::ExactPredicates::enabled() {
+  return exact_predicates;
+}
@@ -354,6 +354,42 @@ namespace carve {
 
     }
 
+    namespace {
+
+      class ClassifyCollector : public BaseCollector {
+        std::unordered_map<const carve::mesh::MeshSet<3>::face_t *, unsigned> &face_bits;
+
+      public:
+        ClassifyCollector(const carve::mesh::MeshSet<3> *_src_a,
+                          const carve::mesh::MeshSet<3> *_src_b,
+                          std::unordered_map<const carve::mesh::MeshSet<3>::face_t *, unsigned> &_face_bits) :
+          BaseCollector(_src_a, _src_b), face_bits(_face_bits) {
+        }
+        virtual ~ClassifyCollector() {
+        }
+        virtual void collect(const carve::mesh::MeshSet<3>::face_t *orig_face,
+                             const std::vector<carve::mesh::MeshSet<3>::vertex_t *> & /* vertices */,
+                             carve::geom3d::Vector /* normal */,
+                             bool /* poly_a */,
+                             FaceClass face_class,
+                             CSG::Hooks & /* hooks */, double, double) {
+          face_bits[orig_face] |= class_to_class_bit(face_class);
+        }
+        virtual carve::mesh::MeshSet<3> *done(CSG::Hooks & /* hooks */) {
+          return NULL;
+        }
+      };
+
+    }
+
+
+
+    CSG::Collector *makeClassifyCollector(const carve::mesh::MeshSet<3> *poly_a,
+                                          const carve::mesh::MeshSet<3> *poly_b,
+                                          std::unordered_map<const carve::mesh::MeshSet<3>::face_t *, unsigned> &face_bits) {
+      return new ClassifyCollector(poly_a, poly_b, face_bits);
+    }
+
     CSG::Collector *makeCollector(CSG::OP op,
                                   const carve::mesh::MeshSet<3> *poly_a,
                                   const carve::mesh::MeshSet<3> *poly_b) {
@@ -20,5 +20,11 @@ namespace carve {
     CSG::Collector *makeCollector(CSG::OP op,
                                   const carve::mesh::MeshSet<3> *poly_a,
                                   const carve::mesh::MeshSet<3> *poly_b);
+
+    // a collector that makes no result, but ors the FaceClassBit of each
+    // classified part of a face into face_bits[face].
+    CSG::Collector *makeClassifyCollector(const carve::mesh::MeshSet<3> *poly_a,
+                                          const carve::mesh::MeshSet<3> *poly_b,
+                                          std::unordered_map<const carve::mesh::MeshSet<3>::face_t *, unsigned> &face_bits);
   }
 }
@@ -45,6 +45,10 @@
 
 
 
+carve::csg::CSG::parallel_for_t carve::csg::CSG::parallel_for = NULL;
+
+
+
 carve::csg::VertexPool::VertexPool() {
 }
 
@@ -657,15 +661,101 @@ void carve::csg::CSG::intersectingFacePairs(detail::Data &data) {
 
 
 
+// The geometric tests of the generate*Intersections() steps. They do
+// not depend on the intersections recorded so far, so they can be run
+// for many face pairs at once.
+
+static bool vertexVertexIntersection(const carve::mesh::MeshSet<3>::vertex_t *va,
+                                     const carve::mesh::MeshSet<3>::edge_t *eb, double EPSILON2) {
+  return carve::geom::distance2(va->v, eb->v1()->v) < EPSILON2;
+}
+
+
+
+static bool vertexEdgeIntersection(const carve::mesh::MeshSet<3>::vertex_t *va,
+                                   const carve::mesh::MeshSet<3>::edge_t *eb, double EPSILON, double EPSILON2) {
+  carve::geom::aabb<3> eb_aabb;
+  eb_aabb.fit(eb->v1()->v, eb->v2()->v);
+  if (eb_aabb.maxAxisSeparation(va->v) > EPSILON) {
+    return false;
+  }
+
+  double a = cross(eb->v2()->v - eb->v1()->v, va->v - eb->v1()->v).length2();
+  double b = (eb->v2()->v - eb->v1()->v).length2();
+
+  return a < b * EPSILON2;
+}
+
+
+
+// RR_INTERSECTION if the edges cross, at p, RR_DEGENERATE if either
+// edge is degenerate, otherwise RR_NO_INTERSECTION.
+static carve::RayIntersectionClass edgeEdgeIntersection(const carve::mesh::MeshSet<3>::edge_t *ea,
+                                                        const carve::mesh::MeshSet<3>::edge_t *eb,
+                                                        carve::mesh::MeshSet<3>::vertex_t::vector_t &p, double EPSILON) {
+  const carve::mesh::MeshSet<3>::vertex_t *v1 = ea->v1(), *v2 = ea->v2();
+  const carve::mesh::MeshSet<3>::vertex_t *v3 = eb->v1(), *v4 = eb->v2();
+
+  carve::geom::aabb<3> ea_aabb, eb_aabb;
+  ea_aabb.fit(v1->v, v2->v);
+  eb_aabb.fit(v3->v, v4->v);
+  if (ea_aabb.maxAxisSeparation(eb_aabb) > EPSILON) return carve::RR_NO_INTERSECTION;
+
+  carve::mesh::MeshSet<3>::vertex_t::vector_t p1, p2;
+  double mu1, mu2;
+
+  switch (carve::geom3d::rayRayIntersection(carve::geom3d::Ray(v2->v - v1->v, v1->v),
+                                            carve::geom3d::Ray(v4->v - v3->v, v3->v),
+                                            p1, p2, mu1, mu2,EPSILON)) {
+  case carve::RR_INTERSECTION: {
+    // edges intersect
+    if (mu1 >= 0.0 && mu1 <= 1.0 && mu2 >= 0.0 && mu2 <= 1.0) {
+      p = (p1 + p2) / 2.0;
+      return carve::RR_INTERSECTION;
+    }
+    break;
+  }
+  case carve::RR_PARALLEL: {
+    // edges parallel. any intersection of this type should have
+    // been handled by generateVertexEdgeIntersections().
+    break;
+  }
+  case carve::RR_DEGENERATE: {
+    return carve::RR_DEGENERATE;
+  }
+  case carve::RR_NO_INTERSECTION: {
+    break;
+  }
+  }
+  return carve::RR_NO_INTERSECTION;
+}
+
+
+
+static bool vertexFaceIntersection(const carve::mesh::MeshSet<3>::face_t *fa,
+                                   const carve::mesh::MeshSet<3>::edge_t *eb, double EPSILON, double EPSILON2) {
+  double d1 = carve::geom::distance(fa->plane, eb->v1()->v);
+
+  return fabs(d1) < EPSILON && fa->containsPoint(eb->v1()->v, EPSILON, EPSILON2);
+}
+
+
+
+static bool edgeFaceIntersection(const carve::mesh::MeshSet<3>::face_t *fa,
+                                 const carve::mesh::MeshSet<3>::edge_t *eb,
+                                 carve::mesh::MeshSet<3>::vertex_t::vector_t &p, double EPSILON) {
+  return fa->simpleLineSegmentIntersection(carve::geom3d::LineSegment(eb->v1()->v, eb->v2()->v), p, EPSILON);
+}
+
+
+
 void carve::csg::CSG::_generateVertexVertexIntersections(meshset_t::vertex_t *va,
                                                          meshset_t::edge_t *eb, double EPSILON2) {
   if (intersections.intersects(va, eb->v1())) {
     return;
   }
 
-  double d_v1 = carve::geom::distance2(va->v, eb->v1()->v);
-
-  if  (d_v1 < EPSILON2) {
+  if (vertexVertexIntersection(va, eb, EPSILON2)) {
     intersections.record(va, eb->v1(), va);
   }
 }
@@ -698,16 +788,7 @@ void carve::csg::CSG::_generateVertexEdgeIntersections(meshset_t::vertex_t *va,
     return;
   }
 
-  carve::geom::aabb<3> eb_aabb;
-  eb_aabb.fit(eb->v1()->v, eb->v2()->v);
-  if (eb_aabb.maxAxisSeparation(va->v) > EPSILON) {
-    return;
-  }
-
-  double a = cross(eb->v2()->v - eb->v1()->v, va->v - eb->v1()->v).length2();
-  double b = (eb->v2()->v - eb->v1()->v).length2();
-
-  if (a < b * EPSILON2) {
+  if (vertexEdgeIntersection(va, eb, EPSILON, EPSILON2)) {
     // vertex-edge intersection
     intersections.record(eb, va, va);
     if (eb->rev) intersections.record(eb->rev, va, va);
@@ -742,44 +823,23 @@ void carve::csg::CSG::_generateEdgeEdgeIntersections(meshset_t::edge_t *ea,
     return;
   }
 
-  meshset_t::vertex_t *v1 = ea->v1(), *v2 = ea->v2();
-  meshset_t::vertex_t *v3 = eb->v1(), *v4 = eb->v2();
-
-  carve::geom::aabb<3> ea_aabb, eb_aabb;
-  ea_aabb.fit(v1->v, v2->v);
-  eb_aabb.fit(v3->v, v4->v);
-  if (ea_aabb.maxAxisSeparation(eb_aabb) > EPSILON) return;
-
-  meshset_t::vertex_t::vector_t p1, p2;
-  double mu1, mu2;
-
-  switch (carve::geom3d::rayRayIntersection(carve::geom3d::Ray(v2->v - v1->v, v1->v),
-                                            carve::geom3d::Ray(v4->v - v3->v, v3->v),
-                                            p1, p2, mu1, mu2,EPSILON)) {
+  meshset_t::vertex_t::vector_t _p;
+  switch (edgeEdgeIntersection(ea, eb, _p, EPSILON)) {
   case carve::RR_INTERSECTION: {
-    // edges intersect
-    if (mu1 >= 0.0 && mu1 <= 1.0 && mu2 >= 0.0 && mu2 <= 1.0) {
-      meshset_t::vertex_t *p = vertex_pool.get((p1 + p2) / 2.0);
-      intersections.record(ea, eb, p);
-      if (ea->rev) intersections.record(ea->rev, eb, p);
-      if (eb->rev) intersections.record(ea, eb->rev, p);
-      if (ea->rev && eb->rev) intersections.record(ea->rev, eb->rev, p);
-    }
-    break;
-  }
-  case carve::RR_PARALLEL: {
-    // edges parallel. any intersection of this type should have
-    // been handled by generateVertexEdgeIntersections().
+    meshset_t::vertex_t *p = vertex_pool.get(_p);
+    intersections.record(ea, eb, p);
+    if (ea->rev) intersections.record(ea->rev, eb, p);
+    if (eb->rev) intersections.record(ea, eb->rev, p);
+    if (ea->rev && eb->rev) intersections.record(ea->rev, eb->rev, p);
     break;
   }
   case carve::RR_DEGENERATE: {
     throw carve::exception("degenerate edge");
     break;
   }
-  case carve::RR_NO_INTERSECTION: {
+  default:
     break;
   }
-  }
 }
 
 
@@ -810,10 +870,7 @@ void carve::csg::CSG::_generateVertexFaceIntersections(meshset_t::face_t *fa,
     return;
   }
 
-  double d1 = carve::geom::distance(fa->plane, eb->v1()->v);
-
-  if (fabs(d1) < EPSILON &&
-      fa->containsPoint(eb->v1()->v, EPSILON, EPSILON2)) {
+  if (vertexFaceIntersection(fa, eb, EPSILON, EPSILON2)) {
     intersections.record(eb->v1(), fa, eb->v1());
   }
 }
@@ -844,7 +901,7 @@ void carve::csg::CSG::_generateEdgeFaceIntersections(meshset_t::face_t *fa,
   }
 
   meshset_t::vertex_t::vector_t _p;
-  if (fa->simpleLineSegmentIntersection(carve::geom3d::LineSegment(eb->v1()->v, eb->v2()->v), _p, EPSILON)) {
+  if (edgeFaceIntersection(fa, eb, _p, EPSILON)) {
     meshset_t::vertex_t *p = vertex_pool.get(_p);
     intersections.record(eb, fa, p);
     if (eb->rev) intersections.record(eb->rev, fa, p);
@@ -868,12 +925,144 @@ void carve::csg::CSG::generateEdgeFaceIntersections(meshset_t::face_t *a,
 }
 
 
+namespace carve {
+  namespace csg {
+    namespace detail {
+
+      /**
+       * \class FaceBounds
+       * \brief A structure of arrays copy of the bounds, planes and
+       * vertices of the faces of a face rtree, for the leaf pair tests
+       * of CSG::generateIntersectionCandidates().
+       *
+       * The faces are stored leaf by leaf, so the faces of a leaf are
+       * contiguous, and the tests of one face against the faces of a
+       * leaf run over contiguous arrays without visiting the faces.
+       * The values are computed as carve::geom::aabb and
+       * Face::rangeInDirection() compute them, so the tests give the
+       * same results.
+       */
+      class FaceBounds {
+        typedef carve::geom::RTreeNode<3, carve::mesh::MeshSet<3>::face_t *> face_rtree_t;
+
+        std::unordered_map<const face_rtree_t *, size_t> leaf_first;
+
+        void add(const face_rtree_t *node) {
+          if (node->child) {
+            for (const face_rtree_t *child = node->child; child; child = child->sibling) {
+              add(child);
+            }
+            return;
+          }
+          leaf_first[node] = lo.size();
+          for (size_t i = 0; i < node->data.size(); ++i) {
+            const carve::mesh::MeshSet<3>::face_t *face = node->data[i];
+            carve::geom::aabb<3> aabb = face->getAABB();
+            std::pair<double, double> range = face->rangeInDirection(face->plane.N, face->edge->vert->v);
+            for (unsigned axis = 0; axis < 3; ++axis) {
+              pos[axis].push_back(aabb.pos.v[axis]);
+              extent[axis].push_back(aabb.extent.v[axis]);
+              normal[axis].push_back(face->plane.N.v[axis]);
+            }
+            lo.push_back(range.first);
+            hi.push_back(range.second);
+            const carve::mesh::MeshSet<3>::edge_t *e = face->edge;
+            do {
+              for (unsigned axis = 0; axis < 3; ++axis) {
+                vertex[axis].push_back(e->vert->v.v[axis]);
+              }
+              e = e->next;
+            } while (e != face->edge);
+            vertex_first.push_back(vertex[0].size());
+          }
+        }
+
+      public:
+        // the bounding box of each face, as carve::geom::aabb stores it.
+        std::vector<double> pos[3], extent[3];
+        // the normal of the plane of each face.
+        std::vector<double> normal[3];
+        // the range of each face along its normal, measured from its
+        // first vertex.
+        std::vector<double> lo, hi;
+        // the vertices of face i, in edge order from face->edge, are
+        // [vertex_first[i], vertex_first[i + 1]).
+        std::vector<size_t> vertex_first;
+        std::vector<double> vertex[3];
+
+        FaceBounds(const face_rtree_t *root) {
+          vertex_first.push_back(0);
+          add(root);
+        }
+
+        size_t first(const face_rtree_t *leaf) const {
+          return leaf_first.find(leaf)->second;
+        }
+
+        // the separation of the bounding box of a face from box, as
+        // aabb::maxAxisSeparation() computes it.
+        double separation(size_t face, const carve::geom::aabb<3> &box) const {
+          double m = fabs(box.pos.v[0] - pos[0][face]) - extent[0][face] - box.extent.v[0];
+          m = std::max(m, fabs(box.pos.v[1] - pos[1][face]) - extent[1][face] - box.extent.v[1]);
+          m = std::max(m, fabs(box.pos.v[2] - pos[2][face]) - extent[2][face] - box.extent.v[2]);
+          return m;
+        }
+
+        // the separations of the bounding boxes of count faces from
+        // first from that of face of other, as
+        // aabb::maxAxisSeparation() computes them. there are no
+        // branches, so that the compiler can vectorise the loop.
+        void separations(size_t first, size_t count, const FaceBounds &other, size_t face, double *out) const {
+          const double opx = other.pos[0][face], opy = other.pos[1][face], opz = other.pos[2][face];
+          const double oex = other.extent[0][face], oey = other.extent[1][face], oez = other.extent[2][face];
+          const double *px = &pos[0][first], *py = &pos[1][first], *pz = &pos[2][first];
+          const double *ex = &extent[0][first], *ey = &extent[1][first], *ez = &extent[2][first];
+          for (size_t j = 0; j < count; ++j) {
+            double m = fabs(opx - px[j]) - ex[j] - oex;
+            m = std::max(m, fabs(opy - py[j]) - ey[j] - oey);
+            m = std::max(m, fabs(opz - pz[j]) - ez[j] - oez);
+            out[j] = m;
+          }
+        }
+
+        // the range of a face along the normal of face b of other,
+        // measured from the first vertex of b, as
+        // Face::rangeInDirection() computes it.
+        std::pair<double, double> rangeInDirection(size_t face, const FaceBounds &other, size_t b) const {
+          const double nx = other.normal[0][b], ny = other.normal[1][b], nz = other.normal[2][b];
+          const size_t b_first = other.vertex_first[b];
+          const double bx = other.vertex[0][b_first], by = other.vertex[1][b_first], bz = other.vertex[2][b_first];
+          size_t v = vertex_first[face], end = vertex_first[face + 1];
+          double r = 0.0;
+          r += nx * (vertex[0][v] - bx);
+          r += ny * (vertex[1][v] - by);
+          r += nz * (vertex[2][v] - bz);
+          double lo = r, hi = r;
+          for (++v; v < end; ++v) {
+            double d = 0.0;
+            d += nx * (vertex[0][v] - bx);
+            d += ny * (vertex[1][v] - by);
+            d += nz * (vertex[2][v] - bz);
+            lo = std::min(lo, d);
+            hi = std::max(hi, d);
+          }
+          return std::make_pair(lo, hi);
+        }
+      };
+
+    }
+  }
+}
+
+
 
 void carve::csg::CSG::generateIntersectionCandidates(meshset_t *a,
                                                      const face_rtree_t *a_node,
+                                                     const detail::FaceBounds &a_bounds,
                                                      meshset_t *b,
                                                      const face_rtree_t *b_node,
-                                                     face_pairs_t &face_pairs, 
+                                                     const detail::FaceBounds &b_bounds,
+                                                     face_pair_list_t &face_pairs, 
 													 double EPSILON,
 													 bool descend_a)
 {
@@ -887,40 +1076,49 @@ void carve::csg::CSG::generateIntersectionCandidates(meshset_t *a,
 	//SRL end of modification
 	if (a_node->child && (descend_a || !b_node->child)) {
 		for (face_rtree_t *node = a_node->child; node; node = node->sibling) {
-			generateIntersectionCandidates(a, node, b, b_node, face_pairs, EPSILON, false);
+			generateIntersectionCandidates(a, node, a_bounds, b, b_node, b_bounds, face_pairs, EPSILON, false);
 		}
 	} else if (b_node->child) {
 		for (face_rtree_t *node = b_node->child; node; node = node->sibling) {
-			generateIntersectionCandidates(a, a_node, b, node, face_pairs,EPSILON, true);
+			generateIntersectionCandidates(a, a_node, a_bounds, b, node, b_bounds, face_pairs,EPSILON, true);
 		}
 	} else {
+    // the bounds of the faces are read from a_bounds and b_bounds,
+    // which give the same values as the faces, without walking their
+    // edges for each pair.
+    const size_t BATCH = 16;
+    double separation[BATCH];
+    size_t a_first = a_bounds.first(a_node);
+    size_t b_first = b_bounds.first(b_node);
     for (size_t i = 0; i < a_node->data.size(); ++i) {
       meshset_t::face_t *fa = a_node->data[i];
-      carve::geom::aabb<3> aabb_a = fa->getAABB();
-      if (aabb_a.maxAxisSeparation(b_node->bbox) > EPSILON) 
+      size_t ia = a_first + i;
+      if (a_bounds.separation(ia, b_node->bbox) > EPSILON) 
 	  {
 		 continue;
 	  }
 	 
       for (size_t j = 0; j < b_node->data.size(); ++j) {
-        meshset_t::face_t *fb = b_node->data[j];
-        carve::geom::aabb<3> aabb_b = fb->getAABB();
-        if (aabb_b.maxAxisSeparation(aabb_a) > EPSILON) 
+        if (j % BATCH == 0) {
+          b_bounds.separations(b_first + j, std::min(BATCH, b_node->data.size() - j), a_bounds, ia, separation);
+        }
+        if (separation[j % BATCH] > EPSILON) 
 		{
 			continue; //check if each face is not in the bounding box of face a, ignore otherwise
 		}
+        meshset_t::face_t *fb = b_node->data[j];
+        size_t jb = b_first + j;
 
-        std::pair<double, double> a_ra = fa->rangeInDirection(fa->plane.N, fa->edge->vert->v);
-        std::pair<double, double> b_ra = fb->rangeInDirection(fa->plane.N, fa->edge->vert->v);
+        std::pair<double, double> a_ra = std::make_pair(a_bounds.lo[ia], a_bounds.hi[ia]);
+        std::pair<double, double> b_ra = b_bounds.rangeInDirection(jb, a_bounds, ia);
         if (carve::rangeSeparation(a_ra, b_ra) > EPSILON) continue;
 		
-        std::pair<double, double> a_rb = fa->rangeInDirection(fb->plane.N, fb->edge->vert->v);
-        std::pair<double, double> b_rb = fb->rangeInDirection(fb->plane.N, fb->edge->vert->v);
+        std::pair<double, double> a_rb = a_bounds.rangeInDirection(ia, b_bounds, jb);
+        std::pair<double, double> b_rb = std::make_pair(b_bounds.lo[jb], b_bounds.hi[jb]);
         if (carve::rangeSeparation(a_rb, b_rb) > EPSILON) continue;
 		
         if (!facesAreCoplanar(fa, fb,EPSILON)) {
-          face_pairs[fa].push_back(fb); 
-          face_pairs[fb].push_back(fa);
+          face_pairs.push_back(std::make_pair(fa, fb));
         }
 		
      }
@@ -930,14 +1128,246 @@ void carve::csg::CSG::generateIntersectionCandidates(meshset_t *a,
 
 
 
+struct carve::csg::CSG::CandidateTask {
+  CSG *csg;
+  meshset_t *a;
+  const face_rtree_t *a_node;
+  const detail::FaceBounds *a_bounds;
+  meshset_t *b;
+  const face_rtree_t *b_node;
+  const detail::FaceBounds *b_bounds;
+  double EPSILON;
+  bool descend_a;
+  bool failed;
+  face_pair_list_t face_pairs;
+
+  CandidateTask(CSG *_csg,
+                meshset_t *_a, const face_rtree_t *_a_node, const detail::FaceBounds *_a_bounds,
+                meshset_t *_b, const face_rtree_t *_b_node, const detail::FaceBounds *_b_bounds,
+                double _EPSILON, bool _descend_a) :
+      csg(_csg), a(_a), a_node(_a_node), a_bounds(_a_bounds), b(_b), b_node(_b_node), b_bounds(_b_bounds),
+      EPSILON(_EPSILON), descend_a(_descend_a), failed(false) {
+  }
+};
+
+
+
+void carve::csg::CSG::generateCandidateTask(void *context, size_t index) {
+  CandidateTask &task = (*(std::vector<CandidateTask> *)context)[index];
+  try {
+    task.csg->generateIntersectionCandidates(task.a, task.a_node, *task.a_bounds, task.b, task.b_node, *task.b_bounds,
+                                             task.face_pairs, task.EPSILON, task.descend_a);
+  } catch (...) {
+    // searched again serially, so that the exception is thrown by the calling thread.
+    task.failed = true;
+  }
+}
+
+
+
+void carve::csg::CSG::generateIntersectionCandidatesInParallel(meshset_t *a,
+                                                               const face_rtree_t *a_node,
+                                                               const detail::FaceBounds &a_bounds,
+                                                               meshset_t *b,
+                                                               const face_rtree_t *b_node,
+                                                               const detail::FaceBounds &b_bounds,
+                                                               face_pair_list_t &face_pairs,
+                                                               double EPSILON) {
+  // descend a level at a time, as generateIntersectionCandidates()
+  // does, until there are enough subtree pairs to keep the threads
+  // busy. the pairs are kept in the order the serial descent visits
+  // them, so joining their results in order gives the serial result.
+  const size_t MIN_TASKS = 256;
+  std::vector<CandidateTask> tasks(1, CandidateTask(this, a, a_node, &a_bounds, b, b_node, &b_bounds, EPSILON, true));
+  bool split = true;
+  while (split && tasks.size() < MIN_TASKS) {
+    std::vector<CandidateTask> next;
+    split = false;
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      const CandidateTask &task = tasks[i];
+      if (task.a_node->bbox.maxAxisSeparation(task.b_node->bbox) > EPSILON) {
+        continue;
+      }
+      if (task.a_node->child && (task.descend_a || !task.b_node->child)) {
+        for (face_rtree_t *node = task.a_node->child; node; node = node->sibling) {
+          next.push_back(CandidateTask(this, a, node, &a_bounds, b, task.b_node, &b_bounds, EPSILON, false));
+        }
+        split = true;
+      } else if (task.b_node->child) {
+        for (face_rtree_t *node = task.b_node->child; node; node = node->sibling) {
+          next.push_back(CandidateTask(this, a, task.a_node, &a_bounds, b, node, &b_bounds, EPSILON, true));
+        }
+        split = true;
+      } else {
+        next.push_back(task);
+      }
+    }
+    tasks.swap(next);
+  }
+
+  parallel_for(tasks.size(), generateCandidateTask, &tasks);
+
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    CandidateTask &task = tasks[i];
+    if (task.failed) {
+      task.face_pairs.clear();
+      generateIntersectionCandidates(a, task.a_node, a_bounds, b, task.b_node, b_bounds, task.face_pairs, EPSILON, task.descend_a);
+    }
+    face_pairs.insert(face_pairs.end(), task.face_pairs.begin(), task.face_pairs.end());
+  }
+}
+
+
+
+struct carve::csg::CSG::IntersectionPhase {
+  enum kind_t {
+    VERTEX_VERTEX,
+    VERTEX_EDGE,
+    EDGE_EDGE,
+    VERTEX_FACE,
+    EDGE_FACE
+  };
+
+  kind_t kind;
+  CSG *csg;
+  std::vector<const face_pairs_t::value_type *> face_pairs;
+  double EPSILON;
+  double EPSILON2;
+  // the predicates of the calling thread, for the worker threads.
+  bool exact_predicates;
+  // for each face pair, the edges (ea, eb) for which the serial step
+  // may record an intersection, in the order it visits them. ea is
+  // NULL for the vertex-face and edge-face steps.
+  std::vector<std::vector<std::pair<meshset_t::edge_t *, meshset_t::edge_t *> > > found;
+  std::vector<char> failed;
+
+  IntersectionPhase(CSG *_csg, const face_pairs_t &_face_pairs, double _EPSILON, double _EPSILON2) :
+      kind(VERTEX_VERTEX), csg(_csg), EPSILON(_EPSILON), EPSILON2(_EPSILON2),
+      exact_predicates(carve::ExactPredicates::enabled()) {
+    face_pairs.reserve(_face_pairs.size());
+    for (face_pairs_t::const_iterator i = _face_pairs.begin(); i != _face_pairs.end(); ++i) {
+      face_pairs.push_back(&*i);
+    }
+  }
+};
+
+
+
+void carve::csg::CSG::findPhaseIntersections(void *context, size_t index) {
+  IntersectionPhase &phase = *(IntersectionPhase *)context;
+  meshset_t::face_t *a = phase.face_pairs[index]->first;
+  const std::vector<meshset_t::face_t *> &b = phase.face_pairs[index]->second;
+  std::vector<std::pair<meshset_t::edge_t *, meshset_t::edge_t *> > &found = phase.found[index];
+  // only read here. an edge pair that already intersects before the
+  // step is skipped by the serial step as well.
+  Intersections &intersections = phase.csg->intersections;
+  meshset_t::vertex_t::vector_t p;
+  carve::ExactPredicates predicates(phase.exact_predicates);
+
+  try {
+    if (phase.kind == IntersectionPhase::VERTEX_FACE || phase.kind == IntersectionPhase::EDGE_FACE) {
+      for (size_t i = 0; i < b.size(); ++i) {
+        meshset_t::face_t *t = b[i];
+        meshset_t::edge_t *eb = t->edge;
+        do {
+          bool hit;
+          if (phase.kind == IntersectionPhase::VERTEX_FACE) {
+            hit = !intersections.intersects(eb->v1(), a) && vertexFaceIntersection(a, eb, phase.EPSILON, phase.EPSILON2);
+          } else {
+            hit = !intersections.intersects(eb, a) && edgeFaceIntersection(a, eb, p, phase.EPSILON);
+          }
+          if (hit) found.push_back(std::make_pair((meshset_t::edge_t *)NULL, eb));
+          eb = eb->next;
+        } while (eb != t->edge);
+      }
+    } else {
+      meshset_t::edge_t *ea = a->edge;
+      do {
+        for (size_t i = 0; i < b.size(); ++i) {
+          meshset_t::face_t *t = b[i];
+          meshset_t::edge_t *eb = t->edge;
+          do {
+            bool hit;
+            if (phase.kind == IntersectionPhase::VERTEX_VERTEX) {
+              hit = !intersections.intersects(ea->v1(), eb->v1()) && vertexVertexIntersection(ea->v1(), eb, phase.EPSILON2);
+            } else if (phase.kind == IntersectionPhase::VERTEX_EDGE) {
+              hit = !intersections.intersects(ea->v1(), eb) && vertexEdgeIntersection(ea->v1(), eb, phase.EPSILON, phase.EPSILON2);
+            } else {
+              // a degenerate edge is a hit, the serial step throws for it.
+              hit = !intersections.intersects(ea, eb) && edgeEdgeIntersection(ea, eb, p, phase.EPSILON) != carve::RR_NO_INTERSECTION;
+            }
+            if (hit) found.push_back(std::make_pair(ea, eb));
+            eb = eb->next;
+          } while (eb != t->edge);
+        }
+        ea = ea->next;
+      } while (ea != a->edge);
+    }
+  } catch (...) {
+    // searched again serially, so that the exception is thrown by the calling thread.
+    phase.failed[index] = 1;
+  }
+}
+
+
+
+void carve::csg::CSG::generateIntersectionsInParallel(IntersectionPhase &phase) {
+  size_t n = phase.face_pairs.size();
+  phase.found.assign(n, std::vector<std::pair<meshset_t::edge_t *, meshset_t::edge_t *> >());
+  phase.failed.assign(n, 0);
+
+  parallel_for(n, findPhaseIntersections, &phase);
+
+  // record the intersections as the serial step does, in the same
+  // order, so that the same vertices are taken from the pool.
+  for (size_t i = 0; i < n; ++i) {
+    meshset_t::face_t *a = phase.face_pairs[i]->first;
+    const std::vector<meshset_t::face_t *> &b = phase.face_pairs[i]->second;
+    if (phase.failed[i]) {
+      switch (phase.kind) {
+      case IntersectionPhase::VERTEX_VERTEX: generateVertexVertexIntersections(a, b, phase.EPSILON2); break;
+      case IntersectionPhase::VERTEX_EDGE: generateVertexEdgeIntersections(a, b, phase.EPSILON, phase.EPSILON2); break;
+      case IntersectionPhase::EDGE_EDGE: generateEdgeEdgeIntersections(a, b, phase.EPSILON); break;
+      case IntersectionPhase::VERTEX_FACE: generateVertexFaceIntersections(a, b, phase.EPSILON, phase.EPSILON2); break;
+      case IntersectionPhase::EDGE_FACE: generateEdgeFaceIntersections(a, b, phase.EPSILON); break;
+      }
+      continue;
+    }
+    const std::vector<std::pair<meshset_t::edge_t *, meshset_t::edge_t *> > &found = phase.found[i];
+    for (size_t j = 0; j < found.size(); ++j) {
+      meshset_t::edge_t *ea = found[j].first, *eb = found[j].second;
+      switch (phase.kind) {
+      case IntersectionPhase::VERTEX_VERTEX: _generateVertexVertexIntersections(ea->v1(), eb, phase.EPSILON2); break;
+      case IntersectionPhase::VERTEX_EDGE: _generateVertexEdgeIntersections(ea->v1(), eb, phase.EPSILON, phase.EPSILON2); break;
+      case IntersectionPhase::EDGE_EDGE: _generateEdgeEdgeIntersections(ea, eb, phase.EPSILON); break;
+      case IntersectionPhase::VERTEX_FACE: _generateVertexFaceIntersections(a, eb, phase.EPSILON, phase.EPSILON2); break;
+      case IntersectionPhase::EDGE_FACE: _generateEdgeFaceIntersections(a, eb, phase.EPSILON); break;
+      }
+    }
+  }
+}
+
+
+
 
 void carve::csg::CSG::generateIntersections(meshset_t *a,
                                             const face_rtree_t *a_rtree,
                                             meshset_t *b,
                                             const face_rtree_t *b_rtree,
                                             detail::Data &data, double EPSILON, double EPSILON2) {
+  detail::FaceBounds a_bounds(a_rtree), b_bounds(b_rtree);
+  face_pair_list_t candidates;
+  if (parallel_for) {
+    generateIntersectionCandidatesInParallel(a, a_rtree, a_bounds, b, b_rtree, b_bounds, candidates, EPSILON);
+  } else {
+    generateIntersectionCandidates(a, a_rtree, a_bounds, b, b_rtree, b_bounds, candidates, EPSILON);
+  }
+
   face_pairs_t face_pairs;
-  generateIntersectionCandidates(a, a_rtree, b, b_rtree, face_pairs, EPSILON);
+  for (face_pair_list_t::const_iterator i = candidates.begin(); i != candidates.end(); ++i) {
+    face_pairs[(*i).first].push_back((*i).second);
+    face_pairs[(*i).second].push_back((*i).first);
+  }
 
   for (face_pairs_t::const_iterator i = face_pairs.begin(); i != face_pairs.end(); ++i) {
     meshset_t::face_t *f = (*i).first;
@@ -948,26 +1378,40 @@ void carve::csg::CSG::generateIntersections(meshset_t *a,
     } while (e != f->edge);
   }
   
-  for (face_pairs_t::const_iterator i = face_pairs.begin(); i != face_pairs.end(); ++i) {
-    generateVertexVertexIntersections((*i).first, (*i).second, EPSILON2);
-  }
-  
-  for (face_pairs_t::const_iterator i = face_pairs.begin(); i != face_pairs.end(); ++i) {
-    generateVertexEdgeIntersections((*i).first, (*i).second,  EPSILON,  EPSILON2);
-  }
-   
-  for (face_pairs_t::const_iterator i = face_pairs.begin(); i != face_pairs.end(); ++i) {
-    generateEdgeEdgeIntersections((*i).first, (*i).second, EPSILON);
-  }
-  
-  for (face_pairs_t::const_iterator i = face_pairs.begin(); i != face_pairs.end(); ++i) {
-    generateVertexFaceIntersections((*i).first, (*i).second, EPSILON, EPSILON2);
-  }
-  
-  for (face_pairs_t::const_iterator i = face_pairs.begin(); i != face_pairs.end(); ++i) {
-    generateEdgeFaceIntersections((*i).first, (*i).second, EPSILON);
+  if (parallel_for) {
+    IntersectionPhase phase(this, face_pairs, EPSILON, EPSILON2);
+    phase.kind = IntersectionPhase::VERTEX_VERTEX;
+    generateIntersectionsInParallel(phase);
+    phase.kind = IntersectionPhase::VERTEX_EDGE;
+    generateIntersectionsInParallel(phase);
+    phase.kind = IntersectionPhase::EDGE_EDGE;
+    generateIntersectionsInParallel(phase);
+    phase.kind = IntersectionPhase::VERTEX_FACE;
+    generateIntersectionsInParallel(phase);
+    phase.kind = IntersectionPhase::EDGE_FACE;
+    generateIntersectionsInParallel(phase);
+  } else {
+    for (face_pairs_t::const_iterator i = face_pairs.begin(); i != face_pairs.end(); ++i) {
+      generateVertexVertexIntersections((*i).first, (*i).second, EPSILON2);
+    }
+
+    for (face_pairs_t::const_iterator i = face_pairs.begin(); i != face_pairs.end(); ++i) {
+      generateVertexEdgeIntersections((*i).first, (*i).second,  EPSILON,  EPSILON2);
+    }
+
+    for (face_pairs_t::const_iterator i = face_pairs.begin(); i != face_pairs.end(); ++i) {
+      generateEdgeEdgeIntersections((*i).first, (*i).second, EPSILON);
+    }
+
+    for (face_pairs_t::const_iterator i = face_pairs.begin(); i != face_pairs.end(); ++i) {
+      generateVertexFaceIntersections((*i).first, (*i).second, EPSILON, EPSILON2);
+    }
+
+    for (face_pairs_t::const_iterator i = face_pairs.begin(); i != face_pairs.end(); ++i) {
+      generateEdgeFaceIntersections((*i).first, (*i).second, EPSILON);
+    }
   }
-   
+
 
 
 #if defined(CARVE_DEBUG)
@@ -1010,7 +1454,7 @@ void carve::csg::CSG::generateIntersections(meshset_t *a,
 
 
 
-carve::csg::CSG::CSG(double prec) {
+carve::csg::CSG::CSG(double prec) : exact_predicates(false) {
 	
 		precision = prec;
 		precision2 = precision * precision;
@@ -1412,6 +1856,94 @@ void returnSharedEdges(carve::csg::V2Set &shared_edges,
 
 
 
+namespace {
+  typedef carve::mesh::MeshSet<3>::face_rtree_t meshset_rtree_t;
+
+  // the spatial index of the faces of meshset: the one it carries from
+  // an earlier operation, or else a new one, which owned takes.
+  const meshset_rtree_t *faceRTree(carve::mesh::MeshSet<3> *meshset,
+                                   std::auto_ptr<meshset_rtree_t> &owned) {
+    if (meshset->faceRTree()) return meshset->faceRTree();
+    owned.reset(meshset_rtree_t::construct_STR(meshset->faceBegin(), meshset->faceEnd(), 4, 4));
+    return owned.get();
+  }
+
+  // follows the faces of src that pass unchanged into the result of a
+  // CSG operation, so that the index of the faces of src can be updated
+  // for the result, rather than the result being indexed from scratch
+  // by the next operation on it.
+  class FaceSuccessors : public carve::csg::CSG::Hook {
+    typedef carve::mesh::MeshSet<3> meshset_t;
+    typedef std::unordered_map<const meshset_t::face_t *, meshset_t::face_t *> face_map_t;
+
+    const meshset_t *src;
+    carve::csg::CSG::Hooks &hooks;
+    face_map_t kept;
+    std::vector<meshset_t::face_t *> added;
+
+    FaceSuccessors(const FaceSuccessors &);
+    FaceSuccessors &operator=(const FaceSuccessors &);
+
+    static bool sameVertices(const meshset_t::face_t *a, const meshset_t::face_t *b) {
+      if (a->n_edges != b->n_edges) return false;
+      const meshset_t::edge_t *ea = a->edge;
+      const meshset_t::edge_t *eb = b->edge;
+      for (size_t i = 0; i < b->n_edges && eb->vert->v != ea->vert->v; ++i) eb = eb->next;
+      do {
+        if (ea->vert->v != eb->vert->v) return false;
+        ea = ea->next;
+        eb = eb->next;
+      } while (ea != a->edge);
+      return true;
+    }
+
+  public:
+    FaceSuccessors(const meshset_t *_src, carve::csg::CSG::Hooks &_hooks) : src(_src), hooks(_hooks) {
+      hooks.registerHook(this, carve::csg::CSG::Hooks::RESULT_FACE_BIT);
+    }
+
+    virtual ~FaceSuccessors() {
+      hooks.unregisterHook(this);
+    }
+
+    virtual void resultFace(const meshset_t::face_t *new_face,
+                            const meshset_t::face_t *orig_face,
+                            bool flipped) {
+      meshset_t::face_t *face = const_cast<meshset_t::face_t *>(new_face);
+      if (!flipped &&
+          orig_face->mesh->meshset == src &&
+          sameVertices(orig_face, new_face) &&
+          kept.insert(std::make_pair(orig_face, face)).second) {
+        return;
+      }
+      added.push_back(face);
+    }
+
+    // the successor of a face of src, or NULL, for RTreeNode::replace().
+    meshset_t::face_t *operator()(meshset_t::face_t *face) const {
+      face_map_t::const_iterator i = kept.find(face);
+      return i == kept.end() ? NULL : (*i).second;
+    }
+
+    // turns rtree, an index of the faces of src that this takes, into
+    // an index of the faces of the result. returns NULL when most faces
+    // of the result are new, as an index built from scratch is then
+    // better, and is left to the next operation that needs one.
+    meshset_rtree_t *update(meshset_rtree_t *rtree) {
+      if (added.size() > kept.size() || !rtree->replace(*this)) {
+        delete rtree;
+        return NULL;
+      }
+      for (size_t i = 0; i < added.size(); ++i) {
+        rtree->insert(added[i], 4, 4);
+      }
+      return rtree;
+    }
+  };
+}
+
+
+
 /** 
  * 
  * 
@@ -1431,6 +1963,7 @@ carve::mesh::MeshSet<3> *carve::csg::CSG::compute(meshset_t *a,
                                                   CLASSIFY_TYPE classify_type) {
   static carve::TimingName FUNC_NAME("CSG::compute");
   carve::TimingBlock block(FUNC_NAME);
+  carve::ExactPredicates predicates(exact_predicates);
 
   VertexClassification vclass;
   EdgeClassification eclass;
@@ -1445,18 +1978,20 @@ carve::mesh::MeshSet<3> *carve::csg::CSG::compute(meshset_t *a,
   size_t b_edge_count;
   double EPSILON = getPrecision();
   double EPSILON2= getPrecision2();
-  std::auto_ptr<face_rtree_t> a_rtree(face_rtree_t::construct_STR(a->faceBegin(), a->faceEnd(), 4, 4));
-  std::auto_ptr<face_rtree_t> b_rtree(face_rtree_t::construct_STR(b->faceBegin(), b->faceEnd(), 4, 4));
-  
+  std::auto_ptr<face_rtree_t> a_rtree_owned;
+  std::auto_ptr<face_rtree_t> b_rtree_owned;
+  const face_rtree_t *a_rtree = faceRTree(a, a_rtree_owned);
+  const face_rtree_t *b_rtree = faceRTree(b, b_rtree_owned);
+  FaceSuccessors a_successors(a, hooks);
 
   {
     static carve::TimingName FUNC_NAME("CSG::compute - calc()");
     carve::TimingBlock block(FUNC_NAME);
-    calc(a, a_rtree.get(), b, b_rtree.get(), vclass, eclass,a_face_loops, b_face_loops, a_edge_count, b_edge_count);
+    calc(a, a_rtree, b, b_rtree, vclass, eclass,a_face_loops, b_face_loops, a_edge_count, b_edge_count);
   }
 #if defined(CARVE_DEBUG)
-  std::cerr<<"A_rtree pos = "<< a_rtree.get()->bbox.pos.asStr()<< "extent = " <<a_rtree.get()->bbox.extent.asStr()<<std::endl;
-  std::cerr<<"B_rtree pos = "<< b_rtree.get()->bbox.pos.asStr()<< "extent = " <<b_rtree.get()->bbox.extent.asStr()<<std::endl;
+  std::cerr<<"A_rtree pos = "<< a_rtree->bbox.pos.asStr()<< "extent = " <<a_rtree->bbox.extent.asStr()<<std::endl;
+  std::cerr<<"B_rtree pos = "<< b_rtree->bbox.pos.asStr()<< "extent = " <<b_rtree->bbox.extent.asStr()<<std::endl;
 #endif
   detail::LoopEdges a_edge_map;
   detail::LoopEdges b_edge_map;
@@ -1523,11 +2058,11 @@ carve::mesh::MeshSet<3> *carve::csg::CSG::compute(meshset_t *a,
     classifyFaceGroupsEdge(shared_edges,
                            vclass,
                            a,
-                           a_rtree.get(),
+                           a_rtree,
                            a_loops_grouped,
                            a_edge_map,
                            b,
-                           b_rtree.get(),
+                           b_rtree,
                            b_loops_grouped,
                            b_edge_map,
                            collector,  EPSILON,  EPSILON2);
@@ -1536,11 +2071,11 @@ carve::mesh::MeshSet<3> *carve::csg::CSG::compute(meshset_t *a,
     classifyFaceGroups(shared_edges,
                        vclass,
                        a,
-                       a_rtree.get(),
+                       a_rtree,
                        a_loops_grouped,
                        a_edge_map,
                        b,
-                       b_rtree.get(),
+                       b_rtree,
                        b_loops_grouped,
                        b_edge_map,
                        collector,  EPSILON,  EPSILON2);
@@ -1548,10 +2083,17 @@ carve::mesh::MeshSet<3> *carve::csg::CSG::compute(meshset_t *a,
   }
 
   meshset_t *result = collector.done(hooks);
+  if (result != NULL) {
+    // the result shares the faces of a that were neither cut nor
+    // dropped, so its index starts from that of a.
+    result->setFaceRTree(a_successors.update(a_rtree_owned.get() ? a_rtree_owned.release() : a_rtree->copy()));
+  }
   if (result != NULL && shared_edges_ptr != NULL) {
     std::list<meshset_t *> result_list;
     result_list.push_back(result);
     returnSharedEdges(shared_edges, result_list, shared_edges_ptr);
+  } else if (shared_edges_ptr != NULL) {
+    shared_edges_ptr->insert(shared_edges.begin(), shared_edges.end());
   }
   return result;
 }
@@ -1587,6 +2129,192 @@ carve::mesh::MeshSet<3> *carve::csg::CSG::compute(meshset_t *a,
 
 
 
+// copies the meshes of each meshset into a single meshset, as meshes of
+// their own, without looking for shared vertices.
+static carve::mesh::MeshSet<3> *gatherMeshes(const std::vector<carve::mesh::MeshSet<3> *> &meshsets) {
+  typedef carve::mesh::MeshSet<3> meshset_t;
+
+  size_t n_vertices = 0;
+  for (size_t i = 0; i < meshsets.size(); ++i) {
+    n_vertices += meshsets[i]->vertex_storage.size();
+  }
+  std::vector<meshset_t::vertex_t> vertex_storage;
+  vertex_storage.reserve(n_vertices);
+  std::vector<meshset_t::mesh_t *> meshes;
+
+  for (size_t i = 0; i < meshsets.size(); ++i) {
+    const meshset_t *meshset = meshsets[i];
+    if (meshset->vertex_storage.empty()) continue;
+    size_t base = vertex_storage.size();
+    vertex_storage.insert(vertex_storage.end(), meshset->vertex_storage.begin(), meshset->vertex_storage.end());
+    for (size_t j = 0; j < meshset->meshes.size(); ++j) {
+      meshes.push_back(meshset->meshes[j]->clone(&meshset->vertex_storage[0], &vertex_storage[base]));
+    }
+  }
+
+  return new meshset_t(vertex_storage, meshes);
+}
+
+
+
+carve::mesh::MeshSet<3> *carve::csg::CSG::subtract(meshset_t *a,
+                                                   const std::vector<meshset_t *> &tools,
+                                                   CLASSIFY_TYPE classify_type) {
+  static carve::TimingName FUNC_NAME("CSG::subtract");
+  carve::TimingBlock block(FUNC_NAME);
+
+  double EPSILON = getPrecision();
+  meshset_t::aabb_t a_aabb = a->getAABB();
+
+  // each tool goes in the first pass whose tools it is clear of. tools
+  // in the same pass can share a meshset without being unioned.
+  std::vector<std::vector<meshset_t *> > passes;
+  std::vector<std::vector<meshset_t::aabb_t> > pass_aabbs;
+  for (size_t i = 0; i < tools.size(); ++i) {
+    if (tools[i]->meshes.empty()) continue;
+    meshset_t::aabb_t aabb = tools[i]->getAABB();
+    if (!aabb.intersects(a_aabb, EPSILON)) continue;
+    size_t p = 0;
+    for (; p < passes.size(); ++p) {
+      size_t j = 0;
+      while (j < pass_aabbs[p].size() && !aabb.intersects(pass_aabbs[p][j], EPSILON)) ++j;
+      if (j == pass_aabbs[p].size()) break;
+    }
+    if (p == passes.size()) {
+      passes.resize(p + 1);
+      pass_aabbs.resize(p + 1);
+    }
+    passes[p].push_back(tools[i]);
+    pass_aabbs[p].push_back(aabb);
+  }
+
+  std::auto_ptr<meshset_t> result;
+  for (size_t p = 0; p < passes.size(); ++p) {
+    std::auto_ptr<meshset_t> b(gatherMeshes(passes[p]));
+    result.reset(compute(result.get() ? result.get() : a, b.get(), A_MINUS_B, NULL, classify_type));
+  }
+
+  return result.get() ? result.release() : a->clone();
+}
+
+
+
+namespace {
+  typedef const carve::mesh::MeshSet<3>::vertex_t *curve_vertex_t;
+  typedef std::unordered_map<curve_vertex_t, std::vector<curve_vertex_t> > curve_adjacency_t;
+  typedef std::set<std::pair<curve_vertex_t, curve_vertex_t> > curve_edges_t;
+
+  bool takeCurveEdge(curve_edges_t &edges, curve_vertex_t v1, curve_vertex_t v2) {
+    return edges.erase(std::make_pair(std::min(v1, v2), std::max(v1, v2))) != 0;
+  }
+
+  // follows the edges not yet taken from v through next, while they
+  // pass through vertices shared by two edges.
+  void followCurve(const curve_adjacency_t &adjacent,
+                   curve_edges_t &edges,
+                   curve_vertex_t v,
+                   curve_vertex_t next,
+                   std::vector<carve::geom3d::Vector> &polyline) {
+    polyline.push_back(v->v);
+    while (takeCurveEdge(edges, v, next)) {
+      polyline.push_back(next->v);
+      const std::vector<curve_vertex_t> &n = (*adjacent.find(next)).second;
+      if (n.size() != 2) break;
+      curve_vertex_t after = n[0] == v ? n[1] : n[0];
+      v = next;
+      next = after;
+    }
+  }
+
+  // puts the curves in an order that depends only on their points, the
+  // vertex pointers they were gathered by differ from run to run. an open
+  // curve runs from its lesser end, a closed one from its least point
+  // towards the lesser of that point's neighbours.
+  void orderCurves(std::vector<std::vector<carve::geom3d::Vector> > &polylines) {
+    for (size_t i = 0; i < polylines.size(); ++i) {
+      std::vector<carve::geom3d::Vector> &p = polylines[i];
+      if (p.size() < 2) continue;
+      if (p.size() > 3 && p.front() == p.back()) {
+        p.pop_back();
+        std::rotate(p.begin(), std::min_element(p.begin(), p.end()), p.end());
+        if (p.back() < p[1]) std::reverse(p.begin() + 1, p.end());
+        p.push_back(p.front());
+      } else if (p.back() < p.front()) {
+        std::reverse(p.begin(), p.end());
+      }
+    }
+    std::sort(polylines.begin(), polylines.end());
+  }
+}
+
+
+
+void carve::csg::CSG::classify(meshset_t *a,
+                               meshset_t *b,
+                               ClassifyResult &result,
+                               CLASSIFY_TYPE classify_type) {
+  static carve::TimingName FUNC_NAME("CSG::classify");
+  carve::TimingBlock block(FUNC_NAME);
+
+  std::unordered_map<const meshset_t::face_t *, unsigned> face_bits;
+  V2Set shared_edges;
+  if (a->isClosed() && b->isClosed() && !a->getAABB().intersects(b->getAABB(), getPrecision())) {
+    // most pairs of elements are clear of each other.
+    result.a_faces.assign(a->faceEnd() - a->faceBegin(), FACE_OUT_BIT);
+    result.b_faces.assign(b->faceEnd() - b->faceBegin(), FACE_OUT_BIT);
+    result.polylines.clear();
+    return;
+  }
+  std::auto_ptr<Collector> collector(makeClassifyCollector(a, b, face_bits));
+  compute(a, b, *collector, &shared_edges, classify_type);
+
+  result.a_faces.clear();
+  result.a_faces.reserve(a->faceEnd() - a->faceBegin());
+  for (meshset_t::face_iter i = a->faceBegin(); i != a->faceEnd(); ++i) {
+    std::unordered_map<const meshset_t::face_t *, unsigned>::const_iterator j = face_bits.find(*i);
+    result.a_faces.push_back(j == face_bits.end() ? 0 : (*j).second);
+  }
+  result.b_faces.clear();
+  result.b_faces.reserve(b->faceEnd() - b->faceBegin());
+  for (meshset_t::face_iter i = b->faceBegin(); i != b->faceEnd(); ++i) {
+    std::unordered_map<const meshset_t::face_t *, unsigned>::const_iterator j = face_bits.find(*i);
+    result.b_faces.push_back(j == face_bits.end() ? 0 : (*j).second);
+  }
+
+  // the shared edges may be found in both directions.
+  curve_edges_t edges;
+  for (V2Set::const_iterator i = shared_edges.begin(); i != shared_edges.end(); ++i) {
+    if ((*i).first == (*i).second) continue;
+    edges.insert(std::make_pair(std::min<curve_vertex_t>((*i).first, (*i).second),
+                                std::max<curve_vertex_t>((*i).first, (*i).second)));
+  }
+  curve_adjacency_t adjacent;
+  for (curve_edges_t::const_iterator i = edges.begin(); i != edges.end(); ++i) {
+    adjacent[(*i).first].push_back((*i).second);
+    adjacent[(*i).second].push_back((*i).first);
+  }
+
+  // open curves run between vertices that do not join two edges, what
+  // is left are closed curves.
+  result.polylines.clear();
+  for (curve_adjacency_t::const_iterator i = adjacent.begin(); i != adjacent.end(); ++i) {
+    if ((*i).second.size() == 2) continue;
+    for (size_t j = 0; j < (*i).second.size(); ++j) {
+      if (!edges.count(std::make_pair(std::min((*i).first, (*i).second[j]), std::max((*i).first, (*i).second[j])))) continue;
+      result.polylines.push_back(std::vector<carve::geom3d::Vector>());
+      followCurve(adjacent, edges, (*i).first, (*i).second[j], result.polylines.back());
+    }
+  }
+  while (!edges.empty()) {
+    std::pair<curve_vertex_t, curve_vertex_t> start = *edges.begin();
+    result.polylines.push_back(std::vector<carve::geom3d::Vector>());
+    followCurve(adjacent, edges, start.first, start.second, result.polylines.back());
+  }
+  orderCurves(result.polylines);
+}
+
+
+
 /** 
  * 
  * 
@@ -1604,6 +2332,7 @@ bool carve::csg::CSG::sliceAndClassify(meshset_t *closed,
                                        std::list<std::pair<FaceClass, meshset_t *> > &result,
                                        carve::csg::V2Set *shared_edges_ptr) {
   if (!closed->isClosed()) return false;
+  carve::ExactPredicates predicates(exact_predicates);
   carve::csg::VertexClassification vclass;
   carve::csg::EdgeClassification eclass;
 
@@ -1617,10 +2346,12 @@ bool carve::csg::CSG::sliceAndClassify(meshset_t *closed,
   size_t b_edge_count;
   double EPSILON = getPrecision();
   double EPSILON2= getPrecision2();
-  std::auto_ptr<face_rtree_t> closed_rtree(face_rtree_t::construct_STR(closed->faceBegin(), closed->faceEnd(), 4, 4));
-  std::auto_ptr<face_rtree_t> open_rtree(face_rtree_t::construct_STR(open->faceBegin(), open->faceEnd(), 4, 4));
+  std::auto_ptr<face_rtree_t> closed_rtree_owned;
+  std::auto_ptr<face_rtree_t> open_rtree_owned;
+  const face_rtree_t *closed_rtree = faceRTree(closed, closed_rtree_owned);
+  const face_rtree_t *open_rtree = faceRTree(open, open_rtree_owned);
 
-  calc(closed, closed_rtree.get(), open, open_rtree.get(), vclass, eclass,a_face_loops, b_face_loops, a_edge_count, b_edge_count);
+  calc(closed, closed_rtree, open, open_rtree, vclass, eclass,a_face_loops, b_face_loops, a_edge_count, b_edge_count);
 
   detail::LoopEdges a_edge_map;
   detail::LoopEdges b_edge_map;
@@ -1638,11 +2369,11 @@ bool carve::csg::CSG::sliceAndClassify(meshset_t *closed,
   halfClassifyFaceGroups(shared_edges,
                          vclass,
                          closed,
-                         closed_rtree.get(),
+                         closed_rtree,
                          a_loops_grouped,
                          a_edge_map,
                          open,
-                         open_rtree.get(),
+                         open_rtree,
                          b_loops_grouped,
                          b_edge_map,  EPSILON,  EPSILON2,
                          result);
@@ -1674,6 +2405,7 @@ void carve::csg::CSG::slice(meshset_t *a,
                             std::list<meshset_t *> &a_sliced,
                             std::list<meshset_t *> &b_sliced, 
                             carve::csg::V2Set *shared_edges_ptr) {
+  carve::ExactPredicates predicates(exact_predicates);
   carve::csg::VertexClassification vclass;
   carve::csg::EdgeClassification eclass;
 
@@ -1687,10 +2419,12 @@ void carve::csg::CSG::slice(meshset_t *a,
   size_t b_edge_count;
   double EPSILON = getPrecision();
   double EPSILON2= getPrecision2();
-  std::auto_ptr<face_rtree_t> a_rtree(face_rtree_t::construct_STR(a->faceBegin(), a->faceEnd(), 4, 4));
-  std::auto_ptr<face_rtree_t> b_rtree(face_rtree_t::construct_STR(b->faceBegin(), b->faceEnd(), 4, 4));
+  std::auto_ptr<face_rtree_t> a_rtree_owned;
+  std::auto_ptr<face_rtree_t> b_rtree_owned;
+  const face_rtree_t *a_rtree = faceRTree(a, a_rtree_owned);
+  const face_rtree_t *b_rtree = faceRTree(b, b_rtree_owned);
 
-  calc(a, a_rtree.get(), b, b_rtree.get(), vclass, eclass,a_face_loops, b_face_loops, a_edge_count, b_edge_count);
+  calc(a, a_rtree, b, b_rtree, vclass, eclass,a_face_loops, b_face_loops, a_edge_count, b_edge_count);
 
   detail::LoopEdges a_edge_map;
   detail::LoopEdges b_edge_map;
@@ -74,6 +74,11 @@ Standard_EXPORT virtual ~BOPAlgo_PaveFiller();
   
   Standard_EXPORT   Handle(IntTools_Context) Context() ;
   
+  //! Sets the context the algorithm caches its classifiers and
+  //! projectors in, so that they can be reused by a later operation
+  //! on the same shapes. A new context is made if it is null.
+  Standard_EXPORT   void SetContext (const Handle(IntTools_Context)& theContext) ;
+  
   Standard_EXPORT   void SetSectionAttribute (const BOPAlgo_SectionAttribute& theSecAttr) ;
   
   Standard_EXPORT virtual   void Perform() ;
@@ -272,6 +277,7 @@ protected:
   BOPDS_PDS myDS;
   BOPDS_PIterator myIterator;
   Handle(IntTools_Context) myContext;
+  Handle(IntTools_Context) myGivenContext;
   BOPAlgo_SectionAttribute mySectionAttribute;
   Standard_Real myFuzzyValue;
 
@@ -0,0 +1,102 @@
+// This file is part of Open CASCADE Technology software library.
+//
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License version 2.1 as published
+// by the Free Software Foundation, with special exception defined in the file
+// OCCT_LGPL_EXCEPTION.txt. Consult the file LICENSE_LGPL_21.txt included in OCCT
+// distribution for complete text of the license and disclaimer of any warranty.
+//
+// Alternatively, this file may be used under the terms of Open CASCADE
+// commercial license or contractual agreement.
+
+#ifndef _BOPCol_BoxBVH_HeaderFile
+#define _BOPCol_BoxBVH_HeaderFile
+
+#include <Standard.hxx>
+#include <Standard_DefineAlloc.hxx>
+#include <Standard_Integer.hxx>
+#include <Standard_Boolean.hxx>
+#include <Bnd_Box.hxx>
+#include <BOPCol_ListOfInteger.hxx>
+#include <vector>
+#include <utility>
+
+/**
+ * Bounding volume hierarchy of boxes built top down by the surface
+ * area heuristic. NCollection_UBTree inserts the boxes one at a time
+ * and its nodes swell around the long thin boxes of walls, slabs and
+ * beams. Here each node is split where the areas of its two children,
+ * weighted by the number of boxes in each, are least.
+ * The lower subtrees are built, and the pairs of overlapping boxes
+ * found, concurrently. Boxes are tested with Bnd_Box::IsOut, so the
+ * boxes found overlapping are those BOPCol_BoxBndTreeSelector finds.
+*/
+class BOPCol_BoxBVH {
+ public:
+  DEFINE_STANDARD_ALLOC
+
+  //! Indices of two overlapping boxes, the less first
+  typedef std::pair<Standard_Integer, Standard_Integer> Pair;
+  typedef std::vector<Pair> VectorOfPair;
+
+  Standard_EXPORT BOPCol_BoxBVH();
+  Standard_EXPORT ~BOPCol_BoxBVH();
+
+  //! Adds the box with the index, void boxes are ignored
+  Standard_EXPORT void Add(const Standard_Integer theIndex,
+                           const Bnd_Box& theBox);
+
+  //! Builds the hierarchy of the boxes added, the subtrees
+  //! are built concurrently if theRunParallel is true
+  Standard_EXPORT void Build(const Standard_Boolean theRunParallel);
+
+  //! Removes the boxes and the hierarchy
+  Standard_EXPORT void Clear();
+
+  //! Returns the number of boxes
+  Standard_EXPORT Standard_Integer Extent() const;
+
+  //! Appends the indices of the boxes that overlap theBox,
+  //! returns the number appended
+  Standard_EXPORT Standard_Integer Select(const Bnd_Box& theBox,
+                                          BOPCol_ListOfInteger& theIndices) const;
+
+  //! Appends each pair of overlapping boxes of the hierarchy
+  //! once. The order of the pairs does not depend on whether,
+  //! or on how many threads, they are found concurrently
+  Standard_EXPORT void SelectPairs(const Standard_Boolean theRunParallel,
+                                   VectorOfPair& thePairs) const;
+
+  //! Appends each pair of a box of the hierarchy, first, and an
+  //! overlapping box of theOther, second
+  Standard_EXPORT void SelectPairs(const BOPCol_BoxBVH& theOther,
+                                   const Standard_Boolean theRunParallel,
+                                   VectorOfPair& thePairs) const;
+
+ public:
+  struct Node {
+    Standard_Real myMin[3];
+    Standard_Real myMax[3];
+    Standard_Integer myFirst;   // first box of the node in myOrder
+    Standard_Integer myCount;   // number of boxes below the node
+    Standard_Integer myLeft;    // children, -1 for a leaf
+    Standard_Integer myRight;
+  };
+
+ protected:
+  BOPCol_BoxBVH(const BOPCol_BoxBVH&);
+  BOPCol_BoxBVH& operator=(const BOPCol_BoxBVH&);
+
+  void SelectPairs(const BOPCol_BoxBVH& theOther,
+                   const Standard_Boolean bSelf,
+                   const Standard_Boolean theRunParallel,
+                   VectorOfPair& thePairs) const;
+
+  std::vector<Bnd_Box> myBoxes;
+  std::vector<Standard_Integer> myIndices;  // index given to each box
+  std::vector<Standard_Real> myBounds;      // min x, y, z, max x, y, z
+  std::vector<Standard_Integer> myOrder;    // boxes grouped by leaf
+  std::vector<Node> myNodes;
+};
+
+#endif
@@ -17,6 +17,7 @@
 #include <BOPDS_ListIteratorOfListOfPassKeyBoolean.hxx>
 #include <Standard_Boolean.hxx>
 #include <TopAbs_ShapeEnum.hxx>
+#include <BOPDS_TreeMode.hxx>
 class BOPDS_DS;
 
 
@@ -97,6 +98,23 @@ Standard_EXPORT virtual ~BOPDS_Iterator();
   
   //! Returns the flag of parallel processing
   Standard_EXPORT   Standard_Boolean RunParallel()  const;
+  
+  //! Sets the tree the pairs of sub-shapes whose boxes overlap
+  //! are found with by every iterator, BOPDS_TreeMode_UBTree
+  //! by default
+  Standard_EXPORT static   void SetTreeMode (const BOPDS_TreeMode theMode) ;
+  
+  //! Returns the tree the pairs are found with
+  Standard_EXPORT static   BOPDS_TreeMode TreeMode() ;
+  
+  //! Returns the totals of the intersections run in the mode
+  //! BOPDS_TreeMode_Compare: the number run, the number whose
+  //! pairs, or the order of their pairs, differed between the
+  //! trees and the seconds spent finding the pairs with each tree
+  Standard_EXPORT static   void TreeStatistics (Standard_Integer& theNbRuns, Standard_Integer& theNbMismatches, Standard_Real& theUBTreeTime, Standard_Real& theBVHTime) ;
+  
+  //! Sets the totals of the comparisons to zero
+  Standard_EXPORT static   void ResetTreeStatistics() ;
 
 
 
@@ -105,6 +123,14 @@ protected:
 
   
   Standard_EXPORT virtual   void Intersect() ;
+  
+  //! Finds the pairs with the unbalanced tree of boxes
+  Standard_EXPORT   void IntersectUBTree() ;
+  
+  //! Finds the pairs with the hierarchy BOPCol_BoxBVH, in
+  //! the order of the index of their first shape, then of
+  //! their second, which is not the order of IntersectUBTree
+  Standard_EXPORT   void IntersectBVH() ;
 
 
   BOPCol_BaseAllocator myAllocator;
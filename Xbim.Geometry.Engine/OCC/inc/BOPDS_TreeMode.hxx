@@ -0,0 +1,28 @@
+// This file is part of Open CASCADE Technology software library.
+//
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License version 2.1 as published
+// by the Free Software Foundation, with special exception defined in the file
+// OCCT_LGPL_EXCEPTION.txt. Consult the file LICENSE_LGPL_21.txt included in OCCT
+// distribution for complete text of the license and disclaimer of any warranty.
+//
+// Alternatively, this file may be used under the terms of Open CASCADE
+// commercial license or contractual agreement.
+
+#ifndef _BOPDS_TreeMode_HeaderFile
+#define _BOPDS_TreeMode_HeaderFile
+
+//! The tree BOPDS_Iterator finds the pairs of sub-shapes whose
+//! boxes overlap with:
+//! BOPDS_TreeMode_UBTree  - the unbalanced tree of boxes BOPCol_BoxBndTree
+//! BOPDS_TreeMode_BVH     - the hierarchy BOPCol_BoxBVH
+//! BOPDS_TreeMode_Compare - both, the pairs of the unbalanced tree are
+//!                          used and compared with those of the hierarchy
+enum BOPDS_TreeMode
+{
+BOPDS_TreeMode_UBTree,
+BOPDS_TreeMode_BVH,
+BOPDS_TreeMode_Compare
+};
+
+#endif // _BOPDS_TreeMode_HeaderFile
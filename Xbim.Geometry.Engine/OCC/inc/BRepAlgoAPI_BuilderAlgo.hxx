@@ -11,6 +11,7 @@
 #include <Standard_Macro.hxx>
 
 #include <Standard_Integer.hxx>
+#include <Handle_IntTools_Context.hxx>
 #include <BOPAlgo_PPaveFiller.hxx>
 #include <BOPAlgo_PBuilder.hxx>
 #include <Standard_Real.hxx>
@@ -44,6 +45,12 @@ Standard_EXPORT virtual ~BRepAlgoAPI_BuilderAlgo();
   //! Returns the additional tolerance
   Standard_EXPORT   Standard_Real FuzzyValue()  const;
   
+  //! Sets the intersection context the operation caches its
+  //! classifiers and projectors in. A context kept from an operation
+  //! on the same shapes lets them be reused rather than built again.
+  //! A new context is made if it is null.
+  Standard_EXPORT   void SetContext (const Handle(IntTools_Context)& theContext) ;
+  
   //! Sets the arguments
   Standard_EXPORT   void SetArguments (const TopTools_ListOfShape& theLS) ;
   
@@ -94,6 +101,7 @@ protected:
   BOPAlgo_PBuilder myBuilder;
   Standard_Real myFuzzyValue;
   TopTools_ListOfShape myArguments;
+  Handle(IntTools_Context) myContext;
 
 
 private:
@@ -198,6 +198,11 @@ Standard_EXPORT virtual  ~IntTools_Context();
   //! Returns true if the solid <theFace> has
   //! infinite bounds
   Standard_EXPORT   Standard_Boolean IsInfiniteFace (const TopoDS_Face& theFace) ;
+  
+  //! Returns the number of classifiers, projectors, hatchers,
+  //! surface data and boxes cached, a measure of the memory
+  //! held by a context that is kept across operations
+  Standard_EXPORT   Standard_Integer NbCachedTools()  const;
 
 
 
@@ -50,124 +50,128 @@
 //! it is more efficient to use the primitive ParallelFor (because it has no critical section).
 class OSD_Parallel
 {
-  //! Auxiliary class which ensures exclusive
-  //! access to iterators of processed data pool.
-  template <typename Value>
-  class Range
+  //! Function that the threads run for each chunk [theBegin, theEnd) of the indices of a loop.
+  typedef void (*ChunkFunction) (Standard_Address theContext,
+                                 Standard_Integer theBegin,
+                                 Standard_Integer theEnd);
+
+  //! Auxiliary wrapper which calls the functor for each index of a chunk.
+  template <typename Functor>
+  class IndexTask
   {
   public: //! @name public methods
 
-    typedef Value Iterator;
-
-    //! Constructor
-    Range(const Value& theBegin, const Value& theEnd)
-    : myBegin(theBegin),
-      myEnd  (theEnd),
-      myIt   (theBegin)
+    //! Method is executed in the context of thread,
+    //! so this method defines the main calculations.
+    static void Run(Standard_Address theFunctor,
+                    Standard_Integer theBegin,
+                    Standard_Integer theEnd)
     {
+      const Functor& aPerformer = *( static_cast<const Functor*>(theFunctor) );
+      for ( Standard_Integer i = theBegin; i < theEnd; ++i )
+      {
+        aPerformer(i);
+      }
     }
+  };
 
-    //! Returns const link on the first element.
-    inline const Value& Begin() const
-    {
-      return myBegin;
-    }
+  //! Auxiliary wrapper which calls the functor for each element of a chunk
+  //! of the iterators of a "foreach" loop, gathered so they can be indexed.
+  template <typename Functor, typename InputIterator>
+  class IteratorTask
+  {
+  public: //! @name public methods
 
-    //! Returns const link on the last element.
-    inline const Value& End() const
+    //! Constructor.
+    IteratorTask(const Functor& thePerformer, const NCollection_Array1<InputIterator>& theIterators)
+    : myPerformer(thePerformer),
+      myIterators(theIterators)
     {
-      return myEnd;
     }
 
-    //! Returns first non processed element or end.
-    //! Thread-safe method.
-    inline Iterator It() const
+    //! Method is executed in the context of thread,
+    //! so this method defines the main calculations.
+    static void Run(Standard_Address theTask,
+                    Standard_Integer theBegin,
+                    Standard_Integer theEnd)
     {
-      Standard_Mutex::Sentry aMutex( myMutex );
-      return ( myIt != myEnd ) ? myIt++ : myEnd;
+      const IteratorTask& aTask = *( static_cast<const IteratorTask*>(theTask) );
+      for ( Standard_Integer i = theBegin; i < theEnd; ++i )
+      {
+        // the iterators of NCollection are dereferenced by a non-const operator
+        InputIterator anIter = aTask.myIterators(i);
+        aTask.myPerformer(*anIter);
+      }
     }
 
   private: //! @name private methods
 
-    //! Empty copy constructor
-    Range(const Range& theCopy);
+    //! Empty copy constructor.
+    IteratorTask(const IteratorTask& theCopy);
 
     //! Empty copy operator.
-    Range& operator=(const Range& theCopy);
+    IteratorTask& operator=(const IteratorTask& theCopy);
 
   private: //! @name private fields
 
-    const Value&           myBegin; //!< Fisrt element of range.
-    const Value&           myEnd;   //!< Last element of range.
-    mutable Value          myIt;    //!< First non processed element of range.
-    mutable Standard_Mutex myMutex; //!< Access controller for the first non processed element.
+    const Functor&                           myPerformer; //!< Link on functor.
+    const NCollection_Array1<InputIterator>& myIterators; //!< Link on gathered iterators.
   };
 
-  //! Auxiliary wrapper class for thread function.
-  template <typename Functor, typename InputIterator>
-  class Task
+#ifdef HAVE_TBB
+  //! Auxiliary TBB body which runs a chunk function on each range it is given.
+  class ChunkBody
   {
   public: //! @name public methods
 
     //! Constructor.
-    Task(const Functor& thePerformer, Range<InputIterator>& theRange)
-    : myPerformer(thePerformer),
-      myRange    (theRange)
-    {
-    }
-
-    //! Method is executed in the context of thread,
-    //! so this method defines the main calculations.
-    static Standard_Address RunWithIterator(Standard_Address theTask)
+    ChunkBody(ChunkFunction theFunction, Standard_Address theContext)
+    : myFunction(theFunction),
+      myContext (theContext)
     {
-      Task<Functor, InputIterator>& aTask =
-        *( static_cast< Task<Functor, InputIterator>* >(theTask) );
-
-      const Range<InputIterator>& aData( aTask.myRange );
-      typename Range<InputIterator>::Iterator i = aData.It();
-
-      for ( ; i != aData.End(); i = aData.It() )
-      {
-        aTask.myPerformer(*i);
-      }
-
-      return NULL;
     }
 
     //! Method is executed in the context of thread,
     //! so this method defines the main calculations.
-    static Standard_Address RunWithIndex(Standard_Address theTask)
+    void operator()(const tbb::blocked_range<Standard_Integer>& theRange) const
     {
-      Task<Functor, InputIterator>& aTask =
-        *( static_cast< Task<Functor, Standard_Integer>* >(theTask) );
-
-      const Range<Standard_Integer>& aData( aTask.myRange );
-      Standard_Integer i = aData.It();
-
-      for ( ; i < aData.End(); i = aData.It())
-      {
-        aTask.myPerformer(i);
-      }
-
-      return NULL;
+      myFunction(myContext, theRange.begin(), theRange.end());
     }
 
-  private: //! @name private methods
-
-    //! Empty copy constructor.
-    Task(const Task& theCopy);
-
-    //! Empty copy operator.
-    Task& operator=(const Task& theCopy);
-
   private: //! @name private fields
 
-    const Functor&              myPerformer; //!< Link on functor.
-    const Range<InputIterator>& myRange;     //!< Link on processed data block.
+    ChunkFunction    myFunction; //!< Function run for each chunk.
+    Standard_Address myContext;  //!< Functor or task the function is run for.
   };
+#endif
+
+  //! Runs theFunction over the chunks of [theBegin, theEnd) on the calling thread and
+  //! the process wide pool of worker threads, and returns when all are done.
+  //! The workers are created on first use, one for each logical processor but the
+  //! caller's, and kept. Each thread taking part owns an equal slice of the range and
+  //! claims chunks from it with an atomic increment, a thread whose slice is done
+  //! claims from the slices of the others, so no lock is taken per element.
+  //! Loops started from inside a loop, or while the pool runs a loop for another
+  //! thread, run on the calling thread alone. An exception thrown by theFunction
+  //! stops the loop and is raised again on the calling thread.
+  //! A chunk is theGrainSize indices, or with a grain size of 0 an eighth of a
+  //! thread's slice. With AdaptiveGrainSize the first indices are run on the
+  //! calling thread and timed, and from their cost the rest are run there too,
+  //! if the loop is too short to be worth waking the workers, or in chunks of
+  //! some microseconds each.
+  Standard_EXPORT static void RunChunks(const Standard_Integer theBegin,
+                                        const Standard_Integer theEnd,
+                                        const Standard_Integer theGrainSize,
+                                        ChunkFunction          theFunction,
+                                        Standard_Address       theContext);
 
 public: //! @name public methods
 
+  //! Grain size which lets a loop choose the grain from the time its first elements take.
+  //! Loops too short to gain from the threads run on the calling thread alone.
+  //! With TBB the grain is left to its partitioner.
+  static const Standard_Integer AdaptiveGrainSize = -1;
+
   //! Returns number of logical proccesrs.
   Standard_EXPORT static Standard_Integer NbLogicalProcessors();
 
@@ -179,6 +183,17 @@ public: //! @name public methods
                        const Standard_Boolean isForceSingleThreadExecution
                          = Standard_False );
 
+  //! Primitive for parallelization of "foreach" loops, which shares out the
+  //! elements in chunks of theGrainSize, or AdaptiveGrainSize. Tight loops of
+  //! cheap elements should give a grain size that amortises the scheduling.
+  template <typename InputIterator, typename Functor>
+  static void ForEach( InputIterator          theBegin,
+                       InputIterator          theEnd,
+                       const Standard_Integer theGrainSize,
+                       const Functor&         theFunctor,
+                       const Standard_Boolean isForceSingleThreadExecution
+                         = Standard_False );
+
   //! Simple primitive for parallelization of "for" loops.
   template <typename Functor>
   static void For( const Standard_Integer theBegin,
@@ -186,24 +201,40 @@ public: //! @name public methods
                    const Functor&         theFunctor,
                    const Standard_Boolean isForceSingleThreadExecution
                      = Standard_False );
+
+  //! Primitive for parallelization of "for" loops, which shares out the
+  //! indices in chunks of theGrainSize, or AdaptiveGrainSize. Tight loops of
+  //! cheap iterations should give a grain size that amortises the scheduling.
+  template <typename Functor>
+  static void For( const Standard_Integer theBegin,
+                   const Standard_Integer theEnd,
+                   const Standard_Integer theGrainSize,
+                   const Functor&         theFunctor,
+                   const Standard_Boolean isForceSingleThreadExecution
+                     = Standard_False );
 };
 
 //=======================================================================
-//function : OSD_Parallel::Range::It
-//purpose  : Template concretization.
+//function : ParallelForEach
+//purpose  : 
 //=======================================================================
-template<> inline Standard_Integer OSD_Parallel::Range<Standard_Integer>::It() const
+template <typename InputIterator, typename Functor>
+void OSD_Parallel::ForEach( InputIterator          theBegin,
+                            InputIterator          theEnd,
+                            const Functor&         theFunctor,
+                            const Standard_Boolean isForceSingleThreadExecution )
 {
-  return Standard_Atomic_Increment( reinterpret_cast<volatile int*>(&myIt) ) - 1;
+  ForEach(theBegin, theEnd, 0, theFunctor, isForceSingleThreadExecution);
 }
 
 //=======================================================================
 //function : ParallelForEach
-//purpose  : 
+//purpose  : Loop with the grain size given.
 //=======================================================================
 template <typename InputIterator, typename Functor>
 void OSD_Parallel::ForEach( InputIterator          theBegin,
                             InputIterator          theEnd,
+                            const Standard_Integer theGrainSize,
                             const Functor&         theFunctor,
                             const Standard_Boolean isForceSingleThreadExecution )
 {
@@ -215,6 +246,7 @@ void OSD_Parallel::ForEach( InputIterator          theBegin,
     return;
   }
   #ifdef HAVE_TBB
+  if ( theGrainSize <= 0 )
   {
     try
     {
@@ -224,24 +256,39 @@ void OSD_Parallel::ForEach( InputIterator          theBegin,
     {
       Standard_NotImplemented::Raise(anException.what());
     }
+    return;
   }
-  #else
-  {
-    Range<InputIterator> aData(theBegin, theEnd);
-    Task<Functor, InputIterator> aTask(theFunctor, aData);
+  #endif
+
+  Standard_Integer aNbItems = 0;
+  for ( InputIterator it(theBegin); it != theEnd; it++ )
+    ++aNbItems;
+
+  if ( aNbItems == 0 )
+    return;
 
-    const Standard_Integer aNbThreads = OSD_Parallel::NbLogicalProcessors();
-    NCollection_Array1<OSD_Thread> aThreads(0, aNbThreads - 1);
+  // gather the iterators so that the threads can share them out by index
+  NCollection_Array1<InputIterator> anIterators(0, aNbItems - 1);
+  Standard_Integer anIndex = 0;
+  for ( InputIterator it(theBegin); it != theEnd; it++ )
+    anIterators(anIndex++) = it;
 
-    for ( Standard_Integer i = 0; i < aNbThreads; ++i )
+  IteratorTask<Functor, InputIterator> aTask(theFunctor, anIterators);
+  #ifdef HAVE_TBB
+  {
+    try
     {
-      OSD_Thread& aThread = aThreads(i);
-      aThread.SetFunction(&Task<Functor, InputIterator>::RunWithIterator);
-      aThread.Run(&aTask);
+      tbb::parallel_for(tbb::blocked_range<Standard_Integer>(0, aNbItems, theGrainSize),
+                        ChunkBody(&IteratorTask<Functor, InputIterator>::Run, &aTask));
+    }
+    catch ( tbb::captured_exception& anException )
+    {
+      Standard_NotImplemented::Raise(anException.what());
     }
-
-    for ( Standard_Integer i = 0; i < aNbThreads; ++i )
-      aThreads(i).Wait();
+  }
+  #else
+  {
+    RunChunks(0, aNbItems, theGrainSize, &IteratorTask<Functor, InputIterator>::Run, &aTask);
   }
   #endif
 }
@@ -255,6 +302,20 @@ void OSD_Parallel::For( const Standard_Integer theBegin,
                         const Standard_Integer theEnd,
                         const Functor&         theFunctor,
                         const Standard_Boolean isForceSingleThreadExecution )
+{
+  For(theBegin, theEnd, 0, theFunctor, isForceSingleThreadExecution);
+}
+
+//=======================================================================
+//function : ParallelFor
+//purpose  : Loop with the grain size given.
+//=======================================================================
+template <typename Functor>
+void OSD_Parallel::For( const Standard_Integer theBegin,
+                        const Standard_Integer theEnd,
+                        const Standard_Integer theGrainSize,
+                        const Functor&         theFunctor,
+                        const Standard_Boolean isForceSingleThreadExecution )
 {
   if ( isForceSingleThreadExecution )
   {
@@ -267,7 +328,11 @@ void OSD_Parallel::For( const Standard_Integer theBegin,
   {
     try
     {
-      tbb::parallel_for( theBegin, theEnd, theFunctor );
+      if ( theGrainSize > 0 && theBegin < theEnd )
+        tbb::parallel_for(tbb::blocked_range<Standard_Integer>(theBegin, theEnd, theGrainSize),
+                          ChunkBody(&IndexTask<Functor>::Run, (Standard_Address )&theFunctor));
+      else
+        tbb::parallel_for( theBegin, theEnd, theFunctor );
     }
     catch ( tbb::captured_exception& anException )
     {
@@ -276,21 +341,7 @@ void OSD_Parallel::For( const Standard_Integer theBegin,
   }
   #else
   {
-    Range<Standard_Integer> aData(theBegin, theEnd);
-    Task<Functor, Standard_Integer> aTask(theFunctor, aData);
-
-    const Standard_Integer aNbThreads = OSD_Parallel::NbLogicalProcessors();
-    NCollection_Array1<OSD_Thread> aThreads(0, aNbThreads - 1);
-
-    for ( Standard_Integer i = 0; i < aNbThreads; ++i )
-    {
-      OSD_Thread& aThread = aThreads(i);
-      aThread.SetFunction(&Task<Functor, Standard_Integer>::RunWithIndex);
-      aThread.Run(&aTask);
-    }
-
-    for ( Standard_Integer i = 0; i < aNbThreads; ++i )
-      aThreads(i).Wait();
+    RunChunks(theBegin, theEnd, theGrainSize, &IndexTask<Functor>::Run, (Standard_Address )&theFunctor);
   }
   #endif
 }
@@ -101,6 +101,15 @@ Handle(IntTools_Context) BOPAlgo_PaveFiller::Context()
   return myContext;
 }
 //=======================================================================
+//function : SetContext
+//purpose  : 
+//=======================================================================
+void BOPAlgo_PaveFiller::SetContext
+  (const Handle(IntTools_Context)& theContext)
+{
+  myGivenContext=theContext;
+}
+//=======================================================================
 //function : SectionAttribute
 //purpose  : 
 //=======================================================================
@@ -185,7 +194,12 @@ void BOPAlgo_PaveFiller::Init()
   myIterator->Prepare();
   //
   // 3 myContext
-  myContext=new IntTools_Context;
+  if (myGivenContext.IsNull()) {
+    myContext=new IntTools_Context;
+  }
+  else {
+    myContext=myGivenContext;
+  }
   //
   myErrorStatus=0;
 }
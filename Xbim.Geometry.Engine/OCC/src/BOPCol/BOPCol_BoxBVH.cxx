@@ -0,0 +1,623 @@
+// This file is part of Open CASCADE Technology software library.
+//
+// This library is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License version 2.1 as published
+// by the Free Software Foundation, with special exception defined in the file
+// OCCT_LGPL_EXCEPTION.txt. Consult the file LICENSE_LGPL_21.txt included in OCCT
+// distribution for complete text of the license and disclaimer of any warranty.
+//
+// Alternatively, this file may be used under the terms of Open CASCADE
+// commercial license or contractual agreement.
+
+#include <BOPCol_BoxBVH.hxx>
+//
+#include <OSD_Parallel.hxx>
+#include <Standard_Real.hxx>
+//
+#include <algorithm>
+#include <cmath>
+
+typedef BOPCol_BoxBVH::Node BOPCol_BVHNode;
+typedef std::vector<BOPCol_BVHNode> BOPCol_VectorOfBVHNode;
+
+// a node is a leaf if it holds no more boxes than this
+static const Standard_Integer THE_MIN_LEAF = 2;
+// a node with more boxes than this is split even if that costs more
+static const Standard_Integer THE_MAX_LEAF = 8;
+static const Standard_Integer THE_NB_BINS = 16;
+// subtrees of no more boxes than this are built by one thread
+static const Standard_Integer THE_TASK_SIZE = 1024;
+// the pairs of subtrees the overlapping pairs are found in concurrently
+static const Standard_Size THE_NB_TASKS = 64;
+
+//=======================================================================
+//function : HalfArea
+//purpose  : half the surface area of the box
+//=======================================================================
+static Standard_Real HalfArea(const Standard_Real* theMin,
+                              const Standard_Real* theMax)
+{
+  Standard_Real dX, dY, dZ;
+  //
+  dX=theMax[0]-theMin[0];
+  dY=theMax[1]-theMin[1];
+  dZ=theMax[2]-theMin[2];
+  return dX*dY+dY*dZ+dZ*dX;
+}
+//=======================================================================
+//function : Overlap
+//purpose  :
+//=======================================================================
+static Standard_Boolean Overlap(const Standard_Real* theMin1,
+                                const Standard_Real* theMax1,
+                                const Standard_Real* theMin2,
+                                const Standard_Real* theMax2)
+{
+  return theMin1[0]<=theMax2[0] && theMin2[0]<=theMax1[0] &&
+         theMin1[1]<=theMax2[1] && theMin2[1]<=theMax1[1] &&
+         theMin1[2]<=theMax2[2] && theMin2[2]<=theMax1[2];
+}
+//=======================================================================
+//class    : BOPCol_BVHBuilder
+//purpose  : builds subtrees of the hierarchy, the subtrees of disjoint
+//           ranges of the order may be built concurrently
+//=======================================================================
+class BOPCol_BVHBuilder {
+ public:
+  struct Task {
+    Standard_Integer myNode;
+    Standard_Integer myFirst;
+    Standard_Integer myCount;
+    BOPCol_VectorOfBVHNode myNodes;
+  };
+  //
+  BOPCol_BVHBuilder(const std::vector<Standard_Real>& theBounds,
+                    const std::vector<Standard_Real>& theCentres,
+                    std::vector<Standard_Integer>& theOrder)
+  : myBounds(theBounds), myCentres(theCentres), myOrder(theOrder) {
+  }
+  //
+  // builds the subtree of the boxes [theFirst, theFirst+theCount) of the
+  // order at the end of theNodes, subtrees of no more than THE_TASK_SIZE
+  // boxes are left to theTasks if it is not null
+  void Build(BOPCol_VectorOfBVHNode& theNodes,
+             const Standard_Integer theFirst,
+             const Standard_Integer theCount,
+             std::vector<Task>* theTasks) const
+  {
+    Standard_Integer i, aMid;
+    std::vector<Standard_Integer> aStack;
+    //
+    aStack.push_back((Standard_Integer)theNodes.size());
+    aStack.push_back(theFirst);
+    aStack.push_back(theCount);
+    theNodes.push_back(BOPCol_BVHNode());
+    while (!aStack.empty()) {
+      Standard_Integer aCount=aStack.back(); aStack.pop_back();
+      Standard_Integer aFirst=aStack.back(); aStack.pop_back();
+      Standard_Integer aIndex=aStack.back(); aStack.pop_back();
+      if (theTasks && aCount<=THE_TASK_SIZE) {
+        Task aTask;
+        aTask.myNode=aIndex;
+        aTask.myFirst=aFirst;
+        aTask.myCount=aCount;
+        theTasks->push_back(aTask);
+        continue;
+      }
+      //
+      BOPCol_BVHNode aNode;
+      aNode.myFirst=aFirst;
+      aNode.myCount=aCount;
+      aNode.myLeft=-1;
+      aNode.myRight=-1;
+      Bounds(aFirst, aCount, aNode);
+      aMid=Split(aFirst, aCount, aNode);
+      if (aMid>=0) {
+        aNode.myLeft=(Standard_Integer)theNodes.size();
+        theNodes.push_back(BOPCol_BVHNode());
+        aNode.myRight=(Standard_Integer)theNodes.size();
+        theNodes.push_back(BOPCol_BVHNode());
+        // the left child is taken first, so that nodes near each
+        // other in the tree are near each other in the vector
+        Standard_Integer aWork[6]={aNode.myRight, aMid, aFirst+aCount-aMid,
+                                   aNode.myLeft, aFirst, aMid-aFirst};
+        for (i=0; i<6; ++i) {
+          aStack.push_back(aWork[i]);
+        }
+      }
+      theNodes[aIndex]=aNode;
+    }
+  }
+  //
+ protected:
+  //
+  // the bounds of the boxes, widened by a few units in the last place so
+  // that a pair Bnd_Box::IsOut keeps is never culled by rounding
+  void Bounds(const Standard_Integer theFirst,
+              const Standard_Integer theCount,
+              BOPCol_BVHNode& theNode) const
+  {
+    Standard_Integer i, k;
+    //
+    for (k=0; k<3; ++k) {
+      theNode.myMin[k]=RealLast();
+      theNode.myMax[k]=RealFirst();
+    }
+    for (i=theFirst; i<theFirst+theCount; ++i) {
+      const Standard_Real* pB=&myBounds[6*myOrder[i]];
+      for (k=0; k<3; ++k) {
+        theNode.myMin[k]=Min(theNode.myMin[k], pB[k]);
+        theNode.myMax[k]=Max(theNode.myMax[k], pB[k+3]);
+      }
+    }
+    for (k=0; k<3; ++k) {
+      theNode.myMin[k]-=1.e-12*(1.+Abs(theNode.myMin[k]));
+      theNode.myMax[k]+=1.e-12*(1.+Abs(theNode.myMax[k]));
+    }
+  }
+  //
+  // partitions the boxes of the node at the least cost split of the bins
+  // of their centres, returns the first box of the right child or -1 if
+  // the node is better left a leaf
+  Standard_Integer Split(const Standard_Integer theFirst,
+                         const Standard_Integer theCount,
+                         const BOPCol_BVHNode& theNode) const
+  {
+    Standard_Integer i, k, b, aBestAxis, aBestBin;
+    Standard_Real aBestCost, aCost, aScale;
+    Standard_Real aCMin[3], aCMax[3];
+    //
+    if (theCount<=THE_MIN_LEAF) {
+      return -1;
+    }
+    for (k=0; k<3; ++k) {
+      aCMin[k]=RealLast();
+      aCMax[k]=RealFirst();
+    }
+    for (i=theFirst; i<theFirst+theCount; ++i) {
+      const Standard_Real* pC=&myCentres[3*myOrder[i]];
+      for (k=0; k<3; ++k) {
+        aCMin[k]=Min(aCMin[k], pC[k]);
+        aCMax[k]=Max(aCMax[k], pC[k]);
+      }
+    }
+    //
+    aBestAxis=-1;
+    aBestBin=-1;
+    aBestCost=RealLast();
+    for (k=0; k<3; ++k) {
+      if (!(aCMax[k]>aCMin[k])) {
+        continue;
+      }
+      Standard_Integer aNb[THE_NB_BINS];
+      Standard_Real aMin[THE_NB_BINS][3], aMax[THE_NB_BINS][3];
+      for (b=0; b<THE_NB_BINS; ++b) {
+        aNb[b]=0;
+        for (Standard_Integer j=0; j<3; ++j) {
+          aMin[b][j]=RealLast();
+          aMax[b][j]=RealFirst();
+        }
+      }
+      aScale=THE_NB_BINS/(aCMax[k]-aCMin[k]);
+      for (i=theFirst; i<theFirst+theCount; ++i) {
+        Standard_Integer aBox=myOrder[i];
+        b=Bin(myCentres[3*aBox+k], aCMin[k], aScale);
+        const Standard_Real* pB=&myBounds[6*aBox];
+        ++aNb[b];
+        for (Standard_Integer j=0; j<3; ++j) {
+          aMin[b][j]=Min(aMin[b][j], pB[j]);
+          aMax[b][j]=Max(aMax[b][j], pB[j+3]);
+        }
+      }
+      //
+      // the costs of the right sides of the splits after each bin
+      Standard_Real aRightCost[THE_NB_BINS];
+      Standard_Real aRMin[3]={RealLast(), RealLast(), RealLast()};
+      Standard_Real aRMax[3]={RealFirst(), RealFirst(), RealFirst()};
+      Standard_Integer aRNb=0;
+      for (b=THE_NB_BINS-1; b>0; --b) {
+        aRNb+=aNb[b];
+        for (Standard_Integer j=0; j<3; ++j) {
+          aRMin[j]=Min(aRMin[j], aMin[b][j]);
+          aRMax[j]=Max(aRMax[j], aMax[b][j]);
+        }
+        aRightCost[b-1]=aRNb ? aRNb*HalfArea(aRMin, aRMax) : -1.;
+      }
+      Standard_Real aLMin[3]={RealLast(), RealLast(), RealLast()};
+      Standard_Real aLMax[3]={RealFirst(), RealFirst(), RealFirst()};
+      Standard_Integer aLNb=0;
+      for (b=0; b<THE_NB_BINS-1; ++b) {
+        aLNb+=aNb[b];
+        for (Standard_Integer j=0; j<3; ++j) {
+          aLMin[j]=Min(aLMin[j], aMin[b][j]);
+          aLMax[j]=Max(aLMax[j], aMax[b][j]);
+        }
+        if (!aLNb || aRightCost[b]<0.) {
+          continue;
+        }
+        aCost=aLNb*HalfArea(aLMin, aLMax)+aRightCost[b];
+        if (aCost<aBestCost) {
+          aBestCost=aCost;
+          aBestAxis=k;
+          aBestBin=b;
+        }
+      }
+    }
+    //
+    if (aBestAxis<0) {
+      // the centres coincide, the boxes are split in halves
+      return theCount<=THE_MAX_LEAF ? -1 : theFirst+theCount/2;
+    }
+    //
+    // a split costs a visit of the node more than a leaf
+    Standard_Real aArea=HalfArea(theNode.myMin, theNode.myMax);
+    if (theCount<=THE_MAX_LEAF && aBestCost+aArea>=theCount*aArea) {
+      return -1;
+    }
+    //
+    Standard_Real aCMinK=aCMin[aBestAxis];
+    aScale=THE_NB_BINS/(aCMax[aBestAxis]-aCMinK);
+    const std::vector<Standard_Real>& aCentres=myCentres;
+    std::vector<Standard_Integer>::iterator aMid=
+      std::partition(myOrder.begin()+theFirst, myOrder.begin()+theFirst+theCount,
+        [&aCentres, aBestAxis, aCMinK, aScale, aBestBin](Standard_Integer theBox) {
+          return Bin(aCentres[3*theBox+aBestAxis], aCMinK, aScale)<=aBestBin;
+        });
+    return (Standard_Integer)(aMid-myOrder.begin());
+  }
+  //
+  static Standard_Integer Bin(const Standard_Real theCentre,
+                              const Standard_Real theMin,
+                              const Standard_Real theScale)
+  {
+    Standard_Integer aBin=(Standard_Integer)((theCentre-theMin)*theScale);
+    return aBin<0 ? 0 : (aBin>=THE_NB_BINS ? THE_NB_BINS-1 : aBin);
+  }
+  //
+  const std::vector<Standard_Real>& myBounds;
+  const std::vector<Standard_Real>& myCentres;
+  std::vector<Standard_Integer>& myOrder;
+};
+//=======================================================================
+//class    : BOPCol_BVHBuildFunctor
+//purpose  :
+//=======================================================================
+class BOPCol_BVHBuildFunctor {
+ public:
+  BOPCol_BVHBuildFunctor(const BOPCol_BVHBuilder& theBuilder,
+                         std::vector<BOPCol_BVHBuilder::Task>& theTasks)
+  : myBuilder(theBuilder), myTasks(theTasks) {
+  }
+  //
+  void operator()(const Standard_Integer theIndex) const {
+    BOPCol_BVHBuilder::Task& aTask=myTasks[theIndex];
+    myBuilder.Build(aTask.myNodes, aTask.myFirst, aTask.myCount, NULL);
+  }
+  //
+ protected:
+  BOPCol_BVHBuildFunctor& operator=(const BOPCol_BVHBuildFunctor&);
+  const BOPCol_BVHBuilder& myBuilder;
+  std::vector<BOPCol_BVHBuilder::Task>& myTasks;
+};
+//=======================================================================
+//function :
+//purpose  :
+//=======================================================================
+BOPCol_BoxBVH::BOPCol_BoxBVH()
+{
+}
+//=======================================================================
+//function : ~
+//purpose  :
+//=======================================================================
+BOPCol_BoxBVH::~BOPCol_BoxBVH()
+{
+}
+//=======================================================================
+//function : Add
+//purpose  :
+//=======================================================================
+void BOPCol_BoxBVH::Add(const Standard_Integer theIndex,
+                        const Bnd_Box& theBox)
+{
+  Standard_Real aX1, aY1, aZ1, aX2, aY2, aZ2;
+  //
+  if (theBox.IsVoid()) {
+    return;
+  }
+  theBox.Get(aX1, aY1, aZ1, aX2, aY2, aZ2);
+  myBoxes.push_back(theBox);
+  myIndices.push_back(theIndex);
+  Standard_Real aB[6]={aX1, aY1, aZ1, aX2, aY2, aZ2};
+  myBounds.insert(myBounds.end(), aB, aB+6);
+}
+//=======================================================================
+//function : Build
+//purpose  :
+//=======================================================================
+void BOPCol_BoxBVH::Build(const Standard_Boolean theRunParallel)
+{
+  Standard_Integer i, k, aNb;
+  Standard_Size j, aOffset;
+  //
+  myNodes.clear();
+  aNb=(Standard_Integer)myBoxes.size();
+  myOrder.resize(aNb);
+  if (!aNb) {
+    return;
+  }
+  //
+  std::vector<Standard_Real> aCentres(3*aNb);
+  for (i=0; i<aNb; ++i) {
+    myOrder[i]=i;
+    for (k=0; k<3; ++k) {
+      aCentres[3*i+k]=0.5*(myBounds[6*i+k]+myBounds[6*i+k+3]);
+    }
+  }
+  //
+  BOPCol_BVHBuilder aBuilder(myBounds, aCentres, myOrder);
+  if (!theRunParallel || aNb<=THE_TASK_SIZE) {
+    aBuilder.Build(myNodes, 0, aNb, NULL);
+    return;
+  }
+  //
+  // the top of the tree is split by this thread, the subtrees below it
+  // are built concurrently and appended in order
+  std::vector<BOPCol_BVHBuilder::Task> aTasks;
+  aBuilder.Build(myNodes, 0, aNb, &aTasks);
+  BOPCol_BVHBuildFunctor aFunctor(aBuilder, aTasks);
+  OSD_Parallel::For(0, (Standard_Integer)aTasks.size(), aFunctor);
+  //
+  for (i=0; i<(Standard_Integer)aTasks.size(); ++i) {
+    BOPCol_VectorOfBVHNode& aSub=aTasks[i].myNodes;
+    aOffset=myNodes.size()-1;
+    for (j=0; j<aSub.size(); ++j) {
+      BOPCol_BVHNode& aNode=aSub[j];
+      if (aNode.myLeft>=0) {
+        aNode.myLeft+=(Standard_Integer)aOffset;
+        aNode.myRight+=(Standard_Integer)aOffset;
+      }
+      if (j) {
+        myNodes.push_back(aNode);
+      }
+    }
+    myNodes[aTasks[i].myNode]=aSub[0];
+  }
+}
+//=======================================================================
+//function : Clear
+//purpose  :
+//=======================================================================
+void BOPCol_BoxBVH::Clear()
+{
+  myBoxes.clear();
+  myIndices.clear();
+  myBounds.clear();
+  myOrder.clear();
+  myNodes.clear();
+}
+//=======================================================================
+//function : Extent
+//purpose  :
+//=======================================================================
+Standard_Integer BOPCol_BoxBVH::Extent() const
+{
+  return (Standard_Integer)myBoxes.size();
+}
+//=======================================================================
+//function : Select
+//purpose  :
+//=======================================================================
+Standard_Integer BOPCol_BoxBVH::Select(const Bnd_Box& theBox,
+                                       BOPCol_ListOfInteger& theIndices) const
+{
+  Standard_Integer i, aNbSelected;
+  Standard_Real aB[6];
+  std::vector<Standard_Integer> aStack;
+  //
+  aNbSelected=0;
+  if (myNodes.empty() || theBox.IsVoid()) {
+    return aNbSelected;
+  }
+  theBox.Get(aB[0], aB[1], aB[2], aB[3], aB[4], aB[5]);
+  aStack.push_back(0);
+  while (!aStack.empty()) {
+    const BOPCol_BVHNode& aNode=myNodes[aStack.back()];
+    aStack.pop_back();
+    if (!Overlap(aNode.myMin, aNode.myMax, aB, aB+3)) {
+      continue;
+    }
+    if (aNode.myLeft>=0) {
+      aStack.push_back(aNode.myRight);
+      aStack.push_back(aNode.myLeft);
+      continue;
+    }
+    for (i=aNode.myFirst; i<aNode.myFirst+aNode.myCount; ++i) {
+      if (!theBox.IsOut(myBoxes[myOrder[i]])) {
+        theIndices.Append(myIndices[myOrder[i]]);
+        ++aNbSelected;
+      }
+    }
+  }
+  return aNbSelected;
+}
+/////////////////////////////////////////////////////////////////////////
+//=======================================================================
+//class    : BOPCol_BVHPairFunctor
+//purpose  : finds the overlapping pairs below pairs of nodes of two
+//           hierarchies, a pair of a node with itself in the same
+//           hierarchy finds the pairs of its own boxes
+//=======================================================================
+class BOPCol_BVHPairFunctor {
+ public:
+  typedef std::pair<Standard_Integer, Standard_Integer> NodePair;
+  //
+  BOPCol_BVHPairFunctor(const std::vector<BOPCol_BVHNode>& theNodes1,
+                        const std::vector<Bnd_Box>& theBoxes1,
+                        const std::vector<Standard_Integer>& theOrder1,
+                        const std::vector<Standard_Integer>& theIndices1,
+                        const std::vector<BOPCol_BVHNode>& theNodes2,
+                        const std::vector<Bnd_Box>& theBoxes2,
+                        const std::vector<Standard_Integer>& theOrder2,
+                        const std::vector<Standard_Integer>& theIndices2,
+                        const Standard_Boolean bSelf,
+                        const std::vector<NodePair>& theTasks,
+                        std::vector<BOPCol_BoxBVH::VectorOfPair>& thePairs)
+  : myNodes1(theNodes1), myBoxes1(theBoxes1), myOrder1(theOrder1),
+    myIndices1(theIndices1), myNodes2(theNodes2), myBoxes2(theBoxes2),
+    myOrder2(theOrder2), myIndices2(theIndices2), mySelf(bSelf),
+    myTasks(theTasks), myPairs(thePairs) {
+  }
+  //
+  // appends the node pairs below the pair that may hold overlapping
+  // boxes to theNext, returns false if the pair is a pair of leaves
+  Standard_Boolean Expand(const NodePair& thePair,
+                          std::vector<NodePair>& theNext) const
+  {
+    const BOPCol_BVHNode& aN1=myNodes1[thePair.first];
+    const BOPCol_BVHNode& aN2=myNodes2[thePair.second];
+    if (mySelf && thePair.first==thePair.second) {
+      if (aN1.myLeft<0) {
+        theNext.push_back(thePair);
+        return Standard_False;
+      }
+      theNext.push_back(NodePair(aN1.myLeft, aN1.myLeft));
+      theNext.push_back(NodePair(aN1.myLeft, aN1.myRight));
+      theNext.push_back(NodePair(aN1.myRight, aN1.myRight));
+      return Standard_True;
+    }
+    if (!Overlap(aN1.myMin, aN1.myMax, aN2.myMin, aN2.myMax)) {
+      return Standard_True;
+    }
+    if (aN1.myLeft<0 && aN2.myLeft<0) {
+      theNext.push_back(thePair);
+      return Standard_False;
+    }
+    if (aN2.myLeft<0 || (aN1.myLeft>=0 && aN1.myCount>=aN2.myCount)) {
+      theNext.push_back(NodePair(aN1.myLeft, thePair.second));
+      theNext.push_back(NodePair(aN1.myRight, thePair.second));
+    }
+    else {
+      theNext.push_back(NodePair(thePair.first, aN2.myLeft));
+      theNext.push_back(NodePair(thePair.first, aN2.myRight));
+    }
+    return Standard_True;
+  }
+  //
+  void operator()(const Standard_Integer theIndex) const
+  {
+    Standard_Integer i, j, aLast;
+    std::vector<NodePair> aStack, aNext;
+    BOPCol_BoxBVH::VectorOfPair& aPairs=myPairs[theIndex];
+    //
+    aStack.push_back(myTasks[theIndex]);
+    while (!aStack.empty()) {
+      NodePair aPair=aStack.back();
+      aStack.pop_back();
+      aNext.clear();
+      if (Expand(aPair, aNext)) {
+        // pushed in reverse so that the left children are taken first
+        for (i=(Standard_Integer)aNext.size()-1; i>=0; --i) {
+          aStack.push_back(aNext[i]);
+        }
+        continue;
+      }
+      //
+      const BOPCol_BVHNode& aN1=myNodes1[aPair.first];
+      const BOPCol_BVHNode& aN2=myNodes2[aPair.second];
+      Standard_Boolean bSame=mySelf && aPair.first==aPair.second;
+      aLast=aN1.myFirst+aN1.myCount;
+      for (i=aN1.myFirst; i<aLast; ++i) {
+        Standard_Integer aBox1=myOrder1[i];
+        const Bnd_Box& aB1=myBoxes1[aBox1];
+        for (j=bSame ? i+1 : aN2.myFirst; j<aN2.myFirst+aN2.myCount; ++j) {
+          Standard_Integer aBox2=myOrder2[j];
+          if (aB1.IsOut(myBoxes2[aBox2])) {
+            continue;
+          }
+          Standard_Integer aI1=myIndices1[aBox1], aI2=myIndices2[aBox2];
+          if (mySelf && aI2<aI1) {
+            std::swap(aI1, aI2);
+          }
+          aPairs.push_back(BOPCol_BoxBVH::Pair(aI1, aI2));
+        }
+      }
+    }
+  }
+  //
+ protected:
+  BOPCol_BVHPairFunctor& operator=(const BOPCol_BVHPairFunctor&);
+  const std::vector<BOPCol_BVHNode>& myNodes1;
+  const std::vector<Bnd_Box>& myBoxes1;
+  const std::vector<Standard_Integer>& myOrder1;
+  const std::vector<Standard_Integer>& myIndices1;
+  const std::vector<BOPCol_BVHNode>& myNodes2;
+  const std::vector<Bnd_Box>& myBoxes2;
+  const std::vector<Standard_Integer>& myOrder2;
+  const std::vector<Standard_Integer>& myIndices2;
+  Standard_Boolean mySelf;
+  const std::vector<NodePair>& myTasks;
+  std::vector<BOPCol_BoxBVH::VectorOfPair>& myPairs;
+};
+//=======================================================================
+//function : SelectPairs
+//purpose  :
+//=======================================================================
+void BOPCol_BoxBVH::SelectPairs(const Standard_Boolean theRunParallel,
+                                VectorOfPair& thePairs) const
+{
+  SelectPairs(*this, Standard_True, theRunParallel, thePairs);
+}
+//=======================================================================
+//function : SelectPairs
+//purpose  :
+//=======================================================================
+void BOPCol_BoxBVH::SelectPairs(const BOPCol_BoxBVH& theOther,
+                                const Standard_Boolean theRunParallel,
+                                VectorOfPair& thePairs) const
+{
+  SelectPairs(theOther, Standard_False, theRunParallel, thePairs);
+}
+//=======================================================================
+//function : SelectPairs
+//purpose  :
+//=======================================================================
+void BOPCol_BoxBVH::SelectPairs(const BOPCol_BoxBVH& theOther,
+                                const Standard_Boolean bSelf,
+                                const Standard_Boolean theRunParallel,
+                                VectorOfPair& thePairs) const
+{
+  Standard_Boolean bExpanded;
+  Standard_Size i;
+  std::vector<BOPCol_BVHPairFunctor::NodePair> aTasks, aNext;
+  //
+  if (myNodes.empty() || theOther.myNodes.empty()) {
+    return;
+  }
+  //
+  std::vector<VectorOfPair> aPairs;
+  BOPCol_BVHPairFunctor aFunctor(myNodes, myBoxes, myOrder, myIndices,
+    theOther.myNodes, theOther.myBoxes, theOther.myOrder, theOther.myIndices,
+    bSelf, aTasks, aPairs);
+  //
+  // the node pairs are expanded breadth first into tasks whatever the
+  // number of threads, so that the pairs are found in the same order
+  aTasks.push_back(BOPCol_BVHPairFunctor::NodePair(0, 0));
+  bExpanded=Standard_True;
+  while (bExpanded && aTasks.size()<THE_NB_TASKS) {
+    bExpanded=Standard_False;
+    aNext.clear();
+    for (i=0; i<aTasks.size(); ++i) {
+      if (aFunctor.Expand(aTasks[i], aNext)) {
+        bExpanded=Standard_True;
+      }
+    }
+    aTasks.swap(aNext);
+  }
+  //
+  aPairs.resize(aTasks.size());
+  OSD_Parallel::For(0, (Standard_Integer)aTasks.size(), aFunctor, !theRunParallel);
+  for (i=0; i<aPairs.size(); ++i) {
+    thePairs.insert(thePairs.end(), aPairs[i].begin(), aPairs[i].end());
+  }
+}
@@ -27,11 +27,18 @@
 #include <BOPCol_NCVector.hxx>
 #include <BOPCol_Parallel.hxx>
 #include <BOPCol_BoxBndTree.hxx>
+#include <BOPCol_BoxBVH.hxx>
 //
 #include <BOPDS_IndexRange.hxx>
 #include <BOPDS_PassKeyBoolean.hxx>
 #include <BOPDS_MapOfPassKeyBoolean.hxx>
 #include <BOPDS_Tools.hxx>
+//
+#include <OSD_Timer.hxx>
+#include <Standard_Mutex.hxx>
+//
+#include <algorithm>
+#include <vector>
 
 /////////////////////////////////////////////////////////////////////////
 //=======================================================================
@@ -73,7 +80,34 @@ typedef BOPCol_NCVector <BOPDS_TSR> BOPDS_VectorOfTSR;
 typedef BOPCol_Functor <BOPDS_TSR,BOPDS_VectorOfTSR> BOPDS_TSRFunctor;
 typedef BOPCol_Cnt <BOPDS_TSRFunctor, BOPDS_VectorOfTSR> BOPDS_TSRCnt;
 /////////////////////////////////////////////////////////////////////////
-
+//
+static BOPDS_TreeMode myTreeMode=BOPDS_TreeMode_UBTree;
+static Standard_Integer myTreeNbRuns=0;
+static Standard_Integer myTreeNbMismatches=0;
+static Standard_Real myTreeUBTreeTime=0.;
+static Standard_Real myTreeBVHTime=0.;
+static Standard_Mutex myTreeMutex;
+//
+//=======================================================================
+//function : Pairs
+//purpose  : the pairs of the lists in the order the lists hold
+//           them, with the list of each
+//=======================================================================
+typedef std::pair<Standard_Integer, std::pair<Standard_Integer, Standard_Integer> > BOPDS_ListPair;
+static void Pairs(const BOPDS_VectorOfListOfPassKeyBoolean& theLists,
+                  std::vector<BOPDS_ListPair>& thePairs)
+{
+  Standard_Integer i, n1, n2;
+  BOPDS_ListIteratorOfListOfPassKeyBoolean aIt;
+  //
+  for (i=0; i<theLists.Extent(); ++i) {
+    aIt.Initialize(theLists(i));
+    for (; aIt.More(); aIt.Next()) {
+      aIt.Value().Ids(n1, n2);
+      thePairs.push_back(BOPDS_ListPair(i, std::make_pair(n1, n2)));
+    }
+  }
+}
 
 //=======================================================================
 //function : 
@@ -141,6 +175,49 @@ Standard_Boolean BOPDS_Iterator::RunParallel()const
   return myRunParallel;
 }
 //=======================================================================
+//function : SetTreeMode
+//purpose  : 
+//=======================================================================
+void BOPDS_Iterator::SetTreeMode(const BOPDS_TreeMode theMode)
+{
+  myTreeMode=theMode;
+}
+//=======================================================================
+//function : TreeMode
+//purpose  : 
+//=======================================================================
+BOPDS_TreeMode BOPDS_Iterator::TreeMode()
+{
+  return myTreeMode;
+}
+//=======================================================================
+//function : TreeStatistics
+//purpose  : 
+//=======================================================================
+void BOPDS_Iterator::TreeStatistics(Standard_Integer& theNbRuns,
+                                    Standard_Integer& theNbMismatches,
+                                    Standard_Real& theUBTreeTime,
+                                    Standard_Real& theBVHTime)
+{
+  Standard_Mutex::Sentry aLocker(myTreeMutex);
+  theNbRuns=myTreeNbRuns;
+  theNbMismatches=myTreeNbMismatches;
+  theUBTreeTime=myTreeUBTreeTime;
+  theBVHTime=myTreeBVHTime;
+}
+//=======================================================================
+//function : ResetTreeStatistics
+//purpose  : 
+//=======================================================================
+void BOPDS_Iterator::ResetTreeStatistics()
+{
+  Standard_Mutex::Sentry aLocker(myTreeMutex);
+  myTreeNbRuns=0;
+  myTreeNbMismatches=0;
+  myTreeUBTreeTime=0.;
+  myTreeBVHTime=0.;
+}
+//=======================================================================
 // function: SetDS
 // purpose: 
 //=======================================================================
@@ -265,6 +342,126 @@ void BOPDS_Iterator::Prepare()
 // purpose: 
 //=======================================================================
 void BOPDS_Iterator::Intersect()
+{
+  Standard_Integer i, aNbInterfTypes;
+  Standard_Real aBVHTime, aUBTreeTime;
+  BOPDS_TreeMode aMode;
+  OSD_Timer aTimer;
+  //
+  aMode=myTreeMode;
+  if (aMode==BOPDS_TreeMode_UBTree) {
+    IntersectUBTree();
+    return;
+  }
+  if (aMode==BOPDS_TreeMode_BVH) {
+    IntersectBVH();
+    return;
+  }
+  //
+  // both trees are timed and their pairs compared in the order they
+  // are taken, the stages of the filler depend on it, the pairs of
+  // the unbalanced tree are kept
+  std::vector<BOPDS_ListPair> aBVHPairs, aUBTreePairs;
+  aTimer.Start();
+  IntersectBVH();
+  aTimer.Stop();
+  aBVHTime=aTimer.ElapsedTime();
+  Pairs(myLists, aBVHPairs);
+  //
+  aNbInterfTypes=BOPDS_DS::NbInterfTypes();
+  for (i=0; i<aNbInterfTypes; ++i) {
+    myLists(i).Clear();
+  }
+  aTimer.Reset();
+  aTimer.Start();
+  IntersectUBTree();
+  aTimer.Stop();
+  aUBTreeTime=aTimer.ElapsedTime();
+  Pairs(myLists, aUBTreePairs);
+  //
+  Standard_Mutex::Sentry aLocker(myTreeMutex);
+  ++myTreeNbRuns;
+  if (aBVHPairs!=aUBTreePairs) {
+    ++myTreeNbMismatches;
+  }
+  myTreeUBTreeTime+=aUBTreeTime;
+  myTreeBVHTime+=aBVHTime;
+}
+//=======================================================================
+// function: IntersectBVH
+// purpose: 
+//=======================================================================
+void BOPDS_Iterator::IntersectBVH()
+{
+  Standard_Boolean bFlag;
+  Standard_Integer aNb, i, j, iTi, iTj, iX;
+  Standard_Size k;
+  TopAbs_ShapeEnum aTi, aTj;
+  BOPDS_PassKeyBoolean aPKXB;
+  BOPCol_BoxBVH aBVH;
+  BOPCol_BoxBVH::VectorOfPair aPairs;
+  //
+  aNb=myDS->NbSourceShapes();
+  std::vector<Standard_Integer> aRanks(aNb, -1);
+  for (i=0; i<aNb; ++i) {
+    const BOPDS_ShapeInfo& aSI=myDS->ShapeInfo(i);
+    if (!aSI.IsInterfering()) {
+      continue;
+    }
+    aRanks[i]=myDS->Rank(i);
+    aBVH.Add(i, aSI.Box());
+  }
+  //
+  aBVH.Build(myRunParallel);
+  aBVH.SelectPairs(myRunParallel, aPairs);
+  //
+  // each pair is found once, the less index first, the pairs are
+  // sorted so that their order does not depend on the build of the
+  // hierarchy. The unbalanced tree takes the partners of each index
+  // in the order its selector visits them instead, so the stages of
+  // the filler may meet the pairs in another order
+  std::sort(aPairs.begin(), aPairs.end());
+  for (k=0; k<aPairs.size(); ++k) {
+    i=aPairs[k].first;
+    j=aPairs[k].second;
+    if (aRanks[i]==aRanks[j]) {
+      continue;// same range
+    }
+    //
+    const BOPDS_ShapeInfo& aSI=myDS->ShapeInfo(i);
+    const BOPDS_ShapeInfo& aSIj=myDS->ShapeInfo(j);
+    aTi=aSI.ShapeType();
+    aTj=aSIj.ShapeType();
+    iTi=BOPDS_Tools::TypeToInteger(aTi);
+    iTj=BOPDS_Tools::TypeToInteger(aTj);
+    //
+    bFlag=Standard_False;
+    if (iTi<iTj) {
+      bFlag=aSI.HasSubShape(j);
+    } 
+    else if (iTj<iTi) {
+      bFlag=aSIj.HasSubShape(i);
+    }
+    if (bFlag) {
+      continue; 
+    }
+    //
+    bFlag=Standard_False;// Bounding boxes are intersected
+    if (aSI.Box().IsOut(aSIj.Box())) {
+      bFlag=!bFlag; //Bounding boxes of Sub-shapes are intersected
+    }
+    //
+    aPKXB.SetIds(i, j);
+    iX=BOPDS_Tools::TypeToInteger(aTi, aTj);
+    aPKXB.SetFlag(bFlag);
+    myLists(iX).Append(aPKXB);
+  }
+}
+//=======================================================================
+// function: IntersectUBTree
+// purpose: 
+//=======================================================================
+void BOPDS_Iterator::IntersectUBTree()
 {
   Standard_Boolean bFlag;
   Standard_Integer aNb, i, aNbR, iTi, iTj;
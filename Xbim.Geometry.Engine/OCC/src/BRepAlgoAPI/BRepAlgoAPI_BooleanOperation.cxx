@@ -310,6 +310,7 @@ void BRepAlgoAPI_BooleanOperation::Build()
     myDSFiller->SetRunParallel(myRunParallel);
     myDSFiller->SetProgressIndicator(myProgressIndicator);
     myDSFiller->SetFuzzyValue(myFuzzyValue);
+    myDSFiller->SetContext(myContext);
     //
     SetAttributes();
     //
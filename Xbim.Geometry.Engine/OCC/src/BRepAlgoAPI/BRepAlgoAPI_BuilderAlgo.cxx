@@ -16,6 +16,7 @@
 
 #include <BOPAlgo_PaveFiller.hxx>
 #include <BOPAlgo_Builder.hxx>
+#include <IntTools_Context.hxx>
 
 //=======================================================================
 // function: 
@@ -69,6 +70,15 @@ Standard_Real BRepAlgoAPI_BuilderAlgo::FuzzyValue() const
   return myFuzzyValue;
 }
 //=======================================================================
+//function : SetContext
+//purpose  : 
+//=======================================================================
+void BRepAlgoAPI_BuilderAlgo::SetContext
+  (const Handle(IntTools_Context)& theContext)
+{
+  myContext=theContext;
+}
+//=======================================================================
 //function : Clear
 //purpose  : 
 //=======================================================================
@@ -124,6 +134,7 @@ void BRepAlgoAPI_BuilderAlgo::Build()
     myDSFiller->SetRunParallel(myRunParallel);
     myDSFiller->SetProgressIndicator(myProgressIndicator);
     myDSFiller->SetFuzzyValue(myFuzzyValue);
+    myDSFiller->SetContext(myContext);
     //
     myDSFiller->Perform();
     iErr=myDSFiller->ErrorStatus();
@@ -199,6 +199,17 @@ Bnd_Box& IntTools_Context::BndBox(const TopoDS_Shape& aS)
   return *pBox;
 }
 //=======================================================================
+//function : NbCachedTools
+//purpose  : 
+//=======================================================================
+Standard_Integer IntTools_Context::NbCachedTools() const
+{
+  return myFClass2dMap.Extent() + myProjPSMap.Extent() +
+    myProjPCMap.Extent() + mySClassMap.Extent() +
+    myProjPTMap.Extent() + myHatcherMap.Extent() +
+    myProjSDataMap.Extent() + myBndBoxDataMap.Extent();
+}
+//=======================================================================
 //function : IsInfiniteFace
 //purpose  : 
 //=======================================================================
@@ -15,11 +15,18 @@
 // commercial license or contractual agreement.
 
 #include <OSD_Parallel.hxx>
+#include <OSD_Thread.hxx>
+#include <Standard_Mutex.hxx>
+
+#include <exception>
+#include <vector>
 
 #ifdef _WIN32
     #include <windows.h>
     #include <process.h>
 #else
+    #include <pthread.h>
+    #include <time.h>
     #include <sys/types.h>
 
     #ifdef __sun
@@ -91,3 +98,410 @@ Standard_Integer OSD_Parallel::NbLogicalProcessors()
 #endif
   return aNumLogicalProcessors;
 }
+
+namespace
+{
+  //! Function run for each chunk of a loop, as OSD_Parallel::ChunkFunction.
+  typedef void (*ChunkFunction) (Standard_Address theContext,
+                                 Standard_Integer theBegin,
+                                 Standard_Integer theEnd);
+
+  //! Adds theValue to the integer pointed by theTarget atomically
+  //! and returns the value it had before.
+  static inline Standard_Integer atomicFetchAdd (volatile Standard_Integer* theTarget,
+                                                 const Standard_Integer     theValue)
+  {
+  #ifdef _WIN32
+    return (Standard_Integer )InterlockedExchangeAdd (reinterpret_cast<volatile LONG*>(theTarget), theValue);
+  #else
+    return __sync_fetch_and_add (theTarget, theValue);
+  #endif
+  }
+
+  //! Time the first items of an adaptive loop are run for, in seconds, to measure their cost.
+  static const Standard_Real THE_PROBE_TIME = 2.0e-5;
+
+  //! Least time, in seconds, the rest of an adaptive loop must take to be run on the pool.
+  static const Standard_Real THE_MIN_PARALLEL_TIME = 1.0e-4;
+
+  //! Time, in seconds, a chunk of an adaptive loop should take.
+  static const Standard_Real THE_CHUNK_TIME = 1.0e-5;
+
+  //! Returns the time in seconds of a steady clock.
+  static Standard_Real currentTime()
+  {
+  #ifdef _WIN32
+    LARGE_INTEGER aCount, aFrequency;
+    QueryPerformanceCounter (&aCount);
+    QueryPerformanceFrequency (&aFrequency);
+    return (Standard_Real )aCount.QuadPart / (Standard_Real )aFrequency.QuadPart;
+  #else
+    timespec aTime;
+    clock_gettime (CLOCK_MONOTONIC, &aTime);
+    return (Standard_Real )aTime.tv_sec + 1.0e-9 * (Standard_Real )aTime.tv_nsec;
+  #endif
+  }
+
+  //! Set on the workers of the pool and on a thread while it runs a loop,
+  //! loops started from inside a loop run on the calling thread alone.
+  #ifdef _MSC_VER
+    static __declspec(thread) int isInLoop = 0;
+  #else
+    static __thread int isInLoop = 0;
+  #endif
+
+  //! Mutex with the conditions the pool waits on, its workers sleep between loops.
+  //! Standard_Mutex is not used as it is released when an exception is raised.
+  class PoolSignal
+  {
+  public:
+
+    PoolSignal()
+    {
+    #ifdef _WIN32
+      InitializeCriticalSection (&myMutex);
+      InitializeConditionVariable (&myStarted);
+      InitializeConditionVariable (&myFinished);
+    #else
+      pthread_mutex_init (&myMutex, NULL);
+      pthread_cond_init (&myStarted, NULL);
+      pthread_cond_init (&myFinished, NULL);
+    #endif
+    }
+
+    void Lock()
+    {
+    #ifdef _WIN32
+      EnterCriticalSection (&myMutex);
+    #else
+      pthread_mutex_lock (&myMutex);
+    #endif
+    }
+
+    void Unlock()
+    {
+    #ifdef _WIN32
+      LeaveCriticalSection (&myMutex);
+    #else
+      pthread_mutex_unlock (&myMutex);
+    #endif
+    }
+
+    //! Waits, with the mutex locked, for a loop to start.
+    void WaitStarted()
+    {
+    #ifdef _WIN32
+      SleepConditionVariableCS (&myStarted, &myMutex, INFINITE);
+    #else
+      pthread_cond_wait (&myStarted, &myMutex);
+    #endif
+    }
+
+    //! Wakes the workers waiting for a loop to start.
+    void NotifyStarted()
+    {
+    #ifdef _WIN32
+      WakeAllConditionVariable (&myStarted);
+    #else
+      pthread_cond_broadcast (&myStarted);
+    #endif
+    }
+
+    //! Waits, with the mutex locked, for a worker to finish.
+    void WaitFinished()
+    {
+    #ifdef _WIN32
+      SleepConditionVariableCS (&myFinished, &myMutex, INFINITE);
+    #else
+      pthread_cond_wait (&myFinished, &myMutex);
+    #endif
+    }
+
+    //! Wakes the thread waiting for the workers to finish.
+    void NotifyFinished()
+    {
+    #ifdef _WIN32
+      WakeConditionVariable (&myFinished);
+    #else
+      pthread_cond_signal (&myFinished);
+    #endif
+    }
+
+  private:
+
+    PoolSignal (const PoolSignal& theCopy);
+    PoolSignal& operator= (const PoolSignal& theCopy);
+
+  private:
+
+  #ifdef _WIN32
+    CRITICAL_SECTION   myMutex;
+    CONDITION_VARIABLE myStarted;
+    CONDITION_VARIABLE myFinished;
+  #else
+    pthread_mutex_t    myMutex;
+    pthread_cond_t     myStarted;
+    pthread_cond_t     myFinished;
+  #endif
+  };
+
+  //! Slice of the indices of a loop owned by one thread. Its chunks are claimed by
+  //! an atomic increment of the cursor, first by the owner and then by the threads
+  //! that have finished their own. Padded so no two cursors share a cache line.
+  struct PoolSlice
+  {
+    volatile Standard_Integer Next;
+    Standard_Integer          End;
+    char                      Padding[64 - 2 * sizeof(Standard_Integer)];
+  };
+
+  //! Process wide pool of worker threads behind OSD_Parallel when TBB is not used.
+  //! The pool is never destroyed, joining its workers while the module is unloaded
+  //! could deadlock, they end with the process.
+  class ThreadPool
+  {
+  public:
+
+    //! Returns the pool, made on the first call,
+    //! or NULL if there is only one logical processor.
+    static ThreadPool* Instance()
+    {
+      Standard_Mutex::Sentry aSentry (myInstanceMutex);
+      if ( !myIsInstanceMade )
+      {
+        const Standard_Integer aNbWorkers = OSD_Parallel::NbLogicalProcessors() - 1;
+        if ( aNbWorkers > 0 )
+          myInstance = new ThreadPool (aNbWorkers);
+        myIsInstanceMade = true;
+      }
+      return myInstance;
+    }
+
+    //! Runs theFunction over the indices theOffset + [0, theNbItems) on the calling
+    //! thread and the workers, in chunks of theGrainSize or, if it is 0, of an eighth
+    //! of a slice. Returns false, without running it, if the pool is running a loop
+    //! for another thread.
+    Standard_Boolean Run (const Standard_Integer theOffset,
+                          const Standard_Integer theNbItems,
+                          const Standard_Integer theGrainSize,
+                          ChunkFunction          theFunction,
+                          Standard_Address       theContext)
+    {
+      mySignal.Lock();
+      const Standard_Boolean isBusy = myIsBusy;
+      myIsBusy = Standard_True;
+      mySignal.Unlock();
+      if ( isBusy )
+        return Standard_False;
+
+      // the workers are idle, the slices are published by the lock taken to start them
+      const Standard_Integer aNbSlices = (Standard_Integer )mySlices.size();
+      for ( Standard_Integer i = 0; i < aNbSlices; ++i )
+      {
+        mySlices[i].Next = (Standard_Integer )(((long long )theNbItems * i) / aNbSlices);
+        mySlices[i].End  = (Standard_Integer )(((long long )theNbItems * (i + 1)) / aNbSlices);
+      }
+      myFunction  = theFunction;
+      myContext   = theContext;
+      myOffset    = theOffset;
+      myChunk     = theGrainSize > 0 ? theGrainSize : Max (1, theNbItems / (aNbSlices * 8));
+      myIsAborted = 0;
+
+      mySignal.Lock();
+      myNbRunning = (Standard_Integer )myWorkers.size();
+      ++myGeneration;
+      mySignal.NotifyStarted();
+      mySignal.Unlock();
+
+      isInLoop = 1;
+      perform (aNbSlices - 1);
+      isInLoop = 0;
+
+      // every chunk is run by the thread that claims it, so the loop is done when all have left it
+      mySignal.Lock();
+      while ( myNbRunning > 0 )
+        mySignal.WaitFinished();
+      std::exception_ptr aFailure = myFailure;
+      myFailure = std::exception_ptr();
+      myIsBusy = Standard_False;
+      mySignal.Unlock();
+
+      if ( aFailure )
+        std::rethrow_exception (aFailure);
+      return Standard_True;
+    }
+
+  private:
+
+    //! Link from a worker thread to the pool.
+    struct Worker
+    {
+      ThreadPool*      Pool;
+      Standard_Integer Index;
+      OSD_Thread       Thread;
+    };
+
+    ThreadPool (const Standard_Integer theNbWorkers)
+    : myWorkers   (theNbWorkers),
+      mySlices    (theNbWorkers + 1),
+      myGeneration(0),
+      myNbRunning (0),
+      myIsBusy    (Standard_False),
+      myIsAborted (0),
+      myFunction  (NULL),
+      myContext   (NULL),
+      myOffset    (0),
+      myChunk     (1)
+    {
+      for ( Standard_Integer i = 0; i < theNbWorkers; ++i )
+      {
+        Worker& aWorker = myWorkers[i];
+        aWorker.Pool  = this;
+        aWorker.Index = i;
+        aWorker.Thread.SetFunction (&ThreadPool::workerFunction);
+        aWorker.Thread.Run (&aWorker);
+      }
+    }
+
+    //! Main function of the workers, runs each loop as it is started.
+    static Standard_Address workerFunction (Standard_Address theWorker)
+    {
+      Worker& aWorker = *( static_cast<Worker*>(theWorker) );
+      ThreadPool& aPool = *aWorker.Pool;
+      isInLoop = 1;
+      unsigned int aSeen = 0;
+      for (;;)
+      {
+        aPool.mySignal.Lock();
+        while ( aPool.myGeneration == aSeen )
+          aPool.mySignal.WaitStarted();
+        aSeen = aPool.myGeneration;
+        aPool.mySignal.Unlock();
+
+        aPool.perform (aWorker.Index);
+
+        aPool.mySignal.Lock();
+        if ( --aPool.myNbRunning == 0 )
+          aPool.mySignal.NotifyFinished();
+        aPool.mySignal.Unlock();
+      }
+    }
+
+    //! Runs the chunks of the thread's own slice and then those left in the others.
+    //! The first exception stops the loop, it is kept to be raised on the calling thread.
+    void perform (const Standard_Integer theSelf)
+    {
+      const Standard_Integer aNbSlices = (Standard_Integer )mySlices.size();
+      try
+      {
+        for ( Standard_Integer k = 0; k < aNbSlices; ++k )
+        {
+          PoolSlice& aSlice = mySlices[(theSelf + k) % aNbSlices];
+          while ( !myIsAborted && aSlice.Next < aSlice.End )
+          {
+            const Standard_Integer aBegin = atomicFetchAdd (&aSlice.Next, myChunk);
+            if ( aBegin >= aSlice.End )
+              break;
+            myFunction (myContext, myOffset + aBegin, myOffset + Min (aBegin + myChunk, aSlice.End));
+          }
+        }
+      }
+      catch (...)
+      {
+        mySignal.Lock();
+        if ( !myFailure )
+          myFailure = std::current_exception();
+        myIsAborted = 1;
+        mySignal.Unlock();
+      }
+    }
+
+  private:
+
+    ThreadPool (const ThreadPool& theCopy);
+    ThreadPool& operator= (const ThreadPool& theCopy);
+
+  private:
+
+    std::vector<Worker>    myWorkers;
+    std::vector<PoolSlice> mySlices;     //!< One per worker, the last is the calling thread's.
+    PoolSignal             mySignal;
+    unsigned int           myGeneration; //!< Count of the loops started, guarded by mySignal.
+    Standard_Integer       myNbRunning;  //!< Workers yet to leave the loop, guarded by mySignal.
+    Standard_Boolean       myIsBusy;     //!< Set while a loop runs, guarded by mySignal.
+    volatile int           myIsAborted;
+    std::exception_ptr     myFailure;
+    ChunkFunction          myFunction;
+    Standard_Address       myContext;
+    Standard_Integer       myOffset;
+    Standard_Integer       myChunk;
+
+    static Standard_Mutex  myInstanceMutex;
+    static ThreadPool*     myInstance;
+    static bool            myIsInstanceMade;
+  };
+
+  // constructed when the module is loaded, function statics are not thread safe with all compilers
+  Standard_Mutex ThreadPool::myInstanceMutex;
+  ThreadPool*    ThreadPool::myInstance = NULL;
+  bool           ThreadPool::myIsInstanceMade = false;
+}
+
+//=======================================================================
+//function : RunChunks
+//purpose  : Runs a loop on the thread pool.
+//=======================================================================
+void OSD_Parallel::RunChunks (const Standard_Integer theBegin,
+                              const Standard_Integer theEnd,
+                              const Standard_Integer theGrainSize,
+                              ChunkFunction          theFunction,
+                              Standard_Address       theContext)
+{
+  if ( theEnd <= theBegin )
+    return;
+
+  ThreadPool* aPool = ( theEnd - theBegin > 1 && !isInLoop ) ? ThreadPool::Instance() : NULL;
+  Standard_Integer aBegin     = theBegin;
+  Standard_Integer aGrainSize = Max (theGrainSize, 0);
+  if ( aPool != NULL && theGrainSize == AdaptiveGrainSize )
+  {
+    // run the first items here, doubling their number until they take long enough to time
+    Standard_Real aTime = 0.0;
+    for ( Standard_Integer aNb = 1; aBegin < theEnd && aTime < THE_PROBE_TIME; aNb *= 2 )
+    {
+      const Standard_Integer anEnd  = aBegin + Min (aNb, theEnd - aBegin);
+      const Standard_Real    aStart = currentTime();
+      theFunction (theContext, aBegin, anEnd);
+      aTime += currentTime() - aStart;
+      aBegin = anEnd;
+    }
+
+    const Standard_Integer aNbLeft    = theEnd - aBegin;
+    const Standard_Real    anItemTime = aTime / (aBegin - theBegin);
+    if ( anItemTime * aNbLeft < THE_MIN_PARALLEL_TIME )
+      aPool = NULL;
+    else
+      aGrainSize = (Standard_Integer )Min ((Standard_Real )aNbLeft, Max (1.0, THE_CHUNK_TIME / anItemTime));
+  }
+
+  if ( aBegin >= theEnd )
+    return;
+
+  if ( aPool != NULL && theEnd - aBegin > 1
+    && aPool->Run (aBegin, theEnd - aBegin, aGrainSize, theFunction, theContext) )
+    return;
+
+  // run on the calling thread alone, as are the loops started from inside this one
+  const int wasInLoop = isInLoop;
+  isInLoop = 1;
+  try
+  {
+    theFunction (theContext, aBegin, theEnd);
+  }
+  catch (...)
+  {
+    isInLoop = wasInLoop;
+    throw;
+  }
+  isInLoop = wasInLoop;
+}
@@ -0,0 +1,167 @@
+#include "XbimBooleanContextCache.h"
+#include <Standard_Mutex.hxx>
+#include <IntTools_Context.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+#include <BRep_Tool.hxx>
+#include <mutex>
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		XbimBooleanContextCache& XbimBooleanContextCache::Default()
+		{
+			static std::once_flag created;
+			static XbimBooleanContextCache* cache = 0;
+			std::call_once(created, []() { cache = new XbimBooleanContextCache(); });
+			return *cache;
+		}
+
+		XbimBooleanContextCache::XbimBooleanContextCache() : _lock(new Standard_Mutex()), _maxHosts(64), _maxTools(20000), _clock(0),
+			_reused(0), _created(0), _invalidated(0)
+		{
+		}
+
+		XbimBooleanContextCache::~XbimBooleanContextCache()
+		{
+			delete _lock;
+		}
+
+		double XbimBooleanContextCache::Tolerances(const TopoDS_Shape& host)
+		{
+			double tolerances = 0;
+			for (TopExp_Explorer exp(host, TopAbs_FACE); exp.More(); exp.Next())
+				tolerances += BRep_Tool::Tolerance(TopoDS::Face(exp.Current()));
+			for (TopExp_Explorer exp(host, TopAbs_EDGE); exp.More(); exp.Next())
+				tolerances += BRep_Tool::Tolerance(TopoDS::Edge(exp.Current()));
+			for (TopExp_Explorer exp(host, TopAbs_VERTEX); exp.More(); exp.Next())
+				tolerances += BRep_Tool::Tolerance(TopoDS::Vertex(exp.Current()));
+			return tolerances;
+		}
+
+		Handle(IntTools_Context) XbimBooleanContextCache::Acquire(const TopoDS_Shape& host, double& tolerances)
+		{
+			tolerances = Tolerances(host);
+			Handle(IntTools_Context) evicted; //released outside the lock
+			{
+				Standard_Mutex::Sentry sentry(*_lock);
+				for (size_t i = 0; i < _entries.size(); i++)
+				{
+					if (!_entries[i].Host.IsSame(host)) continue;
+					Handle(IntTools_Context) context = _entries[i].Context;
+					bool unchanged = _entries[i].Tolerances == tolerances;
+					_entries[i] = _entries.back();
+					_entries.pop_back();
+					if (unchanged)
+					{
+						_reused++;
+						return context;
+					}
+					//the solid was changed by a boolean that did not use the cache
+					evicted = context;
+					_invalidated++;
+					break;
+				}
+				_created++;
+			}
+			return new IntTools_Context();
+		}
+
+		void XbimBooleanContextCache::Release(const TopoDS_Shape& host, const Handle(IntTools_Context)& context, double tolerances)
+		{
+			if (host.IsNull() || context.IsNull()) return;
+			if (Tolerances(host) != tolerances) //the boolean changed the solid, what the context holds for it is stale
+			{
+				Invalidate(host);
+				Standard_Mutex::Sentry sentry(*_lock);
+				_invalidated++;
+				return;
+			}
+			//the maps of a context only grow and its allocator does not free, so a context past the limit is dropped whole
+			if (context->NbCachedTools() > _maxTools) return;
+			Handle(IntTools_Context) evicted; //released outside the lock, freeing a large context takes a while
+			Standard_Mutex::Sentry sentry(*_lock);
+			for (size_t i = 0; i < _entries.size(); i++)
+			{
+				//another thread cut the same solid at the same time, the context released last is kept
+				if (!_entries[i].Host.IsSame(host)) continue;
+				evicted = _entries[i].Context;
+				_entries[i].Context = context;
+				_entries[i].Tolerances = tolerances;
+				_entries[i].Used = ++_clock;
+				return;
+			}
+			if (_maxHosts == 0) return;
+			if (_entries.size() >= _maxHosts)
+			{
+				size_t oldest = 0;
+				for (size_t i = 1; i < _entries.size(); i++)
+					if (_entries[i].Used < _entries[oldest].Used) oldest = i;
+				evicted = _entries[oldest].Context;
+				_entries[oldest] = _entries.back();
+				_entries.pop_back();
+			}
+			Entry entry;
+			entry.Host = host;
+			entry.Tolerances = tolerances;
+			entry.Context = context;
+			entry.Used = ++_clock;
+			_entries.push_back(entry);
+		}
+
+		void XbimBooleanContextCache::Invalidate(const TopoDS_Shape& host)
+		{
+			Handle(IntTools_Context) evicted;
+			Standard_Mutex::Sentry sentry(*_lock);
+			for (size_t i = 0; i < _entries.size(); i++)
+			{
+				if (!_entries[i].Host.IsSame(host)) continue;
+				evicted = _entries[i].Context;
+				_entries[i] = _entries.back();
+				_entries.pop_back();
+				return;
+			}
+		}
+
+		void XbimBooleanContextCache::Clear()
+		{
+			std::vector<Entry> entries;
+			{
+				Standard_Mutex::Sentry sentry(*_lock);
+				entries.swap(_entries);
+			}
+		}
+
+		void XbimBooleanContextCache::SetLimits(size_t maxHosts, int maxTools)
+		{
+			std::vector<Entry> evicted;
+			Standard_Mutex::Sentry sentry(*_lock);
+			_maxHosts = maxHosts;
+			_maxTools = maxTools;
+			while (_entries.size() > _maxHosts)
+			{
+				size_t oldest = 0;
+				for (size_t i = 1; i < _entries.size(); i++)
+					if (_entries[i].Used < _entries[oldest].Used) oldest = i;
+				evicted.push_back(_entries[oldest]);
+				_entries[oldest] = _entries.back();
+				_entries.pop_back();
+			}
+		}
+
+		size_t XbimBooleanContextCache::Count()
+		{
+			Standard_Mutex::Sentry sentry(*_lock);
+			return _entries.size();
+		}
+
+		void XbimBooleanContextCache::Statistics(size_t& reused, size_t& created, size_t& invalidated)
+		{
+			Standard_Mutex::Sentry sentry(*_lock);
+			reused = _reused;
+			created = _created;
+			invalidated = _invalidated;
+		}
+	}
+}
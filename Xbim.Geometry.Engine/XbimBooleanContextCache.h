@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <TopoDS_Shape.hxx>
+#include <Handle_IntTools_Context.hxx>
+
+class Standard_Mutex;
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		//Process wide cache of the intersection contexts of OCC booleans, keyed on the solid that is cut and its location
+		//A context holds the face classifiers, projectors, boxes and solid classifiers a boolean builds for the shapes it meets,
+		//they are keyed on located shapes so only a later cut of the same solid at the same location can reuse them. A cut of
+		//each element by all of its openings at once gains nothing, the cache pays only when one solid is cut again and again
+		//A boolean with a fuzzy value raises the tolerances of the faces, edges and vertices of the solid that its tools meet,
+		//and the boxes and classifiers built for them are then stale. The tolerances of the solid are summed before and after
+		//each cut and its context is dropped if they differ, so in practice a context is reused by cuts whose tools meet none of
+		//the solid's faces, e.g. voids inside it, which reuse the classifier of the solid
+		//A context is taken out of the cache while it is used, so no two operations share one. The entries hold handles to their
+		//solids, so the topology of a solid that is still cached is never freed and its address never reused by another
+		class XbimBooleanContextCache
+		{
+		public:
+			static XbimBooleanContextCache& Default();
+			XbimBooleanContextCache();
+			~XbimBooleanContextCache();
+			//takes the context of the solid out of the cache, or returns a new one if it has none, it is in use or the tolerances
+			//of the solid have changed since it was kept. tolerances is set to those of the solid, pass them to Release
+			Handle(IntTools_Context) Acquire(const TopoDS_Shape& host, double& tolerances);
+			//returns the context to the cache after a boolean on the solid succeeded, the context is dropped if the boolean changed
+			//the tolerances of the solid or if it holds more than the limit of tools, and the solid least recently cut is dropped
+			//if there are more than the limit of solids
+			void Release(const TopoDS_Shape& host, const Handle(IntTools_Context)& context, double tolerances);
+			//drops the context of the solid, it must be called if the solid is modified, e.g. if its tolerances are changed
+			void Invalidate(const TopoDS_Shape& host);
+			void Clear();
+			//sets the most solids kept and the most classifiers, projectors and other tools a kept context may hold
+			void SetLimits(size_t maxHosts, int maxTools);
+			size_t Count();
+			//totals of the contexts acquired, those reused and those made new, and of the contexts dropped as the tolerances of
+			//their solids had changed
+			void Statistics(size_t& reused, size_t& created, size_t& invalidated);
+			//the sum of the tolerances of the faces, edges and vertices of a solid, booleans only raise them so it changes when they do
+			static double Tolerances(const TopoDS_Shape& host);
+		private:
+			struct Entry
+			{
+				TopoDS_Shape Host;
+				double Tolerances;
+				Handle(IntTools_Context) Context;
+				size_t Used;
+			};
+			XbimBooleanContextCache(const XbimBooleanContextCache&);
+			XbimBooleanContextCache& operator=(const XbimBooleanContextCache&);
+			Standard_Mutex* _lock; //not held by value so that managed code including this does not see the platform headers
+			std::vector<Entry> _entries; //few enough that a scan is cheaper than hashing
+			size_t _maxHosts;
+			int _maxTools;
+			size_t _clock;
+			size_t _reused;
+			size_t _created;
+			size_t _invalidated;
+		};
+	}
+}
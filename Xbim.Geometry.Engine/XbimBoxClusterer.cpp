@@ -0,0 +1,115 @@
+#include "XbimBoxClusterer.h"
+#include <algorithm>
+#include <cfloat>
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		XbimBoxClusterer::XbimBoxClusterer()
+		{
+		}
+
+		void XbimBoxClusterer::Add(double minX, double minY, double minZ, double maxX, double maxY, double maxZ)
+		{
+			_bounds.push_back(minX);
+			_bounds.push_back(minY);
+			_bounds.push_back(minZ);
+			_bounds.push_back(maxX);
+			_bounds.push_back(maxY);
+			_bounds.push_back(maxZ);
+		}
+
+		size_t XbimBoxClusterer::Find(size_t box)
+		{
+			while (_parents[box] != box)
+			{
+				_parents[box] = _parents[_parents[box]]; //path halving
+				box = _parents[box];
+			}
+			return box;
+		}
+
+		void XbimBoxClusterer::Union(size_t a, size_t b)
+		{
+			a = Find(a);
+			b = Find(b);
+			if (a == b) return;
+			if (_sizes[a] < _sizes[b]) std::swap(a, b);
+			_parents[b] = a;
+			_sizes[a] += _sizes[b];
+		}
+
+		size_t XbimBoxClusterer::Cluster(std::vector<size_t>& clusters)
+		{
+			size_t count = Count();
+			_parents.resize(count);
+			_sizes.assign(count, 1);
+			for (size_t i = 0; i < count; i++) _parents[i] = i;
+
+			//only the valid boxes are swept, on the axis where they overlap least, the one with the smallest total size relative to its extent
+			std::vector<size_t> order;
+			order.reserve(count);
+			double lower[3] = { DBL_MAX, DBL_MAX, DBL_MAX };
+			double upper[3] = { -DBL_MAX, -DBL_MAX, -DBL_MAX };
+			double sizes[3] = { 0, 0, 0 };
+			for (size_t i = 0; i < count; i++)
+			{
+				const double* b = &_bounds[i * 6];
+				if (!(b[0] <= b[3] && b[1] <= b[4] && b[2] <= b[5])) continue;
+				order.push_back(i);
+				for (int axis = 0; axis < 3; axis++)
+				{
+					lower[axis] = std::min(lower[axis], b[axis]);
+					upper[axis] = std::max(upper[axis], b[axis + 3]);
+					sizes[axis] += b[axis + 3] - b[axis];
+				}
+			}
+			if (order.size() > 1)
+			{
+				int axis = 0;
+				double best = DBL_MAX;
+				for (int a = 0; a < 3; a++)
+				{
+					double extent = upper[a] - lower[a];
+					double overlap = extent > 0 ? sizes[a] / extent : DBL_MAX;
+					if (overlap < best)
+					{
+						best = overlap;
+						axis = a;
+					}
+				}
+				const std::vector<double>& bounds = _bounds;
+				std::sort(order.begin(), order.end(),
+					[&bounds, axis](size_t a, size_t b) { return bounds[a * 6 + axis] < bounds[b * 6 + axis]; });
+				int v = (axis + 1) % 3;
+				int w = (axis + 2) % 3;
+				for (size_t i = 0; i < order.size(); i++)
+				{
+					const double* a = &_bounds[order[i] * 6];
+					//the boxes that follow start at or after this one, stop at the first that starts beyond its end
+					for (size_t j = i + 1; j < order.size(); j++)
+					{
+						const double* b = &_bounds[order[j] * 6];
+						if (b[axis] > a[axis + 3]) break;
+						if (b[v] <= a[v + 3] && b[v + 3] >= a[v] && b[w] <= a[w + 3] && b[w + 3] >= a[w])
+							Union(order[i], order[j]);
+					}
+				}
+			}
+
+			//number the clusters in the order of their first box
+			const size_t unset = (size_t)-1;
+			std::vector<size_t> numbers(count, unset);
+			clusters.resize(count);
+			size_t clusterCount = 0;
+			for (size_t i = 0; i < count; i++)
+			{
+				size_t root = Find(i);
+				if (numbers[root] == unset) numbers[root] = clusterCount++;
+				clusters[i] = numbers[root];
+			}
+			return clusterCount;
+		}
+	}
+}
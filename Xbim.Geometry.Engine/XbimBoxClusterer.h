@@ -0,0 +1,32 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		//Native grouping of axis aligned boxes into clusters of boxes that overlap, directly or through other boxes of the cluster
+		//Overlapping pairs are found by sorting the boxes on their minimum along one axis and sweeping, only boxes whose ranges on that
+		//axis overlap are compared, and the pairs are joined with a union find, so clustering n boxes is O(n log n) plus the pairs found
+		class XbimBoxClusterer
+		{
+		public:
+			XbimBoxClusterer();
+			//adds a box, boxes that touch overlap, a box with a minimum greater than its maximum, or not a number, is void and overlaps nothing
+			void Add(double minX, double minY, double minZ, double maxX, double maxY, double maxZ);
+			size_t Count() const { return _bounds.size() / 6; }
+			//sets the cluster of each box in the order they were added, clusters are numbered in the order of their first box
+			//returns the number of clusters
+			size_t Cluster(std::vector<size_t>& clusters);
+			void Clear() { _bounds.clear(); }
+		private:
+			std::vector<double> _bounds; //min x, y, z then max x, y, z of each box
+			std::vector<size_t> _parents;
+			std::vector<size_t> _sizes;
+
+			size_t Find(size_t box);
+			void Union(size_t a, size_t b);
+		};
+	}
+}
@@ -0,0 +1,161 @@
+#include "XbimBoxTree.h"
+#include <algorithm>
+#include <cfloat>
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		XbimBoxTree::XbimBoxTree()
+		{
+		}
+
+		void XbimBoxTree::Build(const std::vector<Bnd_Box>& boxes)
+		{
+			_nodes.clear();
+			_order.clear();
+			_bounds.resize(boxes.size() * 6);
+			_centres.resize(boxes.size() * 3);
+			for (size_t i = 0; i < boxes.size(); i++)
+			{
+				if (boxes[i].IsVoid()) continue;
+				double* b = &_bounds[i * 6];
+				boxes[i].Get(b[0], b[1], b[2], b[3], b[4], b[5]);
+				for (int axis = 0; axis < 3; axis++)
+					_centres[i * 3 + axis] = (b[axis] + b[axis + 3]) / 2;
+				_order.push_back(i);
+			}
+			if (_order.empty()) return;
+			_nodes.reserve(2 * _order.size() / LeafSize + 1);
+			BuildNode(0, _order.size());
+		}
+
+		size_t XbimBoxTree::BuildNode(size_t start, size_t count)
+		{
+			size_t index = _nodes.size();
+			_nodes.push_back(Node());
+			Node node;
+			node.start = start;
+			node.count = count;
+			node.right = 0;
+			double centreMin[3], centreMax[3];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				node.min[axis] = centreMin[axis] = DBL_MAX;
+				node.max[axis] = centreMax[axis] = -DBL_MAX;
+			}
+			for (size_t i = start; i < start + count; i++)
+			{
+				const double* b = &_bounds[_order[i] * 6];
+				const double* c = &_centres[_order[i] * 3];
+				for (int axis = 0; axis < 3; axis++)
+				{
+					node.min[axis] = std::min(node.min[axis], b[axis]);
+					node.max[axis] = std::max(node.max[axis], b[axis + 3]);
+					centreMin[axis] = std::min(centreMin[axis], c[axis]);
+					centreMax[axis] = std::max(centreMax[axis], c[axis]);
+				}
+			}
+			if (count > LeafSize)
+			{
+				int axis = 0;
+				for (int a = 1; a < 3; a++)
+				{
+					if (centreMax[a] - centreMin[a] > centreMax[axis] - centreMin[axis])
+						axis = a;
+				}
+				size_t half = count / 2;
+				const std::vector<double>& centres = _centres;
+				std::nth_element(_order.begin() + start, _order.begin() + start + half, _order.begin() + start + count,
+					[&centres, axis](size_t a, size_t b) { return centres[a * 3 + axis] < centres[b * 3 + axis]; });
+				BuildNode(start, half);
+				node.right = BuildNode(start + half, count - half);
+			}
+			_nodes[index] = node;
+			return index;
+		}
+
+		void XbimBoxTree::Overlapping(const Bnd_Box& box, std::vector<size_t>& overlapping) const
+		{
+			if (_nodes.empty() || box.IsVoid()) return;
+			double q[6];
+			box.Get(q[0], q[1], q[2], q[3], q[4], q[5]);
+			size_t stack[64];
+			size_t top = 0;
+			stack[top++] = 0;
+			while (top > 0)
+			{
+				const Node& node = _nodes[stack[--top]];
+				if (node.min[0] > q[3] || node.max[0] < q[0] ||
+					node.min[1] > q[4] || node.max[1] < q[1] ||
+					node.min[2] > q[5] || node.max[2] < q[2])
+					continue;
+				if (node.right == 0)
+				{
+					for (size_t i = node.start; i < node.start + node.count; i++)
+					{
+						const double* b = &_bounds[_order[i] * 6];
+						if (b[0] <= q[3] && b[3] >= q[0] && b[1] <= q[4] && b[4] >= q[1] && b[2] <= q[5] && b[5] >= q[2])
+							overlapping.push_back(_order[i]);
+					}
+				}
+				else //the left child is pushed last so that leaves are visited in order
+				{
+					stack[top++] = node.right;
+					stack[top++] = &node - &_nodes[0] + 1;
+				}
+			}
+		}
+
+		//true if the half line from o along the direction with inverse inv, or along an axis where it is 0, meets the box min, max
+		static bool Meets(const double* min, const double* max, const double o[3], const double d[3], const double inv[3])
+		{
+			double enter = 0, leave = DBL_MAX;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (d[axis] == 0)
+				{
+					if (o[axis] < min[axis] || o[axis] > max[axis]) return false;
+					continue;
+				}
+				double t0 = (min[axis] - o[axis]) * inv[axis];
+				double t1 = (max[axis] - o[axis]) * inv[axis];
+				if (t0 > t1) std::swap(t0, t1);
+				enter = std::max(enter, t0);
+				leave = std::min(leave, t1);
+				if (enter > leave) return false;
+			}
+			return true;
+		}
+
+		void XbimBoxTree::Crossing(const double origin[3], const double direction[3], std::vector<size_t>& crossing) const
+		{
+			if (_nodes.empty()) return;
+			double inv[3];
+			for (int axis = 0; axis < 3; axis++)
+				inv[axis] = direction[axis] != 0 ? 1 / direction[axis] : 0;
+			size_t stack[64];
+			size_t top = 0;
+			stack[top++] = 0;
+			while (top > 0)
+			{
+				const Node& node = _nodes[stack[--top]];
+				if (!Meets(node.min, node.max, origin, direction, inv)) continue;
+				if (node.right == 0)
+				{
+					for (size_t i = node.start; i < node.start + node.count; i++)
+					{
+						const double* b = &_bounds[_order[i] * 6];
+						if (Meets(b, b + 3, origin, direction, inv))
+							crossing.push_back(_order[i]);
+					}
+				}
+				else
+				{
+					stack[top++] = node.right;
+					stack[top++] = &node - &_nodes[0] + 1;
+				}
+			}
+		}
+	}
+}
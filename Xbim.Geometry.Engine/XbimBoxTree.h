@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <Bnd_Box.hxx>
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		//Native bounding volume hierarchy over a set of axis aligned boxes
+		//The tree is built top down, each node is split at the median of the box centres along its longest axis,
+		//so the leaves hold boxes that are close together and a query visits only the branches that overlap it
+		class XbimBoxTree
+		{
+		public:
+			XbimBoxTree();
+			//builds the tree over the boxes, a void box never overlaps anything
+			void Build(const std::vector<Bnd_Box>& boxes);
+			//appends the index of each box that overlaps box, in the order of the leaves so that boxes near each other are adjacent
+			void Overlapping(const Bnd_Box& box, std::vector<size_t>& overlapping) const;
+			//appends the index of each box the half line from origin along direction passes through or touches
+			void Crossing(const double origin[3], const double direction[3], std::vector<size_t>& crossing) const;
+			size_t Count() const { return _order.size(); }
+		private:
+			static const size_t LeafSize = 4;
+			struct Node
+			{
+				double min[3];
+				double max[3];
+				size_t start; //first entry of the node in _order
+				size_t count; //number of boxes below the node
+				size_t right; //index of the right child, the left child follows the node, 0 for a leaf
+			};
+			std::vector<Node> _nodes;
+			std::vector<size_t> _order; //indices of the non void boxes, grouped by leaf
+			std::vector<double> _bounds; //min x, y, z then max x, y, z of each box
+			std::vector<double> _centres;
+
+			size_t BuildNode(size_t start, size_t count);
+		};
+	}
+}
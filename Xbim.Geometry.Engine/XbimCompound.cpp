@@ -1,6 +1,8 @@
 #include "XbimCompound.h"
 #include "XbimGeometryCreator.h"
 #include "XbimSolidSet.h"
+#include "XbimBoxClusterer.h"
+#include "XbimShapeFuser.h"
 #include "XbimGeomPrim.h"
 
 #include <BRep_Builder.hxx>
@@ -536,100 +538,103 @@ namespace Xbim
 			BRep_Builder b;
 			
 			////first remove any that intersect as simple merging leads to illegal geometries.
-			Dictionary<XbimSolid^, HashSet<XbimSolid^>^>^ clusters = gcnew Dictionary<XbimSolid^, HashSet<XbimSolid^>^>();
+			List<XbimSolid^>^ toCluster = gcnew List<XbimSolid^>();
+			HashSet<XbimSolid^>^ distinct = gcnew HashSet<XbimSolid^>();
 			for each (IXbimSolid^ solid in solids) //init all the clusters
 			{
 				XbimSolid^ solidToCheck = dynamic_cast<XbimSolid^>(solid);
-				if (solidToCheck != nullptr)
-					clusters[solidToCheck] = gcnew HashSet<XbimSolid^>();
+				if (solidToCheck != nullptr && distinct->Add(solidToCheck))
+					toCluster->Add(solidToCheck);
 			}
-			if (clusters->Count == 0) return nullptr; //nothing to do
+			if (toCluster->Count == 0) return nullptr; //nothing to do
 
 			
 			b.MakeCompound(compound);
-			if (clusters->Count == 1 ) //just one so return it
+			if (toCluster->Count == 1 ) //just one so return it
 			{
-				for each(XbimSolid^ solid in clusters->Keys) //take the first one
-				{
-					b.Add(compound, solid);
-					GC::KeepAlive(solid);
-					return gcnew XbimCompound(compound, true, tolerance);
-				}
+				b.Add(compound, toCluster[0]);
+				GC::KeepAlive(toCluster[0]);
+				return gcnew XbimCompound(compound, true, tolerance);
 			}
-			for each (XbimSolid^ solid in solids)
+			//group the solids whose bounding boxes overlap, directly or through other solids
+			XbimBoxClusterer clusterer;
+			for each (XbimSolid^ solid in toCluster)
 			{
-				XbimSolid^ solidToCheck = dynamic_cast<XbimSolid^>(solid);
-				if (solidToCheck != nullptr)
-				{
-					XbimRect3D bbToCheck = solidToCheck->BoundingBox;
-					for each (KeyValuePair<XbimSolid^, HashSet<XbimSolid^>^>^ cluster in clusters)
-					{
-						if (solidToCheck != cluster->Key && bbToCheck.Intersects(cluster->Key->BoundingBox))
-							cluster->Value->Add(solidToCheck);
-					}
-				}
+				XbimRect3D bb = solid->BoundingBox;
+				clusterer.Add(bb.X, bb.Y, bb.Z, bb.X + bb.SizeX, bb.Y + bb.SizeY, bb.Z + bb.SizeZ);
 			}
+			std::vector<size_t> clusterOf;
+			size_t clusterCount = clusterer.Cluster(clusterOf);
+			std::vector<int> clusterSizes(clusterCount, 0);
+			for (size_t i = 0; i < clusterOf.size(); i++) clusterSizes[clusterOf[i]]++;
 			List<XbimSolid^>^ toMergeReduced = gcnew List<XbimSolid^>();
-			Dictionary<XbimSolid^, HashSet<XbimSolid^>^>^ clustersSparse = gcnew Dictionary<XbimSolid^, HashSet<XbimSolid^>^>();
-			for each (KeyValuePair<XbimSolid^, HashSet<XbimSolid^>^>^ cluster in clusters)
+			array<List<XbimSolid^>^>^ clusters = gcnew array<List<XbimSolid^>^>((int)clusterCount);
+			for (int i = 0; i < toCluster->Count; i++)
 			{
-				if (cluster->Value->Count>0)
-					clustersSparse->Add(cluster->Key, cluster->Value);
+				size_t cluster = clusterOf[i];
+				if (clusterSizes[cluster] == 1)
+					toMergeReduced->Add(toCluster[i]); //record the ones to simply merge
 				else
-					toMergeReduced->Add(cluster->Key); //record the ones to simply merge
-			}
-			clusters = nullptr;
-
-			XbimSolid^ clusterAround = nullptr;
-			for each(XbimSolid^ fsolid in clustersSparse->Keys) //take the first one
-			{
-				clusterAround = fsolid;
-				break;
+				{
+					if (clusters[(int)cluster] == nullptr) clusters[(int)cluster] = gcnew List<XbimSolid^>(clusterSizes[cluster]);
+					clusters[(int)cluster]->Add(toCluster[i]);
+				}
 			}
+			toCluster = nullptr;
 
-			while (clusterAround != nullptr)
+			for each (List<XbimSolid^>^ connected in clusters)
 			{
-				HashSet<XbimSolid^>^ connected = gcnew HashSet<XbimSolid^>();
-				XbimCompound::GetConnected(connected, clustersSparse, clusterAround);
-				
+				if (connected == nullptr) continue;
 				ShapeFix_ShapeTolerance fixTol;
 				TopoDS_Shape unionedShape;
-				for each (XbimSolid^ toConnect in connected) //join up the connected
+				if (XbimGeometryCreator::FuseStrategy != XbimFuseStrategy::Sequential)
 				{
-					fixTol.SetTolerance(toConnect, tolerance);
-					if (unionedShape.IsNull()) unionedShape = toConnect;
-					else
+					std::vector<TopoDS_Shape> toFuse;
+					toFuse.reserve(connected->Count);
+					for each (XbimSolid^ toConnect in connected)
 					{
-						String^ err = "";
-						try
-						{
-							BRepAlgoAPI_Fuse boolOp(unionedShape, toConnect);
-							if (boolOp.ErrorStatus() == 0)
-								unionedShape = boolOp.Shape();
-							else
-								XbimGeometryCreator::logger->WarnFormat("WC004: Boolean Union operation failed." );
-						}
-						catch (Standard_Failure e)
+						fixTol.SetTolerance(toConnect, tolerance);
+						toFuse.push_back(toConnect);
+					}
+					XbimShapeFuser fuser(XbimGeometryCreator::FuseStrategy == XbimFuseStrategy::MultiWay ? XbimShapeFuser::MultiWay : XbimShapeFuser::BalancedTree);
+					std::string err;
+					std::string fallback;
+					size_t failures = fuser.Fuse(toFuse, unionedShape, err, fallback);
+					if (!fallback.empty())
+						XbimGeometryCreator::logger->WarnFormat("WC006: Multi-way Boolean Union operation failed, the solids are fused in pairs. {0}", gcnew String(fallback.c_str()));
+					if (failures > 0)
+						XbimGeometryCreator::logger->WarnFormat("WC004: Boolean Union operation failed for {0} pairs of solids. {1}", (int)failures, gcnew String(err.c_str()));
+					GC::KeepAlive(connected);
+				}
+				else
+				{
+					for each (XbimSolid^ toConnect in connected) //join up the connected
+					{
+						fixTol.SetTolerance(toConnect, tolerance);
+						if (unionedShape.IsNull()) unionedShape = toConnect;
+						else
 						{
-							err = gcnew String(Standard_Failure::Caught()->GetMessageString());
-							XbimGeometryCreator::logger->WarnFormat("WC005: Boolean Union operation failed. " + err);
-						}
+							String^ err = "";
+							try
+							{
+								BRepAlgoAPI_Fuse boolOp(unionedShape, toConnect);
+								if (boolOp.ErrorStatus() == 0)
+									unionedShape = boolOp.Shape();
+								else
+									XbimGeometryCreator::logger->WarnFormat("WC004: Boolean Union operation failed." );
+							}
+							catch (Standard_Failure e)
+							{
+								err = gcnew String(Standard_Failure::Caught()->GetMessageString());
+								XbimGeometryCreator::logger->WarnFormat("WC005: Boolean Union operation failed. " + err);
+							}
 						
+						}
 					}
 				}
 				XbimSolidSet^ solidSet = gcnew XbimSolidSet(unionedShape);
 
 				for each (XbimSolid^ solid in solidSet) toMergeReduced->Add(solid);
-				
-				for each (XbimSolid^ solid in connected) //remove what we have connected
-					clustersSparse->Remove(solid);
-
-				clusterAround = nullptr;
-				for each(XbimSolid^ fsolid in clustersSparse->Keys) //take the first one
-				{
-					clusterAround = fsolid;
-					break;
-				}
 			}
 
 			for each (XbimSolid^ solid in toMergeReduced)
@@ -675,24 +680,6 @@ namespace Xbim
 			return discrete;
 		}
 
-		void  XbimCompound::GetConnected(HashSet<XbimSolid^>^ connected, Dictionary<XbimSolid^, HashSet<XbimSolid^>^>^ clusters, XbimSolid^ clusterAround)
-		{
-			if (connected->Add(clusterAround))
-			{
-				for each (KeyValuePair<XbimSolid^, HashSet<XbimSolid^>^>^ polysets in clusters)
-				{
-					if (!connected->Contains(polysets->Key) && !(polysets->Key == clusterAround) && polysets->Value->Contains(clusterAround))  //don't do the same one twice
-					{
-						GetConnected(connected, clusters, polysets->Key);
-						for each (XbimSolid^ poly in polysets->Value)
-						{
-							GetConnected(connected, clusters, poly);
-						}
-					}
-				}
-			}
-		}
-
 		XbimCompound^ XbimCompound::Cut(XbimCompound^ solids, double tolerance)
 		{
 			if (!IsSewn) Sew();
@@ -42,7 +42,6 @@ namespace Xbim
 			void Init(IfcClosedShell^ solid);
 			//Helpers
 			XbimFace^ BuildFace(List<Tuple<XbimWire^, IfcPolyLoop^>^>^ wires, int label);
-			static void  GetConnected(HashSet<XbimSolid^>^ connected, Dictionary<XbimSolid^, HashSet<XbimSolid^>^>^ clusters, XbimSolid^ clusterAround);
 			
 			
 		public:
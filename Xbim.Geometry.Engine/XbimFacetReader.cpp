@@ -0,0 +1,545 @@
+#include "XbimFacetReader.h"
+#ifdef USE_CARVE_CSG
+#include <carve\arena.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		const char XbimFacetReader::Magic[4] = { 'X', 'F', 'T', 'B' };
+
+		namespace
+		{
+			//10^0 to 10^22 are exact in a double, so a mantissa of up to 2^53 scaled by one of them is correctly rounded
+			const double PowersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+				1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+			const unsigned long long MaxExactMantissa = 1ULL << 53;
+
+			//reads the numbers of the text format, a line at a time, works on narrow and wide text
+			template<typename char_t>
+			class TextScanner
+			{
+			public:
+				TextScanner(const char_t* begin, const char_t* end) : p(begin), end(end), line(1) {}
+
+				bool AtEnd() const { return p == end; }
+				bool AtLineEnd() const { return p == end || *p == '\n' || *p == '\r'; }
+				size_t Line() const { return line; }
+				char_t Peek() const { return p == end ? 0 : *p; }
+				void Skip() { p++; }
+
+				void SkipBlanks()
+				{
+					while (p != end && (*p == ' ' || *p == '\t')) p++;
+				}
+
+				void NextLine()
+				{
+					while (p != end && *p != '\n') p++;
+					if (p != end)
+					{
+						p++;
+						line++;
+					}
+				}
+
+				//the next character must be c, blanks around it are allowed
+				bool Expect(char c)
+				{
+					SkipBlanks();
+					if (p == end || *p != c) return false;
+					p++;
+					SkipBlanks();
+					return true;
+				}
+
+				bool ReadUnsigned(size_t& value)
+				{
+					SkipBlanks();
+					if (p == end || *p < '0' || *p > '9') return false;
+					size_t v = 0;
+					while (p != end && *p >= '0' && *p <= '9')
+					{
+						size_t digit = (size_t)(*p - '0');
+						if (v > ((size_t)-1 - digit) / 10) return false; //overflow
+						v = v * 10 + digit;
+						p++;
+					}
+					value = v;
+					return true;
+				}
+
+				bool ReadDouble(double& value)
+				{
+					SkipBlanks();
+					const char_t* start = p;
+					bool negative = false;
+					if (p != end && (*p == '-' || *p == '+'))
+					{
+						negative = *p == '-';
+						p++;
+					}
+					if (Word("NaN"))
+					{
+						value = std::numeric_limits<double>::quiet_NaN();
+						return true;
+					}
+					if (Word("Infinity"))
+					{
+						value = negative ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+						return true;
+					}
+					unsigned long long mantissa = 0;
+					int digits = 0, significant = 0, scale = 0;
+					bool exact = true;
+					for (; p != end && *p >= '0' && *p <= '9'; p++, digits++)
+						Accumulate(*p, mantissa, significant, exact, scale, false);
+					if (p != end && *p == '.')
+					{
+						p++;
+						for (; p != end && *p >= '0' && *p <= '9'; p++, digits++)
+							Accumulate(*p, mantissa, significant, exact, scale, true);
+					}
+					if (digits == 0) return false;
+					if (p != end && (*p == 'e' || *p == 'E'))
+					{
+						p++;
+						bool negativeExponent = false;
+						if (p != end && (*p == '-' || *p == '+'))
+						{
+							negativeExponent = *p == '-';
+							p++;
+						}
+						if (p == end || *p < '0' || *p > '9') return false;
+						int exponent = 0;
+						for (; p != end && *p >= '0' && *p <= '9'; p++)
+							if (exponent < 100000) exponent = exponent * 10 + (*p - '0');
+						scale += negativeExponent ? -exponent : exponent;
+					}
+					if (exact && mantissa <= MaxExactMantissa && scale >= -22 && scale <= 22)
+					{
+						double v = (double)mantissa;
+						v = scale < 0 ? v / PowersOfTen[-scale] : v * PowersOfTen[scale];
+						value = negative ? -v : v;
+						return true;
+					}
+					//too many digits or too large a scale to round correctly here, leave it to the runtime
+					std::string token;
+					token.reserve((size_t)(p - start));
+					for (const char_t* c = start; c != p; c++) token.push_back((char)*c);
+					value = strtod(token.c_str(), 0);
+					return true;
+				}
+
+			private:
+				const char_t* p;
+				const char_t* end;
+				size_t line;
+
+				//adds a digit to the mantissa while it fits, the digits after that make the value inexact
+				static void Accumulate(char_t c, unsigned long long& mantissa, int& significant, bool& exact, int& scale, bool fraction)
+				{
+					int digit = (int)(c - '0');
+					if (significant < 19)
+					{
+						if (significant > 0 || digit != 0) significant++;
+						mantissa = mantissa * 10 + (unsigned long long)digit;
+						if (fraction) scale--;
+					}
+					else
+					{
+						if (digit != 0) exact = false;
+						if (!fraction) scale++;
+					}
+				}
+
+				bool Word(const char* word)
+				{
+					const char_t* q = p;
+					for (; *word != 0; word++, q++)
+						if (q == end || *q != *word) return false;
+					p = q;
+					return true;
+				}
+			};
+
+			//bounds checked reads of the little endian binary format
+			class BinaryScanner
+			{
+			public:
+				BinaryScanner(const char* begin, size_t length) : p(begin), end(begin + length) {}
+				size_t Remaining() const { return (size_t)(end - p); }
+
+				bool Read(void* value, size_t size)
+				{
+					if (Remaining() < size) return false;
+					memcpy(value, p, size);
+					p += size;
+					return true;
+				}
+
+				bool ReadUInt32(unsigned int& value) { return Read(&value, sizeof(value)); }
+
+				bool Skip(size_t size)
+				{
+					if (Remaining() < size) return false;
+					p += size;
+					return true;
+				}
+
+			private:
+				const char* p;
+				const char* end;
+			};
+
+			//a read only view of a whole file
+			class XbimMappedFile
+			{
+			public:
+				const char* view;
+				size_t size;
+
+				XbimMappedFile() : view(0), size(0)
+				{
+#ifdef _WIN32
+					file = INVALID_HANDLE_VALUE;
+					mapping = 0;
+#else
+					file = -1;
+#endif
+				}
+
+				~XbimMappedFile()
+				{
+#ifdef _WIN32
+					if (view != 0) UnmapViewOfFile(view);
+					if (mapping != 0) CloseHandle(mapping);
+					if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+					if (view != 0) munmap((void*)view, size);
+					if (file != -1) close(file);
+#endif
+				}
+
+				bool Open(const std::string& path)
+				{
+					unsigned long long length;
+#ifdef _WIN32
+					file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, 0);
+					if (file == INVALID_HANDLE_VALUE) return false;
+					LARGE_INTEGER fileSize;
+					if (!GetFileSizeEx(file, &fileSize)) return false;
+					length = (unsigned long long)fileSize.QuadPart;
+#else
+					file = open(path.c_str(), O_RDONLY);
+					if (file == -1) return false;
+					struct stat status;
+					if (fstat(file, &status) != 0) return false;
+					length = (unsigned long long)status.st_size;
+#endif
+					if (length == 0) return true; //an empty file cannot be mapped
+					if (length != (size_t)length) return false; //too large for the address space of the process
+#ifdef _WIN32
+					mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+					if (mapping == 0) return false;
+					view = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+					if (view == 0) return false;
+#else
+					void* mapped = mmap(0, (size_t)length, PROT_READ, MAP_PRIVATE, file, 0);
+					if (mapped == MAP_FAILED) return false;
+					view = (const char*)mapped;
+					madvise(mapped, (size_t)length, MADV_SEQUENTIAL);
+#endif
+					size = (size_t)length;
+					return true;
+				}
+
+			private:
+#ifdef _WIN32
+				HANDLE file;
+				HANDLE mapping;
+#else
+				int file;
+#endif
+				XbimMappedFile(const XbimMappedFile&);
+				XbimMappedFile& operator=(const XbimMappedFile&);
+			};
+
+			//deletes the faces and meshes made while building a mesh set unless it is dismissed,
+			//the arena blocks they were taken from are freed with the last of them
+			class XbimMeshParts
+			{
+			public:
+				std::vector<face_t*> faces;
+				std::vector<mesh_t*> meshes;
+
+				XbimMeshParts() : dismissed(false) {}
+
+				~XbimMeshParts()
+				{
+					if (dismissed) return;
+					//a face is owned by the mesh made from it, the rest have not been taken by any mesh
+					std::vector<face_t*> owned;
+					for (size_t i = 0; i < meshes.size(); i++)
+						owned.insert(owned.end(), meshes[i]->faces.begin(), meshes[i]->faces.end());
+					std::sort(owned.begin(), owned.end());
+					for (size_t i = 0; i < meshes.size(); i++)
+						delete meshes[i];
+					for (size_t i = 0; i < faces.size(); i++)
+					{
+						if (!std::binary_search(owned.begin(), owned.end(), faces[i]))
+							delete faces[i];
+					}
+				}
+
+				void Dismiss() { dismissed = true; }
+
+			private:
+				bool dismissed;
+				XbimMeshParts(const XbimMeshParts&);
+				XbimMeshParts& operator=(const XbimMeshParts&);
+			};
+
+			//reads a corner of a triangle, the index of its vertex, optionally followed by /the index of its normal, which is not used
+			template<typename char_t>
+			bool ReadCorner(TextScanner<char_t>& scanner, size_t& vertex)
+			{
+				size_t normal;
+				return scanner.ReadUnsigned(vertex) && (scanner.Peek() != '/' || (scanner.Expect('/') && scanner.ReadUnsigned(normal)));
+			}
+
+			//a reservation for count items read from data of the given length, a count larger than the data could hold is not trusted
+			size_t Reservation(size_t count, size_t length, size_t minimumItemSize)
+			{
+				size_t most = length / minimumItemSize;
+				return count < most ? count : most;
+			}
+		}
+
+		XbimFacetReader::XbimFacetReader() : _ignoredLines(0), _degenerateTriangles(0)
+		{
+		}
+
+		meshset_t* XbimFacetReader::Read(const char* data, size_t length)
+		{
+			if (length >= sizeof(Magic) && memcmp(data, Magic, sizeof(Magic)) == 0)
+				return ReadBinary(data, length);
+			return ReadText(data, length);
+		}
+
+		meshset_t* XbimFacetReader::ReadText(const char* data, size_t length)
+		{
+			return Parse(data, data + length);
+		}
+
+		meshset_t* XbimFacetReader::ReadText(const wchar_t* data, size_t length)
+		{
+			return Parse(data, data + length);
+		}
+
+		meshset_t* XbimFacetReader::ReadFile(const std::string& path)
+		{
+			XbimMappedFile file;
+			if (!file.Open(path))
+			{
+				_error = "The file '" + path + "' could not be opened";
+				return 0;
+			}
+			return Read(file.view, file.size);
+		}
+
+		template<typename char_t>
+		meshset_t* XbimFacetReader::Parse(const char_t* begin, const char_t* end)
+		{
+			_error.clear();
+			_ignoredLines = 0;
+			_degenerateTriangles = 0;
+			size_t length = (size_t)(end - begin);
+			std::vector<vertex_t> vertices;
+			std::vector<size_t> triangles;
+			TextScanner<char_t> scanner(begin, end);
+			for (; !scanner.AtEnd(); scanner.NextLine())
+			{
+				scanner.SkipBlanks();
+				if (scanner.AtLineEnd()) continue; //skip blank lines
+				char_t cmd = scanner.Peek();
+				scanner.Skip();
+				if (cmd >= 'a' && cmd <= 'z') cmd = (char_t)(cmd - 'a' + 'A');
+				bool valid = true;
+				if (cmd == 'T')
+				{
+					for (scanner.SkipBlanks(); valid && !scanner.AtLineEnd(); scanner.SkipBlanks())
+					{
+						//planar faces give the normal of their first corner only, curved faces give one with every corner
+						size_t a, b, c;
+						valid = ReadCorner(scanner, a) && scanner.Expect(',') && ReadCorner(scanner, b) && scanner.Expect(',') && ReadCorner(scanner, c);
+						if (valid)
+						{
+							triangles.push_back(a);
+							triangles.push_back(b);
+							triangles.push_back(c);
+						}
+					}
+				}
+				else if (cmd == 'V')
+				{
+					for (scanner.SkipBlanks(); valid && !scanner.AtLineEnd(); scanner.SkipBlanks())
+					{
+						double x, y, z;
+						valid = scanner.ReadDouble(x) && scanner.Expect(',') && scanner.ReadDouble(y) && scanner.Expect(',') && scanner.ReadDouble(z);
+						if (valid) vertices.push_back(vertex_t(carve::geom::VECTOR(x, y, z)));
+					}
+				}
+				else if (cmd == 'P') //initialise the polyData
+				{
+					size_t version, vCount, fCount, tCount, nCount;
+					valid = scanner.ReadUnsigned(version) && scanner.ReadUnsigned(vCount) && scanner.ReadUnsigned(fCount) &&
+						scanner.ReadUnsigned(tCount) && scanner.ReadUnsigned(nCount);
+					if (valid)
+					{
+						vertices.reserve(Reservation(vCount, length, 6)); //"0,0,0 "
+						triangles.reserve(3 * Reservation(tCount, length, 6)); //"0,0,0 "
+					}
+				}
+				else if (cmd == 'N' || cmd == 'F')
+				{
+					//the normals and face data are not used
+				}
+				else
+					_ignoredLines++;
+				if (!valid)
+				{
+					std::ostringstream message;
+					message << "Illegal format in line " << scanner.Line() << " of the triangulation";
+					_error = message.str();
+					return 0;
+				}
+			}
+			return Build(vertices, triangles);
+		}
+
+		meshset_t* XbimFacetReader::ReadBinary(const char* data, size_t length)
+		{
+			_error.clear();
+			_ignoredLines = 0;
+			_degenerateTriangles = 0;
+			BinaryScanner scanner(data, length);
+			unsigned int version, vCount, fCount, tCount, nCount;
+			if (!scanner.Skip(sizeof(Magic)) || !scanner.ReadUInt32(version) || !scanner.ReadUInt32(vCount) || !scanner.ReadUInt32(fCount) ||
+				!scanner.ReadUInt32(tCount) || !scanner.ReadUInt32(nCount))
+			{
+				_error = "The binary triangulation header is incomplete";
+				return 0;
+			}
+			if (version != Version)
+			{
+				std::ostringstream message;
+				message << "Binary triangulation version " << version << " is not supported";
+				_error = message.str();
+				return 0;
+			}
+			//the counts are checked against the remaining length before anything is allocated
+			if ((unsigned long long)vCount * 24 + (unsigned long long)nCount * 24 + (unsigned long long)fCount * 8 + (unsigned long long)tCount * 12 > scanner.Remaining())
+			{
+				_error = "The binary triangulation is shorter than its header declares";
+				return 0;
+			}
+			std::vector<vertex_t> vertices;
+			vertices.reserve(vCount);
+			for (unsigned int i = 0; i < vCount; i++)
+			{
+				double xyz[3];
+				scanner.Read(xyz, sizeof(xyz));
+				vertices.push_back(vertex_t(carve::geom::VECTOR(xyz[0], xyz[1], xyz[2])));
+			}
+			scanner.Skip((size_t)nCount * 24); //the normals are not used
+			std::vector<size_t> triangles;
+			triangles.reserve(3 * (size_t)tCount);
+			size_t read = 0;
+			for (unsigned int f = 0; f < fCount; f++)
+			{
+				unsigned int normalIndex, count;
+				if (!scanner.ReadUInt32(normalIndex) || !scanner.ReadUInt32(count) || (unsigned long long)read + count > tCount)
+				{
+					_error = "The faces of the binary triangulation do not match its header";
+					return 0;
+				}
+				for (unsigned int t = 0; t < 3 * count; t++)
+				{
+					unsigned int index;
+					scanner.ReadUInt32(index);
+					triangles.push_back(index);
+				}
+				read += count;
+			}
+			return Build(vertices, triangles);
+		}
+
+		meshset_t* XbimFacetReader::Build(std::vector<vertex_t>& vertices, const std::vector<size_t>& triangles)
+		{
+			size_t vCount = vertices.size();
+			for (size_t i = 0; i < triangles.size(); i++)
+			{
+				if (triangles[i] >= vCount)
+				{
+					std::ostringstream message;
+					message << "Triangle " << i / 3 << " refers to vertex " << triangles[i] << " of " << vCount;
+					_error = message.str();
+					return 0;
+				}
+			}
+			//the vertices do not move from here on, the meshset takes over their storage
+			vertex_t* v = vertices.empty() ? 0 : &vertices[0];
+			try
+			{
+				carve::mesh::Arena::Scope arena; //the faces and edges are taken from a few blocks, they are freed with the last of them
+				XbimMeshParts parts; //if the mesh cannot be made, what was made of it is deleted
+				std::vector<face_t*>& faces = parts.faces;
+				faces.reserve(triangles.size() / 3);
+				for (size_t i = 0; i + 2 < triangles.size(); i += 3)
+				{
+					size_t a = triangles[i], b = triangles[i + 1], c = triangles[i + 2];
+					if (a == b || b == c || c == a) //a triangle with a repeated corner has no edges for the mesh to join, it is counted and skipped
+					{
+						_degenerateTriangles++;
+						continue;
+					}
+					faces.push_back(new face_t(&v[a], &v[b], &v[c]));
+				}
+				mesh_t::create(faces.begin(), faces.end(), parts.meshes, carve::mesh::MeshOptions());
+				meshset_t* meshSet = new meshset_t(vertices, parts.meshes);
+				parts.Dismiss();
+				return meshSet;
+			}
+			catch (carve::exception& e)
+			{
+				_error = e.str();
+			}
+			catch (std::exception& e)
+			{
+				_error = e.what();
+			}
+			return 0;
+		}
+	}
+}
+#endif // USE_CARVE_CSG
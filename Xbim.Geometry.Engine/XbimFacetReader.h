@@ -0,0 +1,48 @@
+#pragma once
+#ifdef USE_CARVE_CSG
+#include "CarveDeclarations.h"
+#include <string>
+#include <cstddef>
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		//Native reader of faceted triangulation streams, the text P/V/N/T format of XbimFacetedSolid::WriteTriangulation(TextWriter^)
+		//and its binary twin written by XbimFacetedSolid::WriteFacets, parsed in place from a buffer or a memory mapped file
+		//Numbers are scanned by hand, the vertices go straight in to the vertex storage of the meshset and the triangles are held as
+		//indices until all have been read, then a face is made of each in one pass and the faces are joined in to meshes
+		//This header does not include the platform headers so managed code can use it
+		class XbimFacetReader
+		{
+		public:
+			//the first bytes of the binary format, text streams start with a command letter
+			static const char Magic[4];
+			static const unsigned int Version = 1;
+			XbimFacetReader();
+			//reads text or binary, told apart by Magic, returns a new meshset or NULL if the data is malformed
+			meshset_t* Read(const char* data, size_t length);
+			meshset_t* ReadText(const char* data, size_t length);
+			meshset_t* ReadText(const wchar_t* data, size_t length);
+			meshset_t* ReadBinary(const char* data, size_t length);
+			//maps the file and reads it
+			meshset_t* ReadFile(const std::string& path);
+			//why the last read failed
+			const std::string& Error() const { return _error; }
+			//the number of lines of the last text read with a command that is not part of the format, they are skipped
+			size_t IgnoredLines() const { return _ignoredLines; }
+			//the number of triangles of the last read with a repeated vertex, they are left out of the mesh
+			size_t DegenerateTriangles() const { return _degenerateTriangles; }
+		private:
+			std::string _error;
+			size_t _ignoredLines;
+			size_t _degenerateTriangles;
+
+			template<typename char_t> meshset_t* Parse(const char_t* begin, const char_t* end);
+			meshset_t* Build(std::vector<vertex_t>& vertices, const std::vector<size_t>& triangles);
+			XbimFacetReader(const XbimFacetReader&);
+			XbimFacetReader& operator=(const XbimFacetReader&);
+		};
+	}
+}
+#endif // USE_CARVE_CSG
@@ -3,6 +3,8 @@
 #include "XbimFacetedSolid.h"
 #include "XbimWireSet.h"
 #include "XbimPoint3DWithTolerance.h"
+#include "XbimVertexWelder.h"
+#include "XbimBoxClusterer.h"
 #include "XbimGeometryCreator.h"
 #include "XbimVertexSet.h"
 #include "XbimEdgeSet.h"
@@ -12,6 +14,8 @@
 #include "XbimPolygonalFace.h"
 #include "XbimLinearEdge.h"
 #include "XbimSolidSet.h"
+#include "XbimWorkStealingPool.h"
+#include "XbimFacetReader.h"
 
 #pragma region Occ headers
 #include <BRepMesh_IncrementalMesh.hxx>
@@ -41,6 +45,16 @@ namespace Xbim
 {
 	namespace Geometry
 	{
+		static void CsgParallelFor(size_t count, void(*body)(void* context, size_t index), void* context)
+		{
+			XbimWorkStealingPool::Default().ParallelFor(count, body, context);
+		}
+
+		void XbimFacetedSolid::UseWorkStealingPool()
+		{
+			carve::csg::CSG::parallel_for = CsgParallelFor;
+		}
+
 		/*Ensures native pointers are deleted and garbage collected*/
 		void XbimFacetedSolid::InstanceCleanup()
 		{
@@ -237,7 +251,7 @@ namespace Xbim
 			std::vector<vertex_t> vertices;
 			vertices.reserve(solid->Vertices->Count); //good for all faceted objects will need to grow further where curved surfaces are converted to facetations
 
-			Dictionary<XbimPoint3DWithTolerance^, size_t>^ pointMap = gcnew Dictionary<XbimPoint3DWithTolerance^, size_t>();
+			XbimVertexWelder pointMap(tolerance, solid->Vertices->Count);
 			//Create a list to hold the face loops for each face, loops are indexes in to the vertex list
 			std::vector<std::vector<size_t>> faceLoops;
 
@@ -247,14 +261,9 @@ namespace Xbim
 				for each (XbimEdge^ edge in face->OuterBound->Edges)
 				{
 					gp_Pnt p = edge->IsReversed ? BRep_Tool::Pnt(TopExp::LastVertex(edge, Standard_False)) : BRep_Tool::Pnt(TopExp::FirstVertex(edge, Standard_False));
-					size_t index;
-					XbimPoint3DWithTolerance^ pt = gcnew XbimPoint3DWithTolerance(p.X(), p.Y(), p.Z(), tolerance);
-					if (!pointMap->TryGetValue(pt, index))
-					{
-						index = vertices.size();
-						pointMap->Add(pt, index);
-						vertices.push_back(carve::geom::VECTOR(pt->X, pt->Y, pt->Z));
-					}
+					size_t index = pointMap.Weld(p.X(), p.Y(), p.Z());
+					if (index == vertices.size()) //it is a new vertex
+						vertices.push_back(carve::geom::VECTOR(p.X(), p.Y(), p.Z()));
 					if (std::find(faceLoop.begin(), faceLoop.end(), index) == faceLoop.end()) //skip any point we have just added
 						faceLoop.push_back(index);
 
@@ -299,14 +308,9 @@ namespace Xbim
 							{
 								gp_Pnt p = edge->IsReversed ? BRep_Tool::Pnt(TopExp::LastVertex(edge, Standard_False)) : BRep_Tool::Pnt(TopExp::FirstVertex(edge, Standard_False));
 
-								size_t index;
-								XbimPoint3DWithTolerance^ pt = gcnew XbimPoint3DWithTolerance(p.X(), p.Y(), p.Z(), tolerance);
-								if (!pointMap->TryGetValue(pt, index))
-								{
-									index = vertices.size();
-									pointMap->Add(pt, index);
-									vertices.push_back(carve::geom::VECTOR(pt->X, pt->Y, pt->Z));
-								}
+								size_t index = pointMap.Weld(p.X(), p.Y(), p.Z());
+								if (index == vertices.size()) //it is a new vertex
+									vertices.push_back(carve::geom::VECTOR(p.X(), p.Y(), p.Z()));
 
 								if (std::find(holeLoop.begin(), holeLoop.end(), index) == holeLoop.end())
 								{
@@ -372,7 +376,7 @@ namespace Xbim
 			std::vector<vertex_t> vertices;
 			vertices.reserve(solid->Vertices->Count); //good for all faceted objects will need to grow further where curved surfaces are converted to facetations
 
-			Dictionary<XbimPoint3DWithTolerance^, size_t>^ pointMap = gcnew Dictionary<XbimPoint3DWithTolerance^, size_t>();
+			XbimVertexWelder pointMap(tolerance, solid->Vertices->Count);
 			//Create a list to hold the face loops for each face, loops are indexes in to the vertex list
 			std::vector<std::vector<size_t>> faceLoops;
 
@@ -404,14 +408,9 @@ namespace Xbim
 						{
 							gp_XYZ p = nodes.Value(edgeMesh->Nodes().Value(i)).XYZ();
 							loc.Transformation().Transforms(p);
-							size_t index;
-							XbimPoint3DWithTolerance^ pt = gcnew XbimPoint3DWithTolerance(p.X(), p.Y(), p.Z(), tolerance);
-							if (!pointMap->TryGetValue(pt, index))
-							{
-								index = vertices.size();
-								pointMap->Add(pt, index);
-								vertices.push_back(carve::geom::VECTOR(pt->X, pt->Y, pt->Z));
-							}
+							size_t index = pointMap.Weld(p.X(), p.Y(), p.Z());
+							if (index == vertices.size()) //it is a new vertex
+								vertices.push_back(carve::geom::VECTOR(p.X(), p.Y(), p.Z()));
 							if (std::find(faceLoop.begin(), faceLoop.end(), index)==faceLoop.end()) //skip any point we have just added
 								faceLoop.push_back(index);
 							/*else
@@ -465,14 +464,9 @@ namespace Xbim
 									{
 										gp_XYZ p = nodes.Value(edgeMesh->Nodes().Value(i)).XYZ();
 										loc.Transformation().Transforms(p);
-										size_t index;
-										XbimPoint3DWithTolerance^ pt = gcnew XbimPoint3DWithTolerance(p.X(), p.Y(), p.Z(), tolerance);
-										if (!pointMap->TryGetValue(pt, index))
-										{
-											index = vertices.size();
-											pointMap->Add(pt, index);
-											vertices.push_back(carve::geom::VECTOR(pt->X, pt->Y, pt->Z));
-										}
+										size_t index = pointMap.Weld(p.X(), p.Y(), p.Z());
+										if (index == vertices.size()) //it is a new vertex
+											vertices.push_back(carve::geom::VECTOR(p.X(), p.Y(), p.Z()));
 
 										if (std::find(holeLoop.begin(), holeLoop.end(), index) == holeLoop.end())
 										{
@@ -518,14 +512,9 @@ namespace Xbim
 						{
 							gp_XYZ p = nodes.Value(t[j]).XYZ();
 							loc.Transformation().Transforms(p);
-							size_t index;
-							XbimPoint3DWithTolerance^ pt = gcnew XbimPoint3DWithTolerance(p.X(), p.Y(), p.Z(), tolerance);
-							if (!pointMap->TryGetValue(pt, index))
-							{
-								index = vertices.size();
-								pointMap->Add(pt, index);
-								vertices.push_back(carve::geom::VECTOR(pt->X, pt->Y, pt->Z));
-							}
+							size_t index = pointMap.Weld(p.X(), p.Y(), p.Z());
+							if (index == vertices.size()) //it is a new vertex
+								vertices.push_back(carve::geom::VECTOR(p.X(), p.Y(), p.Z()));
 							if (std::find(faceLoop.begin(), faceLoop.end(), index) == faceLoop.end())
 								faceLoop.push_back(index);
 						}
@@ -787,34 +776,97 @@ namespace Xbim
 			String^ err = "";
 			try
 			{
+				carve::mesh::Arena::Scope arena; //the edges, faces and meshes of the operation are pooled, the pool is freed with the last of them
 				carve::csg::CSG csg(tolerance);
+				csg.exact_predicates = XbimGeometryCreator::ExactCarvePredicates;
 				meshset_t* cut = csg.compute(this, cuttingObject, carve::csg::CSG::A_MINUS_B, NULL, carve::csg::CSG::CLASSIFY_NORMAL);
 				GC::KeepAlive(this);
 				GC::KeepAlive(cuttingObject);
-				if (cut != nullptr)
-				{
-					size_t tally = cut->meshes.size();
-					if (tally == 1) return gcnew XbimSolidSet(gcnew XbimFacetedSolid(cut));
-					XbimSolidSet^ result = gcnew XbimSolidSet();
+				if (cut != nullptr) return ToSolidSet(cut);
+			}
+			catch (carve::exception ce)
+			{
+				err = gcnew String(ce.str().c_str());
+			}
+			catch (System::Runtime::InteropServices::SEHException^ ex) //these should never happen, raise an error
+			{
+				err = ex->Message;
+			}
+			catch (...)
+			{
+				err = "Unexpected Error";
+			}
+			XbimGeometryCreator::logger->WarnFormat("WF002: Boolean Union operation failed. " + err);
+			return XbimSolidSet::Empty;
+		}
 
-					for (int i = tally - 1; i >= 0; i--)
+		IXbimSolidSet^ XbimFacetedSolid::CutAll(IXbimSolidSet^ tools, double tolerance)
+		{
+			if (!IsValid) return XbimSolidSet::Empty;
+			std::vector<meshset_t*> toolMeshes;
+			for each (IXbimSolid^ tool in tools)
+			{
+				XbimFacetedSolid^ facetedTool = dynamic_cast<XbimFacetedSolid^>(tool);
+				if (facetedTool != nullptr && facetedTool->IsValid)
+					toolMeshes.push_back((meshset_t*)facetedTool);
+			}
+			if (toolMeshes.size() == 0) return gcnew XbimSolidSet(this);
+			String^ err = "";
+			try
+			{
+				carve::mesh::Arena::Scope arena;
+				carve::csg::CSG csg(tolerance);
+				csg.exact_predicates = XbimGeometryCreator::ExactCarvePredicates;
+				meshset_t* cut = csg.subtract(this, toolMeshes, carve::csg::CSG::CLASSIFY_NORMAL);
+				GC::KeepAlive(this);
+				GC::KeepAlive(tools);
+				if (cut != nullptr) return ToSolidSet(cut);
+			}
+			catch (carve::exception ce)
+			{
+				err = gcnew String(ce.str().c_str());
+			}
+			catch (System::Runtime::InteropServices::SEHException^ ex) //these should never happen, raise an error
+			{
+				err = ex->Message;
+			}
+			catch (...)
+			{
+				err = "Unexpected Error";
+			}
+			XbimGeometryCreator::logger->WarnFormat("WF009: Boolean Cut operation failed. " + err);
+			return XbimSolidSet::Empty;
+		}
+
+		bool XbimFacetedSolid::Classify(XbimFacetedSolid^ other, double tolerance, array<XbimFaceContainment>^% faces, List<List<XbimPoint3D>^>^% intersections)
+		{
+			faces = nullptr;
+			intersections = nullptr;
+			if (!IsValid || other == nullptr || !other->IsValid) return false;
+			String^ err = "";
+			try
+			{
+				carve::csg::CSG csg(tolerance);
+				csg.exact_predicates = XbimGeometryCreator::ExactCarvePredicates;
+				carve::csg::CSG::ClassifyResult result;
+				csg.classify(this, other, result, carve::csg::CSG::CLASSIFY_NORMAL);
+				GC::KeepAlive(this);
+				GC::KeepAlive(other);
+				faces = gcnew array<XbimFaceContainment>((int)result.a_faces.size());
+				for (int i = 0; i < faces->Length; i++)
+					faces[i] = (XbimFaceContainment)result.a_faces[i];
+				intersections = gcnew List<List<XbimPoint3D>^>((int)result.polylines.size());
+				for (size_t i = 0; i < result.polylines.size(); i++)
+				{
+					List<XbimPoint3D>^ polyline = gcnew List<XbimPoint3D>((int)result.polylines[i].size());
+					for (size_t j = 0; j < result.polylines[i].size(); j++)
 					{
-						mesh_t* m = cut->meshes.back();
-						cut->meshes.pop_back();
-						m->meshset = nullptr;
-						if (m->isClosed()) //it is a manifold solid
-						{
-							std::vector<mesh_t *> mesh;
-							mesh.push_back(m);
-							meshset_t* mSet = new meshset_t(mesh);
-							result->Add(gcnew XbimFacetedSolid(mSet));
-						}
-					    else
-							delete m; //throw away non manifolds
+						const carve::geom3d::Vector& p = result.polylines[i][j];
+						polyline->Add(XbimPoint3D(p.x, p.y, p.z));
 					}
-					delete cut;
-					return result;
+					intersections->Add(polyline);
 				}
+				return true;
 			}
 			catch (carve::exception ce)
 			{
@@ -828,8 +880,34 @@ namespace Xbim
 			{
 				err = "Unexpected Error";
 			}
-			XbimGeometryCreator::logger->WarnFormat("WF002: Boolean Union operation failed. " + err);
-			return XbimSolidSet::Empty;
+			XbimGeometryCreator::logger->WarnFormat("WF016: Faceted solid classification failed. " + err);
+			faces = nullptr;
+			return false;
+		}
+
+		IXbimSolidSet^ XbimFacetedSolid::ToSolidSet(meshset_t* result)
+		{
+			size_t tally = result->meshes.size();
+			if (tally == 1) return gcnew XbimSolidSet(gcnew XbimFacetedSolid(result));
+			XbimSolidSet^ solids = gcnew XbimSolidSet();
+
+			for (int i = tally - 1; i >= 0; i--)
+			{
+				mesh_t* m = result->meshes.back();
+				result->meshes.pop_back();
+				m->meshset = nullptr;
+				if (m->isClosed()) //it is a manifold solid
+				{
+					std::vector<mesh_t *> mesh;
+					mesh.push_back(m);
+					meshset_t* mSet = new meshset_t(mesh);
+					solids->Add(gcnew XbimFacetedSolid(mSet));
+				}
+				else
+					delete m; //throw away non manifolds
+			}
+			delete result;
+			return solids;
 		}
 
 		IXbimSolidSet^ XbimFacetedSolid::Intersection(IXbimSolidSet^ toIntersect, double tolerance)
@@ -878,7 +956,9 @@ namespace Xbim
 			String^ err = "";
 			try
 			{
+				carve::mesh::Arena::Scope arena;
 				carve::csg::CSG csg(tolerance);
+				csg.exact_predicates = XbimGeometryCreator::ExactCarvePredicates;
 				meshset_t* intersected = csg.compute(this, intersectObject, carve::csg::CSG::INTERSECTION, NULL, carve::csg::CSG::CLASSIFY_NORMAL);
 				GC::KeepAlive(this);
 				GC::KeepAlive(intersectObject);
@@ -969,7 +1049,9 @@ namespace Xbim
 			String^ err = "";
 			try
 			{
+				carve::mesh::Arena::Scope arena;
 				carve::csg::CSG csg(tolerance);
+				csg.exact_predicates = XbimGeometryCreator::ExactCarvePredicates;
 				meshset_t* united = csg.compute(this, unionObject, carve::csg::CSG::UNION, NULL, carve::csg::CSG::CLASSIFY_NORMAL);
 				GC::KeepAlive(this);
 				GC::KeepAlive(unionObject);
@@ -1025,7 +1107,9 @@ namespace Xbim
 			String^ err = "";
 			try
 			{
+				carve::mesh::Arena::Scope arena;
 				carve::csg::CSG csg(tolerance);
+				csg.exact_predicates = XbimGeometryCreator::ExactCarvePredicates;
 				meshset_t* intersected = csg.compute(this, sectionFace, carve::csg::CSG::INTERSECTION, NULL, carve::csg::CSG::CLASSIFY_NORMAL);
 				GC::KeepAlive(this);
 				GC::KeepAlive(sectionFace);
@@ -1105,33 +1189,18 @@ namespace Xbim
 			return nullptr;
 		}
 
-		void XbimFacetedSolid::WriteTriangulation(TextWriter^ tw, double tolerance, double deflection, double angle)
+		//triangulates the valid faces of the mesh set and welds their normals, shared by the text and binary writers of the triangulation
+		//tCount is increased by the number of triangles
+		static void TriangulateFaces(meshset_t* pMSet, double tolerance, XbimVertexWelder& normalMap, std::vector<size_t>& normalIndices,
+			std::vector<std::vector<carve::triangulate::tri_idx>>& triangulation, int& tCount)
 		{
-			if (!IsValid) return;
-			meshset_t* pMSet = (meshset_t*)this;
-			int vCount = pMSet->vertex_storage.size();
-			int fCount = 0, tCount = 0, nCount = 0;
-			for (meshset_t::face_iter i = pMSet->faceBegin(), e = pMSet->faceEnd(); i != e; ++i) fCount++;
-
-			Dictionary<XbimPoint3DWithTolerance^, size_t>^ normalMap = gcnew Dictionary<XbimPoint3DWithTolerance^, size_t>();
-			List<XbimVector3D>^ normals = gcnew List <XbimVector3D>(fCount);
-			List<size_t>^ normalIndices = gcnew List <size_t>(fCount);
-			std::vector<std::vector<carve::triangulate::tri_idx>> triangulation;
 			for (meshset_t::face_iter i = pMSet->faceBegin(), e = pMSet->faceEnd(); i != e; ++i)
 			{
 
 				face_t *face = *i;
 				vector_t n = face->plane.N.normalized();
 				if (face->nVertices() < 3 || Double::IsNaN(n.x)) continue;//skip invalid faces	
-				XbimPoint3DWithTolerance^ p3d = gcnew XbimPoint3DWithTolerance(Math::Round(n.x, 4), Math::Round(n.y, 4), Math::Round(n.z, 4), tolerance);
-				size_t index;
-				if (!normalMap->TryGetValue(p3d, index))
-				{
-					index = normals->Count;
-					normalMap->Add(p3d, index);
-					normals->Add(XbimVector3D(p3d->X, p3d->Y, p3d->Z));
-				}
-				normalIndices->Add(index);
+				normalIndices.push_back(normalMap.Weld(Math::Round(n.x, 4), Math::Round(n.y, 4), Math::Round(n.z, 4)));
 				std::vector<carve::mesh::MeshSet<3>::vertex_t *> verts;
 				face->getVertices(verts);
 				triangulation.push_back(std::vector<carve::triangulate::tri_idx>());
@@ -1164,7 +1233,22 @@ namespace Xbim
 					tCount++;
 				}
 			}
-			nCount = normals->Count;
+		}
+
+		void XbimFacetedSolid::WriteTriangulation(TextWriter^ tw, double tolerance, double deflection, double angle)
+		{
+			if (!IsValid) return;
+			meshset_t* pMSet = (meshset_t*)this;
+			int vCount = pMSet->vertex_storage.size();
+			int fCount = 0, tCount = 0, nCount = 0;
+			for (meshset_t::face_iter i = pMSet->faceBegin(), e = pMSet->faceEnd(); i != e; ++i) fCount++;
+
+			XbimVertexWelder normalMap(tolerance, fCount);
+			std::vector<size_t> normalIndices;
+			normalIndices.reserve(fCount);
+			std::vector<std::vector<carve::triangulate::tri_idx>> triangulation;
+			TriangulateFaces(pMSet, tolerance, normalMap, normalIndices, triangulation, tCount);
+			nCount = (int)normalMap.Count();
 			// Write out header
 			tw->WriteLine(String::Format("P {0} {1} {2} {3} {4}", 1, vCount, fCount, tCount, nCount));
 			//write out vertices and normals  
@@ -1176,7 +1260,11 @@ namespace Xbim
 			}
 			tw->WriteLine();
 			tw->Write("N");
-			for each (XbimVector3D n in normals) tw->Write(String::Format(" {0},{1},{2}", n.X, n.Y, n.Z));
+			for (size_t i = 0; i < normalMap.Count(); i++)
+			{
+				const double* n = normalMap.Point(i);
+				tw->Write(String::Format(" {0},{1},{2}", n[0], n[1], n[2]));
+			}
 			tw->WriteLine();
 			//write out the triangulated faces
 			int faceIndex = 0;
@@ -1282,7 +1370,126 @@ namespace Xbim
 			binaryWriter->Write((UInt32)tCount); //number of triangles
 			binaryWriter->Seek((int)fPos, SeekOrigin::Begin);
 			binaryWriter->Write((Int32)fCount);
-			binaryWriter->Seek((int)cPos, SeekOrigin::Current); //reset position
+			binaryWriter->Seek((int)cPos, SeekOrigin::Begin); //reset position
+		}
+
+		array<XbimFacetedSolid^>^ XbimFacetedSolid::LevelsOfDetail(array<double>^ maxErrors, double tolerance)
+		{
+			if (maxErrors == nullptr) return gcnew array<XbimFacetedSolid^>(0);
+			array<XbimFacetedSolid^>^ levels = gcnew array<XbimFacetedSolid^>(maxErrors->Length);
+			if (!IsValid || maxErrors->Length == 0) return levels;
+			meshset_t* pMSet = (meshset_t*)this;
+			//the decimation works on triangles, so make a mesh of the triangles of the faces
+			int fCount = 0, tCount = 0;
+			for (meshset_t::face_iter i = pMSet->faceBegin(), e = pMSet->faceEnd(); i != e; ++i) fCount++;
+			XbimVertexWelder normalMap(tolerance, fCount);
+			std::vector<size_t> normalIndices;
+			std::vector<std::vector<carve::triangulate::tri_idx>> triangulation;
+			TriangulateFaces(pMSet, tolerance, normalMap, normalIndices, triangulation, tCount);
+			std::vector<carve::geom3d::Vector> points;
+			points.reserve(pMSet->vertex_storage.size());
+			for (std::vector<meshset_t::vertex_t>::const_iterator i = pMSet->vertex_storage.begin(); i != pMSet->vertex_storage.end(); ++i)
+				points.push_back(i->v);
+			std::vector<int> indices;
+			indices.reserve(tCount * 4);
+			for (size_t f = 0; f < triangulation.size(); f++)
+			{
+				for (std::vector<carve::triangulate::tri_idx>::const_iterator t = triangulation[f].begin(); t != triangulation[f].end(); ++t)
+				{
+					indices.push_back(3);
+					indices.push_back((int)t->a);
+					indices.push_back((int)t->b);
+					indices.push_back((int)t->c);
+				}
+			}
+			GC::KeepAlive(this);
+			meshset_t* triangles = new meshset_t(points, tCount, indices);
+			std::vector<double> bounds(maxErrors->Length);
+			for (int i = 0; i < maxErrors->Length; i++) bounds[i] = maxErrors[i];
+			std::vector<meshset_t*> lods;
+			lods.reserve(bounds.size());
+			try
+			{
+				carve::mesh::MeshSimplifier().decimate(triangles, bounds, lods);
+			}
+			catch (carve::exception ce)
+			{
+				XbimGeometryCreator::logger->WarnFormat("WF017: Faceted solid decimation failed. " + gcnew String(ce.str().c_str()));
+			}
+			delete triangles;
+			for (size_t i = 0; i < lods.size(); i++)
+				levels[(int)i] = gcnew XbimFacetedSolid(lods[i]);
+			return levels;
+		}
+
+		void XbimFacetedSolid::WriteTriangulation(BinaryWriter^ binaryWriter, double tolerance, double deflection, double angle, array<double>^ lodErrors)
+		{
+			if (!IsValid) return;
+			WriteTriangulation(binaryWriter, tolerance, deflection, angle);
+			array<XbimFacetedSolid^>^ levels = LevelsOfDetail(lodErrors, tolerance);
+			int lodCount = 0;
+			for (int i = 0; i < levels->Length; i++)
+				if (levels[i] != nullptr && levels[i]->IsValid) lodCount++;
+			binaryWriter->Write((UInt32)lodCount);
+			for (int i = 0; i < levels->Length; i++)
+			{
+				XbimFacetedSolid^ level = levels[i];
+				if (level == nullptr || !level->IsValid) continue;
+				//fewer faces means fewer normals to write, the same angle as ReadTriangulation
+				level->MergeCoPlanarFaces(0.4 * Math::PI / 180.0);
+				binaryWriter->Write(lodErrors[i]);
+				level->WriteTriangulation(binaryWriter, tolerance, deflection, angle);
+				delete level;
+			}
+		}
+
+		void XbimFacetedSolid::WriteFacets(BinaryWriter^ binaryWriter, double tolerance)
+		{
+			if (!IsValid) return;
+			meshset_t* pMSet = (meshset_t*)this;
+			int fCount = 0, tCount = 0;
+			for (meshset_t::face_iter i = pMSet->faceBegin(), e = pMSet->faceEnd(); i != e; ++i) fCount++;
+
+			XbimVertexWelder normalMap(tolerance, fCount);
+			std::vector<size_t> normalIndices;
+			normalIndices.reserve(fCount);
+			std::vector<std::vector<carve::triangulate::tri_idx>> triangulation;
+			TriangulateFaces(pMSet, tolerance, normalMap, normalIndices, triangulation, tCount);
+			// Write out header, the counts are those of the records that follow, BinaryWriter is always little endian
+			for (size_t i = 0; i < sizeof(XbimFacetReader::Magic); i++)
+				binaryWriter->Write((unsigned char)XbimFacetReader::Magic[i]);
+			binaryWriter->Write((UInt32)XbimFacetReader::Version);
+			binaryWriter->Write((UInt32)pMSet->vertex_storage.size());
+			binaryWriter->Write((UInt32)triangulation.size());
+			binaryWriter->Write((UInt32)tCount);
+			binaryWriter->Write((UInt32)normalMap.Count());
+			//write out vertices and normals at full precision
+			for (std::vector<meshset_t::vertex_t>::const_iterator i = pMSet->vertex_storage.begin(); i != pMSet->vertex_storage.end(); ++i)
+			{
+				binaryWriter->Write(i->v.x);
+				binaryWriter->Write(i->v.y);
+				binaryWriter->Write(i->v.z);
+			}
+			for (size_t i = 0; i < normalMap.Count(); i++)
+			{
+				const double* n = normalMap.Point(i);
+				binaryWriter->Write(n[0]);
+				binaryWriter->Write(n[1]);
+				binaryWriter->Write(n[2]);
+			}
+			//write out the triangulated faces
+			for (size_t f = 0; f < triangulation.size(); f++)
+			{
+				const std::vector<carve::triangulate::tri_idx>& triangles = triangulation[f];
+				binaryWriter->Write((UInt32)normalIndices[f]);
+				binaryWriter->Write((UInt32)triangles.size());
+				for (std::vector<carve::triangulate::tri_idx>::const_iterator triangleIt = triangles.begin(); triangleIt != triangles.end(); ++triangleIt)
+				{
+					binaryWriter->Write((UInt32)triangleIt->a);
+					binaryWriter->Write((UInt32)triangleIt->b);
+					binaryWriter->Write((UInt32)triangleIt->c);
+				}
+			}
 		}
 
 
@@ -1303,55 +1510,47 @@ namespace Xbim
 		{
 
 			//first remove any that intersect as simple merging leads to illegal geometries.
-			Dictionary<XbimFacetedSolid^, HashSet<XbimFacetedSolid^>^>^ clusters = gcnew Dictionary<XbimFacetedSolid^, HashSet<XbimFacetedSolid^>^>();
+			List<XbimFacetedSolid^>^ toCluster = gcnew List<XbimFacetedSolid^>();
+			HashSet<XbimFacetedSolid^>^ distinct = gcnew HashSet<XbimFacetedSolid^>();
 			for each (IXbimSolid^ solidToCheck in facetedSolids) //init all the clusters
 			{
 				XbimFacetedSolid^ polyToCheck = dynamic_cast<XbimFacetedSolid^>(solidToCheck);
-				if (polyToCheck != nullptr)
-					clusters[polyToCheck] = gcnew HashSet<XbimFacetedSolid^>();
+				if (polyToCheck != nullptr && distinct->Add(polyToCheck))
+					toCluster->Add(polyToCheck);
 			}
-			if (clusters->Count == 0)
+			if (toCluster->Count == 0)
 				return nullptr; //nothing to do
-			if (clusters->Count == 1) //just one so return it
+			if (toCluster->Count == 1) //just one so return it
+				return toCluster[0];
+			//group the solids whose bounding boxes overlap, directly or through other solids
+			XbimBoxClusterer clusterer;
+			for each (XbimFacetedSolid^ poly in toCluster)
 			{
-				for each(XbimFacetedSolid^ fsolid in clusters->Keys) //take the first one
-					return fsolid;
-			}
-			for each (XbimFacetedSolid^ solidToCheck in facetedSolids)
-			{
-				XbimFacetedSolid^ polyToCheck = dynamic_cast<XbimFacetedSolid^>(solidToCheck);
-				if (polyToCheck != nullptr)
-				{
-					XbimRect3D bbToCheck = polyToCheck->BoundingBox;
-					for each (KeyValuePair<XbimFacetedSolid^, HashSet<XbimFacetedSolid^>^>^ cluster in clusters)
-					{
-						if (polyToCheck != cluster->Key && bbToCheck.Intersects(cluster->Key->BoundingBox))
-							cluster->Value->Add(polyToCheck);
-					}
-				}
+				XbimRect3D bb = poly->BoundingBox;
+				clusterer.Add(bb.X, bb.Y, bb.Z, bb.X + bb.SizeX, bb.Y + bb.SizeY, bb.Z + bb.SizeZ);
 			}
+			std::vector<size_t> clusterOf;
+			size_t clusterCount = clusterer.Cluster(clusterOf);
+			std::vector<int> clusterSizes(clusterCount, 0);
+			for (size_t i = 0; i < clusterOf.size(); i++) clusterSizes[clusterOf[i]]++;
 			List<XbimFacetedSolid^>^ toMergeReduced = gcnew List<XbimFacetedSolid^>();
-			Dictionary<XbimFacetedSolid^, HashSet<XbimFacetedSolid^>^>^ clustersSparse = gcnew Dictionary<XbimFacetedSolid^, HashSet<XbimFacetedSolid^>^>();
-			for each (KeyValuePair<XbimFacetedSolid^, HashSet<XbimFacetedSolid^>^>^ cluster in clusters)
+			array<List<XbimFacetedSolid^>^>^ clusters = gcnew array<List<XbimFacetedSolid^>^>((int)clusterCount);
+			for (int i = 0; i < toCluster->Count; i++)
 			{
-				if (cluster->Value->Count > 0)
-					clustersSparse->Add(cluster->Key, cluster->Value);
+				size_t cluster = clusterOf[i];
+				if (clusterSizes[cluster] == 1)
+					toMergeReduced->Add(toCluster[i]); //record the ones to simply merge
 				else
-					toMergeReduced->Add(cluster->Key); //record the ones to simply merge
-			}
-			clusters = nullptr;
-
-			XbimFacetedSolid^ clusterAround = nullptr;
-			for each(XbimFacetedSolid^ fsolid in clustersSparse->Keys) //take the first one
-			{
-				clusterAround = fsolid;
-				break;
+				{
+					if (clusters[(int)cluster] == nullptr) clusters[(int)cluster] = gcnew List<XbimFacetedSolid^>(clusterSizes[cluster]);
+					clusters[(int)cluster]->Add(toCluster[i]);
+				}
 			}
+			toCluster = nullptr;
 
-			while (clusterAround != nullptr)
+			for each (List<XbimFacetedSolid^>^ connected in clusters)
 			{
-				HashSet<XbimFacetedSolid^>^ connected = gcnew HashSet<XbimFacetedSolid^>();
-				XbimFacetedSolid::GetConnected(connected, clustersSparse, clusterAround);
+				if (connected == nullptr) continue;
 				XbimFacetedSolid^ poly = nullptr;
 				for each (XbimFacetedSolid^ toConnect in connected) //join up the connected
 				{
@@ -1359,7 +1558,9 @@ namespace Xbim
 						poly = toConnect;
 					else
 					{
+						carve::mesh::Arena::Scope arena;
 						carve::csg::CSG csg(tolerance);
+						csg.exact_predicates = XbimGeometryCreator::ExactCarvePredicates;
 						meshset_t* united = csg.compute(poly, toConnect, carve::csg::CSG::UNION, NULL, carve::csg::CSG::CLASSIFY_NORMAL);
 						if (united != nullptr)
 						{
@@ -1368,17 +1569,6 @@ namespace Xbim
 					}
 				}
 				if (poly != nullptr) toMergeReduced->Add(poly);
-				
-				for each (XbimFacetedSolid^ p in connected) //remove what we have conected
-					clustersSparse->Remove(p);
-
-				clusterAround = nullptr;
-				for each(XbimFacetedSolid^ fsolid in clustersSparse->Keys) //take the first one
-				{
-					clusterAround = fsolid;
-					break;
-				}
-
 			}
 
 			//create a map between old and new vertices
@@ -1448,23 +1638,6 @@ namespace Xbim
 			return result;
 		}
 
-		void  XbimFacetedSolid::GetConnected(HashSet<XbimFacetedSolid^>^ connected, Dictionary<XbimFacetedSolid^, HashSet<XbimFacetedSolid^>^>^ clusters, XbimFacetedSolid^ clusterAround)
-		{
-			if (connected->Add(clusterAround))
-			{
-				for each (KeyValuePair<XbimFacetedSolid^, HashSet<XbimFacetedSolid^>^>^ polysets in clusters)
-				{
-					if (!connected->Contains(polysets->Key) && !(polysets->Key == clusterAround) && polysets->Value->Contains(clusterAround))  //don't do the same one twice
-					{
-						GetConnected(connected, clusters, polysets->Key);
-						for each (XbimFacetedSolid^ poly in polysets->Value)
-						{
-							GetConnected(connected, clusters, poly);
-						}
-					}
-				}
-			}
-		}
 #pragma endregion
 
 
@@ -14,6 +14,21 @@ namespace Xbim
 {
 	namespace Geometry
 	{
+		//Where the parts of a face of a faceted solid lie with respect to another solid, a face that crosses the surface
+		//of the other solid is both Inside and Outside, the values are those of carve::csg::FaceClassBit
+		[System::Flags]
+		public enum class XbimFaceContainment
+		{
+			//the face could not be classified
+			Unknown = 0,
+			//on the surface of the other solid, facing the opposite way
+			OnOpposite = 0x01,
+			Outside = 0x02,
+			Inside = 0x04,
+			//on the surface of the other solid, facing the same way
+			OnSame = 0x08
+		};
+
 		ref class XbimFacetedSolid : IXbimSolid
 		{
 			IntPtr pMeshSet;
@@ -24,7 +39,11 @@ namespace Xbim
 			void Init(IfcBooleanClippingResult^ clip);
 			void InstanceCleanup();
 			XbimFacetedSolid^ MakeInfiniteFace(XbimPoint3D l, XbimVector3D n);
-			static void  GetConnected(HashSet<XbimFacetedSolid^>^ connected, Dictionary<XbimFacetedSolid^, HashSet<XbimFacetedSolid^>^>^ clusters, XbimFacetedSolid^ clusterAround);
+			//carve searches for intersections on the threads of the engine's pool
+			static XbimFacetedSolid(){ UseWorkStealingPool(); }
+			static void UseWorkStealingPool();
+			//returns the solids of the result of a boolean, which is deleted, non manifold parts of a result with more than one are discarded
+			static IXbimSolidSet^ ToSolidSet(meshset_t* result);
 		protected:
 			///Returns the pointer to the facet mesh data, it is the responsibility of the caller to delete this when not required
 			///This faceted solid is no longer valid after this call;
@@ -109,9 +128,23 @@ namespace Xbim
 			IXbimSolid^ ConvertToXbimSolid();
 			void WriteTriangulation(TextWriter^ textWriter, double tolerance, double deflection, double angle);
 			void WriteTriangulation(BinaryWriter^ binaryWriter, double tolerance, double deflection, double angle);
+			//writes the triangulation, then the number of levels of detail and, for each bound in lodErrors, the bound and the triangulation
+			//of the level in the same format, so a reader of the one triangulation can ignore the levels after it
+			void WriteTriangulation(BinaryWriter^ binaryWriter, double tolerance, double deflection, double angle, array<double>^ lodErrors);
+			//writes the binary twin of the text triangulation, every vertex and welded normal at full precision, read by XbimFacetReader
+			void WriteFacets(BinaryWriter^ binaryWriter, double tolerance);
 			//merges coplanar faces, where the angle betweeen the normals is less than angle (radians)
 			int MergeCoPlanarFaces(double normalAngle);
+			//progressively coarser copies of this solid made of triangles, one for each bound in maxErrors, which should ascend, no vertex of
+			//a copy is further than its bound from the planes of the faces it replaces, a copy is null if the decimation fails
+			array<XbimFacetedSolid^>^ LevelsOfDetail(array<double>^ maxErrors, double tolerance);
 			static XbimFacetedSolid^ Merge(IXbimSolidSet^ facetedSolids, double tolerance);
+			//cuts every faceted solid in tools from this one without merging them first, tools that do not overlap each other are
+			//cut in the same pass, each with only the faces it intersects
+			IXbimSolidSet^ CutAll(IXbimSolidSet^ tools, double tolerance);
+			//classifies the faces of this solid against other without building a result, faces has the containment of each face,
+			//in the order of Faces, and intersections the curves along which the surfaces meet, returns false if it fails
+			bool Classify(XbimFacetedSolid^ other, double tolerance, array<XbimFaceContainment>^% faces, List<List<XbimPoint3D>^>^% intersections);
 #pragma endregion
 
 		};
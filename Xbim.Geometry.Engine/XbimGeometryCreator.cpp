@@ -16,8 +16,16 @@
 #include <BRep_Tool.hxx>
 #include <TColgp_Array1OfPnt.hxx>
 #include <BRepTools.hxx>
+#include <vcclr.h>
+#include "XbimWorkStealingPool.h"
+#include "XbimShapeCache.h"
+#include "XbimBooleanContextCache.h"
+#include <BOPDS_Iterator.hxx>
+#include "XbimMeshCache.h"
+#include "XbimFacetReader.h"
 
 using namespace  System::Threading;
+using System::Runtime::InteropServices::Marshal;
 using namespace Xbim::Common;
 namespace Xbim
 {
@@ -146,6 +154,222 @@ namespace Xbim
 
 		}
 
+		void XbimGeometryCreator::ClearShapeCache()
+		{
+			XbimShapeCache::Default().Clear();
+		}
+
+		void XbimGeometryCreator::ClearBooleanContextCache()
+		{
+			XbimBooleanContextCache::Default().Clear();
+		}
+
+		void XbimGeometryCreator::InvalidateBooleanContext(IXbimSolid^ solid)
+		{
+			XbimSolid^ occSolid = dynamic_cast<XbimSolid^>(solid);
+			if (occSolid != nullptr && occSolid->IsValid) XbimBooleanContextCache::Default().Invalidate(occSolid);
+		}
+
+		void XbimGeometryCreator::SetBooleanContextLimits(int maxSolids, int maxTools)
+		{
+			XbimBooleanContextCache::Default().SetLimits(maxSolids > 0 ? (size_t)maxSolids : 0, maxTools);
+		}
+
+		void XbimGeometryCreator::GetBooleanContextStatistics(int% reused, int% created, int% invalidated)
+		{
+			size_t contextsReused, contextsCreated, contextsInvalidated;
+			XbimBooleanContextCache::Default().Statistics(contextsReused, contextsCreated, contextsInvalidated);
+			reused = (int)contextsReused;
+			created = (int)contextsCreated;
+			invalidated = (int)contextsInvalidated;
+		}
+
+		XbimBooleanTreeMode XbimGeometryCreator::BooleanTreeMode::get()
+		{
+			switch (BOPDS_Iterator::TreeMode())
+			{
+			case BOPDS_TreeMode_BVH:
+				return XbimBooleanTreeMode::BoundingVolumeHierarchy;
+			case BOPDS_TreeMode_Compare:
+				return XbimBooleanTreeMode::Compare;
+			default:
+				return XbimBooleanTreeMode::UnbalancedTree;
+			}
+		}
+
+		void XbimGeometryCreator::BooleanTreeMode::set(XbimBooleanTreeMode mode)
+		{
+			switch (mode)
+			{
+			case XbimBooleanTreeMode::BoundingVolumeHierarchy:
+				BOPDS_Iterator::SetTreeMode(BOPDS_TreeMode_BVH);
+				break;
+			case XbimBooleanTreeMode::Compare:
+				BOPDS_Iterator::SetTreeMode(BOPDS_TreeMode_Compare);
+				break;
+			default:
+				BOPDS_Iterator::SetTreeMode(BOPDS_TreeMode_UBTree);
+				break;
+			}
+		}
+
+		void XbimGeometryCreator::GetBooleanTreeStatistics(int% runs, int% mismatches, double% unbalancedTreeSeconds, double% hierarchySeconds)
+		{
+			Standard_Integer nbRuns, nbMismatches;
+			Standard_Real ubTreeTime, bvhTime;
+			BOPDS_Iterator::TreeStatistics(nbRuns, nbMismatches, ubTreeTime, bvhTime);
+			runs = nbRuns;
+			mismatches = nbMismatches;
+			unbalancedTreeSeconds = ubTreeTime;
+			hierarchySeconds = bvhTime;
+		}
+
+		void XbimGeometryCreator::ResetBooleanTreeStatistics()
+		{
+			BOPDS_Iterator::ResetTreeStatistics();
+		}
+
+		bool XbimGeometryCreator::OpenMeshCache(String^ path)
+		{
+			std::string error;
+			IntPtr nativePath = Marshal::StringToHGlobalAnsi(path);
+			bool opened = XbimMeshCache::Default().Open((const char*)nativePath.ToPointer(), error);
+			Marshal::FreeHGlobal(nativePath);
+			if (opened) return true;
+			logger->WarnFormat("WG001: The mesh cache could not be opened. {0}", gcnew String(error.c_str()));
+			return false;
+		}
+
+		void XbimGeometryCreator::CloseMeshCache()
+		{
+			XbimMeshCache::Default().Close();
+		}
+
+		array<bool>^ XbimGeometryCreator::ContainsPoints(IXbimSolid^ solid, IList<XbimPoint3D>^ points, double tolerance, double deflection)
+		{
+			XbimSolid^ occSolid = dynamic_cast<XbimSolid^>(solid);
+#ifdef USE_CARVE_CSG
+			XbimFacetedSolid^ facetedSolid = dynamic_cast<XbimFacetedSolid^>(solid);
+			if (facetedSolid != nullptr)
+				occSolid = dynamic_cast<XbimSolid^>(facetedSolid->ConvertToXbimSolid());
+#endif // USE_CARVE_CSG
+			if (occSolid == nullptr)
+			{
+				if (solid != nullptr)
+					logger->WarnFormat("WG007: Points cannot be classified against a {0}, none are contained", solid->GetType()->Name);
+				return gcnew array<bool>(points->Count);
+			}
+			return occSolid->ContainsPoints(points, tolerance, deflection);
+		}
+
+		//the mesh of an item in the cache is its bounding box, 6 doubles, followed by its shape data
+		static const size_t CachedBoxSize = 6 * sizeof(double);
+
+		IXbimShapeGeometryData^ XbimGeometryCreator::CreateShapeGeometry(IfcGeometricRepresentationItem^ item, double precision, double deflection, double angle, XbimGeometryType storageType)
+		{
+			XbimMeshCache& cache = XbimMeshCache::Default();
+			XbimShapeKey key(item->ModelOf->ModelFactors->Precision);
+			if (cache.IsOpen())
+			{
+				key.Add(XbimMeshCache::Version);
+				key.Add((int)storageType);
+				key.AddExact(precision);
+				key.AddExact(deflection);
+				key.AddExact(angle);
+				XbimSolid::AppendItemKey(key, item, true);
+			}
+			else
+				key.Invalidate();
+
+			std::string cached;
+			if (key.IsValid() && cache.Find(key.Bytes(), cached) && cached.size() > CachedBoxSize)
+			{
+				double box[6];
+				memcpy(box, cached.data(), CachedBoxSize);
+				XbimShapeGeometry^ shapeGeom = gcnew XbimShapeGeometry();
+				shapeGeom->ShapeData = gcnew array<Byte>((int)(cached.size() - CachedBoxSize));
+				Marshal::Copy(IntPtr((void*)(cached.data() + CachedBoxSize)), shapeGeom->ShapeData, 0, shapeGeom->ShapeData->Length);
+				shapeGeom->BoundingBox = XbimRect3D(box[0], box[1], box[2], box[3], box[4], box[5]);
+				shapeGeom->LOD = XbimLOD::LOD_Unspecified;
+				shapeGeom->Format = storageType;
+				return shapeGeom;
+			}
+
+			IXbimGeometryObject^ geomObj = Create(item);
+			if (geomObj == nullptr) return nullptr;
+			IXbimShapeGeometryData^ shapeGeom;
+			try
+			{
+				if (!geomObj->IsValid) return nullptr;
+				shapeGeom = CreateShapeGeometry(geomObj, precision, deflection, angle, storageType);
+			}
+			finally
+			{
+				delete geomObj; //only the mesh is returned, the native shape is released now rather than by the finalizer
+			}
+			if (key.IsValid() && shapeGeom->ShapeData != nullptr && shapeGeom->ShapeData->Length > 0)
+			{
+				XbimRect3D bb = ((XbimShapeGeometry^)shapeGeom)->BoundingBox;
+				double box[6] = { bb.X, bb.Y, bb.Z, bb.SizeX, bb.SizeY, bb.SizeZ };
+				std::string entry((const char*)box, CachedBoxSize);
+				pin_ptr<Byte> data = &shapeGeom->ShapeData[0];
+				entry.append((const char*)data, shapeGeom->ShapeData->Length);
+				if (!cache.Add(key.Bytes(), entry.data(), entry.size()))
+					logger->WarnFormat("WG002: The mesh of entity #{0} could not be written to the mesh cache", item->EntityLabel);
+			}
+			return shapeGeom;
+		}
+
+		//a batch of items being created on the native pool
+		ref class XbimShapeGeometryBatch
+		{
+		public:
+			XbimGeometryCreator^ Creator;
+			array<IfcGeometricRepresentationItem^>^ Items;
+			array<IXbimShapeGeometryData^>^ Results;
+			double Precision;
+			double Deflection;
+			double Angle;
+			XbimGeometryType StorageType;
+
+			void Create(int i)
+			{
+				IfcGeometricRepresentationItem^ item = Items[i];
+				if (item == nullptr) return;
+				try
+				{
+					IXbimShapeGeometryData^ shapeGeom = Creator->CreateShapeGeometry(item, Precision, Deflection, Angle, StorageType);
+					if (shapeGeom != nullptr && shapeGeom->ShapeData != nullptr && shapeGeom->ShapeData->Length > 0)
+						Results[i] = shapeGeom;
+				}
+				catch (Exception^ e) //the pool's threads are native, nothing may be thrown back to them
+				{
+					XbimGeometryCreator::logger->ErrorFormat("EG003: Error creating shape geometry of type {0} in entity #{1}\n{2}", item->GetType()->Name, item->EntityLabel, e->Message);
+				}
+			}
+		};
+
+		static void CreateBatchItem(void* context, size_t index)
+		{
+			gcroot<XbimShapeGeometryBatch^>& batch = *(gcroot<XbimShapeGeometryBatch^>*)context;
+			batch->Create((int)index);
+		}
+
+		array<IXbimShapeGeometryData^>^ XbimGeometryCreator::CreateShapeGeometry(array<IfcGeometricRepresentationItem^>^ items, double precision, double deflection, double angle, XbimGeometryType storageType)
+		{
+			XbimShapeGeometryBatch^ batch = gcnew XbimShapeGeometryBatch();
+			batch->Creator = this;
+			batch->Items = items;
+			batch->Results = gcnew array<IXbimShapeGeometryData^>(items->Length);
+			batch->Precision = precision;
+			batch->Deflection = deflection;
+			batch->Angle = angle;
+			batch->StorageType = storageType;
+			gcroot<XbimShapeGeometryBatch^> context(batch);
+			XbimWorkStealingPool::Default().ParallelFor(items->Length, CreateBatchItem, &context);
+			return batch->Results;
+		}
+
 		IXbimGeometryObjectSet^ XbimGeometryCreator::CreateGeometricSet(IfcGeometricSet^ geomSet)
 		{
 			XbimGeometryObjectSet^ result = gcnew XbimGeometryObjectSet(geomSet->Elements->Count);
@@ -588,6 +812,23 @@ namespace Xbim
 			return gcnew XbimFacetedSolid(solid, precision, deflection, angle);
 		}
 
+		bool XbimGeometryCreator::Classify(IXbimSolid^ solid, IXbimSolid^ other, double tolerance, double deflection, array<int>^% faces, List<List<XbimPoint3D>^>^% intersections)
+		{
+			faces = nullptr;
+			intersections = nullptr;
+			if (solid == nullptr || other == nullptr) return false;
+			XbimFacetedSolid^ facetedSolid = dynamic_cast<XbimFacetedSolid^>(solid);
+			if (facetedSolid == nullptr) facetedSolid = gcnew XbimFacetedSolid(solid, tolerance, deflection);
+			XbimFacetedSolid^ facetedOther = dynamic_cast<XbimFacetedSolid^>(other);
+			if (facetedOther == nullptr) facetedOther = gcnew XbimFacetedSolid(other, tolerance, deflection);
+			array<XbimFaceContainment>^ containment;
+			if (!facetedSolid->Classify(facetedOther, tolerance, containment, intersections)) return false;
+			faces = gcnew array<int>(containment->Length);
+			for (int i = 0; i < containment->Length; i++)
+				faces[i] = (int)containment[i];
+			return true;
+		}
+
 		IXbimSolid^ XbimGeometryCreator::CreateTriangulatedSolid(IXbimSolid^ solid, double precision, double deflection)
 		{
 			return gcnew XbimFacetedSolid(solid, precision, deflection, true);
@@ -649,89 +890,98 @@ namespace Xbim
 			XbimOccShape^ xShape = dynamic_cast<XbimOccShape^>(shape);
 			if (xShape != nullptr)
 			{
-				xShape->WriteTriangulation(bw, tolerance, deflection, angle);
+				xShape->WriteTriangulation(bw, tolerance, deflection, angle, ParallelFaceMeshing);
 				return;
 			}
 
 		}
 
 #ifdef USE_CARVE_CSG
-		IXbimGeometryObject^  XbimGeometryCreator::ReadTriangulation(TextReader^ sr)
+		void XbimGeometryCreator::WriteTriangulation(BinaryWriter^ bw, IXbimGeometryObject^ shape, double tolerance, double deflection, double angle, array<double>^ lodErrors)
 		{
-			return ReadTriangulation(sr, false);
+			XbimFacetedSolid^ fSolid = dynamic_cast<XbimFacetedSolid^>(shape);
+			if (fSolid != nullptr)
+			{
+				fSolid->WriteTriangulation(bw, tolerance, deflection, angle, lodErrors);
+				return;
+			}
+			WriteTriangulation(bw, shape, tolerance, deflection, angle);
+			bw->Write((UInt32)0); //only faceted solids have levels of detail
 		}
 
-		IXbimGeometryObject^  XbimGeometryCreator::ReadTriangulation(TextReader^ sr, bool unTriangulate)
+		void XbimGeometryCreator::WriteFacets(BinaryWriter^ bw, IXbimGeometryObject^ shape, double tolerance, double deflection)
 		{
-			String^ l = sr->ReadLine();
-			array<Char>^ space = gcnew array < Char > {' '};
-			array<Char>^ comma = gcnew array < Char > {','};
-			array<Char>^ slash = gcnew array < Char > {'/'};
+			XbimFacetedSolid^ fSolid = dynamic_cast<XbimFacetedSolid^>(shape);
+			if (fSolid != nullptr)
+			{
+				fSolid->WriteFacets(bw, tolerance);
+				return;
+			}
+			IXbimSolid^ solid = dynamic_cast<IXbimSolid^>(shape);
+			if (solid != nullptr && solid->IsValid)
+			{
+				XbimFacetedSolid^ faceted = gcnew XbimFacetedSolid(solid, tolerance, deflection);
+				faceted->WriteFacets(bw, tolerance);
+				return;
+			}
+			if (shape != nullptr)
+				logger->WarnFormat("WG006: Only solids can be written as facets, a {0} has been ignored", shape->GetType()->Name);
+		}
 
-			std::vector<vertex_t> vertices;
-			std::vector<face_t*> meshFaces;
+		IXbimGeometryObject^  XbimGeometryCreator::ReadTriangulation(TextReader^ sr)
+		{
+			return ReadTriangulation(sr, false);
+		}
 
-			while (l != nullptr)
+		//wraps a mesh read by the reader in a faceted solid, or returns an empty solid if it could not be read
+		static XbimFacetedSolid^ ToFacetedSolid(const XbimFacetReader& reader, meshset_t* mesh, bool unTriangulate)
+		{
+			if (reader.IgnoredLines() > 0)
+				XbimGeometryCreator::logger->WarnFormat("WG004: {0} lines with an illegal polygon command have been ignored", (UInt64)reader.IgnoredLines());
+			if (reader.DegenerateTriangles() > 0)
+				XbimGeometryCreator::logger->WarnFormat("WG005: {0} triangles with a repeated vertex have been left out of the triangulation", (UInt64)reader.DegenerateTriangles());
+			if (mesh == nullptr)
 			{
-				array<String^>^ toks = l->Split(space, StringSplitOptions::RemoveEmptyEntries);
-				if (toks->Length < 2) //skip if invalid line
-					continue;
-				String^ cmd = toks[0]->ToUpperInvariant();
-				if (cmd == "T")
-				{
-					if (toks->Length > 1) //we have at least one triangle
-					{
-						for (int i = 1; i < toks->Length; i++) //skip the T
-						{
-							array<String^>^ indices = toks[i]->Split(comma, StringSplitOptions::RemoveEmptyEntries);
-							array<String^>^ a = indices[0]->Split(slash, StringSplitOptions::RemoveEmptyEntries);
-							array<String^>^ b = indices[1]->Split(slash, StringSplitOptions::RemoveEmptyEntries);
-							array<String^>^ c = indices[2]->Split(slash, StringSplitOptions::RemoveEmptyEntries);
-
-							size_t av = UInt32::Parse(a[0]);
-							size_t bv = UInt32::Parse(b[0]);
-							size_t cv = UInt32::Parse(c[0]);
-							meshFaces.push_back(new face_t(&vertices[av], &vertices[bv], &vertices[cv]));
-						}
-					}
-				}
-				else if (cmd == "V")
-				{
-					for (int i = 1; i < toks->Length; i++)
-					{
-						array<String^>^ coords = toks[i]->Split(comma, StringSplitOptions::RemoveEmptyEntries);
-						vertices.push_back(carve::geom::VECTOR(Double::Parse(coords[0]), Double::Parse(coords[1]), Double::Parse(coords[2])));
-					}
-				}
-				else if (cmd == "N")
-				{
-					//ignore them
-				}
-				else if (cmd == "P") //initialise the polyData
-				{
-					String^ version = toks[1];
-					int vCount = Int32::Parse(toks[2]);
-					int fCount = Int32::Parse(toks[3]);
-					int tCount = Int32::Parse(toks[4]);
-					int nCount = Int32::Parse(toks[5]);
-					vertices.reserve(vCount);
-					meshFaces.reserve(tCount);
-				}
-				else if (cmd == "F") //initialise the face data
-				{
-					//do nothing
-				}
-				else
-					Logger->WarnFormat("Illegal Polygon command format '{0}' has been ignored", cmd);
-				l = sr->ReadLine(); //get the next line
+				XbimGeometryCreator::logger->WarnFormat("WG003: The triangulation could not be read. {0}", gcnew String(reader.Error().c_str()));
+				return gcnew XbimFacetedSolid();
 			}
-			std::vector<mesh_t*> newMeshes;
-			mesh_t::create(meshFaces.begin(), meshFaces.end(), newMeshes, carve::mesh::MeshOptions());
-			XbimFacetedSolid^ solid = gcnew XbimFacetedSolid(new meshset_t(vertices, newMeshes));
+			XbimFacetedSolid^ solid = gcnew XbimFacetedSolid(mesh);
 			if (unTriangulate)
 				int reduced = solid->MergeCoPlanarFaces(0.4 * Math::PI / 180.0); //0.4 of a degree
 			return solid;
+		}
+
+		IXbimGeometryObject^  XbimGeometryCreator::ReadTriangulation(TextReader^ sr, bool unTriangulate)
+		{
+			//the text is scanned in place, without splitting it in to strings
+			String^ text = sr->ReadToEnd();
+			pin_ptr<const wchar_t> chars = PtrToStringChars(text);
+			XbimFacetReader reader;
+			meshset_t* mesh = reader.ReadText(chars, (size_t)text->Length);
+			return ToFacetedSolid(reader, mesh, unTriangulate);
+		}
+
+		IXbimGeometryObject^  XbimGeometryCreator::ReadTriangulation(array<Byte>^ data, bool unTriangulate)
+		{
+			XbimFacetReader reader;
+			meshset_t* mesh;
+			if (data->Length == 0)
+				mesh = reader.Read(nullptr, 0);
+			else
+			{
+				pin_ptr<Byte> bytes = &data[0];
+				mesh = reader.Read((const char*)bytes, (size_t)data->Length);
+			}
+			return ToFacetedSolid(reader, mesh, unTriangulate);
+		}
 
+		IXbimGeometryObject^  XbimGeometryCreator::ReadTriangulationFile(String^ path, bool unTriangulate)
+		{
+			IntPtr nativePath = Marshal::StringToHGlobalAnsi(path);
+			XbimFacetReader reader;
+			meshset_t* mesh = reader.ReadFile((const char*)nativePath.ToPointer());
+			Marshal::FreeHGlobal(nativePath);
+			return ToFacetedSolid(reader, mesh, unTriangulate);
 		}
 #endif // USE_CARVE_CSG
 
@@ -17,6 +17,26 @@ namespace Xbim
 {
 	namespace Geometry
 	{
+		//How the overlapping solids of a set are unioned when the set is merged into one compound
+		public enum class XbimFuseStrategy
+		{
+			//each solid is fused in turn into the result of the ones before it
+			Sequential,
+			//a single boolean over all the solids, where that fails they are fused as for BalancedTree
+			MultiWay,
+			//each solid is fused with the nearest by bounding box, then pairs of the results, the pairs of each level are fused in parallel
+			BalancedTree
+		};
+		//How the OCC booleans find the pairs of sub-shapes of their arguments whose bounding boxes overlap
+		public enum class XbimBooleanTreeMode
+		{
+			//the boxes are inserted one at a time into an unbalanced tree
+			UnbalancedTree,
+			//a hierarchy of the boxes is built by the surface area heuristic and searched for its overlapping pairs in parallel
+			BoundingVolumeHierarchy,
+			//both are run, the pairs of the unbalanced tree are used, see GetBooleanTreeStatistics
+			Compare
+		};
 
 		public ref class XbimGeometryCreator : IXbimGeometryCreator
 		{
@@ -37,12 +57,63 @@ namespace Xbim
 			//Central point for logging all errors
 			static ILogger^ logger = LoggerFactory::GetLogger();
 			virtual property ILogger^ Logger{ILogger^ get(){ return XbimGeometryCreator::logger; }};
+			//When true binary triangulations mesh the faces of each shape concurrently with a mesher that shares their edges, the
+			//curved faces are meshed differently to the default of one mesher per face
+			static bool ParallelFaceMeshing = false;
+			//When true identical swept solids and csg primitives are built and meshed once and shared by every item that uses them,
+			//each item's shape is then an instance of the shared one with a location for its placement
+			//The shared topology must not be modified, booleans that update the tolerances of their arguments should not be run
+			//concurrently on instances of the same shape
+			static bool CacheIdenticalShapes = false;
+			//How overlapping solids are unioned when they are merged before a boolean, the balanced tree runs booleans concurrently
+			//and should not be used with CacheIdenticalShapes
+			static XbimFuseStrategy FuseStrategy = XbimFuseStrategy::Sequential;
+			//When true the orientation tests of faceted solid booleans use adaptive exact predicates, their signs are then exact
+			//for near degenerate faces rather than rounded, at a small cost. Comparisons made against the tolerance are unchanged
+			static bool ExactCarvePredicates = false;
+			//releases the shapes held for sharing, shapes already created from them are unaffected
+			static void ClearShapeCache();
+			//When true the intersection context of each solid cut by an OCC boolean is kept and reused when that solid is cut again
+			//at the same location, so the classifiers and projectors built for it are built once. It does not help a solid that is
+			//cut once by all of its tools, and as a cut that raises the tolerances of the solid drops its context it only helps
+			//repeated cuts whose tools do not meet the faces of the solid. Call InvalidateBooleanContext for a solid whose
+			//topology is changed outside a cut
+			static bool CacheBooleanContexts = false;
+			//releases the kept intersection contexts, they are rebuilt by the next cuts
+			static void ClearBooleanContextCache();
+			static void InvalidateBooleanContext(IXbimSolid^ solid);
+			//sets the most solids whose contexts are kept and the most tools a kept context may cache, 64 and 20000 by default
+			static void SetBooleanContextLimits(int maxSolids, int maxTools);
+			//totals of the contexts the cuts have taken from the cache, those reused and those made new, and of the contexts
+			//dropped as the tolerances of their solids had changed
+			static void GetBooleanContextStatistics(int% reused, int% created, int% invalidated);
+			//the tree the OCC booleans find overlapping sub-shapes with, UnbalancedTree by default
+			static property XbimBooleanTreeMode BooleanTreeMode{ XbimBooleanTreeMode get(); void set(XbimBooleanTreeMode mode); }
+			//totals of the booleans run with BooleanTreeMode Compare, the number whose pairs, or the order of their pairs, differed
+			//between the trees and the seconds each tree took to find them
+			static void GetBooleanTreeStatistics(int% runs, int% mismatches, double% unbalancedTreeSeconds, double% hierarchySeconds);
+			static void ResetBooleanTreeStatistics();
+			//Meshes of items created by CreateShapeGeometry from an item are persisted in the file at path and reused by later runs
+			//returns false, and logs why, if the file cannot be opened
+			static bool OpenMeshCache(String^ path);
+			static void CloseMeshCache();
+			//returns for each point whether it is inside the solid or on its boundary within tolerance, e.g. to find the space each
+			//element is in. The triangles of the faces are put in a tree once for all the points, faces with no triangulation are
+			//meshed on a copy at deflection so the solid is not changed. Faceted solids are converted first
+			array<bool>^ ContainsPoints(IXbimSolid^ solid, IList<XbimPoint3D>^ points, double tolerance, double deflection);
 			virtual IXbimShapeGeometryData^ CreateShapeGeometry(IXbimGeometryObject^ geometryObject, double precision, double deflection, double angle, XbimGeometryType storageType);
 			virtual IXbimShapeGeometryData^ CreateShapeGeometry(IXbimGeometryObject^ geometryObject, double precision, double deflection/*, double angle = 0.5, XbimGeometryType storageType = XbimGeometryType::Polyhedron*/)
 			{
 				return CreateShapeGeometry(geometryObject, precision, deflection, 0.5, XbimGeometryType::Polyhedron);
 			};
 			virtual IXbimGeometryObject^ Create(IfcGeometricRepresentationItem^ geomRep);
+			//Creates and triangulates the item, returns null if it has no geometry. If the mesh cache is open and holds an identical item,
+			//at the same placement and triangulated with the same settings, its mesh is returned without creating the item
+			//Swept solids, csg primitives and faceted breps are cached, other items are always created
+			IXbimShapeGeometryData^ CreateShapeGeometry(IfcGeometricRepresentationItem^ item, double precision, double deflection, double angle, XbimGeometryType storageType);
+			//Creates and triangulates each of the items, the result for items[i] is at [i] and is null if it has no geometry
+			//The items are scheduled on the engine's native work stealing pool so that a few large breps do not hold up the rest
+			array<IXbimShapeGeometryData^>^ CreateShapeGeometry(array<IfcGeometricRepresentationItem^>^ items, double precision, double deflection, double angle, XbimGeometryType storageType);
 			virtual IXbimGeometryObjectSet^ CreateGeometricSet(IfcGeometricSet^ geomSet);
 			//Point Creation
 			virtual IXbimPoint^ CreatePoint(double x, double y, double z, double tolerance);
@@ -117,11 +188,18 @@ namespace Xbim
 			//Read and write functions
 			virtual void WriteTriangulation(TextWriter^ tw, IXbimGeometryObject^ shape, double tolerance, double deflection, double angle);
 			virtual void WriteTriangulation(BinaryWriter^ bw, IXbimGeometryObject^ shape, double tolerance, double deflection, double angle);
-			//Reads a triangulate data store, if untriangulate is true coplanar faces are removed
 
 #ifdef USE_CARVE_CSG
+			//writes the binary triangulation followed by levels of detail of faceted solids, see XbimFacetedSolid::WriteTriangulation
+			void WriteTriangulation(BinaryWriter^ bw, IXbimGeometryObject^ shape, double tolerance, double deflection, double angle, array<double>^ lodErrors);
+			//Reads a triangulate data store, if untriangulate is true coplanar faces are removed
 			virtual IXbimGeometryObject^ ReadTriangulation(TextReader^ tr, bool unTriangulate);
 			virtual IXbimGeometryObject^ ReadTriangulation(TextReader^ tr/*, bool unTriangulate = false*/);
+			//writes the binary twin of the text triangulation read by ReadTriangulation, solids that are not faceted are faceted at the deflection
+			void WriteFacets(BinaryWriter^ bw, IXbimGeometryObject^ shape, double tolerance, double deflection);
+			//Reads the text triangulation or its binary twin written by WriteFacets, from memory or from a file, which is mapped
+			IXbimGeometryObject^ ReadTriangulation(array<Byte>^ data, bool unTriangulate);
+			IXbimGeometryObject^ ReadTriangulationFile(String^ path, bool unTriangulate);
 			virtual IXbimSolid^ CreateFacetedSolid(IfcBooleanClippingResult^ ifcSolid);
 #endif // USE_CARVE_CSG
 
@@ -135,6 +213,11 @@ namespace Xbim
 			//Creates a faceted solid of triangles
 			virtual IXbimSolid^ CreateTriangulatedSolid(IXbimSolid^ solid, double precision, double deflection);
 			virtual IXbimSolid^ CreateTriangulatedSolid(IXbimSolid^ solid, double precision, double deflection, double angle);
+			//classifies the faces of solid against other without building a result, faces has the XbimFaceContainment bits of each face
+			//in the order of the faces of solid and intersections the curves along which their surfaces meet, in an order that depends
+			//only on their points. Solids that are not faceted are faceted at deflection first, create the faceted solid with
+			//CreateFacetedSolid to match the faces to their containment. Returns false, and logs why, if the classification fails
+			bool Classify(IXbimSolid^ solid, IXbimSolid^ other, double tolerance, double deflection, array<int>^% faces, List<List<XbimPoint3D>^>^% intersections);
 
 #endif // USE_CARVE_CSG
 
@@ -0,0 +1,348 @@
+#include "XbimMeshCache.h"
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		static const char Magic[8] = { 'X', 'B', 'I', 'M', 'M', 'E', 'S', 'H' };
+
+		struct XbimMeshCacheHeader
+		{
+			char magic[8];
+			unsigned int version;
+			unsigned int reserved;
+		};
+
+		struct XbimMeshCacheEntry
+		{
+			unsigned int keyLength;
+			unsigned int dataLength;
+			unsigned long long checksum; //of the key and the data
+		};
+
+		//64 bit FNV-1a
+		static unsigned long long Checksum(const char* bytes, size_t length, unsigned long long hash = 14695981039346656037ULL)
+		{
+			for (size_t i = 0; i < length; i++)
+			{
+				hash ^= (unsigned char)bytes[i];
+				hash *= 1099511628211ULL;
+			}
+			return hash;
+		}
+
+		struct XbimMeshCache::Impl
+		{
+			struct Data
+			{
+				const char* data;
+				size_t length;
+			};
+			std::mutex lock;
+			std::unordered_map<std::string, Data> index;
+			std::deque<std::string> added; //the data of entries added since the file was opened, a deque does not move them
+			const char* view;
+			unsigned long long viewSize;
+			unsigned long long end; //where the next entry is written
+#ifdef _WIN32
+			HANDLE file;
+			HANDLE mapping;
+#else
+			int file;
+#endif
+			Impl() : view(0), viewSize(0), end(0)
+			{
+#ifdef _WIN32
+				file = INVALID_HANDLE_VALUE;
+				mapping = 0;
+#else
+				file = -1;
+#endif
+			}
+
+			bool IsOpen() const
+			{
+#ifdef _WIN32
+				return file != INVALID_HANDLE_VALUE;
+#else
+				return file != -1;
+#endif
+			}
+
+			bool OpenFile(const std::string& path, unsigned long long& size)
+			{
+#ifdef _WIN32
+				//other processes may read the file but not write it while it is open
+				file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, 0, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+				if (file == INVALID_HANDLE_VALUE) return false;
+				LARGE_INTEGER fileSize;
+				if (!GetFileSizeEx(file, &fileSize)) return false;
+				size = (unsigned long long)fileSize.QuadPart;
+#else
+				file = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+				if (file == -1) return false;
+				if (flock(file, LOCK_EX | LOCK_NB) != 0) return false;
+				struct stat status;
+				if (fstat(file, &status) != 0) return false;
+				size = (unsigned long long)status.st_size;
+#endif
+				return true;
+			}
+
+			bool Map(unsigned long long size)
+			{
+				if (size == 0) return true;
+				if (size != (size_t)size) return false; //too large for the address space of the process
+#ifdef _WIN32
+				mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+				if (mapping == 0) return false;
+				view = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				if (view == 0) return false;
+#else
+				void* mapped = mmap(0, (size_t)size, PROT_READ, MAP_SHARED, file, 0);
+				if (mapped == MAP_FAILED) return false;
+				view = (const char*)mapped;
+#endif
+				viewSize = size;
+				return true;
+			}
+
+			void Unmap()
+			{
+#ifdef _WIN32
+				if (view != 0) UnmapViewOfFile(view);
+				if (mapping != 0) CloseHandle(mapping);
+				mapping = 0;
+#else
+				if (view != 0) munmap((void*)view, (size_t)viewSize);
+#endif
+				view = 0;
+				viewSize = 0;
+			}
+
+			bool Truncate(unsigned long long size)
+			{
+#ifdef _WIN32
+				LARGE_INTEGER position;
+				position.QuadPart = (LONGLONG)size;
+				return SetFilePointerEx(file, position, 0, FILE_BEGIN) && SetEndOfFile(file);
+#else
+				return ftruncate(file, (off_t)size) == 0;
+#endif
+			}
+
+			bool Write(unsigned long long offset, const char* bytes, size_t length)
+			{
+#ifdef _WIN32
+				LARGE_INTEGER position;
+				position.QuadPart = (LONGLONG)offset;
+				if (!SetFilePointerEx(file, position, 0, FILE_BEGIN)) return false;
+				while (length > 0)
+				{
+					DWORD chunk = length > 0x40000000 ? 0x40000000 : (DWORD)length;
+					DWORD written = 0;
+					if (!WriteFile(file, bytes, chunk, &written, 0) || written == 0) return false;
+					bytes += written;
+					length -= written;
+				}
+#else
+				while (length > 0)
+				{
+					ssize_t written = pwrite(file, bytes, length, (off_t)offset);
+					if (written <= 0) return false;
+					bytes += written;
+					length -= (size_t)written;
+					offset += (unsigned long long)written;
+				}
+#endif
+				return true;
+			}
+
+			void CloseFile()
+			{
+				Unmap();
+#ifdef _WIN32
+				if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+				file = INVALID_HANDLE_VALUE;
+#else
+				if (file != -1) close(file);
+				file = -1;
+#endif
+				index.clear();
+				added.clear();
+				end = 0;
+			}
+
+			//indexes the complete entries in the view and returns the end of the last one
+			unsigned long long Scan()
+			{
+				if (viewSize < sizeof(XbimMeshCacheHeader)) return 0;
+				const XbimMeshCacheHeader* header = (const XbimMeshCacheHeader*)view;
+				if (memcmp(header->magic, Magic, sizeof(Magic)) != 0 || header->version != (unsigned int)Version) return 0;
+				unsigned long long offset = sizeof(XbimMeshCacheHeader);
+				while (viewSize - offset >= sizeof(XbimMeshCacheEntry))
+				{
+					XbimMeshCacheEntry entry;
+					memcpy(&entry, view + offset, sizeof(entry));
+					unsigned long long next = offset + sizeof(entry) + entry.keyLength + entry.dataLength;
+					if (next > viewSize) break;
+					const char* key = view + offset + sizeof(entry);
+					const char* data = key + entry.keyLength;
+					if (Checksum(data, entry.dataLength, Checksum(key, entry.keyLength)) != entry.checksum) break;
+					Data found = { data, entry.dataLength };
+					index[std::string(key, entry.keyLength)] = found; //a later entry with the same key replaces an earlier one
+					offset = next;
+				}
+				return offset;
+			}
+		};
+
+		XbimMeshCache& XbimMeshCache::Default()
+		{
+			static std::once_flag created;
+			static XbimMeshCache* cache = 0;
+			std::call_once(created, []() { cache = new XbimMeshCache(); });
+			return *cache;
+		}
+
+		XbimMeshCache::XbimMeshCache() : _impl(new Impl())
+		{
+		}
+
+		XbimMeshCache::~XbimMeshCache()
+		{
+			Close();
+			delete _impl;
+		}
+
+		bool XbimMeshCache::Open(const std::string& path, std::string& error)
+		{
+			std::lock_guard<std::mutex> lock(_impl->lock);
+			_impl->CloseFile();
+			unsigned long long size = 0;
+			if (!_impl->OpenFile(path, size))
+			{
+				error = "The file " + path + " could not be opened, it may be in use by another process";
+				_impl->CloseFile();
+				return false;
+			}
+			if (!_impl->Map(size))
+			{
+				error = "The file " + path + " could not be mapped in to memory";
+				_impl->CloseFile();
+				return false;
+			}
+			unsigned long long end = _impl->Scan();
+			if (end < size) //an entry was left incomplete, or the file is from another version, drop what cannot be read
+			{
+				_impl->index.clear();
+				_impl->Unmap();
+				bool resized = end == 0 ? _impl->Truncate(0) : _impl->Truncate(end) && _impl->Map(end);
+				if (!resized)
+				{
+					error = "The file " + path + " could not be repaired";
+					_impl->CloseFile();
+					return false;
+				}
+				end = _impl->Scan();
+			}
+			if (end == 0)
+			{
+				XbimMeshCacheHeader header;
+				memcpy(header.magic, Magic, sizeof(Magic));
+				header.version = (unsigned int)Version;
+				header.reserved = 0;
+				if (!_impl->Write(0, (const char*)&header, sizeof(header)))
+				{
+					error = "The file " + path + " could not be written";
+					_impl->CloseFile();
+					return false;
+				}
+				end = sizeof(header);
+			}
+			_impl->end = end;
+			return true;
+		}
+
+		void XbimMeshCache::Close()
+		{
+			std::lock_guard<std::mutex> lock(_impl->lock);
+			_impl->CloseFile();
+		}
+
+		bool XbimMeshCache::IsOpen()
+		{
+			std::lock_guard<std::mutex> lock(_impl->lock);
+			return _impl->IsOpen();
+		}
+
+		bool XbimMeshCache::Find(const std::string& key, std::string& data)
+		{
+			//the entry is copied while the lock is held, the view it is read from is unmapped when the cache is closed
+			std::lock_guard<std::mutex> lock(_impl->lock);
+			std::unordered_map<std::string, Impl::Data>::const_iterator found = _impl->index.find(key);
+			if (found == _impl->index.end()) return false;
+			data.assign(found->second.data, found->second.length);
+			return true;
+		}
+
+		bool XbimMeshCache::Add(const std::string& key, const char* data, size_t length)
+		{
+			XbimMeshCacheEntry entry;
+			entry.keyLength = (unsigned int)key.size();
+			entry.dataLength = (unsigned int)length;
+			entry.checksum = Checksum(data, length, Checksum(key.data(), key.size()));
+			std::string bytes;
+			bytes.reserve(sizeof(entry) + key.size() + length);
+			bytes.append((const char*)&entry, sizeof(entry));
+			bytes.append(key);
+			bytes.append(data, length);
+
+			std::lock_guard<std::mutex> lock(_impl->lock);
+			if (!_impl->IsOpen()) return false;
+			if (_impl->index.find(key) != _impl->index.end()) return true;
+			if (!_impl->Write(_impl->end, bytes.data(), bytes.size()))
+			{
+				//do not leave part of an entry for the next one to follow, a mapped file cannot be truncated on Windows so the view
+				//is unmapped first and the entries in it are indexed again once it is mapped back
+				unsigned long long mapped = _impl->viewSize;
+				_impl->Unmap();
+				if (_impl->Truncate(_impl->end) && _impl->Map(mapped))
+					_impl->Scan();
+				else
+					_impl->CloseFile();
+				return false;
+			}
+			_impl->end += bytes.size();
+			_impl->added.push_back(std::string(data, length));
+			Impl::Data added = { _impl->added.back().data(), length };
+			_impl->index[key] = added;
+			return true;
+		}
+
+		size_t XbimMeshCache::Count()
+		{
+			std::lock_guard<std::mutex> lock(_impl->lock);
+			return _impl->index.size();
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		//Native persistent cache of meshed shapes, a single file of entries addressed by the key of the definition they were meshed from
+		//The entries in the file when it is opened are memory mapped and read in place, entries added are appended to the file and are
+		//found by this process straight away and by every process that opens the file later
+		//An entry is written in one piece with a checksum, an entry left incomplete by a crash is removed when the file is next opened
+		//The file is opened for writing by one process at a time, this header does not include the platform headers so managed code can use it
+		class XbimMeshCache
+		{
+		public:
+			//bump when the meshes written by the engine change, so entries written by an older engine are not used
+			static const int Version = 1;
+			//the cache shared by the engine, closed until it is opened
+			static XbimMeshCache& Default();
+			XbimMeshCache();
+			~XbimMeshCache();
+			//opens the cache file, creating it if it does not exist, returns false with the reason in error if it cannot be opened
+			bool Open(const std::string& path, std::string& error);
+			void Close();
+			bool IsOpen();
+			//copies the entry with the key to data and returns true, or returns false if there is none
+			bool Find(const std::string& key, std::string& data);
+			//adds an entry, if the key is already in the cache the entry is not changed, returns false if the file could not be written
+			bool Add(const std::string& key, const char* data, size_t length);
+			size_t Count();
+		private:
+			struct Impl;
+			Impl* _impl;
+			XbimMeshCache(const XbimMeshCache&);
+			XbimMeshCache& operator=(const XbimMeshCache&);
+		};
+	}
+}
@@ -1,6 +1,6 @@
 #include "XbimOccShape.h"
 #include "XbimFaceSet.h"
-#include "XbimPoint3DWithTolerance.h"
+#include "XbimTriangulationWriter.h"
 #include "XbimGeomPrim.h"
 #include <BRepCheck_Analyzer.hxx>
 #include <BRepMesh_IncrementalMesh.hxx>
@@ -14,6 +14,7 @@
 #include <BRepBndLib.hxx>
 #include "XbimWire.h"
 using namespace System::Threading;
+using namespace System::Threading::Tasks;
 using namespace System::Collections::Generic;
 using namespace Xbim::Tessellator;
 
@@ -21,6 +22,70 @@ namespace Xbim
 {
 	namespace Geometry
 	{
+		//Tessellates planar faces natively, falling back to Tess for faces whose bounds cross or touch. The faces are split in to
+		//contiguous ranges, each with its own native tessellator, and the result for each face is kept against its index so the
+		//ranges can be processed in any order
+		ref class XbimPlanarFaceTessellator
+		{
+		private:
+			array<XbimFace^>^ _faces;
+			array<Tess^>^ _results;
+			std::vector<XbimPlanarTessellator>* _tessellators;
+			std::vector<size_t>* _tessellations;
+		public:
+			XbimPlanarFaceTessellator(array<XbimFace^>^ faces, std::vector<XbimPlanarTessellator>& tessellators, std::vector<size_t>& tessellations)
+			{
+				_faces = faces;
+				_results = gcnew array<Tess^>(faces->Length);
+				_tessellators = &tessellators;
+				_tessellations = &tessellations;
+				_tessellations->assign(faces->Length, XbimPlanarTessellator::NotTessellated);
+			}
+			//the Tess tessellation of each face, null for faces that were not given, curved faces, faces tessellated natively
+			//and faces that have no triangles
+			property array<Tess^>^ Results{array<Tess^>^ get(){ return _results; }}
+
+			//the index of the first face of a range, the native tessellations of its faces are held by the range's tessellator
+			int RangeStart(int range)
+			{
+				return (int)((long long)range * _faces->Length / (long long)_tessellators->size());
+			}
+
+			void TessellateRange(int range)
+			{
+				XbimPlanarTessellator& planarTessellator = (*_tessellators)[range];
+				for (int faceIndex = RangeStart(range); faceIndex < RangeStart(range + 1); faceIndex++)
+				{
+					XbimFace^ face = _faces[faceIndex];
+					if (face == nullptr || !face->IsPolygonal) continue;
+					const TopoDS_Face& topoFace = face;
+					(*_tessellations)[faceIndex] = planarTessellator.Tessellate(topoFace);
+					if ((*_tessellations)[faceIndex] == XbimPlanarTessellator::NotTessellated)
+						Tessellate(faceIndex);
+				}
+			}
+
+			void Tessellate(int faceIndex)
+			{
+				XbimFace^ face = _faces[faceIndex];
+				if (face == nullptr || !face->IsPolygonal) return;
+				IXbimWireSet^ bounds = face->Bounds;
+				List<array<ContourVertex>^>^ contours = gcnew List<array<ContourVertex>^>(bounds->Count);
+				for each (XbimWire^ bound in bounds)
+				{
+					array<ContourVertex>^ contour = bound->Contour();
+					if (contour->Length > 0)
+						contours->Add(contour);
+				}
+				if (contours->Count == 0) return;
+				Tess^ tess = gcnew Tess();
+				tess->AddContours(contours, true);
+				tess->Tessellate(Xbim::Tessellator::WindingRule::EvenOdd, Xbim::Tessellator::ElementType::Polygons, 3);
+				if (tess->ElementCount > 0)
+					_results[faceIndex] = tess;
+			}
+		};
+
 		XbimOccShape::XbimOccShape()
 		{
 		}
@@ -45,13 +110,11 @@ namespace Xbim
 				Monitor::Exit(this);
 			}
 
-			Dictionary<XbimPoint3DWithTolerance^, size_t>^ pointMap = gcnew Dictionary<XbimPoint3DWithTolerance^, size_t>();
+			XbimVertexWelder pointMap(tolerance, faces->Count * 5);
 			List<List<size_t>^>^ pointLookup = gcnew List<List<size_t>^>(faces->Count);
-			List<XbimPoint3D>^ points = gcnew List<XbimPoint3D>(faces->Count * 5);;
 
-			Dictionary<XbimPoint3DWithTolerance^, size_t>^ normalMap = gcnew Dictionary<XbimPoint3DWithTolerance^, size_t>();
+			XbimVertexWelder normalMap(tolerance, faces->Count * 4);
 			List<List<size_t>^>^ normalLookup = gcnew List<List<size_t>^>(faces->Count);
-			List<XbimVector3D>^ normals = gcnew List<XbimVector3D>(faces->Count * 4);
 			List<XbimFace^>^ writtenFaces = gcnew List<XbimFace^>(faces->Count);
 			//First write out all the vertices
 			int faceIndex = 0;
@@ -70,7 +133,8 @@ namespace Xbim
 				List<size_t>^ norms;
 				if (!isPolygonal)
 				{
-					Poly::ComputeNormals(mesh); //we need the normals
+					if (!mesh->HasNormals()) //shared shapes have them already
+						Poly::ComputeNormals(mesh); //we need the normals
 					norms = gcnew List<size_t>(mesh->NbNodes());
 					for (Standard_Integer i = 1; i <= mesh->NbNodes() * 3; i += 3) //visit each node
 					{
@@ -81,56 +145,41 @@ namespace Xbim
 						{
 							x *= -1; y *= -1; z *= -1;
 						}
-						size_t index;
-						XbimPoint3DWithTolerance^ n = gcnew XbimPoint3DWithTolerance(x, y, z, tolerance);
-						if (!normalMap->TryGetValue(n, index))
-						{
-							index = normalMap->Count;
-							normalMap->Add(n, index);
-							normals->Add(XbimVector3D(x, y, z));
-						}
-						norms->Add(index);
+						norms->Add(normalMap.Weld(x, y, z));
 					}
 				}
 				else
 				{
 					norms = gcnew List<size_t>(1);
-					size_t index;
-					XbimPoint3DWithTolerance^ n = gcnew XbimPoint3DWithTolerance(face->Normal.X, face->Normal.Y, face->Normal.Z, tolerance);
-					if (!normalMap->TryGetValue(n, index))
-					{
-						index = normalMap->Count;
-						normalMap->Add(n, index);
-						normals->Add(XbimVector3D(n->X, n->Y, n->Z));
-					}
-					norms->Add(index);
+					XbimVector3D n = face->Normal;
+					norms->Add(normalMap.Weld(n.X, n.Y, n.Z));
 				}
 				normalLookup->Add(norms);
 				for (Standard_Integer i = 1; i <= mesh->NbNodes(); i++) //visit each node for vertices
 				{
 					gp_XYZ p = nodes.Value(i).XYZ();
 					loc.Transformation().Transforms(p);
-					size_t index;
-					XbimPoint3DWithTolerance^ pt = gcnew XbimPoint3DWithTolerance(p.X(), p.Y(), p.Z(), tolerance);
-					if (!pointMap->TryGetValue(pt, index))
-					{
-						index = pointMap->Count;
-						pointMap->Add(pt, index);
-						points->Add(pt->VertexGeometry);
-					}
-					pointLookup[faceIndex]->Add(index);
+					pointLookup[faceIndex]->Add(pointMap.Weld(p.X(), p.Y(), p.Z()));
 				}
 				writtenFaces->Add(face);
 				faceIndex++;
 			}
 			// Write out header
-			textWriter->WriteLine(String::Format("P {0} {1} {2} {3} {4}", 1, points->Count, faces->Count, triangleCount, normals->Count));
+			textWriter->WriteLine(String::Format("P {0} {1} {2} {3} {4}", 1, pointMap.Count(), faces->Count, triangleCount, normalMap.Count()));
 			//write out vertices and normals  
 			textWriter->Write("V");
-			for each (XbimPoint3D p in points) textWriter->Write(String::Format(" {0},{1},{2}", p.X, p.Y, p.Z));
+			for (size_t i = 0; i < pointMap.Count(); i++)
+			{
+				const double* p = pointMap.Point(i);
+				textWriter->Write(String::Format(" {0},{1},{2}", p[0], p[1], p[2]));
+			}
 			textWriter->WriteLine();
 			textWriter->Write("N");
-			for each (XbimVector3D n in normals) textWriter->Write(String::Format(" {0},{1},{2}", n.X, n.Y, n.Z));
+			for (size_t i = 0; i < normalMap.Count(); i++)
+			{
+				const double* n = normalMap.Point(i);
+				textWriter->Write(String::Format(" {0},{1},{2}", n[0], n[1], n[2]));
+			}
 			textWriter->WriteLine();
 
 			//now write out the faces
@@ -181,6 +230,11 @@ namespace Xbim
 		}
 
 		void XbimOccShape::WriteTriangulation(BinaryWriter^ binaryWriter, double tolerance, double deflection, double angle)
+		{
+			WriteTriangulation(binaryWriter, tolerance, deflection, angle, false);
+		}
+
+		void XbimOccShape::WriteTriangulation(BinaryWriter^ binaryWriter, double tolerance, double deflection, double angle, bool inParallel)
 		{
 
 			if (!IsValid) return;
@@ -189,196 +243,115 @@ namespace Xbim
 
 			if (faces->Count == 0) return;
 
-			Dictionary<XbimPoint3DWithTolerance^, int>^ pointMap = gcnew Dictionary<XbimPoint3DWithTolerance^, int>();
-			List<List<int>^>^ pointLookup = gcnew List<List<int>^>(faces->Count);
-			List<XbimPoint3D>^ points = gcnew List<XbimPoint3D>(faces->Count * 3);;
-
-			Dictionary<int, int>^ normalMap = gcnew Dictionary<int, int>();
-			List<List<int>^>^ normalLookup = gcnew List<List<int>^>(faces->Count);
-			List<XbimPackedNormal>^ normals = gcnew List<XbimPackedNormal>(faces->Count);
-			//List<XbimFace^>^ writtenFaces = gcnew List<XbimFace^>(faces->Count);
-			//First write out all the vertices
+			array<XbimFace^>^ faceArray = gcnew array<XbimFace^>(faces->Count);
+			std::vector<TopoDS_Face> curvedFaces;
 			int faceIndex = 0;
-			int triangleCount = 0;
-			List<List<int>^>^ tessellations = gcnew List<List<int>^>(faces->Count);
-			
 			for each (XbimFace^ face in faces)
 			{
+				if (!face->IsPolygonal)
+				{
+					const TopoDS_Face& topoFace = face;
+					curvedFaces.push_back(topoFace);
+				}
+				faceArray[faceIndex++] = face;
+			}
+			//mesh the curved faces, the edges are shared between faces so seams stay watertight
+			XbimTriangulationWriter::MeshFaces(this, curvedFaces, deflection, angle, inParallel);
+
+			//tessellate the planar faces, in parallel each range of faces has a native tessellator of its own, the faces are
+			//tessellated the same way whichever range they fall in so the results do not depend on the number of ranges
+			int rangeCount = inParallel ? Math::Min(faceArray->Length, Environment::ProcessorCount * 4) : 1;
+			std::vector<XbimPlanarTessellator> planarTessellators(rangeCount);
+			std::vector<size_t> planarTessellations;
+			XbimPlanarFaceTessellator^ tessellator = gcnew XbimPlanarFaceTessellator(faceArray, planarTessellators, planarTessellations);
+			if (inParallel)
+				Parallel::For(0, rangeCount, gcnew Action<int>(tessellator, &XbimPlanarFaceTessellator::TessellateRange));
+			else
+				tessellator->TessellateRange(0);
+
+			//first pass, weld all the faces in face order, this sizes the stream exactly
+			XbimTriangulationWriter writer(tolerance, faceArray->Length);
+			int range = 0;
+			for (faceIndex = 0; faceIndex < faceArray->Length; faceIndex++)
+			{
+				XbimFace^ face = faceArray[faceIndex];
+				while (faceIndex >= tessellator->RangeStart(range + 1)) range++;
 				bool faceReversed = face->IsReversed;
-				bool isPolygonal = face->IsPolygonal;
-				List<int>^ norms;
-				Tess^ tess = gcnew Tess();
-				if (!isPolygonal)
+				if (!face->IsPolygonal)
 				{
-					Bnd_Box pBox;
-					BRepBndLib::Add(face, pBox);
-					BRepMesh_FastDiscret faceMesher(face, deflection, angle, pBox, Standard_True);
 					TopLoc_Location loc;
 					const Handle_Poly_Triangulation& mesh = BRep_Tool::Triangulation(face, loc);
 					if (mesh.IsNull())
 						continue;
-					const TColgp_Array1OfPnt & nodes = mesh->Nodes();
-					triangleCount += mesh->NbTriangles();
-					pointLookup->Add(gcnew List<int>(mesh->NbNodes()));
-					Poly::ComputeNormals(mesh); //we need the normals
-					norms = gcnew List<int>(mesh->NbNodes());
-					for (Standard_Integer i = 1; i <= mesh->NbNodes() * 3; i += 3) //visit each node
+					if (!mesh->HasNormals()) //shared shapes have them already
+						Poly::ComputeNormals(mesh); //we need the normals
+					unsigned short* packedNormals = writer.AddFace(mesh, loc, faceReversed);
+					const TShort_Array1OfShortReal& meshNormals = mesh->Normals();
+					for (Standard_Integer i = meshNormals.Lower(); i < meshNormals.Lower() + mesh->NbNodes() * 3; i += 3) //visit each node
 					{
-						Standard_Real x = mesh->Normals().Value(i);
-						Standard_Real y = mesh->Normals().Value(i + 1);
-						Standard_Real z = mesh->Normals().Value(i + 2);
+						Standard_Real x = meshNormals.Value(i);
+						Standard_Real y = meshNormals.Value(i + 1);
+						Standard_Real z = meshNormals.Value(i + 2);
 						if (faceReversed)
 						{
 							x *= -1; y *= -1; z *= -1;
 						}
-						int index;
 						XbimPackedNormal packedNormal = XbimPackedNormal(x, y, z);
-						int packedVal = packedNormal.U << 8 | packedNormal.V;
-						if (!normalMap->TryGetValue(packedVal, index))
-						{
-							index = normalMap->Count;
-							normalMap->Add(packedVal, index);
-							normals->Add(packedNormal);
-						}
-						norms->Add(index);
+						*packedNormals++ = (unsigned short)(packedNormal.U << 8 | packedNormal.V);
 					}
-					normalLookup->Add(norms);
-					for (Standard_Integer i = 1; i <= mesh->NbNodes(); i++) //visit each node for vertices
-					{
-						gp_XYZ p = nodes.Value(i).XYZ();
-						loc.Transformation().Transforms(p);
-						int index;
-						XbimPoint3DWithTolerance^ pt = gcnew XbimPoint3DWithTolerance(p.X(), p.Y(), p.Z(), tolerance);
-						if (!pointMap->TryGetValue(pt, index))
-						{
-							index = points->Count;
-							pointMap->Add(pt, index);
-							points->Add(pt->VertexGeometry);
-						}
-						pointLookup[faceIndex]->Add(index);
-					}
-					Standard_Integer t[3];
-					const Poly_Array1OfTriangle& triangles = mesh->Triangles();
-
-					List<int>^ elems = gcnew List<int>(mesh->NbTriangles() * 3);
-					for (Standard_Integer i = 1; i <= mesh->NbTriangles(); i++) //add each triangle as a face
-					{
-						if (faceReversed) //get nodes in the correct order of triangulation
-							triangles(i).Get(t[2], t[1], t[0]);
-						else
-							triangles(i).Get(t[0], t[1], t[2]);
-						elems->Add(t[0] - 1);
-						elems->Add(t[1] - 1);
-						elems->Add(t[2] - 1);
-					}
-					tessellations->Add(elems);
-					faceIndex++;
 				}
-				else //it is planar we can use LibMeshDotNet
+				else if (planarTessellations[faceIndex] != XbimPlanarTessellator::NotTessellated)
 				{
-					norms = gcnew List<int>(1);					
-					IXbimWireSet^ bounds = face->Bounds;
-					List<array<ContourVertex>^>^ contours = gcnew List<array<ContourVertex>^>(bounds->Count);
-					for each (XbimWire^ bound in bounds)
-					{						
-						array<ContourVertex>^ contour = bound->Contour();
-						if (contour->Length > 0)
-							contours->Add(contour);
-					}
-					if (contours->Count > 0)
+					const XbimPlanarTessellator& planarTessellator = planarTessellators[range];
+					const double* n = planarTessellator.Normal(planarTessellations[faceIndex]);
+					XbimPackedNormal packedNormal = XbimPackedNormal(n[0], n[1], n[2]);
+					writer.AddPlanarFace((unsigned short)(packedNormal.U << 8 | packedNormal.V), planarTessellator, planarTessellations[faceIndex]);
+				}
+				else //it is planar and was tessellated by LibMeshDotNet
+				{
+					Tess^ tess = tessellator->Results[faceIndex];
+					if (tess == nullptr)
+						continue;
+					XbimVector3D fn(tess->Normal[0], tess->Normal[1], tess->Normal[2]);
+					XbimPackedNormal packedNormal = XbimPackedNormal(fn);
+					writer.BeginPlanarFace((unsigned short)(packedNormal.U << 8 | packedNormal.V));
+					array<ContourVertex>^ contourVerts = tess->Vertices;
+					for (int v = 0; v < tess->VertexCount; v++) //visit each node for vertices
 					{
-						tess->AddContours(contours, true);
-						tess->Tessellate(Xbim::Tessellator::WindingRule::EvenOdd, Xbim::Tessellator::ElementType::Polygons, 3);
-						int numTriangles = tess->ElementCount;
-						triangleCount += numTriangles;
-						
-						array<ContourVertex>^ contourVerts = tess->Vertices;
-						array<int>^ elements = tess->Elements;
-						if (numTriangles > 0)
-						{
-							pointLookup->Add(gcnew List<int>(tess->VertexCount));
-							int index;
-							XbimVector3D fn(tess->Normal[0], tess->Normal[1], tess->Normal[2]);
-							XbimPackedNormal packedNormal = XbimPackedNormal(fn);
-							int packedVal = packedNormal.U << 8 | packedNormal.V;
-
-							if (!normalMap->TryGetValue(packedVal, index))
-							{
-								index = normalMap->Count;
-								normalMap->Add(packedVal, index);
-								normals->Add(packedNormal);
-							}
-							norms->Add(index);
-							normalLookup->Add(norms);
-							for (int i = 0; i < tess->VertexCount; i++) //visit each node for vertices
-							{
-								Vec3 p = contourVerts[i].Position;
-								int index;
-								XbimPoint3DWithTolerance^ pt = gcnew XbimPoint3DWithTolerance(p.X, p.Y, p.Z, tolerance);
-								if (!pointMap->TryGetValue(pt, index))
-								{
-									index = points->Count;
-									pointMap->Add(pt, index);
-									points->Add(pt->VertexGeometry);
-								}
-								pointLookup[faceIndex]->Add(index);
-							}
-							List<int>^ elems = gcnew List<int>(numTriangles * 3);
-							for (int j = 0; j < numTriangles; j++)
-							{
-								elems->Add(elements[j * 3]);
-								elems->Add(elements[j * 3 + 1]);
-								elems->Add(elements[j * 3 + 2]);
-							}
-							tessellations->Add(elems);
-							faceIndex++;
-						}
+						Vec3 p = contourVerts[v].Position;
+						writer.AddVertex(p.X, p.Y, p.Z);
 					}
+					array<int>^ elements = tess->Elements;
+					pin_ptr<int> pElements = &elements[0];
+					writer.EndPlanarFace(pElements, tess->ElementCount);
 				}
 			}
-			// Write out header
-			binaryWriter->Write((unsigned char)1); //stream format version
-			int numVertices = points->Count;
-			binaryWriter->Write((UInt32)numVertices); //number of vertices
-			binaryWriter->Write((UInt32)triangleCount); //number of triangles
-			//write out vertices 
-			for each (XbimPoint3D p in points)
-			{
-				binaryWriter->Write((float)p.X);
-				binaryWriter->Write((float)p.Y);
-				binaryWriter->Write((float)p.Z);
-			}
+			GC::KeepAlive(this);
 
-			//now write out the faces
-			faceIndex = 0;
-			binaryWriter->Write((Int32)tessellations->Count);
-			for each (List<int>^ tess in tessellations)
+			//second pass, serialise the whole stream in one go in to a buffer of the exact size
+			binaryWriter->Flush();
+			int streamSize = (int)writer.StreamSize();
+			MemoryStream^ memStream = dynamic_cast<MemoryStream^>(binaryWriter->BaseStream);
+			if (memStream != nullptr && memStream->CanWrite)
 			{
-				List<int>^ norms = normalLookup[faceIndex];
-				bool isPlanar = norms->Count == 1;
-				List<int>^ nodeLookup = pointLookup[faceIndex];
-				if (isPlanar)
+				Int64 start = memStream->Position;
+				try
 				{
-					binaryWriter->Write((Int32)tess->Count / 3);
-					normals[norms[0]].Write(binaryWriter); //write the normal for the face
+					if (start + streamSize > memStream->Length)
+						memStream->SetLength(start + streamSize);
+					array<Byte>^ streamBuffer = memStream->GetBuffer(); //write straight in to the stream's own buffer
+					pin_ptr<Byte> pBuffer = &streamBuffer[(int)start];
+					writer.Write(pBuffer);
+					memStream->Position = start + streamSize;
+					return;
 				}
-				else
-					binaryWriter->Write((Int32)(-tess->Count / 3)); //use negative count to indicate that every index has a normal			
-				for (int i = 0; i < tess->Count; i++)
-				{
-					if (isPlanar)
-					{
-						WriteIndex(binaryWriter, nodeLookup[tess[i]], numVertices);	
-					}
-					else //need to write every one
-					{
-						WriteIndex(binaryWriter, nodeLookup[tess[i]], numVertices);
-						normals[norms[tess[i]]].Write(binaryWriter);
-					}
-				}	
-				faceIndex++;
+				catch (NotSupportedException^) {} //the stream cannot grow, fall back to a copy
+				catch (UnauthorizedAccessException^) {} //the stream's buffer is not exposed
 			}
-			GC::KeepAlive(this);
+			array<Byte>^ buffer = gcnew array<Byte>(streamSize);
+			pin_ptr<Byte> pBuffer = &buffer[0];
+			writer.Write(pBuffer);
+			binaryWriter->Write(buffer);
 			binaryWriter->Flush();
 		}
 		
@@ -22,6 +22,8 @@ namespace Xbim
 			virtual operator const TopoDS_Shape& () abstract;
 			void WriteTriangulation(TextWriter^ textWriter, double tolerance, double deflection, double angle);
 			void WriteTriangulation(BinaryWriter^ binaryWriter, double tolerance, double deflection, double angle);
+			//if inParallel the faces are meshed and tessellated concurrently, the curved faces are meshed with their edges shared
+			void WriteTriangulation(BinaryWriter^ binaryWriter, double tolerance, double deflection, double angle, bool inParallel);
 			virtual property bool IsSet{bool get() override { return false; }; }
 			
 		};
@@ -0,0 +1,542 @@
+#include "XbimPlanarTessellator.h"
+#include <TopExp.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Wire.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+#include <BRepTools_WireExplorer.hxx>
+#include <BRep_Tool.hxx>
+#include <gp_Pnt.hxx>
+#include <algorithm>
+#include <cmath>
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		//the vertex types of the sweep, see de Berg et al, Computational Geometry, chapter 3
+		enum SweepVertexType { StartVertex, EndVertex, SplitVertex, MergeVertex, RegularVertex };
+		static const unsigned int NoEdge = 0xFFFFFFFF;
+		static const unsigned char LeftChain = 0;
+		static const unsigned char RightChain = 1;
+
+		XbimPlanarTessellator::XbimPlanarTessellator() : _area(0)
+		{
+		}
+
+		void XbimPlanarTessellator::Clear()
+		{
+			_tessellations.clear();
+			_vertices.clear();
+			_elements.clear();
+		}
+
+		size_t XbimPlanarTessellator::Tessellate(const TopoDS_Face& face)
+		{
+			TopTools_IndexedMapOfShape wires;
+			TopExp::MapShapes(face, TopAbs_WIRE, wires);
+			for (int i = 1; i <= wires.Extent(); i++)
+			{
+				BeginContour();
+				for (BRepTools_WireExplorer exp(TopoDS::Wire(wires(i))); exp.More(); exp.Next())
+				{
+					gp_Pnt p = BRep_Tool::Pnt(exp.CurrentVertex());
+					AddPoint(p.X(), p.Y(), p.Z());
+				}
+			}
+			return Tessellate();
+		}
+
+		void XbimPlanarTessellator::BeginContour()
+		{
+			_contourStarts.push_back(_points.size());
+		}
+
+		void XbimPlanarTessellator::AddPoint(double x, double y, double z)
+		{
+			size_t count = _points.size();
+			if (!_contourStarts.empty() && count > _contourStarts.back()) //skip repeated points
+			{
+				const double* last = &_points[count - 3];
+				if (last[0] == x && last[1] == y && last[2] == z) return;
+			}
+			_points.push_back(x);
+			_points.push_back(y);
+			_points.push_back(z);
+		}
+
+		bool XbimPlanarTessellator::Above(unsigned int a, unsigned int b) const
+		{
+			const SweepVertex& va = _sweep[a];
+			const SweepVertex& vb = _sweep[b];
+			return va.t > vb.t || (va.t == vb.t && va.s < vb.s);
+		}
+
+		double XbimPlanarTessellator::Orient(unsigned int a, unsigned int b, unsigned int c) const
+		{
+			const SweepVertex& va = _sweep[a];
+			const SweepVertex& vb = _sweep[b];
+			const SweepVertex& vc = _sweep[c];
+			return (vb.s - va.s) * (vc.t - va.t) - (vb.t - va.t) * (vc.s - va.s);
+		}
+
+		//where the edge from e to its next vertex crosses the sweep line at t, exactly at its ends
+		double XbimPlanarTessellator::EdgeX(unsigned int e, double t) const
+		{
+			const SweepVertex& a = _sweep[e];
+			const SweepVertex& b = _sweep[a.next];
+			if (t == b.t) return b.s;
+			if (t == a.t) return a.s;
+			return a.s + (t - a.t) * (b.s - a.s) / (b.t - a.t);
+		}
+
+		//the first edge in the sweep status that crosses the sweep line at or to the right of vertex v
+		std::vector<unsigned int>::iterator XbimPlanarTessellator::StatusBound(unsigned int v)
+		{
+			const SweepVertex& sv = _sweep[v];
+			return std::lower_bound(_status.begin(), _status.end(), v, [this, &sv](unsigned int e, unsigned int)
+			{
+				return EdgeX(e, sv.t) < sv.s;
+			});
+		}
+
+		//the edge in the sweep status that is immediately to the left of vertex v
+		unsigned int XbimPlanarTessellator::LeftOf(unsigned int v)
+		{
+			std::vector<unsigned int>::iterator bound = StatusBound(v);
+			return bound == _status.begin() ? NoEdge : *(bound - 1);
+		}
+
+		//adds edge e, which starts the sweep at vertex v, to the sweep status keeping it ordered left to right
+		std::vector<unsigned int>::iterator XbimPlanarTessellator::Insert(unsigned int e, unsigned int v)
+		{
+			return _status.insert(StatusBound(v), e);
+		}
+
+		//removes edge e, which ends at vertex v, from the sweep status
+		bool XbimPlanarTessellator::Remove(unsigned int e, unsigned int v)
+		{
+			//the edge crosses the sweep line at v, so it is among those that start the bound
+			double s = _sweep[v].s, t = _sweep[v].t;
+			for (std::vector<unsigned int>::iterator it = StatusBound(v); it != _status.end() && EdgeX(*it, t) == s; ++it)
+			{
+				if (*it == e)
+				{
+					_status.erase(it);
+					return true;
+				}
+			}
+			//the bounds cross and the status is out of order, the tessellation will be rejected but the sweep must complete
+			std::vector<unsigned int>::iterator found = std::find(_status.begin(), _status.end(), e);
+			if (found == _status.end()) return false;
+			_status.erase(found);
+			return true;
+		}
+
+		void XbimPlanarTessellator::AddDiagonal(unsigned int a, unsigned int b)
+		{
+			if (a == b || _sweep[a].next == b || _sweep[a].prev == b) return; //already connected
+			_diagonals.push_back(a);
+			_diagonals.push_back(b);
+		}
+
+		size_t XbimPlanarTessellator::Tessellate()
+		{
+			size_t result = NotTessellated;
+			size_t vertexStart = _vertices.size() / 3;
+			size_t elementStart = _elements.size();
+			//collect the contours with at least 3 distinct points, as start and count pairs in _contours
+			_contours.clear();
+			double outerArea = 0;
+			double normal[3] = { 0, 0, 0 };
+			for (size_t c = 0; c < _contourStarts.size(); c++)
+			{
+				size_t start = _contourStarts[c] / 3;
+				size_t end = (c + 1 < _contourStarts.size() ? _contourStarts[c + 1] : _points.size()) / 3;
+				size_t count = end - start;
+				if (count > 1)
+				{
+					const double* first = &_points[start * 3];
+					const double* last = &_points[(end - 1) * 3];
+					if (first[0] == last[0] && first[1] == last[1] && first[2] == last[2]) count--; //closed explicitly
+				}
+				if (count < 3) continue;
+				//Newell's normal, its length is twice the area of the contour
+				double n[3] = { 0, 0, 0 };
+				for (size_t i = 0; i < count; i++)
+				{
+					const double* p = &_points[(start + i) * 3];
+					const double* q = &_points[(start + (i + 1) % count) * 3];
+					n[0] += (p[1] - q[1]) * (p[2] + q[2]);
+					n[1] += (p[2] - q[2]) * (p[0] + q[0]);
+					n[2] += (p[0] - q[0]) * (p[1] + q[1]);
+				}
+				double area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				if (area > outerArea)
+				{
+					outerArea = area;
+					normal[0] = n[0]; normal[1] = n[1]; normal[2] = n[2];
+				}
+				_contours.push_back((unsigned int)start);
+				_contours.push_back((unsigned int)count);
+			}
+			size_t contourCount = _contours.size() / 2;
+			if (contourCount > 0 && outerArea > 0)
+			{
+				Tessellation tessellation;
+				for (int i = 0; i < 3; i++) tessellation.normal[i] = normal[i] / outerArea;
+				//project on to the axis plane most nearly parallel to the face, keeping the outer bound anti-clockwise
+				int axis = 0;
+				if (std::fabs(normal[1]) > std::fabs(normal[axis])) axis = 1;
+				if (std::fabs(normal[2]) > std::fabs(normal[axis])) axis = 2;
+				int sAxis = (axis + 1) % 3, tAxis = (axis + 2) % 3;
+				double tSign = normal[axis] > 0 ? 1. : -1.;
+				_sweep.clear();
+				for (size_t c = 0; c < contourCount; c++)
+				{
+					size_t start = _contours[c * 2], count = _contours[c * 2 + 1];
+					for (size_t i = 0; i < count; i++)
+					{
+						const double* p = &_points[(start + i) * 3];
+						SweepVertex v;
+						v.s = p[sAxis];
+						v.t = p[tAxis] * tSign;
+						v.type = RegularVertex;
+						v.helper = NoEdge;
+						_sweep.push_back(v);
+						_vertices.insert(_vertices.end(), p, p + 3);
+					}
+				}
+				//link each contour as it was given and sort the vertices from the top down, the order serves the nesting and the sweep
+				unsigned int first = 0;
+				for (size_t c = 0; c < contourCount; c++)
+				{
+					unsigned int count = _contours[c * 2 + 1];
+					for (unsigned int i = 0; i < count; i++)
+					{
+						_sweep[first + i].prev = first + (i + count - 1) % count;
+						_sweep[first + i].next = first + (i + 1) % count;
+					}
+					first += count;
+				}
+				unsigned int n = (unsigned int)_sweep.size();
+				_order.resize(n);
+				for (unsigned int i = 0; i < n; i++) _order[i] = i;
+				std::sort(_order.begin(), _order.end(), [this](unsigned int a, unsigned int b) { return Above(a, b); });
+				bool valid = contourCount == 1 || Nest(); //a lone contour is not nested
+				//orient each contour by how deeply it is nested, for the even odd rule regions inside an odd number of contours are filled
+				double expectedArea = 0;
+				first = 0;
+				for (size_t c = 0; c < contourCount && valid; c++)
+				{
+					unsigned int count = _contours[c * 2 + 1];
+					double area = 0;
+					unsigned int top = first;
+					for (unsigned int i = 0; i < count; i++)
+					{
+						const SweepVertex& p = _sweep[first + i];
+						const SweepVertex& q = _sweep[first + (i + 1) % count];
+						area += p.s * q.t - q.s * p.t;
+						if (Above(first + i, top)) top = first + i;
+					}
+					area *= 0.5;
+					//each contour that encloses the top vertex has an odd number of edges to its left, any other an even number
+					bool filled = contourCount == 1 || _crossings[top] % 2 == 0;
+					if (area == 0) valid = false;
+					bool reverse = (area > 0) != filled;
+					expectedArea += filled ? std::fabs(area) : -std::fabs(area);
+					if (reverse)
+					{
+						for (unsigned int i = first; i < first + count; i++)
+							std::swap(_sweep[i].prev, _sweep[i].next);
+					}
+					first += count;
+				}
+				_area = 0;
+				if (valid && expectedArea > 0 && Sweep() && BuildAdjacency() && TriangulateFaces() &&
+					std::fabs(_area - expectedArea) <= expectedArea * 1e-6)
+				{
+					tessellation.vertexStart = vertexStart;
+					tessellation.vertexCount = _sweep.size();
+					tessellation.elementStart = elementStart;
+					tessellation.triangleCount = (_elements.size() - elementStart) / 3;
+					result = _tessellations.size();
+					_tessellations.push_back(tessellation);
+				}
+			}
+			if (result == NotTessellated) //roll back anything written for this face
+			{
+				_vertices.resize(vertexStart * 3);
+				_elements.resize(elementStart);
+			}
+			_points.clear();
+			_contourStarts.clear();
+			return result;
+		}
+
+		//counts the edges to the left of each vertex as the sweep line reaches it, at the top vertex of a contour none of its own
+		//edges are yet in the sweep status, so the count is odd if and only if the contour is inside an odd number of others
+		bool XbimPlanarTessellator::Nest()
+		{
+			_status.clear();
+			_crossings.resize(_sweep.size());
+			for (size_t i = 0; i < _order.size(); i++)
+			{
+				unsigned int v = _order[i];
+				const SweepVertex& sv = _sweep[v];
+				_crossings[v] = (unsigned int)(StatusBound(v) - _status.begin());
+				//the edges that end at v leave the status and those that start at v join it
+				if (Above(sv.prev, v) && !Remove(sv.prev, v)) return false;
+				if (Above(sv.next, v) && !Remove(v, v)) return false;
+				if (Above(v, sv.prev)) Insert(sv.prev, v);
+				if (Above(v, sv.next))
+				{
+					std::vector<unsigned int>::iterator inserted = Insert(v, v);
+					//both edges start at v, the one that leans furthest to the left comes first
+					if (inserted + 1 != _status.end() && *(inserted + 1) == sv.prev && Orient(v, sv.prev, sv.next) > 0)
+						std::iter_swap(inserted, inserted + 1);
+				}
+			}
+			return true;
+		}
+
+		//splits the polygon in to y-monotone pieces, the diagonals that do so are added to _diagonals, _order holds the
+		//vertices from the top down
+		bool XbimPlanarTessellator::Sweep()
+		{
+			unsigned int n = (unsigned int)_sweep.size();
+			for (unsigned int i = 0; i < n; i++)
+			{
+				SweepVertex& v = _sweep[i];
+				bool prevBelow = Above(i, v.prev);
+				bool nextBelow = Above(i, v.next);
+				bool convex = Orient(v.prev, i, v.next) > 0;
+				if (prevBelow && nextBelow)
+					v.type = convex ? StartVertex : SplitVertex;
+				else if (!prevBelow && !nextBelow)
+					v.type = convex ? EndVertex : MergeVertex;
+				else
+					v.type = RegularVertex;
+			}
+			_status.clear();
+			_diagonals.clear();
+			for (unsigned int i = 0; i < n; i++)
+			{
+				unsigned int v = _order[i];
+				SweepVertex& sv = _sweep[v];
+				unsigned int e;
+				switch (sv.type)
+				{
+				case StartVertex:
+					Insert(v, v);
+					sv.helper = v;
+					break;
+				case SplitVertex:
+					e = LeftOf(v);
+					if (e == NoEdge) return false;
+					AddDiagonal(v, _sweep[e].helper);
+					_sweep[e].helper = v;
+					Insert(v, v);
+					sv.helper = v;
+					break;
+				case EndVertex:
+				case MergeVertex:
+					e = sv.prev;
+					if (_sweep[e].helper == NoEdge) return false;
+					if (_sweep[_sweep[e].helper].type == MergeVertex)
+						AddDiagonal(v, _sweep[e].helper);
+					if (!Remove(e, v)) return false;
+					if (sv.type == MergeVertex)
+					{
+						e = LeftOf(v);
+						if (e == NoEdge) return false;
+						if (_sweep[_sweep[e].helper].type == MergeVertex)
+							AddDiagonal(v, _sweep[e].helper);
+						_sweep[e].helper = v;
+					}
+					break;
+				default:
+					if (Above(sv.prev, v)) //the interior is to the right, we are on the left hand side of the polygon
+					{
+						e = sv.prev;
+						if (_sweep[e].helper == NoEdge) return false;
+						if (_sweep[_sweep[e].helper].type == MergeVertex)
+							AddDiagonal(v, _sweep[e].helper);
+						if (!Remove(e, v)) return false;
+						Insert(v, v);
+						sv.helper = v;
+					}
+					else
+					{
+						e = LeftOf(v);
+						if (e == NoEdge) return false;
+						if (_sweep[_sweep[e].helper].type == MergeVertex)
+							AddDiagonal(v, _sweep[e].helper);
+						_sweep[e].helper = v;
+					}
+					break;
+				}
+			}
+			return true;
+		}
+
+		//builds the neighbours of each vertex, boundary edges and diagonals, ordered anti-clockwise around the vertex
+		bool XbimPlanarTessellator::BuildAdjacency()
+		{
+			unsigned int n = (unsigned int)_sweep.size();
+			_adjacencyStart.assign(n + 1, 0);
+			for (unsigned int i = 0; i < n; i++) _adjacencyStart[i + 1] = 2;
+			for (size_t i = 0; i < _diagonals.size(); i++) _adjacencyStart[_diagonals[i] + 1]++;
+			for (unsigned int i = 0; i < n; i++) _adjacencyStart[i + 1] += _adjacencyStart[i];
+			_adjacency.resize(_adjacencyStart[n]);
+			//use _order as the fill position of each vertex
+			_order.assign(_adjacencyStart.begin(), _adjacencyStart.end() - 1);
+			for (unsigned int i = 0; i < n; i++)
+			{
+				_adjacency[_order[i]++] = _sweep[i].next;
+				_adjacency[_order[i]++] = _sweep[i].prev;
+			}
+			for (size_t i = 0; i < _diagonals.size(); i += 2)
+			{
+				unsigned int a = _diagonals[i], b = _diagonals[i + 1];
+				_adjacency[_order[a]++] = b;
+				_adjacency[_order[b]++] = a;
+			}
+			for (unsigned int i = 0; i < n; i++)
+			{
+				const SweepVertex& v = _sweep[i];
+				std::vector<unsigned int>::iterator begin = _adjacency.begin() + _adjacencyStart[i];
+				std::vector<unsigned int>::iterator end = _adjacency.begin() + _adjacencyStart[i + 1];
+				std::sort(begin, end, [this, &v](unsigned int a, unsigned int b)
+				{
+					//by angle from the positive s axis, compared by half plane and then cross product as atan2 cannot separate directions near pi
+					double as = _sweep[a].s - v.s, at = _sweep[a].t - v.t;
+					double bs = _sweep[b].s - v.s, bt = _sweep[b].t - v.t;
+					bool aLower = at < 0 || (at == 0 && as < 0);
+					bool bLower = bt < 0 || (bt == 0 && bs < 0);
+					if (aLower != bLower) return bLower;
+					return as * bt - at * bs > 0;
+				});
+				for (std::vector<unsigned int>::iterator it = begin + 1; it < end; ++it)
+					if (*it == *(it - 1)) return false; //coincident edges, the bounds touch
+			}
+			return true;
+		}
+
+		//walks each face of the subdivided polygon, keeping the face on the left, and triangulates it
+		bool XbimPlanarTessellator::TriangulateFaces()
+		{
+			unsigned int n = (unsigned int)_sweep.size();
+			_visited.assign(_adjacency.size(), 0);
+			for (unsigned int v = 0; v < n; v++)
+			{
+				for (unsigned int slot = _adjacencyStart[v]; slot < _adjacencyStart[v + 1]; slot++)
+				{
+					if (_visited[slot] || _adjacency[slot] == _sweep[v].prev) continue; //done or outside the polygon
+					_face.clear();
+					unsigned int u = v, uSlot = slot;
+					do
+					{
+						if (_visited[uSlot] || _adjacency[uSlot] == _sweep[u].prev || _face.size() > n) return false;
+						_visited[uSlot] = 1;
+						_face.push_back(u);
+						unsigned int w = _adjacency[uSlot];
+						unsigned int wStart = _adjacencyStart[w], wDegree = _adjacencyStart[w + 1] - wStart;
+						unsigned int j = 0;
+						while (j < wDegree && _adjacency[wStart + j] != u) j++;
+						if (j == wDegree) return false;
+						uSlot = wStart + (j + wDegree - 1) % wDegree; //the next edge clockwise from the one we arrived on
+						u = w;
+					} while (u != v || uSlot != slot);
+					if (!TriangulateMonotone()) return false;
+				}
+			}
+			return true;
+		}
+
+		//triangulates the y-monotone polygon in _face, its vertices are in anti-clockwise order
+		bool XbimPlanarTessellator::TriangulateMonotone()
+		{
+			size_t k = _face.size();
+			if (k < 3) return false;
+			size_t top = 0, bottom = 0;
+			for (size_t i = 1; i < k; i++)
+			{
+				if (Above(_face[i], _face[top])) top = i;
+				if (Above(_face[bottom], _face[i])) bottom = i;
+			}
+			//merge the left chain, anti-clockwise from the top, with the right chain, clockwise from the top
+			_monotone.clear();
+			_chain.clear();
+			_monotone.push_back(_face[top]);
+			_chain.push_back(LeftChain);
+			size_t li = (top + 1) % k, ri = (top + k - 1) % k;
+			while (li != bottom || ri != bottom)
+			{
+				bool takeLeft = li == bottom ? false : (ri == bottom ? true : Above(_face[li], _face[ri]));
+				if (takeLeft)
+				{
+					_monotone.push_back(_face[li]);
+					_chain.push_back(LeftChain);
+					li = (li + 1) % k;
+				}
+				else
+				{
+					_monotone.push_back(_face[ri]);
+					_chain.push_back(RightChain);
+					ri = (ri + k - 1) % k;
+				}
+				if (!Above(_monotone[_monotone.size() - 2], _monotone.back())) return false; //not monotone
+			}
+			_monotone.push_back(_face[bottom]);
+			if (!Above(_monotone[_monotone.size() - 2], _monotone.back())) return false;
+
+			_stack.clear();
+			_stack.push_back(0);
+			_stack.push_back(1);
+			for (size_t j = 2; j < k - 1; j++)
+			{
+				unsigned int u = _monotone[j];
+				if (_chain[j] != _chain[_stack.back()])
+				{
+					for (size_t i = 0; i + 1 < _stack.size(); i++)
+						Emit(u, _monotone[_stack[i]], _monotone[_stack[i + 1]]);
+					_stack.clear();
+					_stack.push_back((unsigned int)j - 1);
+					_stack.push_back((unsigned int)j);
+				}
+				else
+				{
+					unsigned int last = _stack.back();
+					_stack.pop_back();
+					while (!_stack.empty())
+					{
+						unsigned int b = _stack.back();
+						double orient = Orient(_monotone[b], _monotone[last], u);
+						if (_chain[j] == LeftChain ? orient <= 0 : orient >= 0) break; //the diagonal would be outside
+						Emit(_monotone[b], _monotone[last], u);
+						last = b;
+						_stack.pop_back();
+					}
+					_stack.push_back(last);
+					_stack.push_back((unsigned int)j);
+				}
+			}
+			unsigned int u = _monotone[k - 1];
+			for (size_t i = 0; i + 1 < _stack.size(); i++)
+				Emit(u, _monotone[_stack[i]], _monotone[_stack[i + 1]]);
+			return true;
+		}
+
+		//adds the triangle wound anti-clockwise, slivers with no area are dropped
+		void XbimPlanarTessellator::Emit(unsigned int a, unsigned int b, unsigned int c)
+		{
+			double orient = Orient(a, b, c);
+			if (orient == 0) return;
+			if (orient < 0) std::swap(b, c);
+			_elements.push_back((int)a);
+			_elements.push_back((int)b);
+			_elements.push_back((int)c);
+			_area += std::fabs(orient) * 0.5;
+		}
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <TopoDS_Face.hxx>
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		//Native tessellator for planar faces, triangulates the bounds of a face with the even odd winding rule
+		//The contours are projected on to the plane of the outer bound, nested and split in to y-monotone pieces by sweep lines whose
+		//status is kept ordered, and each piece is triangulated with the usual stack method. Bounds that cross or touch, which need
+		//the intersection handling of the managed Tess, are rejected so the caller can fall back to it
+		//The results of many faces are held in flat buffers and the working buffers are reused from face to face, so once the
+		//buffers have grown to fit the largest face no further allocation is made
+		class XbimPlanarTessellator
+		{
+		public:
+			static const size_t NotTessellated = (size_t)-1;
+			XbimPlanarTessellator();
+			//tessellates the wires of a face, returns the index of the tessellation or NotTessellated if the face cannot be handled
+			size_t Tessellate(const TopoDS_Face& face);
+			//contours can also be given point by point, call BeginContour before the points of each contour and then Tessellate
+			void BeginContour();
+			void AddPoint(double x, double y, double z);
+			size_t Tessellate();
+			//removes all tessellations but retains the capacity for reuse
+			void Clear();
+
+			size_t Count() const { return _tessellations.size(); }
+			//the normal of the plane the triangles are wound anti-clockwise about, it is that of the outer bound
+			const double* Normal(size_t tessellation) const { return _tessellations[tessellation].normal; }
+			size_t VertexCount(size_t tessellation) const { return _tessellations[tessellation].vertexCount; }
+			//3 coordinates for each vertex
+			const double* Vertices(size_t tessellation) const { return _vertices.data() + _tessellations[tessellation].vertexStart * 3; }
+			size_t TriangleCount(size_t tessellation) const { return _tessellations[tessellation].triangleCount; }
+			//3 indices in to the vertices of the tessellation for each triangle
+			const int* Elements(size_t tessellation) const { return _elements.data() + _tessellations[tessellation].elementStart; }
+		private:
+			struct Tessellation
+			{
+				double normal[3];
+				size_t vertexStart;
+				size_t vertexCount;
+				size_t elementStart;
+				size_t triangleCount;
+			};
+			struct SweepVertex
+			{
+				double s, t; //position projected on to the plane
+				unsigned int prev, next; //neighbours in the contour, ordered so that the interior is on the left
+				unsigned int type;
+				unsigned int helper;
+			};
+			//results
+			std::vector<Tessellation> _tessellations;
+			std::vector<double> _vertices;
+			std::vector<int> _elements;
+			//working buffers, reused for each face
+			std::vector<double> _points;
+			std::vector<size_t> _contourStarts;
+			std::vector<unsigned int> _contours;
+			std::vector<SweepVertex> _sweep;
+			std::vector<unsigned int> _order;
+			std::vector<unsigned int> _crossings;
+			//the edges that cross the sweep line, ordered left to right, each edge is named by the vertex it starts at
+			std::vector<unsigned int> _status;
+			std::vector<unsigned int> _diagonals;
+			std::vector<unsigned int> _adjacencyStart;
+			std::vector<unsigned int> _adjacency;
+			std::vector<unsigned char> _visited;
+			std::vector<unsigned int> _face;
+			std::vector<unsigned int> _monotone;
+			std::vector<unsigned char> _chain;
+			std::vector<unsigned int> _stack;
+			double _area;
+
+			bool Above(unsigned int a, unsigned int b) const;
+			double Orient(unsigned int a, unsigned int b, unsigned int c) const;
+			double EdgeX(unsigned int e, double t) const;
+			std::vector<unsigned int>::iterator StatusBound(unsigned int v);
+			unsigned int LeftOf(unsigned int v);
+			std::vector<unsigned int>::iterator Insert(unsigned int e, unsigned int v);
+			bool Remove(unsigned int e, unsigned int v);
+			bool Nest();
+			void AddDiagonal(unsigned int a, unsigned int b);
+			bool Sweep();
+			bool BuildAdjacency();
+			bool TriangulateFaces();
+			bool TriangulateMonotone();
+			void Emit(unsigned int a, unsigned int b, unsigned int c);
+		};
+	}
+}
@@ -0,0 +1,92 @@
+#include "XbimShapeCache.h"
+#include <Standard_Mutex.hxx>
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <BRep_Tool.hxx>
+#include <Poly.hxx>
+#include <Poly_Triangulation.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+#include <cmath>
+#include <mutex>
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		XbimShapeKey::XbimShapeKey(double precision) : _invPrecision(precision > 0 ? 1 / precision : 1e5), _valid(true)
+		{
+			_bytes.reserve(128);
+		}
+
+		void XbimShapeKey::Add(int tag)
+		{
+			_bytes.append((const char*)&tag, sizeof(tag));
+		}
+
+		void XbimShapeKey::Add(double value)
+		{
+			long long snapped = (long long)std::floor(value * _invPrecision + 0.5);
+			_bytes.append((const char*)&snapped, sizeof(snapped));
+		}
+
+		void XbimShapeKey::AddExact(double value)
+		{
+			_bytes.append((const char*)&value, sizeof(value));
+		}
+
+		XbimShapeCache& XbimShapeCache::Default()
+		{
+			static std::once_flag created;
+			static XbimShapeCache* cache = 0;
+			std::call_once(created, []() { cache = new XbimShapeCache(); });
+			return *cache;
+		}
+
+		XbimShapeCache::XbimShapeCache() : _lock(new Standard_Mutex())
+		{
+		}
+
+		XbimShapeCache::~XbimShapeCache()
+		{
+			delete _lock;
+		}
+
+		bool XbimShapeCache::Find(const XbimShapeKey& key, TopoDS_Shape& shape)
+		{
+			Standard_Mutex::Sentry sentry(*_lock);
+			std::unordered_map<std::string, TopoDS_Shape>::const_iterator found = _shapes.find(key.Bytes());
+			if (found == _shapes.end()) return false;
+			shape = found->second;
+			return true;
+		}
+
+		TopoDS_Shape XbimShapeCache::Add(const XbimShapeKey& key, const TopoDS_Shape& shape, double deflection, double angle)
+		{
+			//the shape is not yet visible to other threads, so it is meshed, and its normals computed, outside the lock
+			//once shared the triangulation is only read, meshing an instance at the same deflection leaves it unchanged
+			BRepMesh_IncrementalMesh mesh(shape, deflection, Standard_False, angle);
+			for (TopExp_Explorer faceExp(shape, TopAbs_FACE); faceExp.More(); faceExp.Next())
+			{
+				TopLoc_Location loc;
+				const Handle_Poly_Triangulation& triangulation = BRep_Tool::Triangulation(TopoDS::Face(faceExp.Current()), loc);
+				if (!triangulation.IsNull() && !triangulation->HasNormals())
+					Poly::ComputeNormals(triangulation);
+			}
+			Standard_Mutex::Sentry sentry(*_lock);
+			std::pair<std::unordered_map<std::string, TopoDS_Shape>::iterator, bool> added = _shapes.insert(std::make_pair(key.Bytes(), shape));
+			return added.first->second;
+		}
+
+		void XbimShapeCache::Clear()
+		{
+			Standard_Mutex::Sentry sentry(*_lock);
+			_shapes.clear();
+		}
+
+		size_t XbimShapeCache::Count()
+		{
+			Standard_Mutex::Sentry sentry(*_lock);
+			return _shapes.size();
+		}
+	}
+}
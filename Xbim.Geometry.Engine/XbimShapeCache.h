@@ -0,0 +1,59 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <cstddef>
+#include <TopoDS_Shape.hxx>
+
+class Standard_Mutex;
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		//Canonical key of the geometry of a representation item, excluding its placement
+		//Values are snapped to a grid of precision, so items that differ by less than the model's precision have the same key
+		class XbimShapeKey
+		{
+		public:
+			XbimShapeKey(double precision);
+			//adds a value that must match exactly, a type or a count
+			void Add(int tag);
+			//adds a length, coordinate or angle
+			void Add(double value);
+			//adds a value that must match exactly without snapping, a tolerance or setting
+			void AddExact(double value);
+			//marks the item as one that cannot be keyed, it is then built as normal and not shared
+			void Invalidate() { _valid = false; }
+			bool IsValid() const { return _valid; }
+			const std::string& Bytes() const { return _bytes; }
+		private:
+			double _invPrecision;
+			bool _valid;
+			std::string _bytes;
+		};
+
+		//Process wide cache of the shapes of representation items, keyed on their geometry without their placement
+		//Each unique shape is built once, at the origin, and meshed once when it is added. Identical items are then instances of it,
+		//a TopoDS_Shape sharing its topology and triangulation with a location for the placement of the item
+		//Shapes in the cache must not be modified, as they are shared by every instance
+		class XbimShapeCache
+		{
+		public:
+			static XbimShapeCache& Default();
+			XbimShapeCache();
+			~XbimShapeCache();
+			//sets shape to the cached shape with the key and returns true, or returns false if there is none
+			bool Find(const XbimShapeKey& key, TopoDS_Shape& shape);
+			//meshes the shape and adds it to the cache, if an identical shape was added first by another thread that one is returned
+			//and should be used in place of shape, so that all instances share the same topology
+			TopoDS_Shape Add(const XbimShapeKey& key, const TopoDS_Shape& shape, double deflection, double angle);
+			void Clear();
+			size_t Count();
+		private:
+			XbimShapeCache(const XbimShapeCache&);
+			XbimShapeCache& operator=(const XbimShapeCache&);
+			Standard_Mutex* _lock; //not held by value so that managed code including this does not see the platform headers
+			std::unordered_map<std::string, TopoDS_Shape> _shapes;
+		};
+	}
+}
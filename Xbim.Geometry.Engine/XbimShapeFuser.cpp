@@ -0,0 +1,213 @@
+#include "XbimShapeFuser.h"
+#include "XbimWorkStealingPool.h"
+#include <BRepAlgoAPI_Fuse.hxx>
+#include <BRepBndLib.hxx>
+#include <BRep_Builder.hxx>
+#include <Bnd_Box.hxx>
+#include <TopoDS_Compound.hxx>
+#include <TopTools_ListOfShape.hxx>
+#include <Standard_Failure.hxx>
+#include <cfloat>
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		//the shapes are kept as they are if they cannot be fused, so nothing is lost
+		static TopoDS_Shape Keep(const TopoDS_Shape& a, const TopoDS_Shape& b)
+		{
+			BRep_Builder builder;
+			TopoDS_Compound compound;
+			builder.MakeCompound(compound);
+			builder.Add(compound, a);
+			builder.Add(compound, b);
+			return compound;
+		}
+
+		static bool FusePair(const TopoDS_Shape& a, const TopoDS_Shape& b, TopoDS_Shape& result, std::string& error)
+		{
+			try
+			{
+				BRepAlgoAPI_Fuse boolOp(a, b);
+				if (boolOp.ErrorStatus() == 0)
+				{
+					result = boolOp.Shape();
+					return true;
+				}
+				error = "Error = " + std::to_string(boolOp.ErrorStatus());
+			}
+			catch (Standard_Failure& e)
+			{
+				error = e.GetMessageString();
+			}
+			result = Keep(a, b);
+			return false;
+		}
+
+		//how far apart two shapes are, the gap between their boxes and then the distance between their centres
+		//so that of the shapes a box overlaps the one most in line with it comes first
+		static void Separation(const Bnd_Box& a, const Bnd_Box& b, double& gap, double& centres)
+		{
+			if (a.IsVoid() || b.IsVoid())
+			{
+				gap = DBL_MAX;
+				centres = DBL_MAX;
+				return;
+			}
+			gap = a.Distance(b);
+			double aMin[3], aMax[3], bMin[3], bMax[3];
+			a.Get(aMin[0], aMin[1], aMin[2], aMax[0], aMax[1], aMax[2]);
+			b.Get(bMin[0], bMin[1], bMin[2], bMax[0], bMax[1], bMax[2]);
+			centres = 0;
+			for (int i = 0; i < 3; i++)
+			{
+				double d = (aMin[i] + aMax[i] - bMin[i] - bMax[i]) / 2;
+				centres += d * d;
+			}
+		}
+
+		//orders the shapes so that each is followed by the nearest of those not yet paired,
+		//a fuse of shapes far apart only makes a compound and leaves the intersections for the next level
+		static void PairByProximity(std::vector<TopoDS_Shape>& shapes, std::vector<Bnd_Box>& boxes)
+		{
+			size_t count = shapes.size();
+			std::vector<TopoDS_Shape> pairedShapes;
+			std::vector<Bnd_Box> pairedBoxes;
+			pairedShapes.reserve(count);
+			pairedBoxes.reserve(count);
+			std::vector<char> paired(count, 0);
+			for (size_t i = 0; i < count; i++)
+			{
+				if (paired[i]) continue;
+				paired[i] = 1;
+				pairedShapes.push_back(shapes[i]);
+				pairedBoxes.push_back(boxes[i]);
+				size_t nearest = count;
+				double nearestGap = DBL_MAX, nearestCentres = DBL_MAX;
+				for (size_t j = i + 1; j < count; j++)
+				{
+					if (paired[j]) continue;
+					double gap, centres;
+					Separation(boxes[i], boxes[j], gap, centres);
+					if (nearest == count || gap < nearestGap || (gap == nearestGap && centres < nearestCentres))
+					{
+						nearest = j;
+						nearestGap = gap;
+						nearestCentres = centres;
+					}
+				}
+				if (nearest == count) continue; //the odd one out
+				paired[nearest] = 1;
+				pairedShapes.push_back(shapes[nearest]);
+				pairedBoxes.push_back(boxes[nearest]);
+			}
+			shapes.swap(pairedShapes);
+			boxes.swap(pairedBoxes);
+		}
+
+		struct XbimFuseLevel
+		{
+			const std::vector<TopoDS_Shape>* shapes;
+			const std::vector<Bnd_Box>* boxes;
+			std::vector<TopoDS_Shape> results;
+			std::vector<Bnd_Box> resultBoxes;
+			std::vector<std::string> errors;
+			std::vector<char> failed;
+		};
+
+		static void FuseLevelPair(void* context, size_t i)
+		{
+			XbimFuseLevel* level = (XbimFuseLevel*)context;
+			const std::vector<TopoDS_Shape>& shapes = *level->shapes;
+			const std::vector<Bnd_Box>& boxes = *level->boxes;
+			level->resultBoxes[i] = boxes[2 * i];
+			if (2 * i + 1 < shapes.size())
+			{
+				level->failed[i] = !FusePair(shapes[2 * i], shapes[2 * i + 1], level->results[i], level->errors[i]);
+				level->resultBoxes[i].Add(boxes[2 * i + 1]); //the fuse lies within the boxes of the pair
+			}
+			else
+				level->results[i] = shapes[2 * i]; //the odd one out goes up a level
+		}
+
+		XbimShapeFuser::XbimShapeFuser(Strategy strategy) : _strategy(strategy)
+		{
+		}
+
+		size_t XbimShapeFuser::Fuse(const std::vector<TopoDS_Shape>& shapes, TopoDS_Shape& result, std::string& error, std::string& fallback) const
+		{
+			fallback.clear();
+			if (shapes.empty())
+			{
+				result.Nullify();
+				return 0;
+			}
+			if (shapes.size() == 1)
+			{
+				result = shapes[0];
+				return 0;
+			}
+#ifdef OCC_6_9_SUPPORTED
+			if (_strategy == MultiWay)
+			{
+				try
+				{
+					TopTools_ListOfShape arguments;
+					arguments.Append(shapes[0]);
+					TopTools_ListOfShape tools;
+					for (size_t i = 1; i < shapes.size(); i++)
+						tools.Append(shapes[i]);
+					BRepAlgoAPI_Fuse boolOp;
+					boolOp.SetArguments(arguments);
+					boolOp.SetTools(tools);
+					boolOp.Build();
+					if (boolOp.ErrorStatus() == 0)
+					{
+						result = boolOp.Shape();
+						return 0;
+					}
+					fallback = "Error = " + std::to_string(boolOp.ErrorStatus());
+				}
+				catch (Standard_Failure& e)
+				{
+					fallback = e.GetMessageString();
+				}
+				//a single boolean fails as a whole, fall back to fusing in pairs so that only the shapes that fail are left unfused
+			}
+#endif
+			return FuseTree(shapes, result, error);
+		}
+
+		size_t XbimShapeFuser::FuseTree(const std::vector<TopoDS_Shape>& shapes, TopoDS_Shape& result, std::string& error) const
+		{
+			size_t failures = 0;
+			std::vector<TopoDS_Shape> current(shapes);
+			std::vector<Bnd_Box> boxes(current.size());
+			for (size_t i = 0; i < current.size(); i++)
+				BRepBndLib::Add(current[i], boxes[i]);
+			while (current.size() > 1)
+			{
+				PairByProximity(current, boxes);
+				XbimFuseLevel level;
+				size_t pairs = (current.size() + 1) / 2;
+				level.shapes = &current;
+				level.boxes = &boxes;
+				level.results.resize(pairs);
+				level.resultBoxes.resize(pairs);
+				level.errors.resize(pairs);
+				level.failed.assign(pairs, 0);
+				XbimWorkStealingPool::Default().ParallelFor(pairs, FuseLevelPair, &level);
+				for (size_t i = 0; i < pairs; i++)
+				{
+					if (!level.failed[i]) continue;
+					failures++;
+					error = level.errors[i];
+				}
+				current.swap(level.results);
+				boxes.swap(level.resultBoxes);
+			}
+			result = current[0];
+			return failures;
+		}
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <TopoDS_Shape.hxx>
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		//Native union of many shapes in one call, without growing a single result by fusing the shapes into it one at a time
+		class XbimShapeFuser
+		{
+		public:
+			enum Strategy
+			{
+				//one boolean with the first shape as argument and all the others as tools, every intersection is computed once
+				MultiWay,
+				//each shape is fused with the nearest by bounding box, then pairs of the results, until one is left, each level runs in parallel
+				BalancedTree
+			};
+			XbimShapeFuser(Strategy strategy);
+			//fuses the shapes, shapes whose fuse fails are kept unchanged in a compound with the rest of the result
+			//returns the number of fuses that failed, the message of the last one is in error
+			//if a multi-way fuse fails and the shapes are fused in pairs instead, fallback holds why, otherwise it is empty
+			size_t Fuse(const std::vector<TopoDS_Shape>& shapes, TopoDS_Shape& result, std::string& error, std::string& fallback) const;
+		private:
+			Strategy _strategy;
+			size_t FuseTree(const std::vector<TopoDS_Shape>& shapes, TopoDS_Shape& result, std::string& error) const;
+		};
+	}
+}
@@ -13,6 +13,9 @@
 #include "XbimGeometryCreator.h"
 #include "XbimGeomPrim.h"
 #include "XbimOccWriter.h"
+#include "XbimShapeCache.h"
+#include "XbimSolidClassifier.h"
+#include "XbimBooleanContextCache.h"
 
 #include <TopExp.hxx>
 #include <GProp_GProps.hxx>
@@ -35,6 +38,7 @@
 #include <ShapeFix_Wire.hxx>
 
 #include <BRepAlgoAPI_Cut.hxx>
+#include <IntTools_Context.hxx>
 #include <BRepAlgoAPI_Common.hxx>
 #include <BRepAlgoAPI_Fuse.hxx>
 #include <BRepAlgoAPI_Section.hxx>
@@ -87,6 +91,165 @@ namespace Xbim
 			System::GC::SuppressFinalize(this);
 		}
 
+		//the key of the geometry of an item without its placement, the key is left invalid unless identical shapes are shared
+		//The cache is shared by every model in the process, so the precision the values are snapped to and the deflection and angle
+		//the shape is meshed at when it is added are part of the key, models that differ in them do not share shapes
+		static XbimShapeKey NewKey(IfcGeometricRepresentationItem^ item)
+		{
+			XbimModelFactors^ mf = item->ModelOf->ModelFactors;
+			XbimShapeKey key(mf->Precision);
+			if (XbimGeometryCreator::CacheIdenticalShapes)
+			{
+				key.AddExact(mf->Precision);
+				key.AddExact(mf->DeflectionTolerance);
+				key.AddExact(mf->DeflectionAngle);
+				XbimSolid::AppendItemKey(key, item, false);
+			}
+			else
+				key.Invalidate();
+			return key;
+		}
+
+		static void AppendKey(XbimShapeKey& key, IfcCartesianPoint^ p)
+		{
+			key.Add(p->X);
+			key.Add(p->Y);
+			key.Add(p->Dim == 3 ? p->Z : 0);
+		}
+
+		static void AppendKey(XbimShapeKey& key, IfcDirection^ dir)
+		{
+			key.Add(dir->X);
+			key.Add(dir->Y);
+			key.Add(dir->Dim == 3 ? dir->Z : 0);
+		}
+
+		static void AppendKey(XbimShapeKey& key, IfcAxis2Placement3D^ position)
+		{
+			AppendKey(key, position->Location);
+			key.Add(position->Axis != nullptr ? 1 : 0);
+			if (position->Axis != nullptr) AppendKey(key, position->Axis);
+			key.Add(position->RefDirection != nullptr ? 1 : 0);
+			if (position->RefDirection != nullptr) AppendKey(key, position->RefDirection);
+		}
+
+		static void AppendKey(XbimShapeKey& key, IfcFacetedBrep^ brep)
+		{
+			key.Add(brep->Outer->CfsFaces->Count);
+			for each (IfcFace^ face in brep->Outer->CfsFaces)
+			{
+				key.Add(face->Bounds->Count);
+				for each (IfcFaceBound^ bound in face->Bounds)
+				{
+					IfcPolyLoop^ loop = dynamic_cast<IfcPolyLoop^>(bound->Bound);
+					if (loop == nullptr)
+					{
+						key.Invalidate();
+						return;
+					}
+					key.Add(dynamic_cast<IfcFaceOuterBound^>(bound) != nullptr ? 1 : 0);
+					key.Add(bound->Orientation ? 1 : 0);
+					key.Add(loop->Polygon->Count);
+					for each (IfcCartesianPoint^ p in loop->Polygon)
+						AppendKey(key, p);
+				}
+			}
+		}
+
+		void XbimSolid::AppendItemKey(XbimShapeKey& key, IfcGeometricRepresentationItem^ item, bool withPlacement)
+		{
+			IfcCsgSolid^ csgSolid = dynamic_cast<IfcCsgSolid^>(item);
+			if (csgSolid != nullptr) //the solid is the primitive at its root, a boolean result is not keyed
+				item = dynamic_cast<IfcCsgPrimitive3D^>(csgSolid->TreeRootExpression);
+			IfcExtrudedAreaSolid^ extruded = dynamic_cast<IfcExtrudedAreaSolid^>(item);
+			IfcRevolvedAreaSolid^ revolved = dynamic_cast<IfcRevolvedAreaSolid^>(item);
+			IfcCsgPrimitive3D^ primitive = dynamic_cast<IfcCsgPrimitive3D^>(item);
+			IfcFacetedBrep^ brep = dynamic_cast<IfcFacetedBrep^>(item);
+			if (extruded != nullptr)
+			{
+				key.Add(1);
+				XbimWire::AppendKey(key, extruded->SweptArea);
+				AppendKey(key, extruded->ExtrudedDirection);
+				key.Add(extruded->Depth);
+				if (withPlacement) AppendKey(key, extruded->Position);
+			}
+			else if (revolved != nullptr)
+			{
+				key.Add(2);
+				XbimWire::AppendKey(key, revolved->SweptArea);
+				AppendKey(key, revolved->Axis->Location);
+				AppendKey(key, revolved->Axis->Axis);
+				key.Add(revolved->Angle);
+				if (withPlacement) AppendKey(key, revolved->Position);
+			}
+			else if (dynamic_cast<IfcBlock^>(primitive))
+			{
+				IfcBlock^ block = (IfcBlock^)primitive;
+				key.Add(3);
+				key.Add(block->XLength);
+				key.Add(block->YLength);
+				key.Add(block->ZLength);
+			}
+			else if (dynamic_cast<IfcRightCircularCylinder^>(primitive))
+			{
+				IfcRightCircularCylinder^ cylinder = (IfcRightCircularCylinder^)primitive;
+				key.Add(4);
+				key.Add(cylinder->Radius);
+				key.Add(cylinder->Height);
+			}
+			else if (dynamic_cast<IfcSphere^>(primitive))
+			{
+				key.Add(5);
+				key.Add(((IfcSphere^)primitive)->Radius);
+			}
+			else if (dynamic_cast<IfcRightCircularCone^>(primitive))
+			{
+				IfcRightCircularCone^ cone = (IfcRightCircularCone^)primitive;
+				key.Add(6);
+				key.Add(cone->BottomRadius);
+				key.Add(cone->Height);
+			}
+			else if (dynamic_cast<IfcRectangularPyramid^>(primitive))
+			{
+				IfcRectangularPyramid^ pyramid = (IfcRectangularPyramid^)primitive;
+				key.Add(7);
+				key.Add(pyramid->XLength);
+				key.Add(pyramid->YLength);
+				key.Add(pyramid->Height);
+			}
+			else if (brep != nullptr) //it has no placement
+			{
+				key.Add(8);
+				AppendKey(key, brep);
+			}
+			else
+				key.Invalidate();
+			if (primitive != nullptr && withPlacement && key.IsValid())
+				AppendKey(key, primitive->Position);
+		}
+
+		bool XbimSolid::InitInstance(const XbimShapeKey& key, const TopLoc_Location& position)
+		{
+			TopoDS_Shape shape;
+			if (!key.IsValid() || !XbimShapeCache::Default().Find(key, shape))
+				return false;
+			pSolid = new TopoDS_Solid();
+			*pSolid = TopoDS::Solid(shape.Moved(position));
+			return true;
+		}
+
+		void XbimSolid::InitShared(const XbimShapeKey& key, IfcRepresentationItem^ item, const TopoDS_Shape& solid, const TopLoc_Location& position)
+		{
+			TopoDS_Shape shape = solid;
+			if (key.IsValid()) //mesh it now, so that instances only ever read the triangulation
+			{
+				XbimModelFactors^ mf = item->ModelOf->ModelFactors;
+				shape = XbimShapeCache::Default().Add(key, solid, mf->DeflectionTolerance, mf->DeflectionAngle);
+			}
+			pSolid = new TopoDS_Solid();
+			*pSolid = TopoDS::Solid(shape.Moved(position));
+		}
+
 #pragma region Constructors
 
 		XbimSolid::XbimSolid(const TopoDS_Solid& solid)
@@ -401,6 +564,10 @@ namespace Xbim
 
 		void XbimSolid::Init(IfcExtrudedAreaSolid^ repItem)
 		{
+			XbimShapeKey key = NewKey(repItem);
+			TopLoc_Location position = XbimGeomPrim::ToLocation(repItem->Position);
+			if (InitInstance(key, position)) return;
+
 			XbimFace^ face = gcnew XbimFace(repItem->SweptArea);
 			if (face->IsValid && repItem->Depth > 0) //we have a valid face and extrusion
 			{
@@ -410,11 +577,7 @@ namespace Xbim
 				BRepPrimAPI_MakePrism prism(face, vec);
 				GC::KeepAlive(face);
 				if (prism.IsDone())
-				{
-					pSolid = new TopoDS_Solid();
-					*pSolid = TopoDS::Solid(prism.Shape());
-					pSolid->Move(XbimGeomPrim::ToLocation(repItem->Position));
-				}
+					InitShared(key, repItem, prism.Shape(), position);
 				else
 					XbimGeometryCreator::logger->WarnFormat("WS002: Invalid Solid Extrusion, could not create solid, found in Entity #{0}=IfcExtrudedAreaSolid.",
 					repItem->EntityLabel);
@@ -429,6 +592,10 @@ namespace Xbim
 
 		void XbimSolid::Init(IfcRevolvedAreaSolid^ repItem)
 		{
+			XbimShapeKey key = NewKey(repItem);
+			TopLoc_Location position = XbimGeomPrim::ToLocation(repItem->Position);
+			if (InitInstance(key, position)) return;
+
 			XbimFace^ face = gcnew XbimFace(repItem->SweptArea);
 
 			if (face->IsValid && repItem->Angle > 0) //we have a valid face and angle
@@ -441,11 +608,7 @@ namespace Xbim
 				BRepPrimAPI_MakeRevol revol(face, ax1, repItem->Angle);
 				GC::KeepAlive(face);
 				if (revol.IsDone())
-				{
-					pSolid = new TopoDS_Solid();
-					*pSolid = TopoDS::Solid(revol.Shape());
-					pSolid->Move(XbimGeomPrim::ToLocation(repItem->Position));
-				}
+					InitShared(key, repItem, revol.Shape(), position);
 				else
 					XbimGeometryCreator::logger->WarnFormat("WS003: Invalid Solid Extrusion, could not create solid, found in Entity #{0}=IfcRevolvedAreaSolid.",
 					repItem->EntityLabel);
@@ -840,39 +1003,46 @@ namespace Xbim
 
 		void XbimSolid::Init(IfcSphere^ ifcSolid)
 		{
-			gp_Ax3 	gpax3 = XbimGeomPrim::ToAx3(ifcSolid->Position);			
-			BRepPrimAPI_MakeSphere sphereMaker(gpax3.Ax2(), ifcSolid->Radius);
-			pSolid = new TopoDS_Solid();
-			*pSolid = TopoDS::Solid(sphereMaker.Shape());
+			XbimShapeKey key = NewKey(ifcSolid);
+			TopLoc_Location position = XbimGeomPrim::ToLocation(ifcSolid->Position);
+			if (InitInstance(key, position)) return;
+			BRepPrimAPI_MakeSphere sphereMaker(gp_Ax2(), ifcSolid->Radius);
+			InitShared(key, ifcSolid, sphereMaker.Shape(), position);
 		}
 
 		void XbimSolid::Init(IfcBlock^ ifcSolid)
 		{
-			gp_Ax3 	gpax3 = XbimGeomPrim::ToAx3(ifcSolid->Position);
-			BRepPrimAPI_MakeBox boxMaker(gpax3.Ax2(), ifcSolid->XLength, ifcSolid->YLength, ifcSolid->ZLength);
-			pSolid = new TopoDS_Solid();
-			*pSolid = TopoDS::Solid(boxMaker.Shape());
+			XbimShapeKey key = NewKey(ifcSolid);
+			TopLoc_Location position = XbimGeomPrim::ToLocation(ifcSolid->Position);
+			if (InitInstance(key, position)) return;
+			BRepPrimAPI_MakeBox boxMaker(gp_Ax2(), ifcSolid->XLength, ifcSolid->YLength, ifcSolid->ZLength);
+			InitShared(key, ifcSolid, boxMaker.Shape(), position);
 		}
 
 		void XbimSolid::Init(IfcRightCircularCylinder^ ifcSolid)
 		{
-			gp_Ax3 	gpax3 = XbimGeomPrim::ToAx3(ifcSolid->Position);
-			BRepPrimAPI_MakeCylinder cylinderMaker(gpax3.Ax2(), ifcSolid->Radius, ifcSolid->Height);
-			pSolid = new TopoDS_Solid();
-			*pSolid = TopoDS::Solid(cylinderMaker.Shape());
+			XbimShapeKey key = NewKey(ifcSolid);
+			TopLoc_Location position = XbimGeomPrim::ToLocation(ifcSolid->Position);
+			if (InitInstance(key, position)) return;
+			BRepPrimAPI_MakeCylinder cylinderMaker(gp_Ax2(), ifcSolid->Radius, ifcSolid->Height);
+			InitShared(key, ifcSolid, cylinderMaker.Shape(), position);
 		}
 
 		void XbimSolid::Init(IfcRightCircularCone^ ifcSolid)
 		{
-			gp_Ax3 	gpax3 = XbimGeomPrim::ToAx3(ifcSolid->Position);
-			BRepPrimAPI_MakeCone coneMaker(gpax3.Ax2(), ifcSolid->BottomRadius, 0., ifcSolid->Height);
-			pSolid = new TopoDS_Solid();
-			*pSolid = TopoDS::Solid(coneMaker.Shape());
+			XbimShapeKey key = NewKey(ifcSolid);
+			TopLoc_Location position = XbimGeomPrim::ToLocation(ifcSolid->Position);
+			if (InitInstance(key, position)) return;
+			BRepPrimAPI_MakeCone coneMaker(gp_Ax2(), ifcSolid->BottomRadius, 0., ifcSolid->Height);
+			InitShared(key, ifcSolid, coneMaker.Shape(), position);
 		}
 
 		void XbimSolid::Init(IfcRectangularPyramid^ ifcSolid)
 		{
-			
+			XbimShapeKey key = NewKey(ifcSolid);
+			TopLoc_Location position = XbimGeomPrim::ToLocation(ifcSolid->Position);
+			if (InitInstance(key, position)) return;
+
 			double xOff = ifcSolid->XLength / 2;
 			double yOff = ifcSolid->YLength / 2;
 			double precision = ifcSolid->ModelOf->ModelFactors->Precision;
@@ -944,9 +1114,7 @@ namespace Xbim
 			builder.Add(shell, efaceBlder.Face());
 
 			BRepBuilderAPI_MakeSolid solidMaker(shell);
-			pSolid = new TopoDS_Solid();
-			*pSolid = TopoDS::Solid(solidMaker.Shape());
-			Move(ifcSolid->Position);		
+			InitShared(key, ifcSolid, solidMaker.Shape(), position);
 		}
 
 		TopoDS_Face BuildTriangularFace(const TopoDS_Edge& base, const TopoDS_Vertex& l, const TopoDS_Vertex& r, const TopoDS_Vertex& t)
@@ -1136,7 +1304,16 @@ namespace Xbim
 				boolOp.SetArguments(shapeObjects);
 				boolOp.SetTools(shapeTools);
 				boolOp.SetFuzzyValue(tolerance);
+				Handle(IntTools_Context) context;
+				double tolerances = 0;
+				if (XbimGeometryCreator::CacheBooleanContexts)
+				{
+					context = XbimBooleanContextCache::Default().Acquire(this, tolerances);
+					boolOp.SetContext(context);
+				}
 				boolOp.Build();
+				//a context is only kept after a successful cut, one left part way through an exception is dropped
+				if (!context.IsNull() && boolOp.ErrorStatus() == 0) XbimBooleanContextCache::Default().Release(this, context, tolerances);
 #else
 				ShapeFix_ShapeTolerance fixTol;
 				fixTol.SetTolerance(solidCut, tolerance);
@@ -1392,6 +1569,31 @@ namespace Xbim
 				*pSolid = TopoDS::Solid(fixer.Shape());
 		}
 
+		array<bool>^ XbimSolid::ContainsPoints(IList<XbimPoint3D>^ points, double tolerance, double deflection)
+		{
+			array<bool>^ contained = gcnew array<bool>(points->Count);
+			if (!IsValid || points->Count == 0) return contained;
+			std::vector<gp_Pnt> nativePoints;
+			nativePoints.reserve(points->Count);
+			for each (XbimPoint3D point in points)
+				nativePoints.push_back(gp_Pnt(point.X, point.Y, point.Z));
+			std::vector<TopAbs_State> states;
+			try
+			{
+				XbimSolidClassifier classifier(*pSolid, deflection);
+				classifier.Classify(nativePoints, tolerance, states);
+			}
+			catch (Standard_Failure)
+			{
+				XbimGeometryCreator::logger->WarnFormat("WS033: Points could not be classified against the solid. " + gcnew String(Standard_Failure::Caught()->GetMessageString()));
+				return contained;
+			}
+			GC::KeepAlive(this);
+			for (int i = 0; i < contained->Length; i++)
+				contained[i] = states[i] == TopAbs_IN || states[i] == TopAbs_ON;
+			return contained;
+		}
+
 
 #pragma endregion
 	}
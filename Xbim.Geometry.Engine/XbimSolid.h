@@ -54,6 +54,11 @@ namespace Xbim
 			void Init(IfcRightCircularCylinder^ ifcSolid);
 			void Init(IfcRightCircularCone^ ifcSolid);
 			void Init(IfcRectangularPyramid^ ifcSolid);
+			//identical items share one shape, see XbimGeometryCreator::CacheIdenticalShapes
+			//places an instance of the shape with the key if one has been built, returns false if not
+			bool InitInstance(const XbimShapeKey& key, const TopLoc_Location& position);
+			//places the solid, built at the origin, sharing it with later identical items if the key is valid
+			void InitShared(const XbimShapeKey& key, IfcRepresentationItem^ item, const TopoDS_Shape& solid, const TopLoc_Location& position);
 #pragma endregion
 
 		public:
@@ -66,6 +71,10 @@ namespace Xbim
 			virtual bool Equals(IXbimSolid^ s);
 #pragma endregion
 
+			//adds the geometry of the item to the key of its shape, including its placement if withPlacement
+			//the key is invalidated if the item is not one that can be keyed
+			static void AppendItemKey(XbimShapeKey& key, IfcGeometricRepresentationItem^ item, bool withPlacement);
+
 #pragma region IXbimSolid Interface
 			virtual property bool IsValid{bool get() override { return pSolid != nullptr; }; }
 			virtual property  XbimGeometryObjectType GeometryType{XbimGeometryObjectType  get() override { return XbimGeometryObjectType::XbimSolidType; }; }
@@ -137,6 +146,10 @@ namespace Xbim
 			void Reverse();
 			
 			void FixTopology();
+			//returns for each point whether it is inside the solid or on its boundary within tolerance, faces with no triangulation are
+			//meshed at deflection and the triangles put in a tree once for all the points, so a point is not tested against every face
+			//the points are classified concurrently, points within the deflection of a curved face are classified exactly
+			array<bool>^ ContainsPoints(IList<XbimPoint3D>^ points, double tolerance, double deflection);
 #pragma endregion
 
 			
@@ -0,0 +1,267 @@
+#include "XbimSolidClassifier.h"
+#include "XbimWorkStealingPool.h"
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <BRepBuilderAPI_Copy.hxx>
+#include <BRepClass3d_SolidClassifier.hxx>
+#include <BRepAdaptor_Surface.hxx>
+#include <BRepBndLib.hxx>
+#include <BRep_Tool.hxx>
+#include <Bnd_Box.hxx>
+#include <Poly_Triangulation.hxx>
+#include <TColgp_Array1OfPnt.hxx>
+#include <Poly_Array1OfTriangle.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+#include <gp_Vec.hxx>
+#include <Precision.hxx>
+#include <Standard_Failure.hxx>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		//the rays are cast along these in turn until one meets no triangle at an edge or corner, they are skewed to every axis
+		//and diagonal so that a ray rarely runs along the edges of building geometry, which are mostly axis aligned
+		static const double RayDirections[3][3] = {
+			{ 0.7236067977, 0.5137431483, 0.4609817512 },
+			{ -0.3370595327, 0.8923453127, 0.3001780914 },
+			{ 0.2183818315, -0.4416661982, 0.8702873441 } };
+		static const double EdgeEpsilon = 1e-9;
+
+		static inline void Sub(const double* a, const double* b, double* r) { r[0] = a[0] - b[0]; r[1] = a[1] - b[1]; r[2] = a[2] - b[2]; }
+		static inline double Dot(const double* a, const double* b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+		static inline void Cross(const double* a, const double* b, double* r)
+		{
+			r[0] = a[1] * b[2] - a[2] * b[1];
+			r[1] = a[2] * b[0] - a[0] * b[2];
+			r[2] = a[0] * b[1] - a[1] * b[0];
+		}
+
+		//square of the distance from p to the closest point of the triangle abc
+		static double SquareDistance(const double* p, const double* a, const double* b, const double* c)
+		{
+			double ab[3], ac[3], ap[3], closest[3];
+			Sub(b, a, ab);
+			Sub(c, a, ac);
+			Sub(p, a, ap);
+			double d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+			double s, t;
+			if (d1 <= 0 && d2 <= 0) { s = 0; t = 0; }
+			else
+			{
+				double bp[3], cp[3];
+				Sub(p, b, bp);
+				Sub(p, c, cp);
+				double d3 = Dot(ab, bp), d4 = Dot(ac, bp), d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+				double va = d3 * d6 - d5 * d4, vb = d5 * d2 - d1 * d6, vc = d1 * d4 - d3 * d2;
+				if (d3 >= 0 && d4 <= d3) { s = 1; t = 0; }
+				else if (d6 >= 0 && d5 <= d6) { s = 0; t = 1; }
+				else if (vc <= 0 && d1 >= 0 && d3 <= 0) { s = d1 / (d1 - d3); t = 0; }
+				else if (vb <= 0 && d2 >= 0 && d6 <= 0) { s = 0; t = d2 / (d2 - d6); }
+				else if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) { t = (d4 - d3) / ((d4 - d3) + (d5 - d6)); s = 1 - t; }
+				else
+				{
+					double denom = 1 / (va + vb + vc);
+					s = vb * denom;
+					t = vc * denom;
+				}
+			}
+			for (int axis = 0; axis < 3; axis++)
+				closest[axis] = a[axis] + s * ab[axis] + t * ac[axis] - p[axis];
+			return Dot(closest, closest);
+		}
+
+		//1 if the ray from o along d crosses the inside of the triangle abc, 0 if it misses, -1 if it meets an edge or corner
+		//or runs in its plane, when the crossings of the triangles that share them cannot be counted reliably
+		static int Crosses(const double* o, const double* d, const double* a, const double* b, const double* c)
+		{
+			double e1[3], e2[3], p[3], s[3], q[3];
+			Sub(b, a, e1);
+			Sub(c, a, e2);
+			Cross(d, e2, p);
+			double det = Dot(e1, p);
+			Sub(o, a, s);
+			if (std::abs(det) <= EdgeEpsilon * std::sqrt(Dot(e1, e1) * Dot(e2, e2)))
+			{
+				double n[3];
+				Cross(e1, e2, n);
+				double off = Dot(s, n);
+				return off * off <= EdgeEpsilon * EdgeEpsilon * Dot(n, n) * Dot(s, s) ? -1 : 0;
+			}
+			double inv = 1 / det;
+			double u = Dot(s, p) * inv;
+			if (u < -EdgeEpsilon || u > 1 + EdgeEpsilon) return 0;
+			Cross(s, e1, q);
+			double v = Dot(d, q) * inv;
+			if (v < -EdgeEpsilon || u + v > 1 + EdgeEpsilon) return 0;
+			if (Dot(e2, q) * inv <= 0) return 0;
+			if (u < EdgeEpsilon || v < EdgeEpsilon || u + v > 1 - EdgeEpsilon) return -1;
+			return 1;
+		}
+
+		XbimSolidClassifier::XbimSolidClassifier(const TopoDS_Shape& solid, double deflection) : _solid(solid), _maxMargin(0), _exactOnly(false)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				_min[axis] = DBL_MAX;
+				_max[axis] = -DBL_MAX;
+			}
+			Bnd_Box box;
+			BRepBndLib::Add(solid, box, Standard_False);
+			if (box.IsVoid())
+			{
+				_exactOnly = true;
+				return;
+			}
+			box.Get(_min[0], _min[1], _min[2], _max[0], _max[1], _max[2]);
+			bool meshed = true;
+			for (TopExp_Explorer faceExp(solid, TopAbs_FACE); faceExp.More() && meshed; faceExp.Next())
+			{
+				TopLoc_Location loc;
+				meshed = !BRep_Tool::Triangulation(TopoDS::Face(faceExp.Current()), loc).IsNull();
+			}
+			//the solid may be shared by other items, its topology is not changed, a copy is meshed and only its triangles are kept
+			TopoDS_Shape triangulated = solid;
+			if (!meshed)
+			{
+				triangulated = BRepBuilderAPI_Copy(solid, Standard_False).Shape();
+				BRepMesh_IncrementalMesh mesh(triangulated, deflection, Standard_False, 0.5);
+			}
+
+			std::vector<Bnd_Box> boxes;
+			for (TopExp_Explorer faceExp(triangulated, TopAbs_FACE); faceExp.More(); faceExp.Next())
+			{
+				const TopoDS_Face& face = TopoDS::Face(faceExp.Current());
+				TopLoc_Location loc;
+				const Handle(Poly_Triangulation)& triangulation = BRep_Tool::Triangulation(face, loc);
+				if (triangulation.IsNull())
+				{
+					_exactOnly = true;
+					break;
+				}
+				//the triangles of a plane lie on it, those of a curved face may be as far from it as the deflection it was meshed at
+				double margin = 0;
+				if (BRepAdaptor_Surface(face, Standard_False).GetType() != GeomAbs_Plane)
+					margin = triangulation->Deflection() > 0 ? triangulation->Deflection() : deflection;
+				_maxMargin = std::max(_maxMargin, margin);
+				const TColgp_Array1OfPnt& nodes = triangulation->Nodes();
+				const Poly_Array1OfTriangle& triangles = triangulation->Triangles();
+				for (Standard_Integer t = triangles.Lower(); t <= triangles.Upper(); t++)
+				{
+					Standard_Integer n[3];
+					triangles(t).Get(n[0], n[1], n[2]);
+					gp_Pnt corners[3];
+					for (int k = 0; k < 3; k++)
+					{
+						corners[k] = nodes(n[k]);
+						if (!loc.IsIdentity()) corners[k].Transform(loc.Transformation());
+					}
+					//a triangle with no area is crossed by no ray, if kept it would make every ray that meets its box unreliable
+					if (gp_Vec(corners[0], corners[1]).Crossed(gp_Vec(corners[0], corners[2])).SquareMagnitude() == 0) continue;
+					Bnd_Box triangleBox;
+					for (int k = 0; k < 3; k++)
+					{
+						_triangles.push_back(corners[k].X());
+						_triangles.push_back(corners[k].Y());
+						_triangles.push_back(corners[k].Z());
+						triangleBox.Add(corners[k]);
+					}
+					_margins.push_back(margin);
+					boxes.push_back(triangleBox);
+				}
+			}
+			if (_exactOnly)
+			{
+				_triangles.clear();
+				_margins.clear();
+				return;
+			}
+			_tree.Build(boxes);
+		}
+
+		TopAbs_State XbimSolidClassifier::ClassifyExactly(const gp_Pnt& point, double tolerance) const
+		{
+			try
+			{
+				BRepClass3d_SolidClassifier classifier(_solid, point, tolerance);
+				return classifier.State();
+			}
+			catch (Standard_Failure)
+			{
+				return TopAbs_UNKNOWN;
+			}
+		}
+
+		TopAbs_State XbimSolidClassifier::Classify(const gp_Pnt& point, double tolerance) const
+		{
+			double tol = std::max(tolerance, Precision::Confusion());
+			double p[3] = { point.X(), point.Y(), point.Z() };
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (p[axis] < _min[axis] - tol || p[axis] > _max[axis] + tol) return TopAbs_OUT;
+			}
+			if (_exactOnly) return ClassifyExactly(point, tolerance);
+
+			//a point within the deflection of a curved face may be on the other side of its triangles from the face
+			std::vector<size_t> candidates;
+			Bnd_Box near;
+			near.Set(point);
+			near.Enlarge(_maxMargin + tol);
+			_tree.Overlapping(near, candidates);
+			bool nearCurved = false;
+			for (size_t i = 0; i < candidates.size(); i++)
+			{
+				const double* t = &_triangles[candidates[i] * 9];
+				double reach = _margins[candidates[i]] + tol;
+				if (SquareDistance(p, t, t + 3, t + 6) > reach * reach) continue;
+				if (_margins[candidates[i]] == 0) return TopAbs_ON;
+				nearCurved = true;
+			}
+			if (nearCurved) return ClassifyExactly(point, tolerance);
+
+			for (int r = 0; r < 3; r++)
+			{
+				candidates.clear();
+				_tree.Crossing(p, RayDirections[r], candidates);
+				int crossings = 0;
+				bool reliable = true;
+				for (size_t i = 0; i < candidates.size() && reliable; i++)
+				{
+					const double* t = &_triangles[candidates[i] * 9];
+					int crosses = Crosses(p, RayDirections[r], t, t + 3, t + 6);
+					if (crosses < 0)
+						reliable = false;
+					else
+						crossings += crosses;
+				}
+				if (reliable) return (crossings & 1) ? TopAbs_IN : TopAbs_OUT;
+			}
+			return ClassifyExactly(point, tolerance);
+		}
+
+		struct ClassifyPointsContext
+		{
+			const XbimSolidClassifier* Classifier;
+			const gp_Pnt* Points;
+			double Tolerance;
+			TopAbs_State* States;
+		};
+
+		static void ClassifyPoint(void* context, size_t index)
+		{
+			ClassifyPointsContext* points = (ClassifyPointsContext*)context;
+			points->States[index] = points->Classifier->Classify(points->Points[index], points->Tolerance);
+		}
+
+		void XbimSolidClassifier::Classify(const std::vector<gp_Pnt>& points, double tolerance, std::vector<TopAbs_State>& states) const
+		{
+			states.assign(points.size(), TopAbs_UNKNOWN);
+			if (points.empty()) return;
+			ClassifyPointsContext context = { this, &points[0], tolerance, &states[0] };
+			XbimWorkStealingPool::Default().ParallelFor(points.size(), ClassifyPoint, &context, 16);
+		}
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <TopoDS_Shape.hxx>
+#include <TopAbs_State.hxx>
+#include <gp_Pnt.hxx>
+#include "XbimBoxTree.h"
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		//Classifies many points against one solid, the triangles of its faces are put in a box tree once and a point is classified
+		//by the parity of the triangles a ray from it crosses, so a query only visits the branches of the tree the ray passes through
+		//Points within the deflection of a curved face, or whose rays meet an edge or corner in every direction tried, are classified
+		//exactly by BRepClass3d_SolidClassifier. Classify only reads the classifier and may be called from many threads at once
+		class XbimSolidClassifier
+		{
+		public:
+			//if a face of the solid has no triangulation a copy of it is meshed at deflection, the solid is not changed, it must be closed
+			XbimSolidClassifier(const TopoDS_Shape& solid, double deflection);
+			//returns IN, OUT or ON if the point is within tolerance of the boundary, UNKNOWN if the exact classification failed
+			TopAbs_State Classify(const gp_Pnt& point, double tolerance) const;
+			//classifies the points concurrently on the engine's work stealing pool, the state of points[i] is at states[i]
+			void Classify(const std::vector<gp_Pnt>& points, double tolerance, std::vector<TopAbs_State>& states) const;
+			size_t TriangleCount() const { return _margins.size(); }
+		private:
+			XbimSolidClassifier(const XbimSolidClassifier&);
+			XbimSolidClassifier& operator=(const XbimSolidClassifier&);
+			TopAbs_State ClassifyExactly(const gp_Pnt& point, double tolerance) const;
+			TopoDS_Shape _solid;
+			double _min[3];
+			double _max[3];
+			XbimBoxTree _tree;
+			std::vector<double> _triangles; //x, y, z of the three corners of each triangle
+			std::vector<double> _margins; //the furthest each triangle may be from its face, 0 for planar faces
+			double _maxMargin;
+			bool _exactOnly; //set if a face could not be meshed, the triangles are then not closed
+		};
+	}
+}
@@ -7,6 +7,13 @@
 #include <BRepTools.hxx>
 #include <BRep_Builder.hxx>
 #include <BRepAlgoAPI_Cut.hxx>
+#include <IntTools_Context.hxx>
+#include <BRepBndLib.hxx>
+#include <Bnd_Box.hxx>
+#include <TopoDS_Compound.hxx>
+#include "XbimBoxTree.h"
+#include "XbimBooleanContextCache.h"
+#include <vector>
 using namespace System;
 using namespace Xbim::Common;
 namespace Xbim
@@ -182,6 +189,32 @@ namespace Xbim
 			return true;
 		}
 
+		//selects the tools whose bounds overlap each argument, returns the number of tools that overlap none of them
+		static int SelectTools(const std::vector<TopoDS_Shape>& arguments, const std::vector<TopoDS_Shape>& tools, double tolerance, std::vector<std::vector<size_t>>& argumentTools)
+		{
+			std::vector<Bnd_Box> toolBoxes(tools.size());
+			for (size_t i = 0; i < tools.size(); i++)
+				BRepBndLib::Add(tools[i], toolBoxes[i], Standard_False); //the bounds of the geometry not of a mesh, which may be smaller
+			XbimBoxTree tree;
+			tree.Build(toolBoxes);
+			std::vector<bool> used(tools.size(), false);
+			int usedCount = 0;
+			argumentTools.resize(arguments.size());
+			for (size_t a = 0; a < arguments.size(); a++)
+			{
+				Bnd_Box argumentBox;
+				BRepBndLib::Add(arguments[a], argumentBox, Standard_False);
+				argumentBox.Enlarge(tolerance);
+				tree.Overlapping(argumentBox, argumentTools[a]);
+				for (std::vector<size_t>::const_iterator t = argumentTools[a].begin(); t != argumentTools[a].end(); ++t)
+				{
+					if (!used[*t]) usedCount++;
+					used[*t] = true;
+				}
+			}
+			return (int)tools.size() - usedCount;
+		}
+
 		IXbimSolidSet^ XbimSolidSet::Cut(IXbimSolidSet^ solids, double tolerance)
 		{
 			IXbimSolidSet^ toCutSolidSet = solids; //just to sort out carve exclusion, they must be all OCC solids if no carve
@@ -220,17 +253,20 @@ namespace Xbim
 					}
 				}
 				XbimFacetedSolid^ thisFacetation = XbimFacetedSolid::Merge(thisFacetationSet, tolerance);
-				XbimFacetedSolid^ toCutFacetation = XbimFacetedSolid::Merge(toCutFacetationSet, tolerance);
 				if (thisFacetation == nullptr) return XbimSolidSet::Empty;
-				if (toCutFacetation == nullptr) return this;
+				if (toCutFacetationSet->Count == 0) return this;
+				bool toCutIsValid = false;
+				for each (IXbimSolid^ solid in toCutFacetationSet)
+					toCutIsValid = toCutIsValid || solid->IsValid;
 
-				if ((thisFacetation == nullptr || !thisFacetation->IsValid) && (toCutFacetation == nullptr || !toCutFacetation->IsValid))
+				if (!thisFacetation->IsValid && !toCutIsValid)
 					return XbimSolidSet::Empty;
-				if (thisFacetation != nullptr && thisFacetation->IsValid  && toCutFacetation != nullptr && toCutFacetation->IsValid)
+				if (thisFacetation->IsValid && toCutIsValid)
 				{
-					return (IXbimSolidSet^)thisFacetation->Cut(toCutFacetation, tolerance);
+					//the tools are not merged, each is cut with only the faces near it
+					return thisFacetation->CutAll(toCutFacetationSet, tolerance);
 				}
-				if (toCutFacetation != nullptr && toCutFacetation->IsValid)
+				if (toCutIsValid)
 					return solids;
 				return this;
 			}
@@ -271,38 +307,69 @@ namespace Xbim
 
 #endif // USE_CARVE_CSG
 
+			std::vector<TopoDS_Shape> arguments;
+			for each (IXbimSolid^ iSolid in thisSolidSet)
+			{
+				XbimSolid^ solid = dynamic_cast<XbimSolid^>(iSolid);
+				if (solid != nullptr && solid->IsValid)
+					arguments.push_back(solid);
+			}
+			std::vector<TopoDS_Shape> tools;
+			for each (IXbimSolid^ iSolid in toCutSolidSet)
+			{
+				XbimSolid^ solid = dynamic_cast<XbimSolid^>(iSolid);
+				if (solid != nullptr && solid->IsValid)
+					tools.push_back(solid);
+			}
+			//tools that are nowhere near an argument are dropped before the boolean
+			std::vector<std::vector<size_t>> argumentTools;
+			int culled = SelectTools(arguments, tools, tolerance, argumentTools);
 #ifdef OCC_6_9_SUPPORTED
 			
 			String^ err = "";
 			try
 			{
-				TopTools_ListOfShape shapeTools;
-				for each (IXbimSolid^ iSolid in solids)
+				//each argument is cut with only the tools that overlap it, in the order of the tree so that they are spatially coherent
+				BRep_Builder builder;
+				TopoDS_Compound result;
+				builder.MakeCompound(result);
+				for (size_t a = 0; a < arguments.size() && err->Length == 0; a++)
 				{
-					XbimSolid^ solid = dynamic_cast<XbimSolid^>(iSolid);
-					if (solid!=nullptr)
+					if (argumentTools[a].empty())
 					{
-						shapeTools.Append(solid);
+						builder.Add(result, arguments[a]);
+						continue;
 					}
-				}
-				TopTools_ListOfShape shapeObjects;
-				for each (IXbimSolid^ iSolid in this)
-				{
-					XbimSolid^ solid = dynamic_cast<XbimSolid^>(iSolid);
-					if (solid != nullptr)
+					TopTools_ListOfShape shapeObjects;
+					shapeObjects.Append(arguments[a]);
+					TopTools_ListOfShape shapeTools;
+					for (std::vector<size_t>::const_iterator t = argumentTools[a].begin(); t != argumentTools[a].end(); ++t)
+						shapeTools.Append(tools[*t]);
+					BRepAlgoAPI_Cut boolOp;
+					boolOp.SetArguments(shapeObjects);
+					boolOp.SetTools(shapeTools);
+					boolOp.SetFuzzyValue(tolerance);
+					Handle(IntTools_Context) context;
+					double tolerances = 0;
+					if (XbimGeometryCreator::CacheBooleanContexts)
 					{
-						shapeObjects.Append(solid);
+						context = XbimBooleanContextCache::Default().Acquire(arguments[a], tolerances);
+						boolOp.SetContext(context);
 					}
+					boolOp.Build();
+					if (!context.IsNull() && boolOp.ErrorStatus() == 0) XbimBooleanContextCache::Default().Release(arguments[a], context, tolerances);
+					//BRepTools::Write(boolOp.Shape(), "d:\\s");
+					if (boolOp.ErrorStatus() == 0)
+						builder.Add(result, boolOp.Shape());
+					else
+						err = "Error = " + boolOp.ErrorStatus();
+				}
+				if (err->Length == 0)
+				{
+					XbimSolidSet^ ss = gcnew XbimSolidSet(result);
+					ss->CulledToolCount = culled;
+					return ss;
 				}
-				BRepAlgoAPI_Cut boolOp;
-				boolOp.SetArguments(shapeObjects);
-				boolOp.SetTools(shapeTools);
-				boolOp.SetFuzzyValue(tolerance);
-				boolOp.Build();
-				//BRepTools::Write(boolOp.Shape(), "d:\\s");
-				if (boolOp.ErrorStatus() == 0)
-					return gcnew XbimSolidSet(boolOp.Shape());
-				err = "Error = " + boolOp.ErrorStatus();
 			}
 			catch (Standard_Failure e)
 			{
@@ -311,53 +378,29 @@ namespace Xbim
 			XbimGeometryCreator::logger->WarnFormat("WS032: Boolean Cut operation failed. " + err);
 			return XbimSolidSet::Empty;
 #else
-
-			if (thisSolidSet->Count >_maxOpeningsToCut) //if the base shape is really complicate just give up trying
+			if (arguments.empty()) return XbimSolidSet::Empty;
+			BRep_Builder builder;
+			TopoDS_Compound toCut;
+			builder.MakeCompound(toCut);
+			std::vector<bool> used(tools.size(), false);
+			for (size_t a = 0; a < arguments.size(); a++)
 			{
-				IsSimplified = true;
-				return this;
-			}
-			XbimCompound^ thisSolid = XbimCompound::Merge(thisSolidSet, tolerance);
-			
-			XbimCompound^ toCutSolid;
-			if (thisSolid == nullptr) return XbimSolidSet::Empty;
-			bool isSimplified = false;
-			if (toCutSolidSet->Count > _maxOpeningsToCut)
-			{
-				isSimplified = true;
-				List<Tuple<double, XbimSolid^>^>^ solidsList = gcnew List<Tuple<double, XbimSolid^>^>(toCutSolidSet->Count);
-				for each (XbimSolid^ solid in toCutSolidSet)
-				{
-					solidsList->Add(gcnew Tuple<double, XbimSolid^>(solid->Volume, solid));
-				}
-				solidsList->Sort(_volumeComparer);
-				TopoDS_Compound subsetToCut;
-				BRep_Builder b;
-				b.MakeCompound(subsetToCut);
-				//int i = 0;
-				double totalVolume = this->Volume;
-				double minVolume = totalVolume * _maxOpeningVolumePercentage;
-
-				for (int i = 0; i < _maxOpeningsToCut; i++)
+				for (std::vector<size_t>::const_iterator t = argumentTools[a].begin(); t != argumentTools[a].end(); ++t)
 				{
-					if (solidsList[i]->Item1 < minVolume) break; //give up for small things
-					b.Add(subsetToCut, solidsList[i]->Item2);
+					if (used[*t]) continue;
+					used[*t] = true;
+					builder.Add(toCut, tools[*t]);
 				}
-				
-				toCutSolid = gcnew XbimCompound(subsetToCut,true, tolerance);
-				
-			}
-			else
-			{
-				toCutSolid = XbimCompound::Merge(toCutSolidSet, tolerance);
 			}
-
-			if (toCutSolid == nullptr) return this;
+			if (culled == (int)tools.size()) return this;
+			XbimCompound^ thisSolid = XbimCompound::Merge(thisSolidSet, tolerance);
+			if (thisSolid == nullptr) return XbimSolidSet::Empty;
+			XbimCompound^ toCutSolid = gcnew XbimCompound(toCut, true, tolerance);
 			XbimCompound^ result = thisSolid->Cut(toCutSolid, tolerance);
 			XbimSolidSet^ ss = gcnew XbimSolidSet(result);
 			//BRepTools::Write(result, "d:\\c");
 			GC::KeepAlive(result);
-			ss->IsSimplified = isSimplified;
+			ss->CulledToolCount = culled;
 			return ss;
 #endif
 		}
@@ -10,17 +10,6 @@ namespace Xbim
 {
 	namespace Geometry
 	{
-		private ref class VolumeComparer : IComparer<Tuple<double, XbimSolid^>^>
-		{
-		public:
-			virtual int Compare(Tuple<double, XbimSolid^>^ x, Tuple<double, XbimSolid^>^ y)
-			{
-				// Compare y and x in reverse order. 
-				return y->Item1.CompareTo(x->Item1);
-			}
-		};
-
-
 		ref class XbimSolidSet : IXbimSolidSet
 		{
 		private:
@@ -28,10 +17,8 @@ namespace Xbim
 			static XbimSolidSet^ empty = gcnew XbimSolidSet();
 			void Init(IfcBooleanResult^ boolOp);
 			void Init(XbimCompound^ comp, int label);
-			static VolumeComparer^ _volumeComparer = gcnew VolumeComparer();
-			static int _maxOpeningsToCut = 100;
-			static double _maxOpeningVolumePercentage = 0.0002;
 			bool _isSimplified = false;
+			int _culledToolCount = 0;
 			void InstanceCleanup()
 			{
 				solids = nullptr;
@@ -60,6 +47,8 @@ namespace Xbim
 
 			virtual property bool IsValid{bool get(){ return Count>0; }; }
 			virtual property bool IsSimplified{bool get(){ return _isSimplified; }; void set(bool val){ _isSimplified = val; } }
+			//the number of tools that were not used by the cut that made this set, as their bounds did not touch it
+			property int CulledToolCount{int get(){ return _culledToolCount; }; void set(int val){ _culledToolCount = val; } }
 			virtual property bool IsSet{bool get()  { return true; }; }
 			virtual property IXbimSolid^ First{IXbimSolid^ get(); }
 			virtual property int Count{int get(); }
@@ -0,0 +1,213 @@
+#include "XbimTriangulationWriter.h"
+#include <TColgp_Array1OfPnt.hxx>
+#include <Poly_Array1OfTriangle.hxx>
+#include <BRepMesh_FastDiscret.hxx>
+#include <BRepBndLib.hxx>
+#include <Bnd_Box.hxx>
+#include <OSD_Parallel.hxx>
+#include <BRep_Tool.hxx>
+#include <cstring>
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		template <typename T>
+		static inline void Put(unsigned char*& pos, T value)
+		{
+			memcpy(pos, &value, sizeof(T));
+			pos += sizeof(T);
+		}
+
+		//the same encoding as XbimOccShape::WriteIndex
+		static inline void PutIndex(unsigned char*& pos, unsigned int index, size_t indexSize)
+		{
+			if (indexSize == 1)
+				*pos++ = (unsigned char)index;
+			else if (indexSize == 2)
+				Put(pos, (unsigned short)index);
+			else
+				Put(pos, index);
+		}
+
+		//packed normals are written U then V, as XbimPackedNormal::Write does
+		static inline void PutNormal(unsigned char*& pos, unsigned short packedNormal)
+		{
+			*pos++ = (unsigned char)(packedNormal >> 8);
+			*pos++ = (unsigned char)(packedNormal & 0xFF);
+		}
+
+		XbimTriangulationWriter::XbimTriangulationWriter(double tolerance, size_t expectedFaces) :
+			_welder(tolerance, expectedFaces * 3), _triangleCount(0)
+		{
+			_faces.reserve(expectedFaces);
+			_nodeLookup.reserve(expectedFaces * 3);
+		}
+
+		void XbimTriangulationWriter::MeshFaces(const TopoDS_Shape& shape, const std::vector<TopoDS_Face>& faces, double deflection, double angle, bool inParallel)
+		{
+			//faces of shared shapes are meshed when they are cached, they are left as they are as other threads may be reading them
+			std::vector<TopoDS_Face> unmeshed;
+			unmeshed.reserve(faces.size());
+			for (std::vector<TopoDS_Face>::const_iterator face = faces.begin(); face != faces.end(); ++face)
+			{
+				TopLoc_Location loc;
+				const Handle_Poly_Triangulation& mesh = BRep_Tool::Triangulation(*face, loc);
+				if (mesh.IsNull() || mesh->Deflection() >= 1.1 * deflection) //the same test BRepMesh_IncrementalMesh makes
+					unmeshed.push_back(*face);
+			}
+			if (unmeshed.empty()) return;
+			if (!inParallel)
+			{
+				//each face has a mesher of its own, as it always has, so the default output is unchanged
+				for (std::vector<TopoDS_Face>::const_iterator face = unmeshed.begin(); face != unmeshed.end(); ++face)
+				{
+					Bnd_Box faceBox;
+					BRepBndLib::Add(*face, faceBox);
+					BRepMesh_FastDiscret faceMesher(*face, deflection, angle, faceBox, Standard_True);
+				}
+				return;
+			}
+			Bnd_Box shapeBox;
+			BRepBndLib::Add(shape, shapeBox);
+			BRepMesh_FastDiscret mesher(deflection, angle, shapeBox, Standard_True, Standard_False, Standard_False, Standard_False, Standard_True);
+			mesher.InitSharedFaces(shape);
+			for (std::vector<TopoDS_Face>::const_iterator face = unmeshed.begin(); face != unmeshed.end(); ++face)
+				mesher.Add(*face); //discretises the edges, this must be done serially
+			OSD_Parallel::ForEach(unmeshed.begin(), unmeshed.end(), mesher);
+		}
+
+		unsigned short* XbimTriangulationWriter::AddFace(const Handle_Poly_Triangulation& mesh, const TopLoc_Location& loc, bool reversed)
+		{
+			Face face;
+			face.mesh = mesh;
+			face.reversed = reversed;
+			face.normal = 0;
+			face.lookupStart = _nodeLookup.size();
+			face.normalStart = _nodeNormals.size();
+			face.elementStart = _elements.size();
+			face.triangleCount = mesh->NbTriangles();
+			_faces.push_back(face);
+			_triangleCount += face.triangleCount;
+
+			const TColgp_Array1OfPnt& nodes = mesh->Nodes();
+			const gp_Trsf& trsf = loc.Transformation();
+			bool transform = !loc.IsIdentity();
+			for (Standard_Integer i = nodes.Lower(); i <= nodes.Upper(); i++)
+			{
+				gp_XYZ p = nodes.Value(i).XYZ();
+				if (transform) trsf.Transforms(p);
+				_nodeLookup.push_back((unsigned int)_welder.Weld(p.X(), p.Y(), p.Z()));
+			}
+			_nodeNormals.resize(face.normalStart + nodes.Length());
+			return _nodeNormals.data() + face.normalStart;
+		}
+
+		void XbimTriangulationWriter::BeginPlanarFace(unsigned short packedNormal)
+		{
+			Face face;
+			face.reversed = false;
+			face.normal = packedNormal;
+			face.lookupStart = _nodeLookup.size();
+			face.normalStart = _nodeNormals.size();
+			face.elementStart = _elements.size();
+			face.triangleCount = 0;
+			_faces.push_back(face);
+		}
+
+		void XbimTriangulationWriter::AddVertex(double x, double y, double z)
+		{
+			_nodeLookup.push_back((unsigned int)_welder.Weld(x, y, z));
+		}
+
+		void XbimTriangulationWriter::EndPlanarFace(const int* elements, int triangleCount)
+		{
+			Face& face = _faces.back();
+			face.triangleCount = triangleCount;
+			_elements.insert(_elements.end(), elements, elements + triangleCount * 3);
+			_triangleCount += triangleCount;
+		}
+
+		void XbimTriangulationWriter::AddPlanarFace(unsigned short packedNormal, const XbimPlanarTessellator& tessellator, size_t tessellation)
+		{
+			BeginPlanarFace(packedNormal);
+			const double* vertices = tessellator.Vertices(tessellation);
+			for (size_t i = 0; i < tessellator.VertexCount(tessellation); i++, vertices += 3)
+				AddVertex(vertices[0], vertices[1], vertices[2]);
+			EndPlanarFace(tessellator.Elements(tessellation), (int)tessellator.TriangleCount(tessellation));
+		}
+
+		size_t XbimTriangulationWriter::IndexSize() const
+		{
+			size_t maxInt = _welder.Count();
+			if (maxInt <= 0xFF) return 1;
+			if (maxInt <= 0xFFFF) return 2;
+			return 4;
+		}
+
+		size_t XbimTriangulationWriter::StreamSize() const
+		{
+			size_t indexSize = IndexSize();
+			size_t size = 1 + 4 + 4; //version, vertex and triangle counts
+			size += _welder.Count() * 3 * sizeof(float);
+			size += 4; //face count
+			for (std::vector<Face>::const_iterator face = _faces.begin(); face != _faces.end(); ++face)
+			{
+				size += 4; //triangle count
+				size_t indexCount = (size_t)face->triangleCount * 3;
+				if (face->mesh.IsNull())
+					size += 2 + indexCount * indexSize; //one normal for the face
+				else
+					size += indexCount * (indexSize + 2); //a normal per index
+			}
+			return size;
+		}
+
+		size_t XbimTriangulationWriter::Write(unsigned char* buffer) const
+		{
+			unsigned char* pos = buffer;
+			size_t numVertices = _welder.Count();
+			size_t indexSize = IndexSize();
+			Put(pos, (unsigned char)1); //stream format version
+			Put(pos, (unsigned int)numVertices);
+			Put(pos, (unsigned int)_triangleCount);
+			const double* coords = _welder.Coordinates().data();
+			for (size_t i = 0; i < numVertices * 3; i++)
+				Put(pos, (float)coords[i]);
+
+			Put(pos, (int)_faces.size());
+			for (std::vector<Face>::const_iterator face = _faces.begin(); face != _faces.end(); ++face)
+			{
+				const unsigned int* lookup = _nodeLookup.data() + face->lookupStart;
+				if (face->mesh.IsNull()) //planar, one normal and then the indices
+				{
+					Put(pos, face->triangleCount);
+					PutNormal(pos, face->normal);
+					const int* elements = _elements.data() + face->elementStart;
+					for (int i = 0; i < face->triangleCount * 3; i++)
+						PutIndex(pos, lookup[elements[i]], indexSize);
+				}
+				else //use negative count to indicate that every index has a normal
+				{
+					Put(pos, -face->triangleCount);
+					const unsigned short* normals = _nodeNormals.data() + face->normalStart;
+					const Poly_Array1OfTriangle& triangles = face->mesh->Triangles();
+					Standard_Integer t[3];
+					for (Standard_Integer i = triangles.Lower(); i <= triangles.Upper(); i++)
+					{
+						if (face->reversed) //get nodes in the correct order of triangulation
+							triangles(i).Get(t[2], t[1], t[0]);
+						else
+							triangles(i).Get(t[0], t[1], t[2]);
+						for (int j = 0; j < 3; j++)
+						{
+							PutIndex(pos, lookup[t[j] - 1], indexSize);
+							PutNormal(pos, normals[t[j] - 1]);
+						}
+					}
+				}
+			}
+			return pos - buffer;
+		}
+	}
+}
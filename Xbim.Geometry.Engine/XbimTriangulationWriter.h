@@ -0,0 +1,62 @@
+#pragma once
+#include "XbimVertexWelder.h"
+#include "XbimPlanarTessellator.h"
+#include <Poly_Triangulation.hxx>
+#include <TopLoc_Location.hxx>
+#include <TopoDS_Shape.hxx>
+#include <TopoDS_Face.hxx>
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		//Native writer for the binary triangulation stream (stream format version 1)
+		//Faces are added first, which welds their vertices and sizes the stream exactly, then the whole stream is written
+		//in one pass in to a contiguous buffer supplied by the caller (a pinned managed array, a memory stream's buffer or a mapped file)
+		//Triangles of meshed faces are not copied, they are read directly from the face's Poly_Triangulation when the stream is written
+		class XbimTriangulationWriter
+		{
+		public:
+			XbimTriangulationWriter(double tolerance, size_t expectedFaces = 16);
+			//meshes the given faces of shape, by default each face is meshed on its own. If inParallel the edges are discretised once
+			//in face order, so that faces sharing them stay watertight, and the faces are then triangulated concurrently. The two
+			//meshes differ, but each is the same from run to run
+			static void MeshFaces(const TopoDS_Shape& shape, const std::vector<TopoDS_Face>& faces, double deflection, double angle, bool inParallel);
+			//adds a face meshed by OCC and returns a slot for the packed normal of each node of the mesh, the caller must fill these before the next face is added
+			unsigned short* AddFace(const Handle_Poly_Triangulation& mesh, const TopLoc_Location& loc, bool reversed);
+			//adds a planar face, call AddVertex for each of its vertices and then EndPlanarFace with its triangles
+			void BeginPlanarFace(unsigned short packedNormal);
+			void AddVertex(double x, double y, double z);
+			//elements are indices in to the vertices added since BeginPlanarFace, 3 per triangle
+			void EndPlanarFace(const int* elements, int triangleCount);
+			//adds a planar face triangulated by the native tessellator
+			void AddPlanarFace(unsigned short packedNormal, const XbimPlanarTessellator& tessellator, size_t tessellation);
+			size_t VertexCount() const { return _welder.Count(); }
+			size_t TriangleCount() const { return _triangleCount; }
+			size_t FaceCount() const { return _faces.size(); }
+			//the exact number of bytes Write will emit
+			size_t StreamSize() const;
+			//writes the stream to buffer, which must hold at least StreamSize() bytes, returns the number of bytes written
+			size_t Write(unsigned char* buffer) const;
+		private:
+			struct Face
+			{
+				Handle_Poly_Triangulation mesh; //null for planar faces
+				bool reversed;
+				unsigned short normal; //the normal of a planar face
+				size_t lookupStart; //first entry of the face in _nodeLookup
+				size_t normalStart; //first entry of the face in _nodeNormals
+				size_t elementStart; //first entry of the face in _elements
+				int triangleCount;
+			};
+			XbimVertexWelder _welder;
+			std::vector<Face> _faces;
+			std::vector<unsigned int> _nodeLookup; //welded vertex index of each face node
+			std::vector<unsigned short> _nodeNormals; //packed normal of each node of meshed faces
+			std::vector<int> _elements; //triangle indices of planar faces
+			size_t _triangleCount;
+
+			size_t IndexSize() const;
+		};
+	}
+}
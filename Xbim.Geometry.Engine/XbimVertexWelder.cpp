@@ -0,0 +1,131 @@
+#include "XbimVertexWelder.h"
+#include <cmath>
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		XbimVertexWelder::XbimVertexWelder(double tolerance, size_t expectedVertices)
+		{
+			_tolerance = tolerance > 0 ? tolerance : 0;
+			_toleranceSq = _tolerance * _tolerance;
+			double cellSize = _tolerance > 0 ? _tolerance * 10. : 1.; //coursen up, with no tolerance only identical points weld
+			_invCellSize = 1. / cellSize;
+			_occupied = 0;
+			Reserve(expectedVertices);
+		}
+
+		void XbimVertexWelder::Reserve(size_t vertexCount)
+		{
+			_coords.reserve(vertexCount * 3);
+			_chain.reserve(vertexCount);
+			size_t cellCapacity = 16;
+			while (cellCapacity < vertexCount * 2) cellCapacity <<= 1; //keep the load factor below a half
+			if (cellCapacity > _cells.size())
+				Rehash(cellCapacity);
+		}
+
+		void XbimVertexWelder::Clear()
+		{
+			_coords.clear();
+			_chain.clear();
+			for (size_t i = 0; i < _cells.size(); i++)
+				_cells[i].head = EmptyCell;
+			_occupied = 0;
+		}
+
+		int64_t XbimVertexWelder::Quantize(double v) const
+		{
+			return (int64_t)std::floor(v * _invCellSize);
+		}
+
+		size_t XbimVertexWelder::Slot(int64_t x, int64_t y, int64_t z) const
+		{
+			uint64_t h = (uint64_t)x * 0x9E3779B97F4A7C15ULL;
+			h ^= (uint64_t)y * 0xC2B2AE3D27D4EB4FULL;
+			h ^= (uint64_t)z * 0x165667B19E3779F9ULL;
+			h ^= h >> 29;
+			size_t mask = _cells.size() - 1;
+			size_t slot = (size_t)h & mask;
+			while (true) //linear probe, there is always an empty slot as the table is never more than half full
+			{
+				const Cell& cell = _cells[slot];
+				if (cell.head == EmptyCell || (cell.x == x && cell.y == y && cell.z == z))
+					return slot;
+				slot = (slot + 1) & mask;
+			}
+		}
+
+		size_t XbimVertexWelder::Search(double x, double y, double z) const
+		{
+			//find the range of cells that a sphere of radius tolerance around the point touches, normally just one
+			int64_t x0 = Quantize(x - _tolerance), x1 = Quantize(x + _tolerance);
+			int64_t y0 = Quantize(y - _tolerance), y1 = Quantize(y + _tolerance);
+			int64_t z0 = Quantize(z - _tolerance), z1 = Quantize(z + _tolerance);
+			size_t found = NotFound;
+			for (int64_t cx = x0; cx <= x1; cx++)
+				for (int64_t cy = y0; cy <= y1; cy++)
+					for (int64_t cz = z0; cz <= z1; cz++)
+					{
+						const Cell& cell = _cells[Slot(cx, cy, cz)];
+						for (uint32_t i = cell.head; i != EmptyCell; i = _chain[i])
+						{
+							if (i >= found) continue; //we always return the first vertex added so results do not depend on probe order
+							const double* p = &_coords[(size_t)i * 3];
+							double d = 0, dd;
+							dd = x - p[0]; d += dd * dd;
+							dd = y - p[1]; d += dd * dd;
+							dd = z - p[2]; d += dd * dd;
+							if (d <= _toleranceSq) found = i;
+						}
+					}
+			return found;
+		}
+
+		size_t XbimVertexWelder::Find(double x, double y, double z) const
+		{
+			if (!std::isfinite(x) || !std::isfinite(y) || !std::isfinite(z)) return NotFound;
+			return Search(x, y, z);
+		}
+
+		size_t XbimVertexWelder::Weld(double x, double y, double z)
+		{
+			size_t index = _chain.size();
+			if (!std::isfinite(x) || !std::isfinite(y) || !std::isfinite(z)) //never equal to anything, keep it but do not index it
+			{
+				_coords.push_back(x); _coords.push_back(y); _coords.push_back(z);
+				_chain.push_back((uint32_t)EmptyCell);
+				return index;
+			}
+			size_t found = Search(x, y, z);
+			if (found != NotFound) return found;
+
+			if ((_occupied + 1) * 2 > _cells.size())
+				Rehash(_cells.size() * 2);
+			_coords.push_back(x); _coords.push_back(y); _coords.push_back(z);
+			int64_t cx = Quantize(x), cy = Quantize(y), cz = Quantize(z);
+			Cell& cell = _cells[Slot(cx, cy, cz)];
+			if (cell.head == EmptyCell)
+			{
+				cell.x = cx; cell.y = cy; cell.z = cz;
+				_occupied++;
+			}
+			_chain.push_back(cell.head);
+			cell.head = (uint32_t)index;
+			return index;
+		}
+
+		void XbimVertexWelder::Rehash(size_t cellCapacity)
+		{
+			std::vector<Cell> old;
+			old.swap(_cells);
+			Cell empty = { 0, 0, 0, EmptyCell };
+			_cells.assign(cellCapacity, empty);
+			for (size_t i = 0; i < old.size(); i++)
+			{
+				if (old[i].head == EmptyCell) continue;
+				_cells[Slot(old[i].x, old[i].y, old[i].z)] = old[i];
+			}
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		//Native vertex welder, merges points that lie within tolerance of each other in to a single indexed vertex
+		//Points are quantized on to a grid of 10 * tolerance (the same grid XbimPoint3DWithTolerance::GetHashCode snaps to)
+		//the occupied cells are held in a flat open addressed hash table and the vertices of a cell are chained through an index array
+		//Neighbouring cells are only probed when a point lies within tolerance of a cell boundary, so points that are
+		//within tolerance but fall either side of a grid line are still welded. No allocation is made per vertex
+		class XbimVertexWelder
+		{
+		public:
+			static const size_t NotFound = (size_t)-1;
+			XbimVertexWelder(double tolerance, size_t expectedVertices = 64);
+			//returns the index of the vertex within tolerance of the point, a new vertex is added if there is none
+			size_t Weld(double x, double y, double z);
+			//returns the index of the vertex within tolerance of the point or NotFound
+			size_t Find(double x, double y, double z) const;
+			//ensures the welder can hold vertexCount vertices without growing
+			void Reserve(size_t vertexCount);
+			//removes all vertices but retains the capacity for reuse
+			void Clear();
+			size_t Count() const { return _chain.size(); }
+			double Tolerance() const { return _tolerance; }
+			//the coordinates of the welded vertices, 3 per vertex in the order they were added
+			const std::vector<double>& Coordinates() const { return _coords; }
+			const double* Point(size_t index) const { return &_coords[index * 3]; }
+		private:
+			static const uint32_t EmptyCell = 0xFFFFFFFF;
+			struct Cell
+			{
+				int64_t x, y, z;
+				uint32_t head; //index of the most recently added vertex in this cell, EmptyCell if the slot is unused
+			};
+			double _tolerance;
+			double _toleranceSq;
+			double _invCellSize;
+			size_t _occupied;
+			std::vector<Cell> _cells; //size is always a power of 2
+			std::vector<uint32_t> _chain; //next vertex in the same cell
+			std::vector<double> _coords;
+
+			int64_t Quantize(double v) const;
+			size_t Slot(int64_t x, int64_t y, int64_t z) const;
+			size_t Search(double x, double y, double z) const;
+			void Rehash(size_t cellCapacity);
+		};
+	}
+}
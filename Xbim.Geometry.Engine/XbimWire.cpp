@@ -1093,6 +1093,154 @@ namespace Xbim
 #pragma endregion
 
 #pragma region Parameterised profiles
+
+		static void AppendPositionKey(XbimShapeKey& key, IfcAxis2Placement2D^ position)
+		{
+			if (position == nullptr)
+			{
+				key.Add(0);
+				return;
+			}
+			key.Add(1);
+			key.Add(position->Location->X);
+			key.Add(position->Location->Y);
+			key.Add(position->P[0].X);
+			key.Add(position->P[0].Y);
+		}
+
+		template <typename T>
+		static void AppendOptionalKey(XbimShapeKey& key, Nullable<T> value)
+		{
+			key.Add(value.HasValue ? 1 : 0);
+			if (value.HasValue) key.Add((double)value.Value);
+		}
+
+		void XbimWire::AppendKey(XbimShapeKey& key, IfcProfileDef^ profile)
+		{
+			//the level of detail decides whether fillets are built
+			key.Add(profile->ModelOf->ModelFactors->ProfileDefLevelOfDetail);
+			if (dynamic_cast<IfcArbitraryClosedProfileDef^>(profile) && !dynamic_cast<IfcArbitraryProfileDefWithVoids^>(profile))
+			{
+				IfcPolyline^ pLine = dynamic_cast<IfcPolyline^>(((IfcArbitraryClosedProfileDef^)profile)->OuterCurve);
+				if (pLine == nullptr) return key.Invalidate();
+				key.Add(1);
+				key.Add(pLine->Points->Count);
+				for each (IfcCartesianPoint^ p in pLine->Points)
+				{
+					key.Add(p->X);
+					key.Add(p->Y);
+					key.Add(p->Dim == 3 ? p->Z : 0);
+				}
+				return;
+			}
+			IfcParameterizedProfileDef^ parameterized = dynamic_cast<IfcParameterizedProfileDef^>(profile);
+			if (parameterized == nullptr) return key.Invalidate();
+			AppendPositionKey(key, (IfcAxis2Placement2D^)parameterized->Position);
+			if (dynamic_cast<IfcRectangleHollowProfileDef^>(profile))
+			{
+				IfcRectangleHollowProfileDef^ rect = (IfcRectangleHollowProfileDef^)profile;
+				key.Add(2);
+				key.Add(rect->XDim);
+				key.Add(rect->YDim);
+				key.Add(rect->WallThickness);
+			}
+			else if (dynamic_cast<IfcRectangleProfileDef^>(profile))
+			{
+				IfcRectangleProfileDef^ rect = (IfcRectangleProfileDef^)profile;
+				key.Add(3);
+				key.Add(rect->XDim);
+				key.Add(rect->YDim);
+			}
+			else if (dynamic_cast<IfcCircleHollowProfileDef^>(profile))
+			{
+				IfcCircleHollowProfileDef^ circ = (IfcCircleHollowProfileDef^)profile;
+				key.Add(4);
+				key.Add(circ->Radius);
+				key.Add(circ->WallThickness);
+			}
+			else if (dynamic_cast<IfcCircleProfileDef^>(profile))
+			{
+				key.Add(5);
+				key.Add(((IfcCircleProfileDef^)profile)->Radius);
+			}
+			else if (dynamic_cast<IfcEllipseProfileDef^>(profile))
+			{
+				IfcEllipseProfileDef^ ellipse = (IfcEllipseProfileDef^)profile;
+				key.Add(6);
+				key.Add(ellipse->SemiAxis1);
+				key.Add(ellipse->SemiAxis2);
+			}
+			else if (dynamic_cast<IfcIShapeProfileDef^>(profile))
+			{
+				IfcIShapeProfileDef^ shape = (IfcIShapeProfileDef^)profile;
+				key.Add(7);
+				key.Add(shape->OverallWidth);
+				key.Add(shape->OverallDepth);
+				key.Add(shape->WebThickness);
+				key.Add(shape->FlangeThickness);
+				AppendOptionalKey(key, shape->FilletRadius);
+			}
+			else if (dynamic_cast<IfcLShapeProfileDef^>(profile))
+			{
+				IfcLShapeProfileDef^ shape = (IfcLShapeProfileDef^)profile;
+				key.Add(8);
+				key.Add(shape->Depth);
+				AppendOptionalKey(key, shape->Width);
+				key.Add(shape->Thickness);
+				AppendOptionalKey(key, shape->FilletRadius);
+				AppendOptionalKey(key, shape->EdgeRadius);
+				AppendOptionalKey(key, shape->LegSlope);
+			}
+			else if (dynamic_cast<IfcUShapeProfileDef^>(profile))
+			{
+				IfcUShapeProfileDef^ shape = (IfcUShapeProfileDef^)profile;
+				key.Add(9);
+				key.Add(shape->Depth);
+				key.Add(shape->FlangeWidth);
+				key.Add(shape->WebThickness);
+				key.Add(shape->FlangeThickness);
+				AppendOptionalKey(key, shape->FilletRadius);
+				AppendOptionalKey(key, shape->EdgeRadius);
+				AppendOptionalKey(key, shape->FlangeSlope);
+			}
+			else if (dynamic_cast<IfcCShapeProfileDef^>(profile))
+			{
+				IfcCShapeProfileDef^ shape = (IfcCShapeProfileDef^)profile;
+				key.Add(10);
+				key.Add(shape->Depth);
+				key.Add(shape->Width);
+				key.Add(shape->WallThickness);
+				key.Add(shape->Girth);
+				AppendOptionalKey(key, shape->InternalFilletRadius);
+			}
+			else if (dynamic_cast<IfcTShapeProfileDef^>(profile))
+			{
+				IfcTShapeProfileDef^ shape = (IfcTShapeProfileDef^)profile;
+				key.Add(11);
+				key.Add(shape->Depth);
+				key.Add(shape->FlangeWidth);
+				key.Add(shape->WebThickness);
+				key.Add(shape->FlangeThickness);
+				AppendOptionalKey(key, shape->FilletRadius);
+				AppendOptionalKey(key, shape->FlangeEdgeRadius);
+				AppendOptionalKey(key, shape->WebEdgeRadius);
+				AppendOptionalKey(key, shape->WebSlope);
+				AppendOptionalKey(key, shape->FlangeSlope);
+			}
+			else if (dynamic_cast<IfcZShapeProfileDef^>(profile))
+			{
+				IfcZShapeProfileDef^ shape = (IfcZShapeProfileDef^)profile;
+				key.Add(12);
+				key.Add(shape->Depth);
+				key.Add(shape->FlangeWidth);
+				key.Add(shape->WebThickness);
+				key.Add(shape->FlangeThickness);
+				AppendOptionalKey(key, shape->FilletRadius);
+				AppendOptionalKey(key, shape->EdgeRadius);
+			}
+			else //crane rails and any others are rare enough not to be worth keying
+				key.Invalidate();
+		}
 
 		void XbimWire::Init(IfcProfileDef ^ profile)
 		{
@@ -1,6 +1,7 @@
 #pragma once
 #include "XbimOccShape.h"
 #include "XbimVertex.h"
+#include "XbimShapeCache.h"
 #include <TopoDS_Wire.hxx>
 #include <gp_Pnt.hxx>
 #include <vector>
@@ -143,6 +144,9 @@ namespace Xbim
 			static bool operator !=(XbimWire^ left, XbimWire^ right);
 			virtual bool Equals(IXbimWire^ v);
 #pragma endregion
+			//adds the geometry of the profile, including its position, to the key of a shape built from it
+			//the key is invalidated if the profile is not one that can be keyed
+			static void AppendKey(XbimShapeKey& key, IfcProfileDef^ profile);
 
 			//properties
 property bool IsReversed{bool get(){ return IsValid && pWire->Orientation() == TopAbs_REVERSED; }; }
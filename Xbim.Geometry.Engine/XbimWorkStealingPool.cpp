@@ -0,0 +1,214 @@
+#include "XbimWorkStealingPool.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#define XBIM_THREAD_LOCAL __declspec(thread)
+#else
+#define XBIM_THREAD_LOCAL __thread
+#endif
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		//set while a thread is running the body of a loop, loops started from a body then run serially
+		static XBIM_THREAD_LOCAL bool inLoop = false;
+
+		struct XbimWorkStealingPool::Impl
+		{
+			//the part of the range a thread has still to run, the owner takes from the front and thieves from the back
+			struct Share
+			{
+				std::mutex lock;
+				size_t begin;
+				size_t end;
+			};
+			std::vector<std::thread> workers;
+			std::vector<Share> shares; //one per worker, the last is the calling thread's
+			std::mutex loopLock; //held by the thread running a loop
+			std::mutex stateLock;
+			std::condition_variable started;
+			std::condition_variable finished;
+			unsigned long long generation;
+			size_t running; //workers still in the current loop
+			bool stopping;
+			Body body;
+			void* context;
+			size_t grain;
+
+			Impl(size_t workerCount) : shares(workerCount + 1), generation(0), running(0), stopping(false), body(0), context(0), grain(1)
+			{
+				for (size_t i = 0; i < shares.size(); i++)
+					shares[i].begin = shares[i].end = 0;
+				workers.reserve(workerCount);
+				for (size_t i = 0; i < workerCount; i++)
+					workers.push_back(std::thread(&Impl::Worker, this, i));
+			}
+
+			~Impl()
+			{
+				{
+					std::lock_guard<std::mutex> state(stateLock);
+					stopping = true;
+				}
+				started.notify_all();
+				for (size_t i = 0; i < workers.size(); i++)
+					workers[i].join();
+			}
+
+			void Worker(size_t self)
+			{
+				unsigned long long seen = 0;
+				for (;;)
+				{
+					{
+						std::unique_lock<std::mutex> state(stateLock);
+						while (!stopping && generation == seen)
+							started.wait(state);
+						if (stopping) return;
+						seen = generation;
+					}
+					Run(self);
+					std::lock_guard<std::mutex> state(stateLock);
+					if (--running == 0)
+						finished.notify_one();
+				}
+			}
+
+			//takes the next chunk from the thread's own share
+			bool Take(size_t self, size_t& begin, size_t& end)
+			{
+				Share& share = shares[self];
+				std::lock_guard<std::mutex> lock(share.lock);
+				if (share.begin >= share.end) return false;
+				begin = share.begin;
+				end = std::min(share.end, begin + grain);
+				share.begin = end;
+				return true;
+			}
+
+			//moves the back half of the largest share to the thread's own, returns false when there is nothing left to steal
+			bool Steal(size_t self)
+			{
+				for (;;)
+				{
+					size_t victim = self;
+					size_t largest = 0;
+					for (size_t i = 0; i < shares.size(); i++)
+					{
+						if (i == self) continue;
+						size_t remaining;
+						{
+							std::lock_guard<std::mutex> lock(shares[i].lock);
+							remaining = shares[i].end - shares[i].begin;
+						}
+						if (remaining > largest)
+						{
+							largest = remaining;
+							victim = i;
+						}
+					}
+					if (victim == self) return false;
+					size_t begin, end;
+					{
+						std::lock_guard<std::mutex> lock(shares[victim].lock);
+						Share& share = shares[victim];
+						if (share.begin >= share.end) continue; //the owner or another thief has since taken it
+						size_t remaining = share.end - share.begin;
+						begin = remaining > grain ? share.begin + remaining / 2 : share.begin;
+						end = share.end;
+						share.end = begin;
+					}
+					std::lock_guard<std::mutex> lock(shares[self].lock);
+					shares[self].begin = begin;
+					shares[self].end = end;
+					return true;
+				}
+			}
+
+			void Run(size_t self)
+			{
+				inLoop = true;
+				size_t begin, end;
+				do
+				{
+					while (Take(self, begin, end))
+					{
+						for (size_t i = begin; i < end; i++)
+							body(context, i);
+					}
+				} while (Steal(self));
+				inLoop = false;
+			}
+		};
+
+		XbimWorkStealingPool& XbimWorkStealingPool::Default()
+		{
+			static std::once_flag created;
+			static XbimWorkStealingPool* pool = 0;
+			//never deleted, joining the workers while the module is unloaded would deadlock
+			std::call_once(created, []()
+			{
+				unsigned int hardwareThreads = std::thread::hardware_concurrency();
+				pool = new XbimWorkStealingPool(hardwareThreads > 1 ? hardwareThreads - 1 : 0);
+			});
+			return *pool;
+		}
+
+		XbimWorkStealingPool::XbimWorkStealingPool(size_t workerCount) : _impl(new Impl(workerCount))
+		{
+		}
+
+		XbimWorkStealingPool::~XbimWorkStealingPool()
+		{
+			delete _impl;
+		}
+
+		size_t XbimWorkStealingPool::Concurrency() const
+		{
+			return _impl->shares.size();
+		}
+
+		void XbimWorkStealingPool::ParallelFor(size_t count, Body body, void* context, size_t grain)
+		{
+			if (count == 0) return;
+			if (grain == 0) grain = 1;
+			Impl& impl = *_impl;
+			std::unique_lock<std::mutex> loop(impl.loopLock, std::defer_lock);
+			if (impl.workers.empty() || count <= grain || inLoop || !loop.try_lock())
+			{
+				bool nested = inLoop;
+				inLoop = true;
+				for (size_t i = 0; i < count; i++)
+					body(context, i);
+				inLoop = nested;
+				return;
+			}
+			//the workers are all idle, so the shares can be set without taking their locks
+			size_t participants = impl.shares.size();
+			for (size_t i = 0; i < participants; i++)
+			{
+				impl.shares[i].begin = count * i / participants;
+				impl.shares[i].end = count * (i + 1) / participants;
+			}
+			impl.body = body;
+			impl.context = context;
+			impl.grain = grain;
+			{
+				std::lock_guard<std::mutex> state(impl.stateLock);
+				impl.running = impl.workers.size();
+				impl.generation++;
+			}
+			impl.started.notify_all();
+			impl.Run(participants - 1);
+			//every chunk is owned by a thread that runs it before leaving the loop, so the loop is done when all threads have left it
+			std::unique_lock<std::mutex> state(impl.stateLock);
+			while (impl.running > 0)
+				impl.finished.wait(state);
+		}
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+
+namespace Xbim
+{
+	namespace Geometry
+	{
+		//Native pool of worker threads that run loops over an index range, the work is balanced by stealing
+		//Each thread taking part starts with an equal share of the range and takes grain sized chunks from the front of it, a thread
+		//that runs out steals the back half of the largest share left, so a few expensive items do not leave the other threads idle
+		//The threads are created once and kept, this header does not include the standard thread library so that managed code can use
+		//the pool, the body of a loop may be a managed function, it is called on native threads and must not throw
+		class XbimWorkStealingPool
+		{
+		public:
+			typedef void(*Body)(void* context, size_t index);
+			//the pool shared by the engine, created on first use with a worker for each hardware thread other than the caller's
+			static XbimWorkStealingPool& Default();
+			XbimWorkStealingPool(size_t workerCount);
+			~XbimWorkStealingPool();
+			//the number of threads that run a loop, the workers and the calling thread
+			size_t Concurrency() const;
+			//calls body(context, i) for each i in [0, count) and returns when all have completed, the calling thread takes part
+			//loops started from within a body, or while the pool is running a loop for another thread, are run serially by the caller
+			void ParallelFor(size_t count, Body body, void* context, size_t grain = 1);
+		private:
+			struct Impl;
+			Impl* _impl;
+			XbimWorkStealingPool(const XbimWorkStealingPool&);
+			XbimWorkStealingPool& operator=(const XbimWorkStealingPool&);
+		};
+	}
+}
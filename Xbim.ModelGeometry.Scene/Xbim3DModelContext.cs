@@ -330,9 +330,9 @@ namespace Xbim.ModelGeometry.Scene
 
         public static readonly ILogger Logger = LoggerFactory.GetLogger();
         private readonly IfcRepresentationContextCollection _contexts;
-        private IXbimGeometryCreator _Engine;
+        private XbimGeometryEngine _Engine;
 
-        private IXbimGeometryCreator Engine
+        private XbimGeometryEngine Engine
         {
             get
             {
@@ -1064,6 +1064,10 @@ namespace Xbim.ModelGeometry.Scene
                             {
                                 shapeGeom = xbimTessellator.Mesh(shape);
                             }
+                            else if (!isFeatureElementShape) //the geometry is not needed later, so its mesh may come from the engine's mesh cache
+                            {
+                                shapeGeom = Engine.CreateShapeGeometry(shape, precision, deflection, deflectionAngle, geomStorageType);
+                            }
                             else //we need to create a geometry object
                             {
                                 geomModel = Engine.Create(shape);